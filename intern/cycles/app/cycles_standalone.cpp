@@ -53,8 +53,31 @@ struct Options {
   bool quiet;
   bool show_help, interactive, pause;
   string output_path;
+  int frame_start, frame_end, frame;
+  double sync_time, render_start_time;
 } options;
 
+static bool use_frame_range()
+{
+  return options.frame_end >= options.frame_start;
+}
+
+/* Replace the last sequence of # in the path with the current frame number. */
+static string frame_path(const string &path)
+{
+  size_t end = path.find_last_of('#');
+
+  if (!use_frame_range() || end == string::npos)
+    return path;
+
+  size_t start = path.find_last_not_of('#', end);
+  start = (start == string::npos) ? 0 : start + 1;
+
+  const int digits = (int)(end - start + 1);
+  return path.substr(0, start) + string_printf("%0*d", digits, options.frame) +
+         path.substr(end + 1);
+}
+
 static void session_print(const string &str)
 {
   /* print with carriage return to overwrite previous */
@@ -90,16 +113,17 @@ static void session_print_status()
 
 static bool write_render(const uchar *pixels, int w, int h, int channels)
 {
-  string msg = string_printf("Writing image %s", options.output_path.c_str());
+  string output_path = frame_path(options.output_path);
+  string msg = string_printf("Writing image %s", output_path.c_str());
   session_print(msg);
 
-  unique_ptr<ImageOutput> out = unique_ptr<ImageOutput>(ImageOutput::create(options.output_path));
+  unique_ptr<ImageOutput> out = unique_ptr<ImageOutput>(ImageOutput::create(output_path));
   if (!out) {
     return false;
   }
 
   ImageSpec spec(w, h, channels, TypeDesc::UINT8);
-  if (!out->open(options.output_path, spec)) {
+  if (!out->open(output_path, spec)) {
     return false;
   }
 
@@ -123,13 +147,8 @@ static BufferParams &session_buffer_params()
   return buffer_params;
 }
 
-static void scene_init()
+static void scene_camera_init()
 {
-  options.scene = new Scene(options.scene_params, options.session->device);
-
-  /* Read XML */
-  xml_read_file(options.scene, options.filepath.c_str());
-
   /* Camera width/height override? */
   if (!(options.width == 0 || options.height == 0)) {
     options.scene->camera->width = options.width;
@@ -144,6 +163,42 @@ static void scene_init()
   options.scene->camera->compute_auto_viewplane();
 }
 
+static void scene_init()
+{
+  scoped_timer sync_timer(&options.sync_time);
+
+  options.scene = new Scene(options.scene_params, options.session->device);
+
+  /* Read XML */
+  xml_read_file(options.scene, frame_path(options.filepath).c_str());
+
+  /* Keep a BVH per mesh, so following frames only rebuild the top level BVH for moved objects
+   * and refit the BVH of deformed meshes. */
+  if (use_frame_range())
+    options.scene->params.bvh_type = SceneParams::BVH_DYNAMIC;
+
+  scene_camera_init();
+}
+
+static void scene_update()
+{
+  scoped_timer sync_timer(&options.sync_time);
+
+  /* Update XML, the session thread is not running between frames */
+  xml_update_file(options.scene, frame_path(options.filepath).c_str());
+
+  scene_camera_init();
+}
+
+static void session_start()
+{
+  options.scene->update_times.clear();
+  options.render_start_time = time_dt();
+
+  options.session->reset(session_buffer_params(), options.session_params.samples);
+  options.session->start();
+}
+
 static void session_init()
 {
   options.session_params.write_render_cb = write_render;
@@ -160,8 +215,50 @@ static void session_init()
   scene_init();
   options.session->scene = options.scene;
 
-  options.session->reset(session_buffer_params(), options.session_params.samples);
-  options.session->start();
+  session_start();
+}
+
+static void session_print_frame_times()
+{
+  /* Scene device update runs in the session thread, as part of the render. */
+  const SceneUpdateTimes &times = options.scene->update_times;
+  double render_time = time_dt() - options.render_start_time - times.total;
+
+  string str = string_printf("Frame %d: sync %.3fs, BVH %.3fs, render %.3fs",
+                             options.frame,
+                             options.sync_time + times.total - times.bvh,
+                             times.bvh,
+                             max(render_time, 0.0));
+
+  if (options.quiet) {
+    printf("%s\n", str.c_str());
+  }
+  else {
+    session_print(str);
+    printf("\n");
+  }
+}
+
+static void session_render_frames()
+{
+  /* Render all frames with the same session, keeping the device, kernels and scene data which
+   * did not change between frames. */
+  while (true) {
+    options.session->wait();
+    session_print_frame_times();
+    options.session->write_render();
+
+    if (options.frame == options.frame_end || options.session->progress.get_cancel() ||
+        options.session->progress.get_error()) {
+      break;
+    }
+
+    options.frame++;
+    scene_update();
+
+    options.session->progress.reset();
+    session_start();
+  }
 }
 
 static void session_exit()
@@ -369,6 +466,9 @@ static void options_parse(int argc, const char **argv)
   options.filepath = "";
   options.session = NULL;
   options.quiet = false;
+  options.frame_start = 0;
+  options.frame_end = -1;
+  options.sync_time = 0.0;
 
   /* device names */
   string device_names = "";
@@ -416,6 +516,10 @@ static void options_parse(int argc, const char **argv)
              "--output %s",
              &options.output_path,
              "File path to write output image",
+             "--frames %d %d",
+             &options.frame_start,
+             &options.frame_end,
+             "Render frames from start to end, # in file and output paths is the frame number",
              "--threads %d",
              &options.session_params.threads,
              "CPU Rendering Threads",
@@ -492,6 +596,8 @@ static void options_parse(int argc, const char **argv)
   options.session_params.background = true;
 #endif
 
+  options.frame = options.frame_start;
+
   /* Use progressive rendering */
   options.session_params.progressive = true;
 
@@ -529,6 +635,15 @@ static void options_parse(int argc, const char **argv)
     fprintf(stderr, "No file path specified\n");
     exit(EXIT_FAILURE);
   }
+  else if (use_frame_range() && !options.session_params.background) {
+    fprintf(stderr, "Frame range can only be rendered in background\n");
+    exit(EXIT_FAILURE);
+  }
+  else if (use_frame_range() && options.output_path != "" &&
+           options.output_path.find('#') == string::npos) {
+    fprintf(stderr, "Output path for frame range must contain # for the frame number\n");
+    exit(EXIT_FAILURE);
+  }
 
   /* For smoother Viewport */
   options.session_params.start_resolution = 64;
@@ -548,7 +663,10 @@ int main(int argc, const char **argv)
   if (options.session_params.background) {
 #endif
     session_init();
-    options.session->wait();
+    if (use_frame_range())
+      session_render_frames();
+    else
+      options.session->wait();
     session_exit();
 #ifdef WITH_CYCLES_STANDALONE_GUI
   }
@@ -48,17 +48,32 @@
 
 CCL_NAMESPACE_BEGIN
 
+/* XML update state
+ *
+ * When updating a scene for a new frame, meshes and lights are matched to the
+ * ones of the previous frame in order of appearance. */
+
+struct XMLUpdateState {
+  size_t num_meshes; /* meshes read so far */
+  size_t num_lights; /* lights read so far */
+
+  XMLUpdateState() : num_meshes(0), num_lights(0)
+  {
+  }
+};
+
 /* XML reading state */
 
 struct XMLReadState : public XMLReader {
-  Scene *scene;      /* scene pointer */
-  Transform tfm;     /* current transform state */
-  bool smooth;       /* smooth normal state */
-  Shader *shader;    /* current shader */
-  string base;       /* base path to current file*/
-  float dicing_rate; /* current dicing rate */
-
-  XMLReadState() : scene(NULL), smooth(false), shader(NULL), dicing_rate(1.0f)
+  Scene *scene;           /* scene pointer */
+  Transform tfm;          /* current transform state */
+  bool smooth;            /* smooth normal state */
+  Shader *shader;         /* current shader */
+  string base;            /* base path to current file*/
+  float dicing_rate;      /* current dicing rate */
+  XMLUpdateState *update; /* update of an existing scene, NULL when creating it */
+
+  XMLReadState() : scene(NULL), smooth(false), shader(NULL), dicing_rate(1.0f), update(NULL)
   {
     tfm = transform_identity();
   }
@@ -184,11 +199,28 @@ static bool xml_equal_string(xml_node node, const char *name, const char *value)
   return false;
 }
 
+/* Film, Integrator and Background Settings */
+
+template<typename T> static void xml_read_settings(XMLReadState &state, T *settings, xml_node node)
+{
+  if (!state.update) {
+    xml_read_node(state, settings, node);
+    return;
+  }
+
+  T prev_settings = *settings;
+  xml_read_node(state, settings, node);
+
+  if (settings->modified(prev_settings))
+    settings->tag_update(state.scene);
+}
+
 /* Camera */
 
 static void xml_read_camera(XMLReadState &state, xml_node node)
 {
   Camera *cam = state.scene->camera;
+  Camera prevcam = *cam;
 
   xml_read_int(&cam->width, node, "width");
   xml_read_int(&cam->height, node, "height");
@@ -200,6 +232,13 @@ static void xml_read_camera(XMLReadState &state, xml_node node)
 
   cam->matrix = state.tfm;
 
+  if (state.update) {
+    /* Camera is updated along with the scene on the device. */
+    if (cam->modified(prevcam))
+      cam->tag_update();
+    return;
+  }
+
   cam->need_update = true;
   cam->update(state.scene);
 }
@@ -363,7 +402,11 @@ static void xml_read_shader(XMLReadState &state, xml_node node)
 static void xml_read_background(XMLReadState &state, xml_node node)
 {
   /* Background Settings */
-  xml_read_node(state, state.scene->background, node);
+  xml_read_settings(state, state.scene->background, node);
+
+  /* Shaders are not updated, the ones of the first frame are kept. */
+  if (state.update)
+    return;
 
   /* Background Shader */
   Shader *shader = state.scene->default_background;
@@ -387,24 +430,20 @@ static Mesh *xml_add_mesh(Scene *scene, const Transform &tfm)
   return mesh;
 }
 
-static void xml_read_mesh(const XMLReadState &state, xml_node node)
+static void xml_read_mesh_data(const XMLReadState &state,
+                               Mesh *mesh,
+                               xml_node node,
+                               const vector<float3> &P,
+                               vector<int> &verts,
+                               const vector<int> &nverts)
 {
-  /* add mesh */
-  Mesh *mesh = xml_add_mesh(state.scene, state.tfm);
   mesh->used_shaders.push_back(state.shader);
 
   /* read state */
   int shader = 0;
   bool smooth = state.smooth;
 
-  /* read vertices and polygons */
-  vector<float3> P;
   vector<float> UV;
-  vector<int> verts, nverts;
-
-  xml_read_float3_array(P, node, "P");
-  xml_read_int_array(verts, node, "verts");
-  xml_read_int_array(nverts, node, "nverts");
 
   if (xml_equal_string(node, "subdivision", "catmull-clark")) {
     mesh->subdivision_type = Mesh::SUBDIVISION_CATMULL_CLARK;
@@ -529,16 +568,173 @@ static void xml_read_mesh(const XMLReadState &state, xml_node node)
   }
 }
 
+static bool xml_mesh_topology_equals(const XMLReadState &state,
+                                     const Mesh *mesh,
+                                     xml_node node,
+                                     const vector<int> &verts,
+                                     const vector<int> &nverts)
+{
+  if (mesh->subdivision_type != Mesh::SUBDIVISION_NONE ||
+      xml_equal_string(node, "subdivision", "catmull-clark") ||
+      xml_equal_string(node, "subdivision", "linear")) {
+    /* Tessellation may change with the vertices, always rebuild. */
+    return false;
+  }
+
+  if (mesh->used_shaders.size() != 1 || mesh->used_shaders[0] != state.shader) {
+    return false;
+  }
+
+  if (mesh->smooth.size() && mesh->smooth[0] != state.smooth) {
+    return false;
+  }
+
+  size_t num_triangles = 0;
+  for (size_t i = 0; i < nverts.size(); i++)
+    num_triangles += nverts[i] - 2;
+
+  if (num_triangles != mesh->num_triangles()) {
+    return false;
+  }
+
+  int index_offset = 0;
+  size_t triangle = 0;
+
+  for (size_t i = 0; i < nverts.size(); i++) {
+    for (int j = 0; j < nverts[i] - 2; j++, triangle++) {
+      const Mesh::Triangle t = mesh->get_triangle(triangle);
+
+      if (t.v[0] != verts[index_offset] || t.v[1] != verts[index_offset + j + 1] ||
+          t.v[2] != verts[index_offset + j + 2]) {
+        return false;
+      }
+    }
+
+    index_offset += nverts[i];
+  }
+
+  /* UVs are stored per triangle corner, compare them as well. */
+  vector<float> UV;
+  Attribute *attr = mesh->attributes.find(ATTR_STD_UV);
+
+  if (xml_read_float_array(UV, node, "UV")) {
+    if (!attr) {
+      return false;
+    }
+
+    const float2 *fdata = attr->data_float2();
+    index_offset = 0;
+
+    for (size_t i = 0; i < nverts.size(); i++) {
+      for (int j = 0; j < nverts[i] - 2; j++) {
+        const int v[3] = {index_offset, index_offset + j + 1, index_offset + j + 2};
+
+        for (int k = 0; k < 3; k++, fdata++) {
+          if (fdata->x != UV[v[k] * 2] || fdata->y != UV[v[k] * 2 + 1]) {
+            return false;
+          }
+        }
+      }
+
+      index_offset += nverts[i];
+    }
+  }
+  else if (attr) {
+    return false;
+  }
+
+  return true;
+}
+
+static void xml_read_mesh(const XMLReadState &state, xml_node node)
+{
+  Scene *scene = state.scene;
+
+  /* read vertices and polygons */
+  vector<float3> P;
+  vector<int> verts, nverts;
+
+  xml_read_float3_array(P, node, "P");
+  xml_read_int_array(verts, node, "verts");
+  xml_read_int_array(nverts, node, "nverts");
+
+  if (!state.update || state.update->num_meshes == scene->objects.size()) {
+    /* add mesh */
+    Mesh *mesh = xml_add_mesh(scene, state.tfm);
+    xml_read_mesh_data(state, mesh, node, P, verts, nverts);
+
+    if (state.update) {
+      mesh->tag_update(scene, true);
+      scene->objects.back()->tag_update(scene);
+      state.update->num_meshes++;
+    }
+    return;
+  }
+
+  /* Update mesh of the previous frame. Meshes which only moved keep their BVH, meshes which
+   * only deformed have it refit, rather than rebuilt. */
+  Object *object = scene->objects[state.update->num_meshes++];
+  Mesh *mesh = object->mesh;
+
+  if (!(object->tfm == state.tfm)) {
+    object->tfm = state.tfm;
+    object->tag_update(scene);
+  }
+
+  if (!xml_mesh_topology_equals(state, mesh, node, verts, nverts)) {
+    mesh->clear();
+    xml_read_mesh_data(state, mesh, node, P, verts, nverts);
+    mesh->tag_update(scene, true);
+    return;
+  }
+
+  if (P.size() == mesh->verts.size() && std::equal(P.begin(), P.end(), mesh->verts.data())) {
+    return;
+  }
+
+  mesh->verts = P;
+
+  /* Normals are computed again on device update. */
+  mesh->attributes.remove(ATTR_STD_FACE_NORMAL);
+  mesh->attributes.remove(ATTR_STD_VERTEX_NORMAL);
+  mesh->attributes.remove(ATTR_STD_POSITION_UNDISPLACED);
+
+  Attribute *attr = mesh->attributes.find(ATTR_STD_GENERATED);
+  if (attr) {
+    memcpy(attr->data_float3(), mesh->verts.data(), sizeof(float3) * mesh->verts.size());
+  }
+
+  mesh->tag_update(scene, false);
+}
+
 /* Light */
 
 static void xml_read_light(XMLReadState &state, xml_node node)
 {
+  if (state.update && state.update->num_lights < state.scene->lights.size()) {
+    /* Update light of the previous frame. */
+    Light *light = state.scene->lights[state.update->num_lights++];
+    Light prevlight = *light;
+
+    light->shader = state.shader;
+    xml_read_node(state, light, node);
+
+    if (!light->equals(prevlight))
+      light->tag_update(state.scene);
+    return;
+  }
+
   Light *light = new Light();
 
   light->shader = state.shader;
   xml_read_node(state, light, node);
 
   state.scene->lights.push_back(light);
+
+  if (state.update) {
+    light->tag_update(state.scene);
+    state.update->num_lights++;
+  }
 }
 
 /* Transform */
@@ -611,16 +807,18 @@ static void xml_read_scene(XMLReadState &state, xml_node scene_node)
 {
   for (xml_node node = scene_node.first_child(); node; node = node.next_sibling()) {
     if (string_iequals(node.name(), "film")) {
-      xml_read_node(state, state.scene->film, node);
+      xml_read_settings(state, state.scene->film, node);
     }
     else if (string_iequals(node.name(), "integrator")) {
-      xml_read_node(state, state.scene->integrator, node);
+      xml_read_settings(state, state.scene->integrator, node);
     }
     else if (string_iequals(node.name(), "camera")) {
       xml_read_camera(state, node);
     }
     else if (string_iequals(node.name(), "shader")) {
-      xml_read_shader(state, node);
+      /* Shaders are not updated, the ones of the first frame are kept. */
+      if (!state.update)
+        xml_read_shader(state, node);
     }
     else if (string_iequals(node.name(), "background")) {
       xml_read_background(state, node);
@@ -696,4 +894,42 @@ void xml_read_file(Scene *scene, const char *filepath)
   scene->params.bvh_type = SceneParams::BVH_STATIC;
 }
 
+void xml_update_file(Scene *scene, const char *filepath)
+{
+  XMLReadState state;
+  XMLUpdateState update;
+
+  state.scene = scene;
+  state.tfm = transform_identity();
+  state.shader = scene->default_surface;
+  state.smooth = false;
+  state.dicing_rate = 1.0f;
+  state.base = path_dirname(filepath);
+  state.update = &update;
+
+  xml_read_include(state, path_filename(filepath));
+
+  /* Remove meshes and lights which are not in the file anymore. */
+  if (update.num_meshes < scene->objects.size()) {
+    for (size_t i = update.num_meshes; i < scene->objects.size(); i++) {
+      delete scene->objects[i]->mesh;
+      delete scene->objects[i];
+    }
+
+    scene->objects.resize(update.num_meshes);
+    scene->meshes.resize(update.num_meshes);
+    scene->mesh_manager->tag_update(scene);
+    scene->object_manager->tag_update(scene);
+  }
+
+  if (update.num_lights < scene->lights.size()) {
+    for (size_t i = update.num_lights; i < scene->lights.size(); i++) {
+      delete scene->lights[i];
+    }
+
+    scene->lights.resize(update.num_lights);
+    scene->light_manager->tag_update(scene);
+  }
+}
+
 CCL_NAMESPACE_END
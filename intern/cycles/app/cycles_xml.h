@@ -23,6 +23,10 @@ class Scene;
 
 void xml_read_file(Scene *scene, const char *filepath);
 
+/* Update a scene read with xml_read_file() from the file of another frame. Only the data that
+ * changed is tagged for update, shaders are kept from the first file. */
+void xml_update_file(Scene *scene, const char *filepath);
+
 /* macros for importing */
 #define RAD2DEGF(_rad) ((_rad) * (float)(180.0 / M_PI))
 #define DEG2RADF(_deg) ((_deg) * (float)(M_PI / 180.0))
@@ -100,7 +100,12 @@ int BVHStackEntry::encodeIdx() const
 /* BVH */
 
 BVH::BVH(const BVHParams &params_, const vector<Mesh *> &meshes_, const vector<Object *> &objects_)
-    : params(params_), meshes(meshes_), objects(objects_)
+    : params(params_),
+      meshes(meshes_),
+      objects(objects_),
+      build_sah_cost(0.0f),
+      sah_cost(0.0f),
+      refit_sah(0.0f)
 {
 }
 
@@ -185,6 +190,8 @@ void BVH::build(Progress &progress, Stats *)
   progress.set_substatus("Packing BVH nodes");
   pack_nodes(root);
 
+  build_sah_cost = sah_cost = root->computeSubtreeSAHCost(params);
+
   /* free build nodes */
   root->deleteSubtree();
 }
@@ -200,9 +207,26 @@ void BVH::refit(Progress &progress)
     return;
 
   progress.set_substatus("Refitting BVH nodes");
+  refit_sah = 0.0f;
   refit_nodes();
 }
 
+bool BVH::need_rebuild() const
+{
+  return sah_cost > build_sah_cost * params.max_refit_sah_cost_ratio;
+}
+
+void BVH::refit_sah_add(const BoundBox &bbox, int num_children, int num_primitives)
+{
+  refit_sah += bbox.safe_area() * params.cost(num_children, num_primitives);
+}
+
+void BVH::refit_sah_finish(const BoundBox &root_bbox)
+{
+  const float root_area = root_bbox.safe_area();
+  sah_cost = (root_area > 0.0f) ? refit_sah / root_area : build_sah_cost;
+}
+
 void BVH::refit_primitives(int start, int end, BoundBox &bbox, uint &visibility)
 {
   /* Refit range of primitives. */
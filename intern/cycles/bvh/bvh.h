@@ -87,6 +87,11 @@ class BVH {
   vector<Mesh *> meshes;
   vector<Object *> objects;
 
+  /* SAH cost relative to the root bounds, after build and after the last refit.
+   * Zero when not computed for the BVH layout. */
+  float build_sah_cost;
+  float sah_cost;
+
   static BVH *create(const BVHParams &params,
                      const vector<Mesh *> &meshes,
                      const vector<Object *> &objects);
@@ -101,12 +106,22 @@ class BVH {
 
   void refit(Progress &progress);
 
+  /* Refit degraded the tree too much, a rebuild gives faster rendering. */
+  bool need_rebuild() const;
+
  protected:
   BVH(const BVHParams &params, const vector<Mesh *> &meshes, const vector<Object *> &objects);
 
   /* Refit range of primitives. */
   void refit_primitives(int start, int end, BoundBox &bbox, uint &visibility);
 
+  /* Accumulate SAH cost of a refit node, and compute the total from the root
+   * bounds once all nodes are refit. */
+  void refit_sah_add(const BoundBox &bbox, int num_children, int num_primitives);
+  void refit_sah_finish(const BoundBox &root_bbox);
+
+  float refit_sah;
+
   /* triangles and strands */
   void pack_primitives();
   void pack_triangle(int idx, float4 storage[3]);
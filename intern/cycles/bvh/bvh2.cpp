@@ -242,6 +242,7 @@ void BVH2::refit_nodes()
   BoundBox bbox = BoundBox::empty;
   uint visibility = 0;
   refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility);
+  refit_sah_finish(bbox);
 }
 
 void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
@@ -254,6 +255,7 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     const int c1 = data[0].y;
 
     BVH::refit_primitives(c0, c1, bbox, visibility);
+    refit_sah_add(bbox, 0, c1 - c0);
 
     /* TODO(sergey): De-duplicate with pack_leaf(). */
     float4 leaf_data[BVH_NODE_LEAF_SIZE];
@@ -289,6 +291,7 @@ void BVH2::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     bbox.grow(bbox0);
     bbox.grow(bbox1);
     visibility = visibility0 | visibility1;
+    refit_sah_add(bbox, 2, 0);
   }
 }
 
@@ -380,6 +380,7 @@ void BVH4::refit_nodes()
   BoundBox bbox = BoundBox::empty;
   uint visibility = 0;
   refit_node(0, (pack.root_index == -1) ? true : false, bbox, visibility);
+  refit_sah_finish(bbox);
 }
 
 void BVH4::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
@@ -390,6 +391,7 @@ void BVH4::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
     int4 c = data[0];
 
     BVH::refit_primitives(c.x, c.y, bbox, visibility);
+    refit_sah_add(bbox, 0, c.y - c.x);
 
     /* TODO(sergey): This is actually a copy of pack_leaf(),
      * but this chunk of code only knows actual data and has
@@ -432,6 +434,8 @@ void BVH4::refit_node(int idx, bool leaf, BoundBox &bbox, uint &visibility)
       }
     }
 
+    refit_sah_add(bbox, num_nodes, 0);
+
     if (is_unaligned) {
       Transform aligned_space[4] = {
           transform_identity(), transform_identity(), transform_identity(), transform_identity()};
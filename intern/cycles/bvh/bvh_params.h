@@ -56,6 +56,10 @@ class BVHParams {
   float sah_node_cost;
   float sah_primitive_cost;
 
+  /* Refitting keeps the tree topology, which gets less efficient as primitives
+   * move. Rebuild when refit increased the SAH cost by more than this factor. */
+  float max_refit_sah_cost_ratio;
+
   /* number of primitives in leaf */
   int min_leaf_size;
   int max_triangle_leaf_size;
@@ -110,6 +114,8 @@ class BVHParams {
     sah_node_cost = 1.0f;
     sah_primitive_cost = 1.0f;
 
+    max_refit_sah_cost_ratio = 1.5f;
+
     min_leaf_size = 1;
     max_triangle_leaf_size = 8;
     max_motion_triangle_leaf_size = 8;
@@ -38,6 +38,7 @@
 #include "util/util_logging.h"
 #include "util/util_progress.h"
 #include "util/util_set.h"
+#include "util/util_time.h"
 
 #ifdef WITH_EMBREE
 #  include "bvh/bvh_embree.h"
@@ -1079,15 +1080,25 @@ void Mesh::compute_bvh(
     vector<Object *> objects;
     objects.push_back(&object);
 
-    if (bvh && !need_update_rebuild) {
+    bool rebuild = !bvh || need_update_rebuild;
+
+    if (!rebuild) {
       progress->set_status(msg, "Refitting BVH");
 
       bvh->meshes = meshes;
       bvh->objects = objects;
 
       bvh->refit(*progress);
+
+      /* Deformation made the refit tree too slow to traverse. */
+      if (bvh->need_rebuild()) {
+        VLOG(2) << "Rebuilding BVH of mesh " << name << ", SAH cost increased from "
+                << bvh->build_sah_cost << " to " << bvh->sah_cost << " by refit.";
+        rebuild = true;
+      }
     }
-    else {
+
+    if (rebuild) {
       progress->set_status(msg, "Building BVH");
 
       BVHParams bparams;
@@ -2304,6 +2315,7 @@ void MeshManager::device_update(Device *device,
       return;
   }
 
+  scoped_timer bvh_timer;
   TaskPool pool;
 
   size_t i = 0;
@@ -2338,6 +2350,7 @@ void MeshManager::device_update(Device *device,
     return;
 
   device_update_bvh(device, dscene, scene, progress);
+  scene->update_times.bvh += bvh_timer.get_time();
   if (progress.get_cancel())
     return;
 
@@ -196,6 +196,28 @@ class SceneParams {
   }
 };
 
+/* Scene Update Times
+ *
+ * Time spent updating the scene on the device, accumulated over all updates
+ * since the last clear(). Used to report timings per frame. */
+
+class SceneUpdateTimes {
+ public:
+  double total;
+  double bvh;
+
+  SceneUpdateTimes()
+  {
+    clear();
+  }
+
+  void clear()
+  {
+    total = 0.0;
+    bvh = 0.0;
+  }
+};
+
 /* Scene */
 
 class Scene {
@@ -241,6 +263,9 @@ class Scene {
   /* parameters */
   SceneParams params;
 
+  /* timings */
+  SceneUpdateTimes update_times;
+
   /* mutex must be locked manually by callers */
   thread_mutex mutex;
 
@@ -86,6 +86,7 @@ Session::Session(const SessionParams &params_)
   gpu_need_display_buffer_update = false;
   pause = false;
   kernels_loaded = false;
+  write_render_pending = false;
 
   /* TODO(sergey): Check if it's indeed optimal value for the split kernel. */
   max_closure_global = 1;
@@ -109,18 +110,9 @@ Session::~Session()
     wait();
   }
 
-  if (params.write_render_cb) {
-    /* Copy to display buffer and write out image if requested */
-    delete display;
-
-    display = new DisplayBuffer(device, false);
-    display->reset(buffers->params);
-    copy_to_display_buffer(params.samples);
-
-    int w = display->draw_width;
-    int h = display->draw_height;
-    uchar4 *pixels = display->rgba_byte.copy_from_device(0, w, h);
-    params.write_render_cb((uchar *)pixels, w, h, 4);
+  if (params.write_render_cb && write_render_pending) {
+    /* Write out image if requested and not done already */
+    write_render();
   }
 
   /* clean up */
@@ -134,6 +126,23 @@ Session::~Session()
   TaskScheduler::exit();
 }
 
+void Session::write_render()
+{
+  /* Copy to display buffer and write out image. */
+  delete display;
+
+  display = new DisplayBuffer(device, false);
+  display->reset(buffers->params);
+  copy_to_display_buffer(params.samples);
+
+  int w = display->draw_width;
+  int h = display->draw_height;
+  uchar4 *pixels = display->rgba_byte.copy_from_device(0, w, h);
+  params.write_render_cb((uchar *)pixels, w, h, 4);
+
+  write_render_pending = false;
+}
+
 void Session::start()
 {
   if (!session_thread) {
@@ -792,6 +801,8 @@ void Session::run()
 
   profiler.stop();
 
+  write_render_pending = true;
+
   /* progress update */
   if (progress.get_cancel())
     progress.set_status("Cancel", progress.get_cancel_message());
@@ -924,7 +935,11 @@ bool Session::update_scene()
     }
 
     progress.set_status("Updating Scene");
-    MEM_GUARDED_CALL(&progress, scene->device_update, device, progress);
+    {
+      scoped_timer update_timer;
+      MEM_GUARDED_CALL(&progress, scene->device_update, device, progress);
+      scene->update_times.total += update_timer.get_time();
+    }
 
     DeviceKernelStatus kernel_switch_status = device->get_active_kernel_switch_state();
     bool kernel_switch_needed = kernel_switch_status == DEVICE_KERNEL_FEATURE_KERNEL_AVAILABLE ||
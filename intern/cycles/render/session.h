@@ -160,6 +160,11 @@ class Session {
 
   void device_free();
 
+  /* Write the result of the last render through SessionParams.write_render_cb. When rendering
+   * multiple frames with one session, call this after each wait(), the session otherwise
+   * only writes the last frame when it is destroyed. */
+  void write_render();
+
   /* Returns the rendering progress or 0 if no progress can be determined
    * (for example, when rendering with unlimited samples). */
   float get_progress();
@@ -217,6 +222,9 @@ class Session {
   bool kernels_loaded;
   DeviceRequestedFeatures loaded_kernel_features;
 
+  /* Render finished since the last write_render(). */
+  bool write_render_pending;
+
   double reset_time;
 
   /* progressive refine */
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2011-2020 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "bvh/bvh.h"
+#include "bvh/bvh2.h"
+#include "render/mesh.h"
+#include "render/object.h"
+#include "util/util_boundbox.h"
+#include "util/util_math.h"
+#include "util/util_progress.h"
+#include "util/util_task.h"
+#include "util/util_unique_ptr.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int GRID_SIZE = 32;
+
+const BVHLayout LAYOUTS[] = {BVH_LAYOUT_BVH2, BVH_LAYOUT_BVH4, BVH_LAYOUT_BVH8};
+
+class BVHRefitTest : public testing::Test {
+ protected:
+  Mesh mesh;
+  Object object;
+  vector<Mesh *> meshes;
+  vector<Object *> objects;
+  Progress progress;
+
+  virtual void SetUp()
+  {
+    TaskScheduler::init(0);
+
+    /* Flat grid of quads, triangulated. */
+    mesh.reserve_mesh((GRID_SIZE + 1) * (GRID_SIZE + 1), GRID_SIZE * GRID_SIZE * 2);
+
+    for (int y = 0; y <= GRID_SIZE; y++) {
+      for (int x = 0; x <= GRID_SIZE; x++) {
+        mesh.add_vertex(make_float3((float)x, (float)y, 0.0f));
+      }
+    }
+
+    for (int y = 0; y < GRID_SIZE; y++) {
+      for (int x = 0; x < GRID_SIZE; x++) {
+        const int v0 = y * (GRID_SIZE + 1) + x;
+        const int v1 = v0 + 1;
+        const int v2 = v0 + GRID_SIZE + 1;
+        const int v3 = v2 + 1;
+        mesh.add_triangle(v0, v1, v3, 0, false);
+        mesh.add_triangle(v0, v3, v2, 0, false);
+      }
+    }
+
+    object.mesh = &mesh;
+    meshes.push_back(&mesh);
+    objects.push_back(&object);
+  }
+
+  virtual void TearDown()
+  {
+    TaskScheduler::exit();
+  }
+
+  BVH *build(BVHLayout layout)
+  {
+    BVHParams params;
+    params.bvh_layout = layout;
+    /* Keep node bounds exact, spatial splits clip triangles to the split planes. */
+    params.use_spatial_split = false;
+
+    mesh.compute_bounds();
+
+    BVH *bvh = BVH::create(params, meshes, objects);
+    bvh->build(progress);
+    return bvh;
+  }
+
+  void refit(BVH *bvh)
+  {
+    mesh.compute_bounds();
+    bvh->refit(progress);
+  }
+
+  /* Every packed triangle must match the current vertex positions. */
+  void expect_triangles_match(const BVH *bvh)
+  {
+    const PackedBVH &pack = bvh->pack;
+
+    for (size_t i = 0; i < pack.prim_index.size(); i++) {
+      const Mesh::Triangle t = mesh.get_triangle(pack.prim_index[i]);
+      const int tri = pack.prim_tri_index[i];
+
+      for (int k = 0; k < 3; k++) {
+        EXPECT_TRUE(float4_to_float3(pack.prim_tri_verts[tri + k]) == mesh.verts[t.v[k]]);
+      }
+    }
+  }
+
+  /* Bounds of the triangles below a BVH2 node. Checks that the bounds stored for
+   * both children of inner nodes are exactly the bounds of their triangles. */
+  BoundBox bvh2_subtree_bounds(const PackedBVH &pack, int idx, bool leaf)
+  {
+    BoundBox bounds = BoundBox::empty;
+
+    if (leaf) {
+      const int4 data = pack.leaf_nodes[idx];
+
+      for (int prim = data.x; prim < data.y; prim++) {
+        const int tri = pack.prim_tri_index[prim];
+        for (int k = 0; k < 3; k++) {
+          bounds.grow(float4_to_float3(pack.prim_tri_verts[tri + k]));
+        }
+      }
+      return bounds;
+    }
+
+    const int4 *data = &pack.nodes[idx];
+
+    for (int i = 0; i < 2; i++) {
+      const int child = data[0][2 + i];
+      const BoundBox child_bounds = bvh2_subtree_bounds(
+          pack, (child < 0) ? -child - 1 : child, child < 0);
+
+      const float3 node_min = make_float3(__int_as_float(data[1][i]),
+                                          __int_as_float(data[2][i]),
+                                          __int_as_float(data[3][i]));
+      const float3 node_max = make_float3(__int_as_float(data[1][2 + i]),
+                                          __int_as_float(data[2][2 + i]),
+                                          __int_as_float(data[3][2 + i]));
+      EXPECT_TRUE(node_min == child_bounds.min);
+      EXPECT_TRUE(node_max == child_bounds.max);
+
+      bounds.grow(child_bounds);
+    }
+
+    return bounds;
+  }
+
+  BoundBox bvh2_bounds(const BVH *bvh)
+  {
+    const PackedBVH &pack = bvh->pack;
+    return bvh2_subtree_bounds(pack, 0, pack.root_index == -1);
+  }
+};
+
+}  // namespace
+
+TEST_F(BVHRefitTest, unchanged)
+{
+  for (BVHLayout layout : LAYOUTS) {
+    unique_ptr<BVH> bvh(build(layout));
+    EXPECT_GT(bvh->build_sah_cost, 0.0f);
+
+    /* Refit computes the same SAH cost as the build. */
+    refit(bvh.get());
+    EXPECT_NEAR(bvh->sah_cost, bvh->build_sah_cost, bvh->build_sah_cost * 1e-4f);
+    EXPECT_FALSE(bvh->need_rebuild());
+  }
+}
+
+TEST_F(BVHRefitTest, translated)
+{
+  for (BVHLayout layout : LAYOUTS) {
+    unique_ptr<BVH> bvh(build(layout));
+
+    for (size_t i = 0; i < mesh.verts.size(); i++) {
+      mesh.verts[i] += make_float3(10.0f, -3.0f, 5.0f);
+    }
+
+    /* Moving all primitives together keeps the quality of the tree. */
+    refit(bvh.get());
+    expect_triangles_match(bvh.get());
+    EXPECT_NEAR(bvh->sah_cost, bvh->build_sah_cost, bvh->build_sah_cost * 1e-3f);
+    EXPECT_FALSE(bvh->need_rebuild());
+
+    for (size_t i = 0; i < mesh.verts.size(); i++) {
+      mesh.verts[i] -= make_float3(10.0f, -3.0f, 5.0f);
+    }
+  }
+}
+
+TEST_F(BVHRefitTest, deformed)
+{
+  const array<float3> verts = mesh.verts;
+
+  for (BVHLayout layout : LAYOUTS) {
+    unique_ptr<BVH> refit_bvh(build(layout));
+
+    /* Small wave over the grid, as for a deforming character. */
+    for (size_t i = 0; i < mesh.verts.size(); i++) {
+      float3 &co = mesh.verts[i];
+      co.z = 0.02f * sinf(co.x * 0.5f) * cosf(co.y * 0.5f);
+    }
+
+    refit(refit_bvh.get());
+    unique_ptr<BVH> rebuild_bvh(build(layout));
+
+    expect_triangles_match(refit_bvh.get());
+    expect_triangles_match(rebuild_bvh.get());
+
+    /* Quality stays close enough to a rebuild. */
+    EXPECT_FALSE(refit_bvh->need_rebuild());
+    EXPECT_LE(refit_bvh->sah_cost,
+              rebuild_bvh->build_sah_cost * refit_bvh->params.max_refit_sah_cost_ratio);
+
+    if (layout == BVH_LAYOUT_BVH2) {
+      /* Node bounds are exact in both trees, the refit one is as valid for traversal. */
+      const BoundBox refit_bounds = bvh2_bounds(refit_bvh.get());
+      const BoundBox rebuild_bounds = bvh2_bounds(rebuild_bvh.get());
+      EXPECT_TRUE(refit_bounds.min == rebuild_bounds.min);
+      EXPECT_TRUE(refit_bounds.max == rebuild_bounds.max);
+    }
+
+    mesh.verts = verts;
+  }
+}
+
+TEST_F(BVHRefitTest, scrambled)
+{
+  for (BVHLayout layout : LAYOUTS) {
+    unique_ptr<BVH> bvh(build(layout));
+
+    /* Move every vertex far from its neighbors, so that the topology of the tree
+     * no longer matches the primitives. */
+    const array<float3> verts = mesh.verts;
+    const size_t num_verts = verts.size();
+    for (size_t i = 0; i < num_verts; i++) {
+      mesh.verts[i] = verts[(i * 7919) % num_verts];
+    }
+
+    refit(bvh.get());
+    expect_triangles_match(bvh.get());
+    EXPECT_TRUE(bvh->need_rebuild());
+
+    mesh.verts = verts;
+  }
+}
+
+CCL_NAMESPACE_END
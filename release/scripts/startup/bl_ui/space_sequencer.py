@@ -1807,6 +1807,8 @@ class SEQUENCER_PT_cache_settings(SequencerButtonsPanel, Panel):
         col.prop(ed, "use_cache_final")
         col.separator()
         col.prop(ed, "recycle_max_cost")
+        col.separator()
+        col.prop(ed, "use_cache_disk")
 
 
 class SEQUENCER_PT_proxy_settings(SequencerButtonsPanel, Panel):
@@ -608,6 +608,14 @@ class USERPREF_PT_system_memory(SystemPanel, CenterAlignMixIn, Panel):
 
         flow = layout.grid_flow(row_major=False, columns=0, even_columns=True, even_rows=False, align=False)
 
+        flow.prop(system, "sequencer_disk_cache_dir", text="Sequencer Disk Cache Directory")
+        flow.prop(system, "sequencer_disk_cache_size_limit", text="Disk Cache Limit")
+        flow.prop(system, "sequencer_disk_cache_compression", text="Disk Cache Compression")
+
+        layout.separator()
+
+        flow = layout.grid_flow(row_major=False, columns=0, even_columns=True, even_rows=False, align=False)
+
         flow.prop(system, "texture_time_out", text="Texture Time Out")
         flow.prop(system, "texture_collection_rate", text="Garbage Collection Rate")
 
@@ -244,4 +244,8 @@ bool bvhcache_has_tree(const BVHCache *cache, const BVHTree *tree);
 void bvhcache_insert(BVHCache **cache_p, BVHTree *tree, int type);
 void bvhcache_free(BVHCache **cache_p);
 
+/* Trees of an evaluated mesh refitted for the next one when the topology is the same. */
+void bvhcache_carry_over_store(BVHCache **cache_prev_p, struct Mesh *mesh);
+void bvhcache_carry_over_restore(struct Mesh *mesh, BVHCache **cache_prev_p);
+
 #endif
@@ -73,6 +73,18 @@ typedef enum eCDAllocType {
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
+  /**
+   * Use data pointers, with the layer data kept alive until all layers using it are freed.
+   * The source stays the owner: it keeps its data pointers and modifies them in place.
+   * New layers get their own copy from #CustomData_duplicate_referenced_layer before
+   * modifying them. Used for copy-on-write copies of the active depsgraph.
+   */
+  CD_SHARE = 5,
+  /**
+   * Same as #CD_SHARE, without an owner: source layers get their own copy before modifying
+   * them too. Used to share data between evaluated meshes.
+   */
+  CD_SHARE_UNOWNED = 6,
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -107,6 +119,7 @@ bool CustomData_bmesh_has_free(const struct CustomData *data);
  * Checks if any of the customdata layers is referenced.
  */
 bool CustomData_has_referenced(const struct CustomData *data);
+bool CustomData_has_copy_on_write(const struct CustomData *data);
 
 /* copies the "value" (e.g. mloopuv uv or mloopcol colors) from one block to
  * another, while not overwriting anything else (e.g. flags).  probably only
@@ -218,6 +231,8 @@ int CustomData_number_of_layers(const struct CustomData *data, int type);
 int CustomData_number_of_layers_typemask(const struct CustomData *data, CustomDataMask mask);
 
 /* duplicate data of a layer with flag NOFREE, and remove that flag.
+ * Layers using shared data they don't own (see CD_SHARE) get their own copy as well,
+ * the owner keeps its data.
  * returns the layer data */
 void *CustomData_duplicate_referenced_layer(struct CustomData *data,
                                             const int type,
@@ -230,6 +245,8 @@ void *CustomData_duplicate_referenced_layer_named(struct CustomData *data,
                                                   const int type,
                                                   const char *name,
                                                   const int totelem);
+/* Same as above, for all layers. */
+void CustomData_duplicate_referenced_layers(struct CustomData *data, const int totelem);
 bool CustomData_is_referenced_layer(struct CustomData *data, int type);
 
 /* set the CD_FLAG_NOCOPY flag in custom data layers where the mask is
@@ -412,6 +429,11 @@ void CustomData_from_bmesh_block(const struct CustomData *source,
                                  struct CustomData *dest,
                                  void *src_block,
                                  int dest_index);
+void CustomData_from_bmesh_block_range(const struct CustomData *source,
+                                       struct CustomData *dest,
+                                       void *const *src_blocks,
+                                       int dest_index_start,
+                                       int count);
 
 void CustomData_file_write_prepare(struct CustomData *data,
                                    struct CustomDataLayer **r_write_layers,
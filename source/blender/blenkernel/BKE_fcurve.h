@@ -348,6 +348,11 @@ float evaluate_fcurve_driver(struct PathResolvedRNA *anim_rna,
 bool BKE_fcurve_is_empty(struct FCurve *fcu);
 /* evaluate fcurve and store value */
 float calculate_fcurve(struct PathResolvedRNA *anim_rna, struct FCurve *fcu, float evaltime);
+/* evaluate many fcurves without drivers, caching lookups on them */
+void BKE_fcurves_evaluate_batch(struct FCurve **fcurves,
+                                const int fcurves_len,
+                                const float evaltime,
+                                float *r_values);
 
 /* ************* F-Curve Samples API ******************** */
 
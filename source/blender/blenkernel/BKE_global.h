@@ -111,6 +111,9 @@ enum {
   /** Support simulating events (for testing). */
   G_FLAG_EVENT_SIMULATE = (1 << 3),
   G_FLAG_USERPREF_NO_SAVE_ON_EXIT = (1 << 4),
+  /** Only read the data-blocks used by the active scene when loading files in background mode,
+   * see #BLO_READ_SKIP_UNUSED. */
+  G_FLAG_READ_USED_ONLY = (1 << 5),
 
   G_FLAG_SCRIPT_AUTOEXEC = (1 << 13),
   /** When this flag is set ignore the prefs #USER_SCRIPT_AUTOEXEC_DISABLE. */
@@ -122,7 +125,7 @@ enum {
 /** Don't overwrite these flags when reading a file. */
 #define G_FLAG_ALL_RUNTIME \
   (G_FLAG_SCRIPT_AUTOEXEC | G_FLAG_SCRIPT_OVERRIDE_PREF | G_FLAG_EVENT_SIMULATE | \
-   G_FLAG_USERPREF_NO_SAVE_ON_EXIT)
+   G_FLAG_USERPREF_NO_SAVE_ON_EXIT | G_FLAG_READ_USED_ONLY)
 
 /** Flags to read from blend file. */
 #define G_FLAG_ALL_READFILE 0
@@ -182,10 +185,14 @@ enum {
   /** On write, restore paths after editing them (G_FILE_RELATIVE_REMAP) */
   G_FILE_SAVE_COPY = (1 << 27),
   /* #define G_FILE_GLSL_NO_ENV_LIGHTING (1 << 28) */ /* deprecated */
+  /** On write, use chunked compression (see `BLO_chunkfile.h`), takes precedence over
+   * #G_FILE_COMPRESS. Unchanged chunks are copied from the file being overwritten. */
+  G_FILE_COMPRESS_CHUNKED = (1 << 29),
 };
 
 /** Don't overwrite these flags when reading a file. */
-#define G_FILE_FLAG_ALL_RUNTIME (G_FILE_NO_UI | G_FILE_RELATIVE_REMAP | G_FILE_SAVE_COPY)
+#define G_FILE_FLAG_ALL_RUNTIME \
+  (G_FILE_NO_UI | G_FILE_RELATIVE_REMAP | G_FILE_SAVE_COPY | G_FILE_COMPRESS_CHUNKED)
 
 /** ENDIAN_ORDER: indicates what endianness the platform where the file was written had. */
 #if !defined(__BIG_ENDIAN__) && !defined(__LITTLE_ENDIAN__)
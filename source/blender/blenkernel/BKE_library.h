@@ -96,6 +96,12 @@ enum {
   LIB_ID_COPY_NO_ANIMDATA = 1 << 19,
   /** Mesh: Reference CD data layers instead of doing real copy - USE WITH CAUTION! */
   LIB_ID_COPY_CD_REFERENCE = 1 << 20,
+  /** Mesh: Share CD data layers with the source, which stays the owner that may modify them
+   * (see #CD_SHARE). Used by copy-on-write, where the source is the original data-block. */
+  LIB_ID_COPY_CD_SHARE = 1 << 21,
+  /** Mesh: Share CD data layers with the source, both copy them before modifying them
+   * (see #CD_SHARE_UNOWNED). Used between evaluated meshes. */
+  LIB_ID_COPY_CD_SHARE_UNOWNED = 1 << 22,
 
   /* *** XXX Hackish/not-so-nice specific behaviors needed for some corner cases. *** */
   /* *** Ideally we should not have those, but we need them for now... *** */
@@ -124,7 +130,7 @@ void *BKE_libblock_copy(struct Main *bmain, const struct ID *id) ATTR_WARN_UNUSE
 void *BKE_libblock_copy_for_localize(const struct ID *id);
 
 void BKE_libblock_rename(struct Main *bmain, struct ID *id, const char *name) ATTR_NONNULL();
-void BLI_libblock_ensure_unique_name(struct Main *bmain, const char *name) ATTR_NONNULL();
+void BLI_libblock_ensure_unique_name(struct Main *bmain, struct ID *id) ATTR_NONNULL();
 
 struct ID *BKE_libblock_find_name(struct Main *bmain,
                                   const short type,
@@ -203,8 +209,10 @@ void id_sort_by_name(struct ListBase *lb, struct ID *id, struct ID *id_sorting_h
 void BKE_id_expand_local(struct Main *bmain, struct ID *id);
 void BKE_id_copy_ensure_local(struct Main *bmain, const struct ID *old_id, struct ID *new_id);
 
-bool BKE_id_new_name_validate(struct ListBase *lb, struct ID *id, const char *name)
-    ATTR_NONNULL(1, 2);
+bool BKE_id_new_name_validate(struct Main *bmain,
+                              struct ListBase *lb,
+                              struct ID *id,
+                              const char *name) ATTR_NONNULL(1, 2, 3);
 void id_clear_lib_data(struct Main *bmain, struct ID *id);
 void id_clear_lib_data_ex(struct Main *bmain, struct ID *id, const bool id_in_mainlist);
 
@@ -226,7 +234,7 @@ void BKE_main_id_refcount_recompute(struct Main *bmain, const bool do_linked_onl
 void BKE_main_lib_objects_recalc_all(struct Main *bmain);
 
 /* Only for repairing files via versioning, avoid for general use. */
-void BKE_main_id_repair_duplicate_names_listbase(struct ListBase *lb);
+void BKE_main_id_repair_duplicate_names_listbase(struct Main *bmain, struct ListBase *lb);
 
 #define MAX_ID_FULL_NAME (64 + 64 + 3 + 1)         /* 64 is MAX_ID_NAME - 2 */
 #define MAX_ID_FULL_NAME_UI (MAX_ID_FULL_NAME + 3) /* Adds 'keycode' two letters at beginning. */
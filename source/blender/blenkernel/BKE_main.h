@@ -45,6 +45,7 @@ struct GSet;
 struct ImBuf;
 struct Library;
 struct MainLock;
+struct UniqueName_Map;
 
 /* Blender thumbnail, as written on file (width, height, and data as char RGBA). */
 /* We pack pixel data after that struct. */
@@ -78,6 +79,9 @@ typedef struct Main {
   uint64_t build_commit_timestamp; /* commit's timestamp from buildinfo */
   char build_hash[16];             /* hash from buildinfo */
   char recovered;                  /* indicate the main->name (file) is the recovered one */
+  /** Only the data-blocks used by the active scene were read (see #BLO_READ_SKIP_UNUSED),
+   * saving would lose all others. */
+  char is_read_partial;
   /** All current ID's exist in the last memfile undo step. */
   char is_memfile_undo_written;
   /**
@@ -133,6 +137,12 @@ typedef struct Main {
    */
   struct MainIDRelations *relations;
 
+  /**
+   * Index of local ID names, built lazily by the name map API (see #BKE_main_namemap.h)
+   * and kept up to date by code adding, renaming and removing IDs.
+   */
+  struct UniqueName_Map *name_map;
+
   struct MainLock *lock;
 } Main;
 
@@ -0,0 +1,66 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+#ifndef __BKE_MAIN_NAMEMAP_H__
+#define __BKE_MAIN_NAMEMAP_H__
+
+/** \file
+ * \ingroup bke
+ *
+ * Index of the names of local IDs in a #Main, used to look up IDs by name and to generate
+ * unique names without scanning the whole list of a given ID type.
+ *
+ * The index of an ID type is built from its list the first time it is needed. Code adding IDs
+ * to #Main or renaming them keeps it up to date through #BKE_id_new_name_validate (or
+ * #BLI_libblock_ensure_unique_name after writing the name). Code removing IDs from #Main has to
+ * call #BKE_main_namemap_remove_name, code moving IDs from one #Main to another also calls
+ * #BKE_main_namemap_add_name on the destination, and code adding or renaming many IDs at once
+ * (like file reading) can simply call #BKE_main_namemap_clear.
+ *
+ * The index is authoritative for local IDs, #BKE_libblock_find_name only scans the list for
+ * linked IDs.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ID;
+struct Main;
+struct UniqueName_Map;
+
+void BKE_main_namemap_destroy(struct UniqueName_Map **r_name_map);
+void BKE_main_namemap_clear(struct Main *bmain);
+
+struct ID *BKE_main_namemap_find(struct Main *bmain, const short id_type, const char *name);
+
+bool BKE_main_namemap_get_name(struct Main *bmain,
+                               struct ID *id,
+                               char *name,
+                               struct ID **r_id_sorting_hint);
+void BKE_main_namemap_remove_name(struct Main *bmain, struct ID *id);
+void BKE_main_namemap_add_name(struct Main *bmain, struct ID *id);
+
+bool BKE_main_namemap_validate(struct Main *bmain);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BKE_MAIN_NAMEMAP_H__ */
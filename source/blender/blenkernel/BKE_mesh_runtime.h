@@ -48,6 +48,15 @@ bool BKE_mesh_runtime_clear_edit_data(struct Mesh *mesh);
 void BKE_mesh_runtime_clear_geometry(struct Mesh *mesh);
 void BKE_mesh_runtime_clear_cache(struct Mesh *mesh);
 
+void BKE_mesh_runtime_normals_tag_dirty(struct Mesh *mesh);
+const float (*BKE_mesh_runtime_poly_normals_ensure(struct Mesh *mesh))[3];
+const float (*BKE_mesh_runtime_loop_normals_ensure(struct Mesh *mesh,
+                                                   const bool use_split_normals,
+                                                   const float split_angle))[3];
+const float (*BKE_mesh_runtime_loop_normals_get(struct Mesh *mesh,
+                                                const bool use_split_normals,
+                                                const float split_angle))[3];
+
 void BKE_mesh_runtime_verttri_from_looptri(struct MVertTri *r_verttri,
                                            const struct MLoop *mloop,
                                            const struct MLoopTri *looptri,
@@ -0,0 +1,87 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#ifndef __BKE_MODIFIER_CACHE_H__
+#define __BKE_MODIFIER_CACHE_H__
+
+/** \file
+ * \ingroup bke
+ *
+ * Cache of mesh modifier stack results, shared by all objects.
+ *
+ * Results are keyed by a hash of everything the stack depends on up to the modifier: the input
+ * mesh, the settings of the modifiers, and the transforms of objects they use. Modifiers whose
+ * inputs can't be hashed cheaply (simulations, other geometry, textures) end the part of the
+ * stack which can be cached. Least recently used results are freed to stay within the memory
+ * limit.
+ */
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct Mesh;
+struct ModifierData;
+struct Object;
+
+/* Meshes the modifier stack evaluation has after a modifier. */
+typedef struct ModifierCacheResult {
+  struct Mesh *mesh;
+  struct Mesh *mesh_orco;
+  struct Mesh *mesh_orco_cloth;
+  /* Result of the leading deform modifiers. */
+  struct Mesh *mesh_deform;
+} ModifierCacheResult;
+
+typedef struct ModifierCacheStats {
+  int hits;
+  int misses;
+  int entries;
+  size_t memory;
+} ModifierCacheStats;
+
+/* Hashing of inputs, return false when the input can't be cached. */
+uint64_t BKE_modifier_cache_hash_data(uint64_t hash, const void *data, size_t len);
+bool BKE_modifier_cache_hash_mesh(uint64_t *hash, const struct Object *ob, const struct Mesh *me);
+/* Everything except vertex coordinates and normals, to detect changes of positions only. */
+bool BKE_modifier_cache_hash_mesh_without_positions(uint64_t *hash, const struct Mesh *me);
+bool BKE_modifier_cache_hash_modifier(uint64_t *hash,
+                                      struct Object *ob,
+                                      struct ModifierData *md);
+
+/* Fill r_result with copies of the cached meshes, owned by the caller. Their layers are shared
+ * with the cache (see #CD_SHARE_UNOWNED), so must be made single user before modifying them.
+ * The deform mesh is only copied when needed, the lookup fails when it wasn't cached. */
+bool BKE_modifier_cache_lookup(uint64_t key, bool need_deform, ModifierCacheResult *r_result);
+/* Add copies of the result meshes, sharing their layers. */
+void BKE_modifier_cache_add(uint64_t key, const ModifierCacheResult *result);
+
+void BKE_modifier_cache_clear(void);
+/* Limit in bytes, zero disables the cache. */
+void BKE_modifier_cache_memory_limit_set(size_t limit);
+size_t BKE_modifier_cache_memory_limit_get(void);
+void BKE_modifier_cache_stats_get(ModifierCacheStats *r_stats);
+void BKE_modifier_cache_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BKE_MODIFIER_CACHE_H__ */
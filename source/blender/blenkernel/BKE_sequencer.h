@@ -310,7 +310,7 @@ void BKE_sequencer_proxy_set(struct Sequence *seq, bool value);
 /* **********************************************************************
  * seqcache.c
  *
- * Sequencer memory cache management functions
+ * Sequencer memory and disk cache management functions
  * ********************************************************************** */
 
 #define SEQ_CACHE_COST_MAX 10.0f
@@ -336,6 +336,7 @@ void BKE_sequencer_cache_free_temp_cache(struct Scene *scene, short id, int cfra
 void BKE_sequencer_cache_destruct(struct Scene *scene);
 void BKE_sequencer_cache_cleanup_all(struct Main *bmain);
 void BKE_sequencer_cache_cleanup(struct Scene *scene);
+void BKE_sequencer_cache_cleanup_memory(struct Scene *scene);
 void BKE_sequencer_cache_cleanup_sequence(struct Scene *scene,
                                           struct Sequence *seq,
                                           struct Sequence *seq_changed,
@@ -345,6 +346,8 @@ void BKE_sequencer_cache_iterate(
     void *userdata,
     bool callback(void *userdata, struct Sequence *seq, int cfra, int cache_type, float cost));
 bool BKE_sequencer_cache_is_full(struct Scene *scene);
+/* Images are written to the disk cache in the background, wait until all queued are written. */
+void BKE_sequencer_cache_disk_write_wait(struct Scene *scene);
 
 /* **********************************************************************
  * seqprefetch.c
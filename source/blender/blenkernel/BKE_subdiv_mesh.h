@@ -26,8 +26,11 @@
 
 #include "BLI_sys_types.h"
 
+#include "BKE_subdiv.h"
+
 struct Mesh;
 struct Subdiv;
+struct SubdivMeshVertexSamples;
 
 typedef struct SubdivToMeshSettings {
   /* Resolution at which regular ptex (created for quad polygon) are being
@@ -46,4 +49,47 @@ struct Mesh *BKE_subdiv_to_mesh(struct Subdiv *subdiv,
                                 const SubdivToMeshSettings *settings,
                                 const struct Mesh *coarse_mesh);
 
+/* Same as above, but also gives the limit surface points at which vertices of the result are
+ * evaluated, so that their positions and normals can be updated for new coarse positions.
+ * The samples are NULL when the mesh has geometry which is not evaluated from the limit surface,
+ * like loose edges or displacement. */
+struct Mesh *BKE_subdiv_to_mesh_ex(struct Subdiv *subdiv,
+                                   const SubdivToMeshSettings *settings,
+                                   const struct Mesh *coarse_mesh,
+                                   struct SubdivMeshVertexSamples **r_vertex_samples);
+
+/* Re-evaluate vertex positions and normals of a mesh created by BKE_subdiv_to_mesh_ex() for new
+ * positions of the coarse mesh vertices. Topology and all other data of the coarse mesh is to
+ * be unchanged. Vertices of subdiv_mesh are modified in place. */
+bool BKE_subdiv_mesh_vertices_update(struct Subdiv *subdiv,
+                                     const struct SubdivMeshVertexSamples *vertex_samples,
+                                     const struct Mesh *coarse_mesh,
+                                     struct Mesh *subdiv_mesh);
+
+void BKE_subdiv_mesh_vertex_samples_free(struct SubdivMeshVertexSamples *vertex_samples);
+
+/* Last result of BKE_subdiv_to_mesh_cached(), of which copies are made with only vertices
+ * re-evaluated while nothing but positions of the coarse mesh change. */
+typedef struct SubdivMeshCache {
+  struct Mesh *mesh;
+  struct SubdivMeshVertexSamples *vertex_samples;
+  SubdivSettings subdiv_settings;
+  SubdivToMeshSettings mesh_settings;
+  /* Hash of the coarse mesh without vertex positions. */
+  uint64_t coarse_mesh_hash;
+} SubdivMeshCache;
+
+/* Same as BKE_subdiv_to_mesh(), continuing from the cached result when it is valid.
+ * Layers of the returned mesh other than vertices are shared with the cache
+ * (see #CD_SHARE_UNOWNED), so must be made single user before modifying them. */
+struct Mesh *BKE_subdiv_to_mesh_cached(struct Subdiv *subdiv,
+                                       const SubdivToMeshSettings *settings,
+                                       const struct Mesh *coarse_mesh,
+                                       SubdivMeshCache *cache);
+bool BKE_subdiv_mesh_cache_is_valid(const SubdivMeshCache *cache,
+                                    const struct Subdiv *subdiv,
+                                    const SubdivToMeshSettings *settings,
+                                    const uint64_t coarse_mesh_hash);
+void BKE_subdiv_mesh_cache_free(SubdivMeshCache *cache);
+
 #endif /* __BKE_SUBDIV)MESH_H__ */
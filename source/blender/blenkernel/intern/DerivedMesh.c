@@ -51,6 +51,7 @@
 #include "BKE_library.h"
 #include "BKE_material.h"
 #include "BKE_modifier.h"
+#include "BKE_modifier_cache.h"
 #include "BKE_mesh.h"
 #include "BKE_mesh_iterators.h"
 #include "BKE_mesh_mapping.h"
@@ -781,6 +782,10 @@ static void add_orco_mesh(Object *ob, BMEditMesh *em, Mesh *mesh, Mesh *mesh_orc
 
       layerorco = CustomData_get_layer(&mesh->vdata, layer);
     }
+    else {
+      /* The layer may be shared with a cached mesh. */
+      layerorco = CustomData_duplicate_referenced_layer(&mesh->vdata, layer, mesh->totvert);
+    }
 
     memcpy(layerorco, orco, sizeof(float) * 3 * totvert);
     if (free) {
@@ -809,6 +814,10 @@ static void mesh_calc_modifier_final_normals(const Mesh *mesh_input,
     if (!CustomData_has_layer(&mesh_final->pdata, CD_NORMAL)) {
       float(*polynors)[3] = CustomData_add_layer(
           &mesh_final->pdata, CD_NORMAL, CD_CALLOC, NULL, mesh_final->totpoly);
+      /* Vertex normals are written too, the final mesh may reference the input mesh, which
+       * shares its data with the original (see #CD_SHARE). */
+      mesh_final->mvert = CustomData_duplicate_referenced_layer(
+          &mesh_final->vdata, CD_MVERT, mesh_final->totvert);
       BKE_mesh_calc_normals_poly(mesh_final->mvert,
                                  NULL,
                                  mesh_final->totvert,
@@ -869,6 +878,181 @@ static void mesh_calc_finalize(const Mesh *mesh_input, Mesh *mesh_eval)
   mesh_eval->edit_mesh = mesh_input->edit_mesh;
 }
 
+/* Result of a constructive modifier which may be in the modifier cache. */
+typedef struct ModifierCacheStage {
+  ModifierData *md;
+  CDMaskLink *md_datamask;
+  uint64_t key;
+  /* The key changed since the last evaluation at the same frame, the stage is being edited and
+   * its result is not added to the cache. */
+  bool is_edited;
+} ModifierCacheStage;
+
+/* Compute cache keys for the constructive modifiers of the stack, up to the first modifier
+ * whose inputs can't be hashed. Modifiers are skipped the same way as in
+ * mesh_calc_modifiers(). The input mesh is only hashed when there are stages to cache. */
+static int mesh_calc_modifiers_cache_stages(Scene *scene,
+                                            Object *ob,
+                                            const Mesh *mesh_input,
+                                            ModifierData *firstmd,
+                                            CDMaskLink *datamasks,
+                                            const CustomData_MeshMasks *final_datamask,
+                                            const int required_mode,
+                                            const int useDeform,
+                                            const bool need_mapping,
+                                            const bool use_cache,
+                                            const bool need_deform,
+                                            ModifierCacheStage **r_stages)
+{
+  uint64_t key = 0;
+  int modifiers_num = 0;
+  for (ModifierData *md = firstmd; md; md = md->next) {
+    modifiers_num++;
+  }
+  ModifierCacheStage *stages = MEM_malloc_arrayN(
+      (size_t)modifiers_num, sizeof(*stages), __func__);
+  int stages_num = 0;
+
+  bool is_leading_deform = (useDeform != 0);
+  bool have_non_onlydeform_modifiers = false;
+  CDMaskLink *md_datamask = datamasks;
+  for (ModifierData *md = firstmd; md; md = md->next, md_datamask = md_datamask->next) {
+    const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+    const bool is_deform = (mti->type == eModifierTypeType_OnlyDeform);
+
+    if (!modifier_isEnabled(scene, md, required_mode)) {
+      continue;
+    }
+    if (useDeform < 0 && mti->dependsOnTime && mti->dependsOnTime(md)) {
+      continue;
+    }
+
+    is_leading_deform &= is_deform;
+    if (!is_leading_deform) {
+      if ((is_deform && !useDeform) ||
+          ((mti->flags & eModifierTypeFlag_RequiresOriginalData) &&
+           have_non_onlydeform_modifiers) ||
+          (need_mapping && !modifier_supportsMapping(md))) {
+        continue;
+      }
+    }
+
+    if (!BKE_modifier_cache_hash_modifier(&key, ob, md)) {
+      break;
+    }
+    key = BKE_modifier_cache_hash_data(key, &md_datamask->mask, sizeof(md_datamask->mask));
+
+    if (!is_deform) {
+      have_non_onlydeform_modifiers = true;
+      stages[stages_num].md = md;
+      stages[stages_num].md_datamask = md_datamask;
+      stages[stages_num].key = key;
+      stages[stages_num].is_edited = false;
+      stages_num++;
+    }
+  }
+
+  uint64_t input_key = 0;
+  if (stages_num == 0 || !BKE_modifier_cache_hash_mesh(&input_key, ob, mesh_input)) {
+    MEM_freeN(stages);
+    return 0;
+  }
+
+  const int settings[] = {required_mode,
+                          useDeform,
+                          need_mapping,
+                          use_cache,
+                          need_deform,
+                          scene->r.mode & R_SIMPLIFY,
+                          scene->r.simplify_subsurf,
+                          scene->r.simplify_subsurf_render};
+  input_key = BKE_modifier_cache_hash_data(input_key, settings, sizeof(settings));
+  input_key = BKE_modifier_cache_hash_data(input_key, final_datamask, sizeof(*final_datamask));
+  for (int i = 0; i < stages_num; i++) {
+    stages[i].key = BKE_modifier_cache_hash_data(input_key, &stages[i].key, sizeof(uint64_t));
+  }
+
+  *r_stages = stages;
+  return stages_num;
+}
+
+/* Compare the keys with the ones of the last evaluation of the object and store them.
+ * Scrubbing the timeline comes back to results of other frames, while results of edits at the
+ * same frame are not used anymore once the edit continues. */
+static void mesh_calc_modifiers_cache_stages_history(Object *ob,
+                                                     const float ctime,
+                                                     ModifierCacheStage *stages,
+                                                     const int stages_num)
+{
+  Object_Runtime *runtime = &ob->runtime;
+
+  if (runtime->modifier_cache_keys != NULL && runtime->modifier_cache_ctime == ctime) {
+    for (int i = 0; i < stages_num; i++) {
+      stages[i].is_edited = (i >= runtime->modifier_cache_keys_num ||
+                             runtime->modifier_cache_keys[i] != stages[i].key);
+    }
+  }
+
+  MEM_SAFE_FREE(runtime->modifier_cache_keys);
+  runtime->modifier_cache_keys_num = stages_num;
+  runtime->modifier_cache_ctime = ctime;
+  if (stages_num != 0) {
+    runtime->modifier_cache_keys = MEM_malloc_arrayN(
+        (size_t)stages_num, sizeof(uint64_t), __func__);
+    for (int i = 0; i < stages_num; i++) {
+      runtime->modifier_cache_keys[i] = stages[i].key;
+    }
+  }
+}
+
+/* Modifiers may return meshes sharing layers with their own caches (see #CD_SHARE_UNOWNED). */
+static bool mesh_calc_modifiers_layers_are_shared(const Mesh *mesh)
+{
+  return CustomData_has_copy_on_write(&mesh->vdata) ||
+         CustomData_has_copy_on_write(&mesh->edata) ||
+         CustomData_has_copy_on_write(&mesh->fdata) ||
+         CustomData_has_copy_on_write(&mesh->ldata) ||
+         CustomData_has_copy_on_write(&mesh->pdata);
+}
+
+/* Cached meshes share their layers with the evaluated ones, modifiers may modify them in place. */
+static void mesh_calc_modifiers_cache_layers_ensure_owned(Mesh *mesh)
+{
+  if (mesh == NULL) {
+    return;
+  }
+  CustomData_duplicate_referenced_layers(&mesh->vdata, mesh->totvert);
+  CustomData_duplicate_referenced_layers(&mesh->edata, mesh->totedge);
+  CustomData_duplicate_referenced_layers(&mesh->fdata, mesh->totface);
+  CustomData_duplicate_referenced_layers(&mesh->ldata, mesh->totloop);
+  CustomData_duplicate_referenced_layers(&mesh->pdata, mesh->totpoly);
+  BKE_mesh_update_customdata_pointers(mesh, false);
+}
+
+/* Return true when the meshes were added, sharing their layers with the cache. */
+static bool mesh_calc_modifiers_cache_add(const ModifierCacheStage *stage,
+                                          ModifierData *firstmd,
+                                          Mesh *mesh_final,
+                                          Mesh *mesh_orco,
+                                          Mesh *mesh_orco_cloth,
+                                          Mesh *mesh_deform)
+{
+  if (stage->is_edited) {
+    return false;
+  }
+
+  /* Errors are set during evaluation, they would be missing when continuing from the cache. */
+  for (ModifierData *md = firstmd; md != stage->md->next; md = md->next) {
+    if (md->error) {
+      return false;
+    }
+  }
+
+  const ModifierCacheResult result = {mesh_final, mesh_orco, mesh_orco_cloth, mesh_deform};
+  BKE_modifier_cache_add(stage->key, &result);
+  return true;
+}
+
 static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
                                 Scene *scene,
                                 Object *ob,
@@ -955,8 +1139,51 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   /* Clear errors before evaluation. */
   modifiers_clearErrors(ob);
 
+  /* Continue from the deepest result of a constructive modifier found in the cache. */
+  ModifierCacheStage *cache_stages = NULL;
+  int cache_stages_num = 0;
+  int cache_stage_next = 0;
+  bool cache_hit = false;
+  /* Meshes of the current evaluation share layers with the cache or a modifier's cache. */
+  bool cache_meshes_shared = false;
+  if (index == -1 && !sculpt_mode && BKE_modifier_cache_memory_limit_get() != 0) {
+    const bool need_deform = (r_deform != NULL && useDeform);
+    cache_stages_num = mesh_calc_modifiers_cache_stages(scene,
+                                                        ob,
+                                                        mesh_input,
+                                                        md,
+                                                        datamasks,
+                                                        &final_datamask,
+                                                        required_mode,
+                                                        useDeform,
+                                                        need_mapping,
+                                                        use_cache,
+                                                        need_deform,
+                                                        &cache_stages);
+    mesh_calc_modifiers_cache_stages_history(
+        ob, DEG_get_ctime(depsgraph), cache_stages, cache_stages_num);
+
+    for (int i = cache_stages_num - 1; i >= 0; i--) {
+      ModifierCacheResult result;
+      if (BKE_modifier_cache_lookup(cache_stages[i].key, need_deform, &result)) {
+        mesh_final = result.mesh;
+        mesh_final->runtime.deformed_only = false;
+        mesh_orco = result.mesh_orco;
+        mesh_orco_cloth = result.mesh_orco_cloth;
+        mesh_deform = result.mesh_deform;
+
+        md = cache_stages[i].md->next;
+        md_datamask = cache_stages[i].md_datamask->next;
+        cache_stage_next = i + 1;
+        cache_hit = true;
+        cache_meshes_shared = true;
+        break;
+      }
+    }
+  }
+
   /* Apply all leading deform modifiers. */
-  if (useDeform) {
+  if (useDeform && !cache_hit) {
     for (; md; md = md->next, md_datamask = md_datamask->next) {
       const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
 
@@ -1007,7 +1234,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   }
 
   /* Apply all remaining constructive and deforming modifiers. */
-  bool have_non_onlydeform_modifiers_appled = false;
+  bool have_non_onlydeform_modifiers_appled = cache_hit;
   for (; md; md = md->next, md_datamask = md_datamask->next) {
     const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
 
@@ -1107,6 +1334,14 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
     else {
       have_non_onlydeform_modifiers_appled = true;
 
+      /* Modifiers may return their input with layers modified in place. */
+      if (cache_meshes_shared) {
+        mesh_calc_modifiers_cache_layers_ensure_owned(mesh_final);
+        mesh_calc_modifiers_cache_layers_ensure_owned(mesh_orco);
+        mesh_calc_modifiers_cache_layers_ensure_owned(mesh_orco_cloth);
+        cache_meshes_shared = false;
+      }
+
       /* determine which data layers are needed by following modifiers */
       CustomData_MeshMasks nextmask;
       if (md_datamask->next) {
@@ -1199,6 +1434,11 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
           MEM_freeN(deformed_verts);
           deformed_verts = NULL;
         }
+
+        /* The subdivision surface result shares layers with its cache. */
+        if (!cache_meshes_shared && mesh_calc_modifiers_layers_are_shared(mesh_final)) {
+          cache_meshes_shared = true;
+        }
       }
 
       /* create an orco mesh in parallel */
@@ -1267,6 +1507,16 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
       }
 
       mesh_final->runtime.deformed_only = false;
+
+      if (cache_stage_next < cache_stages_num && cache_stages[cache_stage_next].md == md) {
+        cache_meshes_shared |= mesh_calc_modifiers_cache_add(&cache_stages[cache_stage_next],
+                                                             firstmd,
+                                                             mesh_final,
+                                                             mesh_orco,
+                                                             mesh_orco_cloth,
+                                                             mesh_deform);
+        cache_stage_next++;
+      }
     }
 
     isPrevDeform = (mti->type == eModifierTypeType_OnlyDeform);
@@ -1282,6 +1532,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   }
 
   BLI_linklist_free((LinkNode *)datamasks, NULL);
+  MEM_SAFE_FREE(cache_stages);
 
   for (md = firstmd; md; md = md->next) {
     modifier_freeTemporaryData(md);
@@ -1634,6 +1885,12 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
         }
       }
 
+      /* Modifiers may modify their input in place, a subdivision surface result shares layers
+       * with its cache. */
+      if (mesh_final && mesh_calc_modifiers_layers_are_shared(mesh_final)) {
+        mesh_calc_modifiers_cache_layers_ensure_owned(mesh_final);
+      }
+
       Mesh *mesh_next = modwrap_applyModifier(md, &mectx, mesh_final);
       ASSERT_IS_VALID_MESH(mesh_next);
 
@@ -1818,6 +2075,14 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
 
   assign_object_mesh_eval(ob);
 
+  /* Trees of the previous result, refitted on first use when the topology didn't change. */
+  if (ob->runtime.is_mesh_eval_owned) {
+    bvhcache_carry_over_restore(ob->runtime.mesh_eval, &ob->runtime.bvh_cache_prev);
+  }
+  else {
+    bvhcache_free(&ob->runtime.bvh_cache_prev);
+  }
+
   ob->runtime.last_data_mask = *dataMask;
   ob->runtime.last_need_mapping = need_mapping;
 
@@ -1885,6 +1885,32 @@ static void animsys_write_orig_anim_rna(PointerRNA *ptr,
   }
 }
 
+/* Number of F-Curves evaluated at once by #animsys_evaluate_fcurves. */
+#define ANIMSYS_FCURVE_BATCH_SIZE 64
+
+typedef struct AnimsysFCurveBatch {
+  FCurve *fcurves[ANIMSYS_FCURVE_BATCH_SIZE];
+  PathResolvedRNA anim_rna[ANIMSYS_FCURVE_BATCH_SIZE];
+  float values[ANIMSYS_FCURVE_BATCH_SIZE];
+  int len;
+} AnimsysFCurveBatch;
+
+static void animsys_evaluate_fcurve_batch(PointerRNA *ptr,
+                                          AnimsysFCurveBatch *batch,
+                                          float ctime,
+                                          bool flush_to_original)
+{
+  BKE_fcurves_evaluate_batch(batch->fcurves, batch->len, ctime, batch->values);
+  for (int i = 0; i < batch->len; i++) {
+    FCurve *fcu = batch->fcurves[i];
+    BKE_animsys_write_rna_setting(&batch->anim_rna[i], batch->values[i]);
+    if (flush_to_original) {
+      animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, batch->values[i]);
+    }
+  }
+  batch->len = 0;
+}
+
 /**
  * Evaluate all the F-Curves in the given list
  * This performs a set of standard checks. If extra checks are required,
@@ -1895,6 +1921,13 @@ static void animsys_evaluate_fcurves(PointerRNA *ptr,
                                      float ctime,
                                      bool flush_to_original)
 {
+  /* Curves of evaluated copies aren't edited, so they can be evaluated in batches which cache
+   * lookups on the curves. Original curves can be edited at any time. */
+  const bool use_batch = (ptr->owner_id != NULL) &&
+                         (ptr->owner_id->tag & LIB_TAG_COPIED_ON_WRITE);
+  AnimsysFCurveBatch batch;
+  batch.len = 0;
+
   /* Calculate then execute each curve. */
   for (FCurve *fcu = list->first; fcu; fcu = fcu->next) {
     /* Check if this F-Curve doesn't belong to a muted group. */
@@ -1911,6 +1944,19 @@ static void animsys_evaluate_fcurves(PointerRNA *ptr,
     }
     PathResolvedRNA anim_rna;
     if (BKE_animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, &anim_rna)) {
+      if (use_batch && fcu->driver == NULL) {
+        batch.fcurves[batch.len] = fcu;
+        batch.anim_rna[batch.len] = anim_rna;
+        batch.len++;
+        if (batch.len == ANIMSYS_FCURVE_BATCH_SIZE) {
+          animsys_evaluate_fcurve_batch(ptr, &batch, ctime, flush_to_original);
+        }
+        continue;
+      }
+      /* Keep the order in which values are written. */
+      if (batch.len != 0) {
+        animsys_evaluate_fcurve_batch(ptr, &batch, ctime, flush_to_original);
+      }
       const float curval = calculate_fcurve(&anim_rna, fcu, ctime);
       BKE_animsys_write_rna_setting(&anim_rna, curval);
       if (flush_to_original) {
@@ -1918,6 +1964,10 @@ static void animsys_evaluate_fcurves(PointerRNA *ptr,
       }
     }
   }
+
+  if (batch.len != 0) {
+    animsys_evaluate_fcurve_batch(ptr, &batch, ctime, flush_to_original);
+  }
 }
 
 /* ***************************************** */
@@ -38,6 +38,10 @@
 #include "BLI_utildefines.h"
 #include "BLI_alloca.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include "DNA_anim_types.h"
 #include "DNA_armature_types.h"
 #include "DNA_constraint_types.h"
@@ -1474,6 +1478,108 @@ typedef struct ArmatureUserdata {
   float postmat[4][4];
 } ArmatureUserdata;
 
+static MDeformVert *armature_vert_dvert(const ArmatureUserdata *data, const int i)
+{
+  if (data->mesh) {
+    BLI_assert(i < data->mesh->totvert);
+    return (data->mesh->dvert) ? data->mesh->dvert + i : NULL;
+  }
+  if (data->dverts && i < data->target_totvert) {
+    return data->dverts + i;
+  }
+  return NULL;
+}
+
+static bool armature_weight_is_used(const ArmatureUserdata *data, const MDeformWeight *dw)
+{
+  return (dw->def_nr >= 0 && dw->def_nr < data->defbase_tot && data->defnrToPC[dw->def_nr]);
+}
+
+/* Deform by the vertex group weights of a vertex, returns false when none of the groups has a
+ * deforming bone. Matrices of regular bones are blended first, to transform the vertex only
+ * once. B-Bones, bones multiplied by envelopes and dual quaternions are accumulated per bone. */
+static bool armature_vert_deform_weights(const ArmatureUserdata *data,
+                                         const MDeformVert *dvert,
+                                         const float co[3],
+                                         float vec[3],
+                                         DualQuat *dq,
+                                         float (*smat)[3],
+                                         float *contrib)
+{
+#ifdef __SSE2__
+  __m128 blend_mat[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+#else
+  float blend_mat[4][4] = {{0.0f}};
+#endif
+  float blend_weight = 0.0f;
+  bool deformed = false;
+
+  for (int j = 0; j < dvert->totweight; j++) {
+    const MDeformWeight *dw = &dvert->dw[j];
+    if (!armature_weight_is_used(data, dw)) {
+      continue;
+    }
+
+    bPoseChannel *pchan = data->defnrToPC[dw->def_nr];
+    const Bone *bone = pchan->bone;
+    if (bone == NULL) {
+      continue;
+    }
+    float fac = dw->weight;
+    deformed = true;
+
+    if (bone->flag & BONE_MULT_VG_ENV) {
+      fac *= distfactor_to_bone(
+          co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
+    }
+
+    if (dq || (bone->segments > 1 && pchan->runtime.bbone_segments == bone->segments)) {
+      pchan_bone_deform(pchan, fac, vec, dq, smat, co, contrib);
+      continue;
+    }
+    if (fac == 0.0f) {
+      continue;
+    }
+
+#ifdef __SSE2__
+    const __m128 fac4 = _mm_set1_ps(fac);
+    for (int k = 0; k < 4; k++) {
+      blend_mat[k] = _mm_add_ps(blend_mat[k], _mm_mul_ps(_mm_loadu_ps(pchan->chan_mat[k]), fac4));
+    }
+#else
+    madd_m4_m4m4fl(blend_mat, blend_mat, pchan->chan_mat, fac);
+#endif
+    blend_weight += fac;
+  }
+
+  if (blend_weight == 0.0f) {
+    return deformed;
+  }
+
+#ifdef __SSE2__
+  float mat[4][4];
+  for (int k = 0; k < 4; k++) {
+    _mm_storeu_ps(mat[k], blend_mat[k]);
+  }
+#else
+  float(*mat)[4] = blend_mat;
+#endif
+
+  float tmp[3];
+  mul_v3_m4v3(tmp, mat, co);
+  madd_v3_v3fl(tmp, co, -blend_weight);
+  add_v3_v3(vec, tmp);
+
+  if (smat) {
+    float tmpmat[3][3];
+    copy_m3_m4(tmpmat, mat);
+    add_m3_m3m3(smat, smat, tmpmat);
+  }
+
+  *contrib += blend_weight;
+  return deformed;
+}
+
 static void armature_vert_task(void *__restrict userdata,
                                const int i,
                                const TaskParallelTLS *__restrict UNUSED(tls))
@@ -1512,21 +1618,7 @@ static void armature_vert_task(void *__restrict userdata,
   }
 
   if (use_dverts || armature_def_nr != -1) {
-    if (data->mesh) {
-      BLI_assert(i < data->mesh->totvert);
-      if (data->mesh->dvert != NULL) {
-        dvert = data->mesh->dvert + i;
-      }
-      else {
-        dvert = NULL;
-      }
-    }
-    else if (data->dverts && i < data->target_totvert) {
-      dvert = data->dverts + i;
-    }
-    else {
-      dvert = NULL;
-    }
+    dvert = armature_vert_dvert(data, i);
   }
   else {
     dvert = NULL;
@@ -1558,28 +1650,11 @@ static void armature_vert_task(void *__restrict userdata,
   mul_m4_v3(data->premat, co);
 
   if (use_dverts && dvert && dvert->totweight) { /* use weight groups ? */
-    MDeformWeight *dw = dvert->dw;
-    int deformed = 0;
-    unsigned int j;
-    for (j = dvert->totweight; j != 0; j--, dw++) {
-      const int index = dw->def_nr;
-      if (index >= 0 && index < data->defbase_tot && (pchan = data->defnrToPC[index])) {
-        float weight = dw->weight;
-        Bone *bone = pchan->bone;
-
-        deformed = 1;
-
-        if (bone && bone->flag & BONE_MULT_VG_ENV) {
-          weight *= distfactor_to_bone(
-              co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
-        }
+    const bool deformed = armature_vert_deform_weights(data, dvert, co, vec, dq, smat, &contrib);
 
-        pchan_bone_deform(pchan, weight, vec, dq, smat, co, &contrib);
-      }
-    }
     /* if there are vertexgroups but not groups with bones
      * (like for softbody groups) */
-    if (deformed == 0 && use_envelope) {
+    if (!deformed && use_envelope) {
       for (pchan = data->armOb->pose->chanbase.first; pchan; pchan = pchan->next) {
         if (!(pchan->bone->flag & BONE_NO_DEFORM)) {
           contrib += dist_bone_deform(pchan, vec, dq, smat, co);
@@ -49,6 +49,7 @@
 #include "BKE_image.h"
 #include "BKE_layer.h"
 #include "BKE_main.h"
+#include "BKE_modifier_cache.h"
 #include "BKE_node.h"
 #include "BKE_report.h"
 #include "BKE_scene.h"
@@ -93,6 +94,7 @@ void BKE_blender_free(void)
   DEG_free_node_types();
 
   BKE_brush_system_exit();
+  BKE_modifier_cache_clear();
   RE_texture_rng_exit();
 
   BKE_callback_global_finalize();
@@ -52,6 +52,8 @@
 #include "BKE_layer.h"
 #include "BKE_library.h"
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
+#include "BKE_modifier_cache.h"
 #include "BKE_report.h"
 #include "BKE_scene.h"
 #include "BKE_screen.h"
@@ -148,7 +150,10 @@ static void setup_app_data(bContext *C,
 
   /* may happen with library files - UNDO file should never have NULL cursccene... */
   if (ELEM(NULL, bfd->curscreen, bfd->curscene)) {
-    BKE_report(reports, RPT_WARNING, "Library file, loading empty scene");
+    /* A scene read on its own has no screen (see #BLO_read_from_file_id). */
+    if (bfd->curscene == NULL || !bfd->main->is_read_partial) {
+      BKE_report(reports, RPT_WARNING, "Library file, loading empty scene");
+    }
     mode = LOAD_UI_OFF;
   }
   else if (BLI_listbase_is_empty(&bfd->main->screens)) {
@@ -164,6 +169,7 @@ static void setup_app_data(bContext *C,
   /* Free all render results, without this stale data gets displayed after loading files */
   if (mode != LOAD_UNDO) {
     RE_FreeAllRenderResults();
+    BKE_modifier_cache_clear();
   }
 
   /* Only make filepaths compatible when loading for real (not undo) */
@@ -417,7 +423,12 @@ int BKE_blendfile_read(bContext *C,
     printf("Read blend: %s\n", filepath);
   }
 
-  bfd = BLO_read_from_file(filepath, params->skip_flags, reports);
+  if (params->root_idname != NULL) {
+    bfd = BLO_read_from_file_id(filepath, params->root_idname, params->skip_flags, reports);
+  }
+  else {
+    bfd = BLO_read_from_file(filepath, params->skip_flags, reports);
+  }
   if (bfd) {
     if (0 == handle_subversion_warning(bfd->main, reports)) {
       BKE_main_free(bfd->main);
@@ -837,6 +848,7 @@ bool BKE_blendfile_write_partial(Main *bmain_src,
     for (id = lb_src->first; id; id = nextid) {
       nextid = id->next;
       if (id->tag & LIB_TAG_DOIT) {
+        BKE_main_namemap_remove_name(bmain_src, id);
         BLI_remlink(lb_src, id);
         BLI_addtail(lb_dst, id);
       }
@@ -874,9 +886,11 @@ bool BKE_blendfile_write_partial(Main *bmain_src,
     while ((id = BLI_pophead(lb_src))) {
       BLI_addtail(lb_dst, id);
       id_sort_by_name(lb_dst, id, NULL);
+      BKE_main_namemap_add_name(bmain_src, id);
     }
   }
 
+  BKE_main_namemap_destroy(&bmain_dst->name_map);
   MEM_freeN(bmain_dst);
 
   return retval;
@@ -32,17 +32,74 @@
 #include "BLI_utildefines.h"
 #include "BLI_linklist.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_bvhutils.h"
 #include "BKE_editmesh.h"
 #include "BKE_mesh.h"
 #include "BKE_mesh_runtime.h"
+#include "BKE_modifier_cache.h"
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 static ThreadRWMutex cache_rwlock = BLI_RWLOCK_INITIALIZER;
 
+typedef struct BVHCacheItem {
+  int type;
+  BVHTree *tree;
+
+  /* Caches holding the item, a tree carried over to the next evaluated mesh is shared with the
+   * previous one until that is freed. Only refitted while it has a single user. */
+  int users;
+  /* Topology of the mesh the tree was carried over from, see #bvhcache_carry_over_store. */
+  uint64_t topology_hash;
+
+  /* Set while a carried over tree is refitted by the consumer which claimed it, other consumers
+   * wait for `refit_lock`, which is held during the refit. */
+  int is_claimed;
+  ThreadMutex refit_lock;
+} BVHCacheItem;
+
+static BVHCacheItem *bvhcache_find_item(BVHCache *cache, const int type)
+{
+  for (; cache; cache = cache->next) {
+    BVHCacheItem *item = cache->link;
+    if (item->type == type) {
+      return item;
+    }
+  }
+  return NULL;
+}
+
+/* Wait for the consumer which claimed the item to finish refitting its tree,
+ * must be called without the cache lock. */
+static void bvhcache_item_wait_refit(BVHCacheItem *item)
+{
+  if (atomic_add_and_fetch_int32(&item->is_claimed, 0) != 0) {
+    BLI_mutex_lock(&item->refit_lock);
+    BLI_mutex_unlock(&item->refit_lock);
+  }
+}
+
+/**
+ * Wait for a refit of the cached tree of \a type by another consumer, see
+ * #bvhcache_carry_over_find. Only the item is looked up under the cache lock, so other caches
+ * can be used and built meanwhile.
+ */
+static void bvhcache_wait_refit(BVHCache *const *bvh_cache, const int type)
+{
+  BLI_rw_mutex_lock(&cache_rwlock, THREAD_LOCK_READ);
+  BVHCacheItem *item = bvhcache_find_item(*bvh_cache, type);
+  BLI_rw_mutex_unlock(&cache_rwlock);
+
+  if (item != NULL) {
+    bvhcache_item_wait_refit(item);
+  }
+}
+
 /* -------------------------------------------------------------------- */
 /** \name Local Callbacks
  * \{ */
@@ -598,6 +655,9 @@ BVHTree *bvhtree_from_mesh_verts_ex(BVHTreeFromMesh *data,
       }
     }
   }
+  if (in_cache) {
+    bvhcache_wait_refit(bvh_cache, bvh_cache_type);
+  }
 
   if (in_cache == false) {
     tree = bvhtree_from_mesh_verts_create_tree(
@@ -818,6 +878,9 @@ BVHTree *bvhtree_from_mesh_edges_ex(BVHTreeFromMesh *data,
       }
     }
   }
+  if (in_cache) {
+    bvhcache_wait_refit(bvh_cache, bvh_cache_type);
+  }
 
   if (in_cache == false) {
     tree = bvhtree_from_mesh_edges_create_tree(
@@ -953,6 +1016,9 @@ BVHTree *bvhtree_from_mesh_faces_ex(BVHTreeFromMesh *data,
       }
     }
   }
+  if (in_cache) {
+    bvhcache_wait_refit(bvh_cache, bvh_cache_type);
+  }
 
   if (in_cache == false) {
     tree = bvhtree_from_mesh_faces_create_tree(
@@ -1193,6 +1259,9 @@ BVHTree *bvhtree_from_mesh_looptri_ex(BVHTreeFromMesh *data,
       }
     }
   }
+  if (in_cache) {
+    bvhcache_wait_refit(bvh_cache, bvh_cache_type);
+  }
 
   if (in_cache == false) {
     /* Setup BVHTreeFromMesh */
@@ -1306,8 +1375,214 @@ static BLI_bitmap *looptri_no_hidden_map_get(const MPoly *mpoly,
   return looptri_mask;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Carry Over
+ *
+ * Evaluated meshes are replaced on every depsgraph update, deforming animation gives a new mesh
+ * with the same topology every frame. Trees of the previous mesh are kept in
+ * #Mesh_Runtime.bvh_cache_prev and refitted to the new positions on first use, instead of
+ * building them again.
+ * \{ */
+
+/* Everything the leafs of the trees and their order depend on, besides positions.
+ * Computed once per mesh, evaluated meshes don't change topology once they are used. */
+static uint64_t mesh_topology_hash(Mesh *mesh)
+{
+  if (mesh->runtime.topology_hash != 0) {
+    return mesh->runtime.topology_hash;
+  }
+
+  uint64_t hash = 0;
+  hash = BKE_modifier_cache_hash_data(hash, &mesh->totvert, sizeof(mesh->totvert));
+  hash = BKE_modifier_cache_hash_data(hash, mesh->medge, sizeof(*mesh->medge) * mesh->totedge);
+  hash = BKE_modifier_cache_hash_data(hash, mesh->mloop, sizeof(*mesh->mloop) * mesh->totloop);
+  hash = BKE_modifier_cache_hash_data(hash, mesh->mpoly, sizeof(*mesh->mpoly) * mesh->totpoly);
+  /* Threads computing it at the same time store the same value. */
+  mesh->runtime.topology_hash = (hash != 0) ? hash : 1;
+  return mesh->runtime.topology_hash;
+}
+
+static bool bvhcache_type_supports_refit(const int bvh_cache_type)
+{
+  return ELEM(bvh_cache_type,
+              BVHTREE_FROM_VERTS,
+              BVHTREE_FROM_LOOSEVERTS,
+              BVHTREE_FROM_EDGES,
+              BVHTREE_FROM_LOOSEEDGES,
+              BVHTREE_FROM_LOOPTRI,
+              BVHTREE_FROM_LOOPTRI_NO_HIDDEN);
+}
+
+typedef struct BVHTreeRefitData {
+  BVHTree *tree;
+  int bvh_cache_type;
+  const MVert *vert;
+  const MEdge *edge;
+  const MLoop *loop;
+  const MLoopTri *looptri;
+  /* Element of each leaf when some elements are masked out, NULL otherwise. */
+  const int *leaf_elem;
+} BVHTreeRefitData;
+
+static void bvhtree_refit_leaf_cb(void *__restrict userdata,
+                                  const int leaf,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHTreeRefitData *data = userdata;
+  const int i = data->leaf_elem ? data->leaf_elem[leaf] : leaf;
+  float co[3][3];
+
+  switch (data->bvh_cache_type) {
+    case BVHTREE_FROM_VERTS:
+    case BVHTREE_FROM_LOOSEVERTS:
+      BLI_bvhtree_update_node(data->tree, leaf, data->vert[i].co, NULL, 1);
+      break;
+    case BVHTREE_FROM_EDGES:
+    case BVHTREE_FROM_LOOSEEDGES:
+      copy_v3_v3(co[0], data->vert[data->edge[i].v1].co);
+      copy_v3_v3(co[1], data->vert[data->edge[i].v2].co);
+      BLI_bvhtree_update_node(data->tree, leaf, co[0], NULL, 2);
+      break;
+    case BVHTREE_FROM_LOOPTRI:
+    case BVHTREE_FROM_LOOPTRI_NO_HIDDEN: {
+      const MLoopTri *lt = &data->looptri[i];
+      copy_v3_v3(co[0], data->vert[data->loop[lt->tri[0]].v].co);
+      copy_v3_v3(co[1], data->vert[data->loop[lt->tri[1]].v].co);
+      copy_v3_v3(co[2], data->vert[data->loop[lt->tri[2]].v].co);
+      BLI_bvhtree_update_node(data->tree, leaf, co[0], NULL, 3);
+      break;
+    }
+  }
+}
+
+/* Update the tree to the positions of a mesh with the topology it was built for. */
+static void bvhtree_refit_from_mesh(BVHTree *tree, const int bvh_cache_type, Mesh *mesh)
+{
+  BVHTreeRefitData data = {
+      .tree = tree,
+      .bvh_cache_type = bvh_cache_type,
+      .vert = mesh->mvert,
+      .edge = mesh->medge,
+      .loop = mesh->mloop,
+  };
+
+  BLI_bitmap *mask = NULL;
+  int elem_len = 0, mask_active_len = -1;
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_LOOSEVERTS:
+      elem_len = mesh->totvert;
+      mask = loose_verts_map_get(
+          mesh->medge, mesh->totedge, mesh->mvert, elem_len, &mask_active_len);
+      break;
+    case BVHTREE_FROM_LOOSEEDGES:
+      elem_len = mesh->totedge;
+      mask = loose_edges_map_get(mesh->medge, elem_len, &mask_active_len);
+      break;
+    case BVHTREE_FROM_LOOPTRI:
+    case BVHTREE_FROM_LOOPTRI_NO_HIDDEN:
+      data.looptri = BKE_mesh_runtime_looptri_ensure(mesh);
+      if (bvh_cache_type == BVHTREE_FROM_LOOPTRI_NO_HIDDEN) {
+        elem_len = BKE_mesh_runtime_looptri_len(mesh);
+        mask = looptri_no_hidden_map_get(mesh->mpoly, elem_len, &mask_active_len);
+      }
+      break;
+  }
+
+  const int leaf_len = BLI_bvhtree_get_len(tree);
+  int *leaf_elem = NULL;
+  if (mask != NULL) {
+    BLI_assert(mask_active_len == leaf_len);
+    leaf_elem = MEM_malloc_arrayN((size_t)leaf_len, sizeof(*leaf_elem), __func__);
+    int leaf = 0;
+    for (int i = 0; i < elem_len; i++) {
+      if (BLI_BITMAP_TEST_BOOL(mask, i)) {
+        leaf_elem[leaf++] = i;
+      }
+    }
+    data.leaf_elem = leaf_elem;
+    MEM_freeN(mask);
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(0, leaf_len, &data, bvhtree_refit_leaf_cb, &settings);
+  BLI_bvhtree_update_tree(tree);
+
+  MEM_SAFE_FREE(leaf_elem);
+}
+
+/**
+ * Move the tree of the previous evaluated mesh to the cache of the mesh, when it was built for the
+ * same topology. The item is claimed while it's refitted outside of the cache lock, other
+ * consumers finding it in the cache wait for the refit, see #bvhcache_item_wait_refit.
+ */
+static bool bvhcache_carry_over_find(Mesh *mesh, const int bvh_cache_type, BVHTree **r_tree)
+{
+  if (!bvhcache_type_supports_refit(bvh_cache_type)) {
+    return false;
+  }
+  if (ELEM(bvh_cache_type, BVHTREE_FROM_LOOPTRI, BVHTREE_FROM_LOOPTRI_NO_HIDDEN)) {
+    BKE_mesh_runtime_looptri_ensure(mesh);
+  }
+  const uint64_t topology_hash = mesh_topology_hash(mesh);
+
+  BLI_rw_mutex_lock(&cache_rwlock, THREAD_LOCK_WRITE);
+  BVHCacheItem *item = bvhcache_find_item(mesh->runtime.bvh_cache, bvh_cache_type);
+  bool is_claimed = false;
+
+  LinkNode **node_p = &mesh->runtime.bvh_cache_prev;
+  while (item == NULL && *node_p != NULL) {
+    LinkNode *node = *node_p;
+    BVHCacheItem *item_prev = node->link;
+    if (item_prev->type != bvh_cache_type) {
+      node_p = &node->next;
+      continue;
+    }
+    if (item_prev->topology_hash != topology_hash) {
+      /* All trees come from the same mesh, none of them can be used. */
+      bvhcache_free(&mesh->runtime.bvh_cache_prev);
+      break;
+    }
+    /* The previous mesh still uses the tree, it can't be changed. */
+    if (atomic_add_and_fetch_int32(&item_prev->users, 0) != 1) {
+      break;
+    }
+
+    item = item_prev;
+    if (item->tree != NULL) {
+      BLI_mutex_lock(&item->refit_lock);
+      atomic_fetch_and_or_int32(&item->is_claimed, 1);
+      is_claimed = true;
+    }
+    *node_p = node->next;
+    node->next = mesh->runtime.bvh_cache;
+    mesh->runtime.bvh_cache = node;
+  }
+
+  BLI_rw_mutex_unlock(&cache_rwlock);
+
+  if (item == NULL) {
+    return false;
+  }
+  if (is_claimed) {
+    bvhtree_refit_from_mesh(item->tree, bvh_cache_type, mesh);
+    atomic_fetch_and_and_int32(&item->is_claimed, 0);
+    BLI_mutex_unlock(&item->refit_lock);
+  }
+  else {
+    bvhcache_item_wait_refit(item);
+  }
+  *r_tree = item->tree;
+  return true;
+}
+
+/** \} */
+
 /**
  * Builds or queries a bvhcache for the cache bvhtree of the request type.
+ *
+ * Trees of the previous evaluated mesh are refitted when the topology didn't change.
  */
 BVHTree *BKE_bvhtree_from_mesh_get(struct BVHTreeFromMesh *data,
                                    struct Mesh *mesh,
@@ -1319,8 +1594,17 @@ BVHTree *BKE_bvhtree_from_mesh_get(struct BVHTreeFromMesh *data,
 
   BLI_rw_mutex_lock(&cache_rwlock, THREAD_LOCK_READ);
   bool is_cached = bvhcache_find(*bvh_cache, bvh_cache_type, &tree);
+  const bool has_cache_prev = mesh->runtime.bvh_cache_prev != NULL;
   BLI_rw_mutex_unlock(&cache_rwlock);
 
+  if (is_cached) {
+    bvhcache_wait_refit(bvh_cache, bvh_cache_type);
+  }
+
+  if (is_cached == false && has_cache_prev) {
+    is_cached = bvhcache_carry_over_find(mesh, bvh_cache_type, &tree);
+  }
+
   if (is_cached && tree == NULL) {
     memset(data, 0, sizeof(*data));
     return tree;
@@ -1620,26 +1904,20 @@ void free_bvhtree_from_mesh(struct BVHTreeFromMesh *data)
 /** \name BVHCache
  * \{ */
 
-typedef struct BVHCacheItem {
-  int type;
-  BVHTree *tree;
-
-} BVHCacheItem;
-
 /**
  * Queries a bvhcache for the cache bvhtree of the request type
+ *
+ * \note A tree of a mesh may still be refitted by another thread,
+ * mesh trees are used after #bvhcache_wait_refit.
  */
 bool bvhcache_find(const BVHCache *cache, int type, BVHTree **r_tree)
 {
-  while (cache) {
-    const BVHCacheItem *item = cache->link;
-    if (item->type == type) {
-      *r_tree = item->tree;
-      return true;
-    }
-    cache = cache->next;
+  BVHCacheItem *item = bvhcache_find_item((BVHCache *)cache, type);
+  if (item == NULL) {
+    return false;
   }
-  return false;
+  *r_tree = item->tree;
+  return true;
 }
 
 bool bvhcache_has_tree(const BVHCache *cache, const BVHTree *tree)
@@ -1672,6 +1950,10 @@ void bvhcache_insert(BVHCache **cache_p, BVHTree *tree, int type)
 
   item->type = type;
   item->tree = tree;
+  item->users = 1;
+  item->topology_hash = 0;
+  item->is_claimed = 0;
+  BLI_mutex_init(&item->refit_lock);
 
   BLI_linklist_prepend(cache_p, item);
 }
@@ -1683,8 +1965,11 @@ static void bvhcacheitem_free(void *_item)
 {
   BVHCacheItem *item = (BVHCacheItem *)_item;
 
-  BLI_bvhtree_free(item->tree);
-  MEM_freeN(item);
+  if (atomic_sub_and_fetch_int32(&item->users, 1) == 0) {
+    BLI_bvhtree_free(item->tree);
+    BLI_mutex_end(&item->refit_lock);
+    MEM_freeN(item);
+  }
 }
 
 void bvhcache_free(BVHCache **cache_p)
@@ -1693,4 +1978,52 @@ void bvhcache_free(BVHCache **cache_p)
   *cache_p = NULL;
 }
 
+static void bvhcache_carry_over_add(BVHCache **cache_prev_p,
+                                    BVHCacheItem *item,
+                                    const uint64_t topology_hash)
+{
+  if (!bvhcache_type_supports_refit(item->type) ||
+      bvhcache_find(*cache_prev_p, item->type, &(BVHTree *){0})) {
+    return;
+  }
+  atomic_add_and_fetch_int32(&item->users, 1);
+  item->topology_hash = topology_hash;
+  BLI_linklist_prepend(cache_prev_p, item);
+}
+
+/**
+ * Keep the trees of an evaluated mesh which is about to be freed, for the next evaluated mesh of
+ * the same object. They are shared with the mesh until it is freed.
+ */
+void bvhcache_carry_over_store(BVHCache **cache_prev_p, Mesh *mesh)
+{
+  bvhcache_free(cache_prev_p);
+  if (mesh->runtime.bvh_cache == NULL && mesh->runtime.bvh_cache_prev == NULL) {
+    return;
+  }
+
+  const uint64_t topology_hash = mesh_topology_hash(mesh);
+  for (LinkNode *node = mesh->runtime.bvh_cache; node; node = node->next) {
+    bvhcache_carry_over_add(cache_prev_p, node->link, topology_hash);
+  }
+  /* Trees not used for this mesh are still valid for the next one if the topology is the same. */
+  for (LinkNode *node = mesh->runtime.bvh_cache_prev; node; node = node->next) {
+    BVHCacheItem *item = node->link;
+    if (item->topology_hash == topology_hash) {
+      bvhcache_carry_over_add(cache_prev_p, item, topology_hash);
+    }
+  }
+}
+
+/**
+ * Give the trees kept by #bvhcache_carry_over_store to the new evaluated mesh,
+ * they are refitted by #BKE_bvhtree_from_mesh_get.
+ */
+void bvhcache_carry_over_restore(Mesh *mesh, BVHCache **cache_prev_p)
+{
+  bvhcache_free(&mesh->runtime.bvh_cache_prev);
+  mesh->runtime.bvh_cache_prev = *cache_prev_p;
+  *cache_prev_p = NULL;
+}
+
 /** \} */
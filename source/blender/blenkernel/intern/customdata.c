@@ -34,12 +34,14 @@
 #include "DNA_ID.h"
 
 #include "BLI_utildefines.h"
+#include "BLI_ghash.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_string_utils.h"
 #include "BLI_math.h"
 #include "BLI_math_color_blend.h"
 #include "BLI_mempool.h"
+#include "BLI_threads.h"
 
 #include "BLT_translation.h"
 
@@ -54,6 +56,8 @@
 
 #include "CLG_log.h"
 
+#include "atomic_ops.h"
+
 /* only for customdata_data_transfer_interp_normal_normals */
 #include "data_transfer_intern.h"
 
@@ -1811,6 +1815,184 @@ void customData_mask_layers__print(const CustomData_MeshMasks *mask)
   }
 }
 
+/********************* Layer Sharing *********************/
+
+/* Users of layer data shared between layers of different CustomData, see CD_SHARE. Only the last
+ * user frees the data. */
+typedef struct CustomDataSharing {
+  int users;
+  /* Number of elements the data had when it got shared, the array can't be resized while it is
+   * shared. Used to copy and free the data. */
+  int totelem;
+} CustomDataSharing;
+
+/* Run-time only, layer data pointers to their #CustomDataSharing. Only layers with
+ * #CD_FLAG_SHARED are looked up, so layers that never shared their data don't take the lock.
+ * Layers referencing data (#CD_FLAG_NOFREE) are never users, even when their data is shared by
+ * others. The map is freed when the last shared data is. */
+static GHash *shared_data = NULL;
+static ThreadMutex shared_data_lock = BLI_MUTEX_INITIALIZER;
+
+#define CD_FLAG_SHARED_ALL (CD_FLAG_SHARED | CD_FLAG_SHARED_COPY_ON_WRITE)
+
+static bool customData_layer_may_be_shared(const CustomDataLayer *layer)
+{
+  return (layer->flag & CD_FLAG_SHARED) && (layer->data != NULL) &&
+         !(layer->flag & CD_FLAG_NOFREE);
+}
+
+/* Lookup of the sharing of the layer data, the caller holds #shared_data_lock. */
+static CustomDataSharing *customData_layer_sharing_find(const CustomDataLayer *layer)
+{
+  if (shared_data == NULL || !customData_layer_may_be_shared(layer)) {
+    return NULL;
+  }
+  return BLI_ghash_lookup(shared_data, layer->data);
+}
+
+/* Remove a user from shared data, the caller holds #shared_data_lock.
+ * Returns true when the data is still used by other layers, so it must not be freed. */
+static bool customData_sharing_remove_user(const void *data, CustomDataSharing *sharing)
+{
+  if (--sharing->users > 0) {
+    return true;
+  }
+  BLI_ghash_remove(shared_data, data, NULL, MEM_freeN);
+  if (BLI_ghash_len(shared_data) == 0) {
+    BLI_ghash_free(shared_data, NULL, NULL);
+    shared_data = NULL;
+  }
+  return false;
+}
+
+/* Add a user to the data of the source layer, for a new layer using the same data.
+ * With #CD_SHARE the source stays the owner of the data, with #CD_SHARE_UNOWNED it gets its own
+ * copy before modifying the data too. */
+static void customData_layer_share(CustomDataLayer *layer_src,
+                                   CustomDataLayer *layer_dst,
+                                   eCDAllocType alloctype,
+                                   int totelem)
+{
+  BLI_assert(layer_src->data != NULL && !(layer_src->flag & CD_FLAG_NOFREE));
+  BLI_assert(ELEM(alloctype, CD_SHARE, CD_SHARE_UNOWNED));
+
+  /* Different depsgraphs may copy the same original at the same time. */
+  BLI_mutex_lock(&shared_data_lock);
+  if (shared_data == NULL) {
+    shared_data = BLI_ghash_ptr_new(__func__);
+  }
+  void **sharing_p;
+  if (!BLI_ghash_ensure_p(shared_data, layer_src->data, &sharing_p)) {
+    CustomDataSharing *sharing = MEM_mallocN(sizeof(*sharing), __func__);
+    sharing->users = 1;
+    sharing->totelem = totelem;
+    *sharing_p = sharing;
+  }
+  ((CustomDataSharing *)*sharing_p)->users++;
+
+  /* The source flag is only ever set here, under the lock. */
+  int flag_src = CD_FLAG_SHARED;
+  if (alloctype == CD_SHARE_UNOWNED) {
+    flag_src |= CD_FLAG_SHARED_COPY_ON_WRITE;
+  }
+  atomic_fetch_and_or_int32(&layer_src->flag, flag_src);
+  BLI_mutex_unlock(&shared_data_lock);
+
+  layer_dst->flag |= CD_FLAG_SHARED_ALL;
+}
+
+/* Shared data the layer doesn't own, it must get its own copy before modifying it. */
+static bool customData_layer_is_copy_on_write(const CustomDataLayer *layer)
+{
+  if (!(layer->flag & CD_FLAG_SHARED_COPY_ON_WRITE)) {
+    return false;
+  }
+  BLI_mutex_lock(&shared_data_lock);
+  const bool is_shared = customData_layer_sharing_find(layer) != NULL;
+  BLI_mutex_unlock(&shared_data_lock);
+  return is_shared;
+}
+
+/* Remove the layer from the users of its data, and clear its sharing flags.
+ * Returns true when the data is still used by other layers, so it must not be freed.
+ * \a r_totelem is set to the number of elements of shared data. */
+static bool customData_layer_sharing_release(CustomDataLayer *layer, int *r_totelem)
+{
+  if (!(layer->flag & CD_FLAG_SHARED)) {
+    return false;
+  }
+  BLI_mutex_lock(&shared_data_lock);
+  CustomDataSharing *sharing = customData_layer_sharing_find(layer);
+  bool is_used = false;
+  if (sharing != NULL) {
+    if (r_totelem) {
+      *r_totelem = sharing->totelem;
+    }
+    is_used = customData_sharing_remove_user(layer->data, sharing);
+  }
+  BLI_mutex_unlock(&shared_data_lock);
+  layer->flag &= ~CD_FLAG_SHARED_ALL;
+  return is_used;
+}
+
+static void customData_free_layer_data(const LayerTypeInfo *typeInfo, void *data, int totelem)
+{
+  if (typeInfo->free) {
+    typeInfo->free(data, totelem, typeInfo->size);
+  }
+  MEM_freeN(data);
+}
+
+/* Give the layer its own copy of shared data. Used before resizing the data or freeing
+ * elements, which the other users must not see, even when this layer is the owner. */
+static void customData_layer_unshare(CustomDataLayer *layer)
+{
+  if (!(layer->flag & CD_FLAG_SHARED)) {
+    return;
+  }
+  BLI_mutex_lock(&shared_data_lock);
+  CustomDataSharing *sharing = customData_layer_sharing_find(layer);
+  if (sharing == NULL || sharing->users == 1) {
+    /* The only user keeps the data, nothing else can start using it meanwhile since users are
+     * only added through layers using the data. */
+    if (sharing != NULL) {
+      customData_sharing_remove_user(layer->data, sharing);
+    }
+    BLI_mutex_unlock(&shared_data_lock);
+    layer->flag &= ~CD_FLAG_SHARED_ALL;
+    return;
+  }
+  const int totelem = sharing->totelem;
+  BLI_mutex_unlock(&shared_data_lock);
+
+  /* Copy before releasing, the other users may free the data as soon as it is released. */
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+  void *shared_data_layer = layer->data;
+  void *data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, layerType_getName(layer->type));
+  if (typeInfo->copy) {
+    typeInfo->copy(shared_data_layer, data, totelem);
+  }
+  else {
+    memcpy(data, shared_data_layer, (size_t)totelem * typeInfo->size);
+  }
+
+  if (!customData_layer_sharing_release(layer, NULL)) {
+    /* Other users were freed in the meantime. */
+    customData_free_layer_data(typeInfo, shared_data_layer, totelem);
+  }
+  layer->data = data;
+}
+
+/* Make the layer data writable. The owner of shared data keeps its data pointer and writes in
+ * place, other layers using the data get their own copy first. */
+static void customData_layer_ensure_owned(CustomDataLayer *layer)
+{
+  if ((layer->flag & CD_FLAG_SHARED_ALL) == CD_FLAG_SHARED) {
+    return;
+  }
+  customData_layer_unshare(layer);
+}
+
 /********************* CustomData functions *********************/
 static void customData_update_offsets(CustomData *data);
 
@@ -1899,6 +2081,8 @@ bool CustomData_merge(const struct CustomData *source,
       case CD_ASSIGN:
       case CD_REFERENCE:
       case CD_DUPLICATE:
+      case CD_SHARE:
+      case CD_SHARE_UNOWNED:
         data = layer->data;
         break;
       default:
@@ -1910,11 +2094,25 @@ bool CustomData_merge(const struct CustomData *source,
       newlayer = customData_add_layer__internal(
           dest, type, CD_REFERENCE, data, totelem, layer->name);
     }
+    else if (ELEM(alloctype, CD_SHARE, CD_SHARE_UNOWNED) &&
+             ((flag & CD_FLAG_NOFREE) || data == NULL)) {
+      /* The source doesn't own referenced data, it may be freed while shared. */
+      newlayer = customData_add_layer__internal(
+          dest, type, CD_DUPLICATE, data, totelem, layer->name);
+    }
     else {
       newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
     }
 
     if (newlayer) {
+      if (ELEM(alloctype, CD_SHARE, CD_SHARE_UNOWNED) && data && (newlayer->data == data)) {
+        /* The source data is modified by tagging it shared, even though the source is const. */
+        customData_layer_share((CustomDataLayer *)layer, newlayer, alloctype, totelem);
+      }
+      else if ((alloctype == CD_ASSIGN) && (newlayer->data == data)) {
+        /* The new layer takes over the use of shared data. */
+        newlayer->flag |= flag & CD_FLAG_SHARED_ALL;
+      }
       newlayer->uid = layer->uid;
 
       newlayer->active = lastactive;
@@ -1940,6 +2138,7 @@ void CustomData_realloc(CustomData *data, int totelem)
     if (layer->flag & CD_FLAG_NOFREE) {
       continue;
     }
+    customData_layer_unshare(layer);
     typeInfo = layerType_getInfo(layer->type);
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
@@ -1962,18 +2161,12 @@ void CustomData_copy(const struct CustomData *source,
 
 static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
-  const LayerTypeInfo *typeInfo;
-
-  if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
-    typeInfo = layerType_getInfo(layer->type);
-
-    if (typeInfo->free) {
-      typeInfo->free(layer->data, totelem, typeInfo->size);
-    }
-
-    if (layer->data) {
-      MEM_freeN(layer->data);
-    }
+  if ((layer->data == NULL) || (layer->flag & CD_FLAG_NOFREE)) {
+    return;
+  }
+  /* Shared data is freed with the element count it was shared with. */
+  if (!customData_layer_sharing_release(layer, &totelem)) {
+    customData_free_layer_data(layerType_getInfo(layer->type), layer->data, totelem);
   }
 }
 
@@ -2304,13 +2497,15 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   /* Passing a layer-data to copy from with an alloctype that won't copy is
    * most likely a bug */
   BLI_assert(!layerdata || (alloctype == CD_ASSIGN) || (alloctype == CD_DUPLICATE) ||
-             (alloctype == CD_REFERENCE));
+             (alloctype == CD_REFERENCE) || (alloctype == CD_SHARE) ||
+             (alloctype == CD_SHARE_UNOWNED));
 
   if (!typeInfo->defaultname && CustomData_has_layer(data, type)) {
     return &data->layers[CustomData_get_layer_index(data, type)];
   }
 
-  if ((alloctype == CD_ASSIGN) || (alloctype == CD_REFERENCE)) {
+  if ((alloctype == CD_ASSIGN) || (alloctype == CD_REFERENCE) || (alloctype == CD_SHARE) ||
+      (alloctype == CD_SHARE_UNOWNED)) {
     newlayerdata = layerdata;
   }
   else if (totelem > 0 && typeInfo->size > 0) {
@@ -2566,6 +2761,9 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
 
     layer->flag &= ~CD_FLAG_NOFREE;
   }
+  else {
+    customData_layer_ensure_owned(layer);
+  }
 
   return layer->data;
 }
@@ -2606,6 +2804,13 @@ void *CustomData_duplicate_referenced_layer_named(CustomData *data,
   return customData_duplicate_referenced_layer_index(data, layer_index, totelem);
 }
 
+void CustomData_duplicate_referenced_layers(CustomData *data, const int totelem)
+{
+  for (int i = 0; i < data->totlayer; i++) {
+    customData_duplicate_referenced_layer_index(data, i, totelem);
+  }
+}
+
 bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 {
   CustomDataLayer *layer;
@@ -2619,7 +2824,7 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type)
 
   layer = &data->layers[layer_index];
 
-  return (layer->flag & CD_FLAG_NOFREE) != 0;
+  return (layer->flag & CD_FLAG_NOFREE) || customData_layer_is_copy_on_write(layer);
 }
 
 void CustomData_free_temporary(CustomData *data, int totelem)
@@ -2807,6 +3012,9 @@ void CustomData_free_elem(CustomData *data, int index, int count)
       if (typeInfo->free) {
         size_t offset = (size_t)index * typeInfo->size;
 
+        /* Other users of shared data still use the elements. */
+        customData_layer_unshare(&data->layers[i]);
+
         typeInfo->free(POINTER_OFFSET(data->layers[i].data, offset), count, typeInfo->size);
       }
     }
@@ -3053,6 +3261,8 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
+  /* The old data is still used by other layers when shared, it's not passed to the caller. */
+  customData_layer_sharing_release(&data->layers[layer_index], NULL);
   data->layers[layer_index].data = ptr;
 
   return ptr;
@@ -3066,6 +3276,8 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
+  /* The old data is still used by other layers when shared, it's not passed to the caller. */
+  customData_layer_sharing_release(&data->layers[layer_index], NULL);
   data->layers[layer_index].data = ptr;
 
   return ptr;
@@ -3683,7 +3895,22 @@ bool CustomData_has_referenced(const struct CustomData *data)
 {
   int i;
   for (i = 0; i < data->totlayer; i++) {
-    if (data->layers[i].flag & CD_FLAG_NOFREE) {
+    if ((data->layers[i].flag & CD_FLAG_NOFREE) ||
+        customData_layer_is_copy_on_write(&data->layers[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * True when a layer shares its data with another #CustomData (see #CD_SHARE_UNOWNED),
+ * such layers must be made single user before modifying them.
+ */
+bool CustomData_has_copy_on_write(const struct CustomData *data)
+{
+  for (int i = 0; i < data->totlayer; i++) {
+    if (customData_layer_is_copy_on_write(&data->layers[i])) {
       return true;
     }
   }
@@ -3995,6 +4222,52 @@ void CustomData_from_bmesh_block(const CustomData *source,
   }
 }
 
+/**
+ * A version of #CustomData_from_bmesh_block copying a range of elements layer by layer,
+ * \a src_blocks are the blocks of the elements copied to
+ * [dest_index_start, dest_index_start + count).
+ */
+void CustomData_from_bmesh_block_range(const CustomData *source,
+                                       CustomData *dest,
+                                       void *const *src_blocks,
+                                       int dest_index_start,
+                                       int count)
+{
+  int dest_i = 0;
+  for (int src_i = 0; src_i < source->totlayer; src_i++) {
+    while (dest_i < dest->totlayer && dest->layers[dest_i].type < source->layers[src_i].type) {
+      dest_i++;
+    }
+
+    if (dest_i >= dest->totlayer) {
+      return;
+    }
+
+    if (dest->layers[dest_i].type == source->layers[src_i].type) {
+      const LayerTypeInfo *typeInfo = layerType_getInfo(dest->layers[dest_i].type);
+      const int offset = source->layers[src_i].offset;
+      void *dst_data = POINTER_OFFSET(dest->layers[dest_i].data,
+                                      (size_t)dest_index_start * typeInfo->size);
+
+      if (typeInfo->copy) {
+        for (int i = 0; i < count; i++) {
+          typeInfo->copy(POINTER_OFFSET(src_blocks[i], offset),
+                         POINTER_OFFSET(dst_data, (size_t)i * typeInfo->size),
+                         1);
+        }
+      }
+      else {
+        for (int i = 0; i < count; i++) {
+          memcpy(POINTER_OFFSET(dst_data, (size_t)i * typeInfo->size),
+                 POINTER_OFFSET(src_blocks[i], offset),
+                 typeInfo->size);
+        }
+      }
+      dest_i++;
+    }
+  }
+}
+
 void CustomData_file_write_info(int type, const char **r_struct_name, int *r_struct_num)
 {
   const LayerTypeInfo *typeInfo = layerType_getInfo(type);
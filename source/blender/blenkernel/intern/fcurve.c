@@ -74,6 +74,8 @@ static ThreadMutex python_driver_lock = BLI_MUTEX_INITIALIZER;
 
 static CLG_LogRef LOG = {"bke.fcurve"};
 
+static void fcurve_eval_cache_free(FCurve *fcu);
+
 /* ************************** Data-Level Functions ************************* */
 
 /* ---------------------- Freeing --------------------------- */
@@ -88,6 +90,7 @@ void free_fcurve(FCurve *fcu)
   /* free curve data */
   MEM_SAFE_FREE(fcu->bezt);
   MEM_SAFE_FREE(fcu->fpt);
+  fcurve_eval_cache_free(fcu);
 
   /* free RNA-path, as this were allocated when getting the path string */
   MEM_SAFE_FREE(fcu->rna_path);
@@ -140,6 +143,7 @@ FCurve *copy_fcurve(const FCurve *fcu)
 
   fcu_d->next = fcu_d->prev = NULL;
   fcu_d->grp = NULL;
+  fcu_d->eval_cache = NULL;
 
   /* copy curve data */
   fcu_d->bezt = MEM_dupallocN(fcu_d->bezt);
@@ -2511,78 +2515,84 @@ void correct_bezpart(float v1[2], float v2[2], float v3[2], float v4[2])
   }
 }
 
-/* find root ('zero') */
-static int findzero(float x, float q0, float q1, float q2, float q3, float *o)
+/* find root ('zero') in [0, 1] of a cubic polynomial with leading coefficient one, in terms of
+ * a third of its second coefficient and the depressed cubic x^3 + 3px + 2q for x = t + a */
+static int solve_cubic_depressed(double a, double p, double q, float *o)
 {
-  double c0, c1, c2, c3, a, b, c, p, q, d, t, phi;
+  double d, t, phi;
   int nr = 0;
 
-  c0 = q0 - x;
-  c1 = 3.0f * (q1 - q0);
-  c2 = 3.0f * (q0 - 2.0f * q1 + q2);
-  c3 = q3 - q0 + 3.0f * (q1 - q2);
+  d = q * q + p * p * p;
 
-  if (c3 != 0.0) {
-    a = c2 / c3;
-    b = c1 / c3;
-    c = c0 / c3;
-    a = a / 3;
+  if (d > 0.0) {
+    t = sqrt(d);
+    o[0] = (float)(sqrt3d(-q + t) + sqrt3d(-q - t) - a);
 
-    p = b / 3 - a * a;
-    q = (2 * a * a * a - a * b + c) / 2;
-    d = q * q + p * p * p;
+    if ((o[0] >= (float)SMALL) && (o[0] <= 1.000001f)) {
+      return 1;
+    }
+    else {
+      return 0;
+    }
+  }
+  else if (d == 0.0) {
+    t = sqrt3d(-q);
+    o[0] = (float)(2 * t - a);
 
-    if (d > 0.0) {
-      t = sqrt(d);
-      o[0] = (float)(sqrt3d(-q + t) + sqrt3d(-q - t) - a);
+    if ((o[0] >= (float)SMALL) && (o[0] <= 1.000001f)) {
+      nr++;
+    }
+    o[nr] = (float)(-t - a);
 
-      if ((o[0] >= (float)SMALL) && (o[0] <= 1.000001f)) {
-        return 1;
-      }
-      else {
-        return 0;
-      }
+    if ((o[nr] >= (float)SMALL) && (o[nr] <= 1.000001f)) {
+      return nr + 1;
+    }
+    else {
+      return nr;
+    }
+  }
+  else {
+    phi = acos(-q / sqrt(-(p * p * p)));
+    t = sqrt(-p);
+    p = cos(phi / 3);
+    q = sqrt(3 - 3 * p * p);
+    o[0] = (float)(2 * t * p - a);
+
+    if ((o[0] >= (float)SMALL) && (o[0] <= 1.000001f)) {
+      nr++;
     }
-    else if (d == 0.0) {
-      t = sqrt3d(-q);
-      o[0] = (float)(2 * t - a);
+    o[nr] = (float)(-t * (p + q) - a);
 
-      if ((o[0] >= (float)SMALL) && (o[0] <= 1.000001f)) {
-        nr++;
-      }
-      o[nr] = (float)(-t - a);
+    if ((o[nr] >= (float)SMALL) && (o[nr] <= 1.000001f)) {
+      nr++;
+    }
+    o[nr] = (float)(-t * (p - q) - a);
 
-      if ((o[nr] >= (float)SMALL) && (o[nr] <= 1.000001f)) {
-        return nr + 1;
-      }
-      else {
-        return nr;
-      }
+    if ((o[nr] >= (float)SMALL) && (o[nr] <= 1.000001f)) {
+      return nr + 1;
     }
     else {
-      phi = acos(-q / sqrt(-(p * p * p)));
-      t = sqrt(-p);
-      p = cos(phi / 3);
-      q = sqrt(3 - 3 * p * p);
-      o[0] = (float)(2 * t * p - a);
+      return nr;
+    }
+  }
+}
 
-      if ((o[0] >= (float)SMALL) && (o[0] <= 1.000001f)) {
-        nr++;
-      }
-      o[nr] = (float)(-t * (p + q) - a);
+/* find root ('zero') of the cubic polynomial with coefficients c0 to c3 in [0, 1] */
+static int solve_cubic(double c0, double c1, double c2, double c3, float *o)
+{
+  double a, b, c, p, q;
+  int nr = 0;
 
-      if ((o[nr] >= (float)SMALL) && (o[nr] <= 1.000001f)) {
-        nr++;
-      }
-      o[nr] = (float)(-t * (p - q) - a);
+  if (c3 != 0.0) {
+    a = c2 / c3;
+    b = c1 / c3;
+    c = c0 / c3;
+    a = a / 3;
 
-      if ((o[nr] >= (float)SMALL) && (o[nr] <= 1.000001f)) {
-        return nr + 1;
-      }
-      else {
-        return nr;
-      }
-    }
+    p = b / 3 - a * a;
+    q = (2 * a * a * a - a * b + c) / 2;
+
+    return solve_cubic_depressed(a, p, q, o);
   }
   else {
     a = c2;
@@ -2638,6 +2648,17 @@ static int findzero(float x, float q0, float q1, float q2, float q3, float *o)
   }
 }
 
+/* find root ('zero') */
+static int findzero(float x, float q0, float q1, float q2, float q3, float *o)
+{
+  const double c0 = q0 - x;
+  const double c1 = 3.0f * (q1 - q0);
+  const double c2 = 3.0f * (q0 - 2.0f * q1 + q2);
+  const double c3 = q3 - q0 + 3.0f * (q1 - q2);
+
+  return solve_cubic(c0, c1, c2, c3, o);
+}
+
 static void berekeny(float f1, float f2, float f3, float f4, float *o, int b)
 {
   float t, c0, c1, c2, c3;
@@ -2654,10 +2675,215 @@ static void berekeny(float f1, float f2, float f3, float f4, float *o, int b)
   }
 }
 
+/* ----------------- Evaluation Cache -------------------------- */
+
+/* Used for batched evaluation of curves which aren't edited while the cache exists. The segment
+ * used last is kept with its Bezier curve as polynomials, so evaluating near the previous time
+ * neither searches nor reads the keyframes. Results are the same as without the cache.
+ */
+
+/* Threshold of the keyframe search in #fcurve_eval_keyframes. */
+#define FCURVE_EVAL_SEARCH_THRESH 0.0001f
+
+typedef struct FCurveSegment {
+  /* Index of the keyframe at the start, -1 when unset. */
+  int index;
+  /* Times of the keyframes at the start and end. */
+  float x0, x1;
+  /* Bezier interpolation, with the coefficients below set. */
+  bool is_bezier;
+  /* Handles are flat, the value is the first polynomial coefficient. */
+  bool is_flat;
+  /* Coefficients of the time polynomial after #correct_bezpart, but for x0. */
+  float cx[3];
+  /* Coefficients of the value polynomial. */
+  float cy[4];
+  /* Parts of #solve_cubic which don't depend on the time, when the time polynomial is cubic. */
+  double cubic_a, cubic_p, cubic_q;
+} FCurveSegment;
+
+typedef struct FCurveEvalCache {
+  /* Curves of shared actions may be evaluated by several threads at once. */
+  SpinLock lock;
+  /* Keyframes the cache was built for. */
+  const BezTriple *bezt;
+  unsigned int totvert;
+  FCurveSegment segment;
+} FCurveEvalCache;
+
+static void fcurve_eval_cache_free(FCurve *fcu)
+{
+  FCurveEvalCache *cache = fcu->eval_cache;
+  if (cache) {
+    BLI_spin_end(&cache->lock);
+    MEM_freeN(cache);
+    fcu->eval_cache = NULL;
+  }
+}
+
+static FCurveEvalCache *fcurve_eval_cache_ensure(FCurve *fcu)
+{
+  FCurveEvalCache *cache = fcu->eval_cache;
+  if (cache) {
+    return (cache->bezt == fcu->bezt && cache->totvert == fcu->totvert) ? cache : NULL;
+  }
+  if (fcu->bezt == NULL || fcu->totvert < 2) {
+    return NULL;
+  }
+
+  cache = MEM_callocN(sizeof(*cache), __func__);
+  BLI_spin_init(&cache->lock);
+  cache->bezt = fcu->bezt;
+  cache->totvert = fcu->totvert;
+  cache->segment.index = -1;
+
+  FCurveEvalCache *cache_other = atomic_cas_ptr((void **)&fcu->eval_cache, NULL, cache);
+  if (cache_other != NULL) {
+    BLI_spin_end(&cache->lock);
+    MEM_freeN(cache);
+    return (cache_other->bezt == fcu->bezt && cache_other->totvert == fcu->totvert) ?
+               cache_other :
+               NULL;
+  }
+  return cache;
+}
+
+static void fcurve_segment_init(FCurveSegment *segment, const BezTriple *bezts, const int index)
+{
+  const BezTriple *prevbezt = &bezts[index];
+  const BezTriple *bezt = &bezts[index + 1];
+  float v1[2], v2[2], v3[2], v4[2];
+
+  copy_v2_v2(v1, prevbezt->vec[1]);
+  copy_v2_v2(v2, prevbezt->vec[2]);
+  copy_v2_v2(v3, bezt->vec[0]);
+  copy_v2_v2(v4, bezt->vec[1]);
+
+  segment->index = index;
+  segment->x0 = v1[0];
+  segment->x1 = v4[0];
+  segment->is_bezier = (prevbezt->ipo == BEZT_IPO_BEZ);
+  if (!segment->is_bezier) {
+    return;
+  }
+
+  segment->is_flat = (fabsf(v1[1] - v4[1]) < FLT_EPSILON && fabsf(v2[1] - v3[1]) < FLT_EPSILON &&
+                      fabsf(v3[1] - v4[1]) < FLT_EPSILON);
+
+  correct_bezpart(v1, v2, v3, v4);
+
+  /* Same expressions as #findzero and #berekeny. */
+  segment->cx[0] = 3.0f * (v2[0] - v1[0]);
+  segment->cx[1] = 3.0f * (v1[0] - 2.0f * v2[0] + v3[0]);
+  segment->cx[2] = v4[0] - v1[0] + 3.0f * (v2[0] - v3[0]);
+
+  segment->cy[0] = v1[1];
+  segment->cy[1] = 3.0f * (v2[1] - v1[1]);
+  segment->cy[2] = 3.0f * (v1[1] - 2.0f * v2[1] + v3[1]);
+  segment->cy[3] = v4[1] - v1[1] + 3.0f * (v2[1] - v3[1]);
+
+  if (segment->cx[2] != 0.0f) {
+    /* Same as #solve_cubic, q only lacks the constant term. */
+    const double c1 = segment->cx[0], c2 = segment->cx[1], c3 = segment->cx[2];
+    double a = c2 / c3;
+    const double b = c1 / c3;
+    a = a / 3;
+    segment->cubic_a = a;
+    segment->cubic_p = b / 3 - a * a;
+    segment->cubic_q = 2 * a * a * a - a * b;
+  }
+}
+
+/* The keyframe search finds the segment without a keyframe within its threshold. */
+BLI_INLINE bool fcurve_segment_contains(const float x0, const float x1, const float evaltime)
+{
+  return (evaltime - x0 > FCURVE_EVAL_SEARCH_THRESH) &&
+         (x1 - evaltime > FCURVE_EVAL_SEARCH_THRESH);
+}
+
+/**
+ * Find the segment strictly containing the time among the segment used last and its neighbors,
+ * copying it to \a r_segment.
+ */
+static bool fcurve_eval_cache_find_segment(FCurveEvalCache *cache,
+                                           const BezTriple *bezts,
+                                           const float evaltime,
+                                           FCurveSegment *r_segment)
+{
+  bool found = false;
+
+  BLI_spin_lock(&cache->lock);
+  const int index = cache->segment.index;
+  if (index != -1) {
+    if (fcurve_segment_contains(cache->segment.x0, cache->segment.x1, evaltime)) {
+      found = true;
+    }
+    else {
+      /* The next segment for playback and the previous one for playing backwards. */
+      const int offsets[2] = {1, -1};
+      for (int i = 0; i < ARRAY_SIZE(offsets); i++) {
+        const int other = index + offsets[i];
+        if (other >= 0 && other + 1 < (int)cache->totvert &&
+            fcurve_segment_contains(
+                bezts[other].vec[1][0], bezts[other + 1].vec[1][0], evaltime)) {
+          fcurve_segment_init(&cache->segment, bezts, other);
+          found = true;
+          break;
+        }
+      }
+    }
+  }
+  if (found) {
+    *r_segment = cache->segment;
+  }
+  BLI_spin_unlock(&cache->lock);
+
+  return found;
+}
+
+static void fcurve_eval_cache_set_segment(FCurveEvalCache *cache,
+                                          const BezTriple *bezts,
+                                          const int index)
+{
+  BLI_spin_lock(&cache->lock);
+  if (cache->segment.index != index) {
+    fcurve_segment_init(&cache->segment, bezts, index);
+  }
+  BLI_spin_unlock(&cache->lock);
+}
+
+static bool fcurve_segment_eval(const FCurveSegment *segment, float evaltime, float *r_value)
+{
+  float opl[32];
+
+  if (segment->is_flat) {
+    *r_value = segment->cy[0];
+    return true;
+  }
+
+  const double c0 = segment->x0 - evaltime;
+  const int roots = (segment->cx[2] != 0.0f) ?
+                        solve_cubic_depressed(segment->cubic_a,
+                                              segment->cubic_p,
+                                              (segment->cubic_q + c0 / segment->cx[2]) / 2,
+                                              opl) :
+                        solve_cubic(c0, segment->cx[0], segment->cx[1], segment->cx[2], opl);
+  if (roots) {
+    const float t = opl[0];
+    *r_value = segment->cy[0] + t * segment->cy[1] + t * t * segment->cy[2] +
+               t * t * t * segment->cy[3];
+    return true;
+  }
+  return false;
+}
+
 /* -------------------------- */
 
-/* Calculate F-Curve value for 'evaltime' using BezTriple keyframes */
-static float fcurve_eval_keyframes(FCurve *fcu, BezTriple *bezts, float evaltime)
+/* Calculate F-Curve value for 'evaltime' using BezTriple keyframes, the cache is optional */
+static float fcurve_eval_keyframes(FCurve *fcu,
+                                   BezTriple *bezts,
+                                   float evaltime,
+                                   FCurveEvalCache *cache)
 {
   const float eps = 1.e-8f;
   BezTriple *bezt, *prevbezt, *lastbezt;
@@ -2665,15 +2891,29 @@ static float fcurve_eval_keyframes(FCurve *fcu, BezTriple *bezts, float evaltime
   unsigned int a;
   int b;
   float cvalue = 0.0f;
+  bool found_segment = false;
+
+  /* segment near the one used last, strictly between its keyframes, doesn't need the search */
+  if (cache) {
+    FCurveSegment segment;
+    if (fcurve_eval_cache_find_segment(cache, bezts, evaltime, &segment)) {
+      if (segment.is_bezier && !(fcu->flag & FCURVE_DISCRETE_VALUES)) {
+        /* same as the bezier interpolation below */
+        fcurve_segment_eval(&segment, evaltime, &cvalue);
+        return cvalue;
+      }
+      a = (unsigned int)segment.index;
+      found_segment = true;
+    }
+  }
 
   /* get pointers */
-  a = fcu->totvert - 1;
   prevbezt = bezts;
   bezt = prevbezt + 1;
-  lastbezt = prevbezt + a;
+  lastbezt = prevbezt + fcu->totvert - 1;
 
   /* evaluation time at or past endpoints? */
-  if (prevbezt->vec[1][0] >= evaltime) {
+  if (!found_segment && prevbezt->vec[1][0] >= evaltime) {
     /* before or on first keyframe */
     if ((fcu->extend == FCURVE_EXTRAPOLATE_LINEAR) && (prevbezt->ipo != BEZT_IPO_CONST) &&
         !(fcu->flag & FCURVE_DISCRETE_VALUES)) {
@@ -2724,7 +2964,7 @@ static float fcurve_eval_keyframes(FCurve *fcu, BezTriple *bezts, float evaltime
       cvalue = prevbezt->vec[1][1];
     }
   }
-  else if (lastbezt->vec[1][0] <= evaltime) {
+  else if (!found_segment && lastbezt->vec[1][0] <= evaltime) {
     /* after or on last keyframe */
     if ((fcu->extend == FCURVE_EXTRAPOLATE_LINEAR) && (lastbezt->ipo != BEZT_IPO_CONST) &&
         !(fcu->flag & FCURVE_DISCRETE_VALUES)) {
@@ -2789,21 +3029,34 @@ static float fcurve_eval_keyframes(FCurve *fcu, BezTriple *bezts, float evaltime
      *   Weird errors, like selecting the wrong keyframe range (see T39207), occur.
      *   This lower bound was established in b888a32eee8147b028464336ad2404d8155c64dd.
      */
-    a = binarysearch_bezt_index_ex(bezts, evaltime, fcu->totvert, 0.0001, &exact);
-
-    if (exact) {
-      /* index returned must be interpreted differently when it sits on top of an existing keyframe
-       * - that keyframe is the start of the segment we need (see action_bug_2.blend in T39207)
-       */
+    if (found_segment) {
+      /* it doesn't start or end at evaltime */
       prevbezt = bezts + a;
-      bezt = (a < fcu->totvert - 1) ? (prevbezt + 1) : prevbezt;
+      bezt = prevbezt + 1;
     }
     else {
-      /* index returned refers to the keyframe that the eval-time occurs *before*
-       * - hence, that keyframe marks the start of the segment we're dealing with
-       */
-      bezt = bezts + a;
-      prevbezt = (a > 0) ? (bezt - 1) : bezt;
+      a = binarysearch_bezt_index_ex(
+          bezts, evaltime, fcu->totvert, FCURVE_EVAL_SEARCH_THRESH, &exact);
+
+      if (exact) {
+        /* index returned must be interpreted differently when it sits on top of an existing
+         * keyframe - that keyframe is the start of the segment we need (see action_bug_2.blend in
+         * T39207)
+         */
+        prevbezt = bezts + a;
+        bezt = (a < fcu->totvert - 1) ? (prevbezt + 1) : prevbezt;
+      }
+      else {
+        /* index returned refers to the keyframe that the eval-time occurs *before*
+         * - hence, that keyframe marks the start of the segment we're dealing with
+         */
+        bezt = bezts + a;
+        prevbezt = (a > 0) ? (bezt - 1) : bezt;
+      }
+
+      if (cache && bezt == prevbezt + 1) {
+        fcurve_eval_cache_set_segment(cache, bezts, (int)(prevbezt - bezts));
+      }
     }
 
     /* use if the key is directly on the frame,
@@ -3132,7 +3385,7 @@ static float fcurve_eval_samples(FCurve *fcu, FPoint *fpts, float evaltime)
 /* Evaluate and return the value of the given F-Curve at the specified frame ("evaltime")
  * Note: this is also used for drivers
  */
-static float evaluate_fcurve_ex(FCurve *fcu, float evaltime, float cvalue)
+static float evaluate_fcurve_ex(FCurve *fcu, float evaltime, float cvalue, const bool use_cache)
 {
   float devaltime;
 
@@ -3149,7 +3402,8 @@ static float evaluate_fcurve_ex(FCurve *fcu, float evaltime, float cvalue)
    *   F-Curve modifier on the stack requested the curve to be evaluated at
    */
   if (fcu->bezt) {
-    cvalue = fcurve_eval_keyframes(fcu, fcu->bezt, devaltime);
+    FCurveEvalCache *cache = use_cache ? fcurve_eval_cache_ensure(fcu) : NULL;
+    cvalue = fcurve_eval_keyframes(fcu, fcu->bezt, devaltime, cache);
   }
   else if (fcu->fpt) {
     cvalue = fcurve_eval_samples(fcu, fcu->fpt, devaltime);
@@ -3173,7 +3427,29 @@ float evaluate_fcurve(FCurve *fcu, float evaltime)
 {
   BLI_assert(fcu->driver == NULL);
 
-  return evaluate_fcurve_ex(fcu, evaltime, 0.0);
+  return evaluate_fcurve_ex(fcu, evaltime, 0.0, false);
+}
+
+/**
+ * Evaluate F-Curves without drivers at the same time, as done for animation playback, storing
+ * the values in \a r_values (also set as their curval).
+ *
+ * The segment used last by each curve is checked first and Bezier segments are stored as
+ * polynomials, in a cache on the curve. Curves must not be edited after this, which is the case
+ * for evaluated copies as they're copied again on changes.
+ */
+void BKE_fcurves_evaluate_batch(FCurve **fcurves,
+                                const int fcurves_len,
+                                const float evaltime,
+                                float *r_values)
+{
+  for (int i = 0; i < fcurves_len; i++) {
+    FCurve *fcu = fcurves[i];
+    BLI_assert(fcu->driver == NULL);
+
+    r_values[i] = evaluate_fcurve_ex(fcu, evaltime, 0.0, true);
+    fcu->curval = r_values[i]; /* debug display only, not thread safe! */
+  }
 }
 
 float evaluate_fcurve_only_curve(FCurve *fcu, float evaltime)
@@ -3181,7 +3457,7 @@ float evaluate_fcurve_only_curve(FCurve *fcu, float evaltime)
   /* Can be used to evaluate the (keyframed) fcurve only.
    * Also works for driver-fcurves when the driver itself is not relevant.
    * E.g. when inserting a keyframe in a driver fcurve. */
-  return evaluate_fcurve_ex(fcu, evaltime, 0.0);
+  return evaluate_fcurve_ex(fcu, evaltime, 0.0, false);
 }
 
 float evaluate_fcurve_driver(PathResolvedRNA *anim_rna,
@@ -3228,7 +3504,7 @@ float evaluate_fcurve_driver(PathResolvedRNA *anim_rna,
     }
   }
 
-  return evaluate_fcurve_ex(fcu, evaltime, cvalue);
+  return evaluate_fcurve_ex(fcu, evaltime, cvalue, false);
 }
 
 /* Checks if the curve has valid keys, drivers or modifiers that produce an actual curve. */
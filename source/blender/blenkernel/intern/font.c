@@ -268,7 +268,7 @@ VFont *BKE_vfont_load(Main *bmain, const char *filepath)
 
       /* if there's a font name, use it for the ID name */
       if (vfd->name[0] != '\0') {
-        BLI_strncpy(vfont->id.name + 2, vfd->name, sizeof(vfont->id.name) - 2);
+        BKE_libblock_rename(bmain, &vfont->id, vfd->name);
       }
       BLI_strncpy(vfont->name, filepath, sizeof(vfont->name));
 
@@ -30,6 +30,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_math_vector.h"
 #include "BLI_string_utils.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -56,6 +57,12 @@
 
 #include "RNA_access.h"
 
+#include "atomic_ops.h"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #define KEY_MODE_DUMMY 0 /* use where mode isn't checked for */
 #define KEY_MODE_BPOINT 1
 #define KEY_MODE_BEZTRIPLE 2
@@ -71,12 +78,49 @@ typedef struct WeightsArrayCache {
   float **defgroup_weights;
 } WeightsArrayCache;
 
+/* Elements a key block changes relative to its reference block, see #key_sparse_data_ensure. */
+typedef struct KeySparseBlock {
+  /* Data the deltas were computed from, the block is only used while these match. */
+  const float *data;
+  const float *ref_data;
+  int totelem;
+  /* False when too many elements change for skipping the others to be worth it. */
+  bool is_sparse;
+  int len;
+  int *indices;
+  float (*deltas)[3];
+} KeySparseBlock;
+
+typedef struct KeySparseData {
+  int totkey;
+  KeySparseBlock *blocks;
+} KeySparseData;
+
+static void key_sparse_data_free_ex(KeySparseData *sparse)
+{
+  for (int a = 0; a < sparse->totkey; a++) {
+    MEM_SAFE_FREE(sparse->blocks[a].indices);
+    MEM_SAFE_FREE(sparse->blocks[a].deltas);
+  }
+  MEM_freeN(sparse->blocks);
+  MEM_freeN(sparse);
+}
+
+static void key_sparse_data_free(Key *key)
+{
+  if (key->sparse_data) {
+    key_sparse_data_free_ex(key->sparse_data);
+    key->sparse_data = NULL;
+  }
+}
+
 /** Free (or release) any data used by this shapekey (does not free the key itself). */
 void BKE_key_free(Key *key)
 {
   KeyBlock *kb;
 
   BKE_animdata_free((ID *)key, false);
+  key_sparse_data_free(key);
 
   while ((kb = BLI_pophead(&key->block))) {
     if (kb->data) {
@@ -90,6 +134,8 @@ void BKE_key_free_nolib(Key *key)
 {
   KeyBlock *kb;
 
+  key_sparse_data_free(key);
+
   while ((kb = BLI_pophead(&key->block))) {
     if (kb->data) {
       MEM_freeN(kb->data);
@@ -166,6 +212,7 @@ void BKE_key_copy_data(Main *UNUSED(bmain),
                        const int UNUSED(flag))
 {
   BLI_duplicatelist(&key_dst->block, &key_src->block);
+  key_dst->sparse_data = NULL;
 
   KeyBlock *kb_dst, *kb_src;
   for (kb_src = key_src->block.first, kb_dst = key_dst->block.first; kb_dst;
@@ -195,6 +242,7 @@ Key *BKE_key_copy_nolib(Key *key)
   keyn = MEM_dupallocN(key);
 
   keyn->adt = NULL;
+  keyn->sparse_data = NULL;
 
   BLI_duplicatelist(&keyn->block, &key->block);
 
@@ -908,6 +956,300 @@ static void key_evaluate_relative(const int start,
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Relative Keys on Coordinates
+ *
+ * Faster evaluation of relative keys for meshes and lattices, where every element is a
+ * coordinate. Keys without influence are skipped up front, elements are processed in parallel
+ * chunks applying the keys in order, and keys of evaluated data-blocks skip the elements they
+ * don't change. The result is the same as #key_evaluate_relative, to the bit.
+ * \{ */
+
+/* Keys changing at most this fraction of the elements are stored sparse. */
+#define KEY_SPARSE_MAX_FRACTION 4
+#define KEY_EVAL_CHUNK_SIZE 1024
+
+typedef struct KeySparseBuildData {
+  Key *key;
+  KeyBlock **keyblocks;
+  KeySparseBlock *blocks;
+} KeySparseBuildData;
+
+static void key_sparse_block_build_cb(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  KeySparseBuildData *data = userdata;
+  KeyBlock *kb = data->keyblocks[index];
+  KeySparseBlock *block = &data->blocks[index];
+
+  if (kb == data->key->refkey || kb->relative < 0 || kb->relative >= data->key->totkey) {
+    return;
+  }
+  KeyBlock *refb = data->keyblocks[kb->relative];
+  if (kb->data == NULL || refb->data == NULL || kb->totelem != refb->totelem) {
+    return;
+  }
+
+  const float(*co)[3] = kb->data;
+  const float(*ref_co)[3] = refb->data;
+  const int totelem = kb->totelem;
+
+  /* Deltas are computed as in #rel_flerp, elements are skipped only when they're exactly zero. */
+  int len = 0;
+  for (int i = 0; i < totelem; i++) {
+    if (ref_co[i][0] - co[i][0] != 0.0f || ref_co[i][1] - co[i][1] != 0.0f ||
+        ref_co[i][2] - co[i][2] != 0.0f) {
+      len++;
+    }
+  }
+
+  block->data = kb->data;
+  block->ref_data = refb->data;
+  block->totelem = totelem;
+  block->is_sparse = (len * KEY_SPARSE_MAX_FRACTION <= totelem);
+  if (!block->is_sparse || len == 0) {
+    return;
+  }
+
+  block->len = len;
+  block->indices = MEM_mallocN(sizeof(*block->indices) * len, __func__);
+  block->deltas = MEM_mallocN(sizeof(*block->deltas) * len, __func__);
+  for (int i = 0, j = 0; i < totelem; i++) {
+    float delta[3];
+    sub_v3_v3v3(delta, ref_co[i], co[i]);
+    if (delta[0] != 0.0f || delta[1] != 0.0f || delta[2] != 0.0f) {
+      block->indices[j] = i;
+      copy_v3_v3(block->deltas[j], delta);
+      j++;
+    }
+  }
+}
+
+/**
+ * Sparse representation of the key blocks, built once for evaluated keys. Original keys are
+ * edited in place so they're always evaluated densely, evaluated keys are copied again when
+ * their data changes, which frees the sparse data.
+ */
+static const KeySparseData *key_sparse_data_ensure(Key *key)
+{
+  if ((key->id.tag & LIB_TAG_COPIED_ON_WRITE) == 0) {
+    return NULL;
+  }
+
+  KeySparseData *sparse = key->sparse_data;
+  if (sparse != NULL) {
+    return (sparse->totkey == key->totkey) ? sparse : NULL;
+  }
+
+  sparse = MEM_callocN(sizeof(*sparse), __func__);
+  sparse->totkey = key->totkey;
+  sparse->blocks = MEM_callocN(sizeof(*sparse->blocks) * key->totkey, __func__);
+
+  KeyBlock **keyblocks = MEM_mallocN(sizeof(*keyblocks) * key->totkey, __func__);
+  int keyblock_index = 0;
+  LISTBASE_FOREACH (KeyBlock *, kb, &key->block) {
+    if (keyblock_index == key->totkey) {
+      break;
+    }
+    keyblocks[keyblock_index++] = kb;
+  }
+  sparse->totkey = keyblock_index;
+
+  KeySparseBuildData data = {
+      .key = key,
+      .keyblocks = keyblocks,
+      .blocks = sparse->blocks,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, sparse->totkey, &data, key_sparse_block_build_cb, &settings);
+  MEM_freeN(keyblocks);
+
+  /* Objects sharing the key may evaluate it at the same time, keep the first result. */
+  KeySparseData *sparse_other = atomic_cas_ptr((void **)&key->sparse_data, NULL, sparse);
+  if (sparse_other != NULL) {
+    key_sparse_data_free_ex(sparse);
+    return (sparse_other->totkey == key->totkey) ? sparse_other : NULL;
+  }
+  return (sparse->totkey == key->totkey) ? sparse : NULL;
+}
+
+typedef struct KeyEvalBlock {
+  const float (*co)[3];
+  const float (*ref_co)[3];
+  const float *weights;
+  float icuval;
+  const KeySparseBlock *sparse;
+} KeyEvalBlock;
+
+typedef struct KeyEvalData {
+  float (*out)[3];
+  int tot;
+  const KeyEvalBlock *blocks;
+  int blocks_len;
+} KeyEvalData;
+
+static void key_eval_block_sparse(const KeyEvalBlock *block,
+                                  float (*out)[3],
+                                  const int start,
+                                  const int end)
+{
+  const KeySparseBlock *sparse = block->sparse;
+
+  /* First changed element in the chunk. */
+  int lo = 0, hi = sparse->len;
+  while (lo < hi) {
+    const int mid = (lo + hi) / 2;
+    if (sparse->indices[mid] < start) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+
+  for (int j = lo; j < sparse->len && sparse->indices[j] < end; j++) {
+    const int i = sparse->indices[j];
+    const float weight = block->weights ? (block->weights[i] * block->icuval) : block->icuval;
+    out[i][0] -= weight * sparse->deltas[j][0];
+    out[i][1] -= weight * sparse->deltas[j][1];
+    out[i][2] -= weight * sparse->deltas[j][2];
+  }
+}
+
+static void key_eval_block_dense(const KeyEvalBlock *block,
+                                 float (*out)[3],
+                                 const int start,
+                                 const int end)
+{
+  if (block->weights) {
+    for (int i = start; i < end; i++) {
+      rel_flerp(KEYELEM_FLOAT_LEN_COORD,
+                out[i],
+                (float *)block->ref_co[i],
+                (float *)block->co[i],
+                block->weights[i] * block->icuval);
+    }
+    return;
+  }
+
+  /* Coordinates of the chunk are contiguous, blend them as one array of floats. */
+  float *r = out[start];
+  const float *ref = block->ref_co[start];
+  const float *co = block->co[start];
+  const int len = (end - start) * 3;
+  int k = 0;
+#ifdef __SSE2__
+  const __m128 fac = _mm_set1_ps(block->icuval);
+  for (; k + 4 <= len; k += 4) {
+    const __m128 delta = _mm_sub_ps(_mm_loadu_ps(&ref[k]), _mm_loadu_ps(&co[k]));
+    _mm_storeu_ps(&r[k], _mm_sub_ps(_mm_loadu_ps(&r[k]), _mm_mul_ps(fac, delta)));
+  }
+#endif
+  for (; k < len; k++) {
+    r[k] -= block->icuval * (ref[k] - co[k]);
+  }
+}
+
+static void key_evaluate_relative_coords_cb(void *__restrict userdata,
+                                            const int chunk,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KeyEvalData *data = userdata;
+  const int start = chunk * KEY_EVAL_CHUNK_SIZE;
+  const int end = min_ii(start + KEY_EVAL_CHUNK_SIZE, data->tot);
+
+  for (int b = 0; b < data->blocks_len; b++) {
+    const KeyEvalBlock *block = &data->blocks[b];
+    if (block->sparse) {
+      key_eval_block_sparse(block, data->out, start, end);
+    }
+    else {
+      key_eval_block_dense(block, data->out, start, end);
+    }
+  }
+}
+
+/**
+ * Evaluate relative keys of meshes and lattices.
+ * \return false when the key isn't supported and #key_evaluate_relative has to be used.
+ */
+static bool key_evaluate_relative_coords(
+    Key *key, KeyBlock *actkb, float **per_keyblock_weights, float (*out)[3], const int tot)
+{
+  if (key->elemsize != sizeof(float[KEYELEM_FLOAT_LEN_COORD]) || key->refkey == NULL) {
+    return false;
+  }
+  /* Edit-mode coordinates of the active key are only available through #key_block_get_data. */
+  if (actkb && key->from && GS(key->from->name) == ID_ME && ((Mesh *)key->from)->edit_mesh) {
+    return false;
+  }
+
+  cp_key(0, tot, tot, (char *)out, key, actkb, key->refkey, NULL, KEY_MODE_DUMMY);
+
+  const KeySparseData *sparse = key_sparse_data_ensure(key);
+  KeyEvalBlock *blocks = MEM_mallocN(sizeof(*blocks) * key->totkey, __func__);
+  int blocks_len = 0;
+
+  KeyBlock *kb;
+  int keyblock_index;
+  for (kb = key->block.first, keyblock_index = 0; kb && keyblock_index < key->totkey;
+       kb = kb->next, keyblock_index++) {
+    if (kb == key->refkey || (kb->flag & KEYBLOCK_MUTE) || kb->curval == 0.0f ||
+        kb->totelem != tot) {
+      continue;
+    }
+    KeyBlock *refb = BLI_findlink(&key->block, kb->relative);
+    if (refb == NULL) {
+      continue;
+    }
+
+    const KeySparseBlock *sparse_block = NULL;
+    if (sparse) {
+      sparse_block = &sparse->blocks[keyblock_index];
+      if (!sparse_block->is_sparse || sparse_block->data != kb->data ||
+          sparse_block->ref_data != refb->data || sparse_block->totelem != tot) {
+        sparse_block = NULL;
+      }
+      else if (sparse_block->len == 0) {
+        continue;
+      }
+    }
+
+    KeyEvalBlock *block = &blocks[blocks_len++];
+    block->co = kb->data;
+    block->ref_co = refb->data;
+    block->weights = per_keyblock_weights ? per_keyblock_weights[keyblock_index] : NULL;
+    block->icuval = kb->curval;
+    block->sparse = sparse_block;
+  }
+
+  if (blocks_len != 0) {
+    KeyEvalData data = {
+        .out = out,
+        .tot = tot,
+        .blocks = blocks,
+        .blocks_len = blocks_len,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (tot > KEY_EVAL_CHUNK_SIZE);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(0,
+                            (tot + KEY_EVAL_CHUNK_SIZE - 1) / KEY_EVAL_CHUNK_SIZE,
+                            &data,
+                            key_evaluate_relative_coords_cb,
+                            &settings);
+  }
+
+  MEM_freeN(blocks);
+  return true;
+}
+
+/** \} */
+
 static void do_key(const int start,
                    int end,
                    const int tot,
@@ -1262,6 +1604,11 @@ static float **keyblock_get_per_block_weights(Object *ob, Key *key, WeightsArray
 
   for (keyblock = key->block.first, keyblock_index = 0; keyblock;
        keyblock = keyblock->next, keyblock_index++) {
+    /* Weights of blocks without influence aren't used by relative keys. */
+    if ((keyblock->flag & KEYBLOCK_MUTE) || keyblock->curval == 0.0f) {
+      per_keyblock_weights[keyblock_index] = NULL;
+      continue;
+    }
     per_keyblock_weights[keyblock_index] = get_weights_array(ob, keyblock->vgroup, cache);
   }
 
@@ -1306,8 +1653,11 @@ static void do_mesh_key(Object *ob, Key *key, char *out, const int tot)
     WeightsArrayCache cache = {0, NULL};
     float **per_keyblock_weights;
     per_keyblock_weights = keyblock_get_per_block_weights(ob, key, &cache);
-    key_evaluate_relative(
-        0, tot, tot, (char *)out, key, actkb, per_keyblock_weights, KEY_MODE_DUMMY);
+    if (!key_evaluate_relative_coords(
+            key, actkb, per_keyblock_weights, (float(*)[3])out, tot)) {
+      key_evaluate_relative(
+          0, tot, tot, (char *)out, key, actkb, per_keyblock_weights, KEY_MODE_DUMMY);
+    }
     keyblock_free_per_block_weights(key, per_keyblock_weights, &cache);
   }
   else {
@@ -1399,8 +1749,11 @@ static void do_latt_key(Object *ob, Key *key, char *out, const int tot)
   if (key->type == KEY_RELATIVE) {
     float **per_keyblock_weights;
     per_keyblock_weights = keyblock_get_per_block_weights(ob, key, NULL);
-    key_evaluate_relative(
-        0, tot, tot, (char *)out, key, actkb, per_keyblock_weights, KEY_MODE_DUMMY);
+    if (!key_evaluate_relative_coords(
+            key, actkb, per_keyblock_weights, (float(*)[3])out, tot)) {
+      key_evaluate_relative(
+          0, tot, tot, (char *)out, key, actkb, per_keyblock_weights, KEY_MODE_DUMMY);
+    }
     keyblock_free_per_block_weights(key, per_keyblock_weights, NULL);
   }
   else {
@@ -38,6 +38,7 @@
 #include "BKE_library.h"
 #include "BKE_library_query.h"
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
 
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
@@ -194,6 +195,8 @@ void BKE_main_free(Main *mainvar)
     BKE_main_relations_free(mainvar);
   }
 
+  BKE_main_namemap_destroy(&mainvar->name_map);
+
   BLI_spin_end((SpinLock *)mainvar->lock);
   MEM_freeN(mainvar->lock);
   MEM_freeN(mainvar);
@@ -0,0 +1,463 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup bke
+ *
+ * Index of local ID names of a #Main, see #BKE_main_namemap.h.
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+
+#include "BLI_bitmap.h"
+#include "BLI_ghash.h"
+#include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_math_bits.h"
+#include "BLI_memarena.h"
+#include "BLI_string.h"
+#include "BLI_string_utf8.h"
+#include "BLI_string_utils.h"
+
+#include "DNA_ID.h"
+
+#include "BKE_idcode.h"
+#include "BKE_main.h"
+#include "BKE_main_namemap.h"
+
+#include "CLG_log.h"
+
+#include "BLI_strict_flags.h"
+
+static CLG_LogRef LOG = {"bke.main_namemap"};
+
+/* Note: this code assumes and ensures that the suffix number can never go beyond 1 billion. */
+#define MAX_NUMBER 1000000000
+/* We do not want to get "name.000", so minimal number is 1. */
+#define MIN_NUMBER 1
+/* Numbers below that value are tracked one by one for each base name, so that the smallest
+ * unused one can be found. Beyond that value, we only use the number following the biggest one
+ * ever used with that base name, without trying to 'fill the gaps'. */
+#define MAX_NUMBERS_IN_USE 1024
+
+/* Suffix numbers in use with a given base name ("name" for "name.001", "name.002"...). */
+typedef struct UniqueName_Base {
+  BLI_bitmap numbers_in_use[MAX_NUMBERS_IN_USE >> 5];
+  /* Biggest number ever used, not decreased when IDs get removed or renamed. */
+  int number_max;
+} UniqueName_Base;
+
+typedef struct UniqueName_TypeMap {
+  /* Full name -> ID, keys are owned by the map. */
+  GHash *names;
+  /* ID -> key it is registered with in names, which differs from its current name when the ID
+   * was renamed directly. */
+  GHash *ids;
+  /* Base name -> UniqueName_Base, both allocated in the arena. */
+  GHash *bases;
+  MemArena *arena;
+  /* List of the IDs in #Main. */
+  ListBase *lb;
+  /* Some ID was found renamed directly, its new name may not be indexed. */
+  bool is_stale;
+} UniqueName_TypeMap;
+
+typedef struct UniqueName_Map {
+  UniqueName_TypeMap *type_maps[INDEX_ID_MAX];
+} UniqueName_Map;
+
+/* -------------------------------------------------------------------- */
+/** \name Type Maps
+ * \{ */
+
+static UniqueName_Base *namemap_base_ensure(UniqueName_TypeMap *type_map, const char *base_name)
+{
+  void **key_p, **val_p;
+  if (!BLI_ghash_ensure_p_ex(type_map->bases, base_name, &key_p, &val_p)) {
+    *key_p = BLI_memarena_alloc(type_map->arena, strlen(base_name) + 1);
+    strcpy(*key_p, base_name);
+    *val_p = BLI_memarena_calloc(type_map->arena, sizeof(UniqueName_Base));
+  }
+  return *val_p;
+}
+
+static void namemap_number_set_used(UniqueName_Base *base, const int number)
+{
+  if (number >= MIN_NUMBER && number < MAX_NUMBERS_IN_USE) {
+    BLI_BITMAP_ENABLE(base->numbers_in_use, number);
+  }
+  base->number_max = max_ii(base->number_max, number);
+}
+
+/**
+ * Smallest unused number below #MAX_NUMBERS_IN_USE if any, otherwise the number following the
+ * biggest one used, and at least \a number_min.
+ */
+static int namemap_number_unused(const UniqueName_Base *base, const int number_min)
+{
+  for (int i = 0; i < (int)ARRAY_SIZE(base->numbers_in_use); i++) {
+    /* Number zero would be the name without suffix, never use it. */
+    const BLI_bitmap block = base->numbers_in_use[i] | (i == 0 ? 1u : 0u);
+    if (block != ~0u) {
+      return (i << 5) + (int)bitscan_forward_uint(~block);
+    }
+  }
+  return max_ii(number_min, base->number_max + 1);
+}
+
+static void namemap_unregister(UniqueName_TypeMap *type_map, ID *id)
+{
+  char *key = BLI_ghash_popkey(type_map->ids, id, NULL);
+  if (key == NULL) {
+    return;
+  }
+
+  char base_name[MAX_ID_NAME - 2];
+  int number;
+  BLI_split_name_num(base_name, &number, key, '.');
+  if (number >= MIN_NUMBER && number < MAX_NUMBERS_IN_USE) {
+    UniqueName_Base *base = BLI_ghash_lookup(type_map->bases, base_name);
+    if (base != NULL) {
+      BLI_BITMAP_DISABLE(base->numbers_in_use, number);
+    }
+  }
+  BLI_ghash_remove(type_map->names, key, MEM_freeN, NULL);
+}
+
+static void namemap_register(UniqueName_TypeMap *type_map, ID *id, const char *name)
+{
+  namemap_unregister(type_map, id);
+
+  void **key_p, **val_p;
+  if (BLI_ghash_ensure_p_ex(type_map->names, name, &key_p, &val_p)) {
+    /* Name was registered with another ID, which has been renamed directly since. */
+    BLI_ghash_remove(type_map->ids, *val_p, NULL, NULL);
+    type_map->is_stale = true;
+  }
+  else {
+    *key_p = BLI_strdup(name);
+  }
+  *val_p = id;
+  BLI_ghash_insert(type_map->ids, id, *key_p);
+
+  char base_name[MAX_ID_NAME - 2];
+  int number;
+  BLI_split_name_num(base_name, &number, name, '.');
+  namemap_number_set_used(namemap_base_ensure(type_map, base_name), number);
+}
+
+/* Index IDs which were renamed without updating the name map under their current name. */
+static void namemap_sync(UniqueName_TypeMap *type_map)
+{
+  for (ID *id = type_map->lb->first; id; id = id->next) {
+    if (ID_IS_LINKED(id)) {
+      continue;
+    }
+
+    const char *key = BLI_ghash_lookup(type_map->ids, id);
+    if (key != NULL && STREQ(key, id->name + 2)) {
+      continue;
+    }
+
+    ID *id_other = BLI_ghash_lookup(type_map->names, id->name + 2);
+    if (id_other == NULL || !STREQ(id_other->name + 2, id->name + 2)) {
+      namemap_register(type_map, id, id->name + 2);
+    }
+    else {
+      /* Name is used twice, keep the ID which already has it. */
+      namemap_unregister(type_map, id);
+    }
+  }
+  type_map->is_stale = false;
+}
+
+static ID *namemap_find(UniqueName_TypeMap *type_map, const char *name)
+{
+  ID *id = BLI_ghash_lookup(type_map->names, name);
+  if (id != NULL && STREQ(id->name + 2, name)) {
+    return id;
+  }
+
+  /* Either the name is not used, or the ID using it was renamed directly and was not indexed
+   * with its new name yet. Only scan the list in the latter case, after a stale entry was
+   * found once. */
+  if (id != NULL) {
+    type_map->is_stale = true;
+  }
+  if (type_map->is_stale) {
+    namemap_sync(type_map);
+    id = BLI_ghash_lookup(type_map->names, name);
+  }
+  return id;
+}
+
+static void namemap_type_free(UniqueName_TypeMap *type_map)
+{
+  BLI_ghash_free(type_map->names, MEM_freeN, NULL);
+  BLI_ghash_free(type_map->ids, NULL, NULL);
+  BLI_ghash_free(type_map->bases, NULL, NULL);
+  BLI_memarena_free(type_map->arena);
+  MEM_freeN(type_map);
+}
+
+/* Get the map of given ID type, building it from the IDs currently in Main if needed. */
+static UniqueName_TypeMap *namemap_type_ensure(Main *bmain, const short id_type)
+{
+  if (bmain->name_map == NULL) {
+    bmain->name_map = MEM_callocN(sizeof(*bmain->name_map), __func__);
+  }
+
+  UniqueName_TypeMap **type_map_p = &bmain->name_map->type_maps[BKE_idcode_to_index(id_type)];
+  if (*type_map_p == NULL) {
+    ListBase *lb = which_libbase(bmain, id_type);
+    const uint lb_len = (uint)BLI_listbase_count(lb);
+
+    UniqueName_TypeMap *type_map = MEM_mallocN(sizeof(*type_map), __func__);
+    type_map->names = BLI_ghash_str_new_ex(__func__, lb_len);
+    type_map->ids = BLI_ghash_ptr_new_ex(__func__, lb_len);
+    type_map->bases = BLI_ghash_str_new(__func__);
+    type_map->arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
+    type_map->lb = lb;
+
+    /* Linked IDs already have a unique name in their library, they are not indexed. */
+    for (ID *id = lb->first; id; id = id->next) {
+      if (!ID_IS_LINKED(id) && !BLI_ghash_haskey(type_map->names, id->name + 2)) {
+        namemap_register(type_map, id, id->name + 2);
+      }
+    }
+    type_map->is_stale = false;
+    *type_map_p = type_map;
+  }
+  return *type_map_p;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+void BKE_main_namemap_destroy(UniqueName_Map **r_name_map)
+{
+  UniqueName_Map *name_map = *r_name_map;
+  if (name_map == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < INDEX_ID_MAX; i++) {
+    if (name_map->type_maps[i] != NULL) {
+      namemap_type_free(name_map->type_maps[i]);
+    }
+  }
+  MEM_freeN(name_map);
+  *r_name_map = NULL;
+}
+
+/**
+ * Drop the name map of given \a bmain, it will be built again from the lists of IDs when needed.
+ * To be used after adding, removing or renaming many IDs without going through the name map.
+ */
+void BKE_main_namemap_clear(Main *bmain)
+{
+  BKE_main_namemap_destroy(&bmain->name_map);
+}
+
+/**
+ * Find the local ID of given type using given name (without the ID code).
+ */
+ID *BKE_main_namemap_find(Main *bmain, const short id_type, const char *name)
+{
+  return namemap_find(namemap_type_ensure(bmain, id_type), name);
+}
+
+/**
+ * Helper building final ID name from given base_name and number.
+ *
+ * If everything goes well and we do generate a valid final ID name in given name, we return true.
+ * In case the final name would overflow the allowed ID name length, or given number is bigger than
+ * maximum allowed value, we truncate further the base_name (and given name, which is assumed to
+ * have the same 'base_name' part), and return false.
+ */
+static bool id_name_final_build(char *name, char *base_name, size_t base_name_len, int number)
+{
+  char number_str[11]; /* Dot + nine digits + NULL terminator. */
+  size_t number_str_len = BLI_snprintf_rlen(number_str, ARRAY_SIZE(number_str), ".%.3d", number);
+
+  /* If the number would lead to an overflow of the maximum ID name length, we need to truncate
+   * the base name part and do all the number checks again. */
+  if (base_name_len + number_str_len >= MAX_ID_NAME - 2 || number >= MAX_NUMBER) {
+    if (base_name_len + number_str_len >= MAX_ID_NAME - 2) {
+      base_name_len = MAX_ID_NAME - 2 - number_str_len - 1;
+    }
+    else {
+      base_name_len--;
+    }
+    base_name[base_name_len] = '\0';
+
+    /* Code above may have generated invalid utf-8 string, due to raw truncation.
+     * Ensure we get a valid one now. */
+    base_name_len -= (size_t)BLI_utf8_invalid_strip(base_name, base_name_len);
+
+    /* Also truncate orig name, and start the whole check again. */
+    name[base_name_len] = '\0';
+    return false;
+  }
+
+  /* We have our final number, we can put it in name and exit the function. */
+  BLI_strncpy(name + base_name_len, number_str, number_str_len + 1);
+  return true;
+}
+
+/* The ID using the number preceding given one, after which a new ID can be sorted. */
+static ID *namemap_sorting_hint(UniqueName_TypeMap *type_map,
+                                const char *base_name,
+                                const int number)
+{
+  char name[MAX_ID_NAME - 2];
+  if (number - 1 < MIN_NUMBER) {
+    BLI_strncpy(name, base_name, sizeof(name));
+  }
+  else {
+    BLI_snprintf(name, sizeof(name), "%s.%.3d", base_name, number - 1);
+  }
+  return namemap_find(type_map, name);
+}
+
+/**
+ * Check to see if an ID name is already used by another local ID, and find a new one if so.
+ * Given \a id is registered in the name map with the resulting name.
+ *
+ * \param r_id_sorting_hint: Set to an ID after which \a id can be sorted in the list, if known.
+ * \return true if a new name was created (returned in name).
+ */
+bool BKE_main_namemap_get_name(Main *bmain, ID *id, char *name, ID **r_id_sorting_hint)
+{
+  BLI_assert(strlen(name) < MAX_ID_NAME - 2);
+  BLI_assert(!ID_IS_LINKED(id));
+
+  UniqueName_TypeMap *type_map = namemap_type_ensure(bmain, GS(id->name));
+  bool is_name_changed = false;
+
+  *r_id_sorting_hint = NULL;
+
+  while (true) {
+    ID *id_test = namemap_find(type_map, name);
+    /* If there is no double, we are done.
+     * Note however that name might have been changed (truncated) in a previous iteration. */
+    if (id_test == NULL || id_test == id) {
+      namemap_register(type_map, id, name);
+      return is_name_changed;
+    }
+
+    /* Get the name and number parts ("name.number"). */
+    char base_name[MAX_ID_NAME - 2];
+    int number = MIN_NUMBER;
+    size_t base_name_len = BLI_split_name_num(base_name, &number, name, '.');
+
+    /* In case we get an insane initial number suffix in given name. */
+    if (number >= MAX_NUMBER || number < MIN_NUMBER) {
+      number = MIN_NUMBER;
+    }
+
+    /* We know for sure that name will be changed. */
+    is_name_changed = true;
+
+    UniqueName_Base *base = namemap_base_ensure(type_map, base_name);
+    while (true) {
+      const int number_test = namemap_number_unused(base, number);
+
+      /* If id_name_final_build helper returns false, it had to truncate further given name,
+       * hence we have to go over the whole check again. */
+      if (!id_name_final_build(name, base_name, base_name_len, number_test)) {
+        break;
+      }
+
+      id_test = namemap_find(type_map, name);
+      if (id_test == NULL || id_test == id) {
+        namemap_register(type_map, id, name);
+        *r_id_sorting_hint = namemap_sorting_hint(type_map, base_name, number_test);
+        return is_name_changed;
+      }
+
+      /* Number is used by an ID which was renamed without updating the name map, or which
+       * spells it differently ("name.01" and "name.001"). */
+      namemap_number_set_used(base, number_test);
+    }
+  }
+}
+
+/**
+ * Remove given \a id from the name map, to be called before removing it from its #Main list.
+ */
+void BKE_main_namemap_remove_name(Main *bmain, ID *id)
+{
+  if (bmain->name_map == NULL) {
+    return;
+  }
+
+  UniqueName_TypeMap *type_map =
+      bmain->name_map->type_maps[BKE_idcode_to_index(GS(id->name))];
+  if (type_map != NULL) {
+    namemap_unregister(type_map, id);
+  }
+}
+
+/**
+ * Index given local \a id under its current name, which has to be unique already. To be called
+ * after moving it into the list of \a bmain from another #Main.
+ */
+void BKE_main_namemap_add_name(Main *bmain, ID *id)
+{
+  if (bmain->name_map == NULL || ID_IS_LINKED(id)) {
+    return;
+  }
+
+  UniqueName_TypeMap *type_map =
+      bmain->name_map->type_maps[BKE_idcode_to_index(GS(id->name))];
+  if (type_map != NULL) {
+    namemap_register(type_map, id, id->name + 2);
+  }
+}
+
+/**
+ * Check that all local IDs of \a bmain have a unique name, which is the one they are indexed with.
+ */
+bool BKE_main_namemap_validate(Main *bmain)
+{
+  bool is_valid = true;
+
+  ListBase *lbarray[MAX_LIBARRAY];
+  int a = set_listbasepointers(bmain, lbarray);
+  while (a--) {
+    for (ID *id = lbarray[a]->first; id; id = id->next) {
+      if (!ID_IS_LINKED(id) && BKE_main_namemap_find(bmain, GS(id->name), id->name + 2) != id) {
+        CLOG_ERROR(&LOG, "'%s' is not unique or not indexed", id->name);
+        is_valid = false;
+      }
+    }
+  }
+
+  return is_valid;
+}
+
+/** \} */
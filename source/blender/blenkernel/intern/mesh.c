@@ -587,7 +587,16 @@ void BKE_mesh_copy_data(Main *bmain, Mesh *me_dst, const Mesh *me_src, const int
 
   me_dst->mat = MEM_dupallocN(me_src->mat);
 
-  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
+  eCDAllocType alloc_type = CD_DUPLICATE;
+  if (flag & LIB_ID_COPY_CD_REFERENCE) {
+    alloc_type = CD_REFERENCE;
+  }
+  else if (flag & LIB_ID_COPY_CD_SHARE) {
+    alloc_type = CD_SHARE;
+  }
+  else if (flag & LIB_ID_COPY_CD_SHARE_UNOWNED) {
+    alloc_type = CD_SHARE_UNOWNED;
+  }
   CustomData_copy(&me_src->vdata, &me_dst->vdata, mask.vmask, alloc_type, me_dst->totvert);
   CustomData_copy(&me_src->edata, &me_dst->edata, mask.emask, alloc_type, me_dst->totedge);
   CustomData_copy(&me_src->ldata, &me_dst->ldata, mask.lmask, alloc_type, me_dst->totloop);
@@ -1568,6 +1577,7 @@ void BKE_mesh_vert_coords_apply(Mesh *mesh, const float (*vert_coords)[3])
     copy_v3_v3(mv->co, vert_coords[i]);
   }
   mesh->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+  BKE_mesh_runtime_normals_tag_dirty(mesh);
 }
 
 void BKE_mesh_vert_coords_apply_with_mat4(Mesh *mesh,
@@ -1581,6 +1591,7 @@ void BKE_mesh_vert_coords_apply_with_mat4(Mesh *mesh,
     mul_v3_m4v3(mv->co, mat, vert_coords[i]);
   }
   mesh->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+  BKE_mesh_runtime_normals_tag_dirty(mesh);
 }
 
 void BKE_mesh_vert_normals_apply(Mesh *mesh, const short (*vert_normals)[3])
@@ -1592,6 +1603,7 @@ void BKE_mesh_vert_normals_apply(Mesh *mesh, const short (*vert_normals)[3])
     copy_v3_v3_short(mv->no, vert_normals[i]);
   }
   mesh->runtime.cd_dirty_vert &= ~CD_MASK_NORMAL;
+  BKE_mesh_runtime_normals_tag_dirty(mesh);
 }
 
 /**
@@ -1615,7 +1627,7 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
   const float split_angle = (mesh->flag & ME_AUTOSMOOTH) != 0 ? mesh->smoothresh : (float)M_PI;
 
   if (CustomData_has_layer(&mesh->ldata, CD_NORMAL)) {
-    r_loopnors = CustomData_get_layer(&mesh->ldata, CD_NORMAL);
+    r_loopnors = CustomData_duplicate_referenced_layer(&mesh->ldata, CD_NORMAL, mesh->totloop);
     memset(r_loopnors, 0, sizeof(float[3]) * mesh->totloop);
   }
   else {
@@ -1623,6 +1635,16 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
     CustomData_set_layer_flag(&mesh->ldata, CD_NORMAL, CD_FLAG_TEMPORARY);
   }
 
+  /* Reuse normals computed for other users of the mesh, when the smooth fans aren't needed. */
+  const float(*loopnors_cached)[3] = NULL;
+  if (r_lnors_spacearr == NULL) {
+    loopnors_cached = BKE_mesh_runtime_loop_normals_get(mesh, use_split_normals, split_angle);
+  }
+  if (loopnors_cached != NULL) {
+    memcpy(r_loopnors, loopnors_cached, sizeof(float[3]) * mesh->totloop);
+    return;
+  }
+
   /* may be NULL */
   clnors = CustomData_get_layer(&mesh->ldata, CD_CUSTOMLOOPNORMAL);
 
@@ -1666,6 +1688,9 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
     MEM_freeN(polynors);
   }
 
+  if (mesh->runtime.cd_dirty_vert & CD_MASK_NORMAL) {
+    BKE_mesh_runtime_normals_tag_dirty(mesh);
+  }
   mesh->runtime.cd_dirty_vert &= ~CD_MASK_NORMAL;
 }
 
@@ -48,6 +48,7 @@
 #include "BKE_customdata.h"
 #include "BKE_global.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
 #include "BKE_multires.h"
 #include "BKE_report.h"
 
@@ -216,6 +217,16 @@ typedef struct MeshCalcNormalsData {
   float (*pnors)[3];
   float (*lnors_weighted)[3];
   float (*vnors)[3];
+  /* Loops using each vertex, for the threaded accumulation of weighted loop normals.
+   * Vertex `v` uses `vert_loops[vert_loops_end[v - 1]]` to `vert_loops[vert_loops_end[v]]`
+   * (from zero for the first vertex). While the map is built, `vert_loops_end` first holds the
+   * number of loops of each vertex, then the first slot of each vertex, used as fill cursor. */
+  int *vert_loops_end;
+  int *vert_loops;
+  /* First slot of each block of #MESH_NORMALS_SCAN_BLOCK_SIZE vertices, for the threaded prefix
+   * sum of the loops counts. */
+  int *vert_blocks_offset;
+  int numVerts;
 } MeshCalcNormalsData;
 
 static void mesh_calc_normals_poly_cb(void *__restrict userdata,
@@ -272,7 +283,7 @@ static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
 
   /* accumulate angle weighted face normal */
   /* inline version of #accumulate_vertex_normals_poly_v3,
-   * split between this threaded callback and #mesh_calc_normals_poly_accum_cb. */
+   * split between this threaded callback and the accumulation of weighted loop normals. */
   {
     const float *prev_edge = edgevecbuf[nverts - 1];
 
@@ -287,11 +298,57 @@ static void mesh_calc_normals_poly_prepare_cb(void *__restrict userdata,
       /* Store for later accumulation */
       mul_v3_v3fl(lnors_weighted[lidx], pnor, fac);
 
+      if (data->vert_loops_end) {
+        atomic_add_and_fetch_int32(&data->vert_loops_end[ml[i].v], 1);
+      }
+
       prev_edge = cur_edge;
     }
   }
 }
 
+#define MESH_NORMALS_SCAN_BLOCK_SIZE 4096
+
+static void mesh_calc_normals_poly_scan_count_cb(void *__restrict userdata,
+                                                 const int block,
+                                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshCalcNormalsData *data = userdata;
+  const int vidx_start = block * MESH_NORMALS_SCAN_BLOCK_SIZE;
+  const int vidx_end = min_ii(vidx_start + MESH_NORMALS_SCAN_BLOCK_SIZE, data->numVerts);
+
+  int count = 0;
+  for (int vidx = vidx_start; vidx < vidx_end; vidx++) {
+    count += data->vert_loops_end[vidx];
+  }
+  data->vert_blocks_offset[block] = count;
+}
+
+static void mesh_calc_normals_poly_scan_offset_cb(void *__restrict userdata,
+                                                  const int block,
+                                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshCalcNormalsData *data = userdata;
+  const int vidx_start = block * MESH_NORMALS_SCAN_BLOCK_SIZE;
+  const int vidx_end = min_ii(vidx_start + MESH_NORMALS_SCAN_BLOCK_SIZE, data->numVerts);
+
+  int offset = data->vert_blocks_offset[block];
+  for (int vidx = vidx_start; vidx < vidx_end; vidx++) {
+    const int count = data->vert_loops_end[vidx];
+    data->vert_loops_end[vidx] = offset;
+    offset += count;
+  }
+}
+
+static void mesh_calc_normals_poly_fill_cb(void *__restrict userdata,
+                                           const int lidx,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  MeshCalcNormalsData *data = userdata;
+  const int slot = atomic_fetch_and_add_int32(&data->vert_loops_end[data->mloop[lidx].v], 1);
+  data->vert_loops[slot] = lidx;
+}
+
 static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
                                                const int vidx,
                                                const TaskParallelTLS *__restrict UNUSED(tls))
@@ -301,6 +358,27 @@ static void mesh_calc_normals_poly_finalize_cb(void *__restrict userdata,
   MVert *mv = &data->mverts[vidx];
   float *no = data->vnors[vidx];
 
+  if (data->vert_loops) {
+    int *vert_loops = data->vert_loops;
+    const int start = (vidx == 0) ? 0 : data->vert_loops_end[vidx - 1];
+    const int end = data->vert_loops_end[vidx];
+
+    /* Loops are filled in any order by the threads, sort the few of this vertex so they are
+     * summed in ascending order, like in the single threaded accumulation. */
+    for (int i = start + 1; i < end; i++) {
+      const int lidx = vert_loops[i];
+      int j = i;
+      for (; j > start && vert_loops[j - 1] > lidx; j--) {
+        vert_loops[j] = vert_loops[j - 1];
+      }
+      vert_loops[j] = lidx;
+    }
+
+    for (int i = start; i < end; i++) {
+      add_v3_v3(no, data->lnors_weighted[vert_loops[i]]);
+    }
+  }
+
   if (UNLIKELY(normalize_v3(no) == 0.0f)) {
     /* following Mesh convention; we use vertex coordinate itself for normal in this case */
     normalize_v3_v3(no, mv->co);
@@ -340,6 +418,12 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
     return;
   }
 
+  /* With multiple threads, weighted loop normals are gathered per vertex through a map of the
+   * loops using each vertex, instead of being accumulated afterwards in a single thread.
+   * Both sum them in loop order, so vertex normals do not depend on the number of threads. */
+  const bool use_threaded_accum = numPolys > settings.min_iter_per_thread &&
+                                  BLI_task_scheduler_num_threads(BLI_task_scheduler_get()) > 1;
+
   float(*vnors)[3] = r_vertnors;
   float(*lnors_weighted)[3] = MEM_malloc_arrayN(
       (size_t)numLoops, sizeof(*lnors_weighted), __func__);
@@ -363,24 +447,59 @@ void BKE_mesh_calc_normals_poly(MVert *mverts,
       .vnors = vnors,
   };
 
+  if (use_threaded_accum) {
+    data.vert_loops_end = MEM_calloc_arrayN((size_t)numVerts, sizeof(int), __func__);
+    data.numVerts = numVerts;
+  }
+
   /* Compute poly normals, and prepare weighted loop normals. */
   BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_prepare_cb, &settings);
 
-  /* Actually accumulate weighted loop normals into vertex ones. */
-  /* Unfortunately, not possible to thread that
-   * (not in a reasonable, totally lock- and barrier-free fashion),
-   * since several loops will point to the same vertex... */
-  for (int lidx = 0; lidx < numLoops; lidx++) {
-    add_v3_v3(vnors[mloop[lidx].v], data.lnors_weighted[lidx]);
+  if (use_threaded_accum) {
+    /* Build the map of loops using each vertex: a prefix sum of the loops counts by blocks of
+     * vertices, then every loop takes the next slot of its vertex. */
+    const int blocks_num = (numVerts + MESH_NORMALS_SCAN_BLOCK_SIZE - 1) /
+                           MESH_NORMALS_SCAN_BLOCK_SIZE;
+    data.vert_blocks_offset = MEM_malloc_arrayN((size_t)blocks_num, sizeof(int), __func__);
+    data.vert_loops = MEM_malloc_arrayN((size_t)numLoops, sizeof(int), __func__);
+
+    TaskParallelSettings scan_settings;
+    BLI_parallel_range_settings_defaults(&scan_settings);
+    scan_settings.min_iter_per_thread = 1;
+
+    BLI_task_parallel_range(
+        0, blocks_num, &data, mesh_calc_normals_poly_scan_count_cb, &scan_settings);
+    int offset = 0;
+    for (int block = 0; block < blocks_num; block++) {
+      const int count = data.vert_blocks_offset[block];
+      data.vert_blocks_offset[block] = offset;
+      offset += count;
+    }
+    BLI_task_parallel_range(
+        0, blocks_num, &data, mesh_calc_normals_poly_scan_offset_cb, &scan_settings);
+
+    BLI_task_parallel_range(0, numLoops, &data, mesh_calc_normals_poly_fill_cb, &settings);
+  }
+  else {
+    /* Actually accumulate weighted loop normals into vertex ones. */
+    for (int lidx = 0; lidx < numLoops; lidx++) {
+      add_v3_v3(vnors[mloop[lidx].v], lnors_weighted[lidx]);
+    }
   }
 
-  /* Normalize and validate computed vertex normals. */
+  /* Gather weighted loop normals when threaded, normalize and validate computed vertex normals. */
   BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_cb, &settings);
 
+  MEM_freeN(lnors_weighted);
+  if (use_threaded_accum) {
+    MEM_freeN(data.vert_loops_end);
+    MEM_freeN(data.vert_blocks_offset);
+    MEM_freeN(data.vert_loops);
+  }
+
   if (free_vnors) {
     MEM_freeN(vnors);
   }
-  MEM_freeN(lnors_weighted);
 }
 
 void BKE_mesh_ensure_normals(Mesh *mesh)
@@ -402,6 +521,9 @@ void BKE_mesh_ensure_normals_for_display(Mesh *mesh)
 
   if (do_vert_normals || do_poly_normals) {
     const bool do_add_poly_nors_cddata = (poly_nors == NULL);
+    if (!do_add_poly_nors_cddata) {
+      poly_nors = CustomData_duplicate_referenced_layer(&mesh->pdata, CD_NORMAL, mesh->totpoly);
+    }
     if (do_add_poly_nors_cddata) {
       poly_nors = MEM_malloc_arrayN((size_t)mesh->totpoly, sizeof(*poly_nors), __func__);
     }
@@ -423,6 +545,7 @@ void BKE_mesh_ensure_normals_for_display(Mesh *mesh)
 
     mesh->runtime.cd_dirty_vert &= ~CD_MASK_NORMAL;
     mesh->runtime.cd_dirty_poly &= ~CD_MASK_NORMAL;
+    BKE_mesh_runtime_normals_tag_dirty(mesh);
   }
 }
 
@@ -446,6 +569,7 @@ void BKE_mesh_calc_normals(Mesh *mesh)
   TIMEIT_END_AVERAGED(BKE_mesh_calc_normals);
 #endif
   mesh->runtime.cd_dirty_vert &= ~CD_MASK_NORMAL;
+  BKE_mesh_runtime_normals_tag_dirty(mesh);
 }
 
 void BKE_mesh_calc_normals_looptri(MVert *mverts,
@@ -2078,6 +2202,8 @@ static void mesh_set_custom_normals(Mesh *mesh, float (*r_custom_nors)[3], const
                                mesh->totpoly,
                                clnors,
                                use_vertices);
+  /* Cached loop normals used the previous custom normals. */
+  BKE_mesh_runtime_normals_tag_dirty(mesh);
 
   if (free_polynors) {
     MEM_freeN(polynors);
@@ -112,6 +112,83 @@ static bool mesh_remap_bvhtree_query_raycast(BVHTreeFromMesh *treedata,
   }
 }
 
+/**
+ * Batched version of #mesh_remap_bvhtree_query_nearest, for all \a cos at once.
+ *
+ * \return An array of \a num results, whose index is -1 when there is no source within
+ * \a max_dist_sq, to be freed by the caller.
+ */
+static BVHTreeNearest *mesh_remap_bvhtree_query_nearest_batch(BVHTreeFromMesh *treedata,
+                                                              const float (*cos)[3],
+                                                              const int num,
+                                                              const float max_dist_sq)
+{
+  BVHTreeNearest *nearest = MEM_malloc_arrayN((size_t)num, sizeof(*nearest), __func__);
+
+  for (int i = 0; i < num; i++) {
+    nearest[i].index = -1;
+    nearest[i].dist_sq = max_dist_sq;
+  }
+  BLI_bvhtree_find_nearest_batch(
+      treedata->tree, cos, num, nearest, treedata->nearest_callback, treedata, 0);
+
+  return nearest;
+}
+
+/**
+ * Batched version of #mesh_remap_bvhtree_query_raycast, for all \a cos and \a nos at once.
+ *
+ * \return An array of \a num results, whose index is -1 when there is no source within
+ * \a max_dist, to be freed by the caller.
+ */
+static BVHTreeRayHit *mesh_remap_bvhtree_query_raycast_batch(BVHTreeFromMesh *treedata,
+                                                             const float (*cos)[3],
+                                                             const float (*nos)[3],
+                                                             const int num,
+                                                             const float radius,
+                                                             const float max_dist)
+{
+  BVHTreeRayHit *rayhits = MEM_malloc_arrayN((size_t)num, sizeof(*rayhits), __func__);
+  BVHTreeRayHit *rayhits_inv = MEM_malloc_arrayN((size_t)num, sizeof(*rayhits_inv), __func__);
+  float(*inv_nos)[3] = MEM_malloc_arrayN((size_t)num, sizeof(*inv_nos), __func__);
+
+  for (int i = 0; i < num; i++) {
+    rayhits[i].index = rayhits_inv[i].index = -1;
+    rayhits[i].dist = rayhits_inv[i].dist = max_dist;
+    negate_v3_v3(inv_nos[i], nos[i]);
+  }
+  BLI_bvhtree_ray_cast_batch(treedata->tree,
+                             cos,
+                             nos,
+                             num,
+                             radius,
+                             rayhits,
+                             treedata->raycast_callback,
+                             treedata,
+                             BVH_RAYCAST_DEFAULT);
+
+  /* Also cast in the other direction! */
+  BLI_bvhtree_ray_cast_batch(treedata->tree,
+                             cos,
+                             (const float(*)[3])inv_nos,
+                             num,
+                             radius,
+                             rayhits_inv,
+                             treedata->raycast_callback,
+                             treedata,
+                             BVH_RAYCAST_DEFAULT);
+  for (int i = 0; i < num; i++) {
+    if (rayhits_inv[i].dist < rayhits[i].dist) {
+      rayhits[i] = rayhits_inv[i];
+    }
+  }
+
+  MEM_freeN(rayhits_inv);
+  MEM_freeN(inv_nos);
+
+  return rayhits;
+}
+
 /** \} */
 
 /**
@@ -519,51 +596,49 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
   }
   else {
     BVHTreeFromMesh treedata = {NULL};
-    BVHTreeNearest nearest = {0};
-    BVHTreeRayHit rayhit = {0};
-    float hit_dist;
-    float tmp_co[3], tmp_no[3];
+    float(*vcos_dst)[3] = MEM_malloc_arrayN((size_t)numverts_dst, sizeof(*vcos_dst), __func__);
+
+    /* Convert the vertices to tree coordinates, if needed. */
+    for (i = 0; i < numverts_dst; i++) {
+      copy_v3_v3(vcos_dst[i], verts_dst[i].co);
+      if (space_transform) {
+        BLI_space_transform_apply(space_transform, vcos_dst[i]);
+      }
+    }
 
     if (mode == MREMAP_MODE_VERT_NEAREST) {
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_VERTS, 2);
-      nearest.index = -1;
 
-      for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
+      BVHTreeNearest *nearest = mesh_remap_bvhtree_query_nearest_batch(
+          &treedata, (const float(*)[3])vcos_dst, numverts_dst, max_dist_sq);
 
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
-
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest.index, &full_weight);
+      for (i = 0; i < numverts_dst; i++) {
+        if (nearest[i].index != -1) {
+          const float hit_dist = sqrtf(nearest[i].dist_sq);
+          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest[i].index, &full_weight);
         }
         else {
           /* No source for this dest vertex! */
           BKE_mesh_remap_item_define_invalid(r_map, i);
         }
       }
+
+      MEM_freeN(nearest);
     }
     else if (ELEM(mode, MREMAP_MODE_VERT_EDGE_NEAREST, MREMAP_MODE_VERT_EDGEINTERP_NEAREST)) {
       MEdge *edges_src = me_src->medge;
       float(*vcos_src)[3] = BKE_mesh_vert_coords_alloc(me_src, NULL);
 
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_EDGES, 2);
-      nearest.index = -1;
-
-      for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
 
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
+      BVHTreeNearest *nearest = mesh_remap_bvhtree_query_nearest_batch(
+          &treedata, (const float(*)[3])vcos_dst, numverts_dst, max_dist_sq);
 
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          MEdge *me = &edges_src[nearest.index];
+      for (i = 0; i < numverts_dst; i++) {
+        if (nearest[i].index != -1) {
+          const float *tmp_co = vcos_dst[i];
+          const float hit_dist = sqrtf(nearest[i].dist_sq);
+          MEdge *me = &edges_src[nearest[i].index];
           const float *v1cos = vcos_src[me->v1];
           const float *v2cos = vcos_src[me->v2];
 
@@ -594,6 +669,7 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
         }
       }
 
+      MEM_freeN(nearest);
       MEM_freeN(vcos_src);
     }
     else if (ELEM(mode,
@@ -612,24 +688,36 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_LOOPTRI, 2);
 
       if (mode == MREMAP_MODE_VERT_POLYINTERP_VNORPROJ) {
+        float(*vnos_dst)[3] = MEM_malloc_arrayN(
+            (size_t)numverts_dst, sizeof(*vnos_dst), __func__);
+
         for (i = 0; i < numverts_dst; i++) {
-          copy_v3_v3(tmp_co, verts_dst[i].co);
-          normal_short_to_float_v3(tmp_no, verts_dst[i].no);
+          normal_short_to_float_v3(vnos_dst[i], verts_dst[i].no);
 
-          /* Convert the vertex to tree coordinates, if needed. */
+          /* Convert the normal to tree coordinates, if needed. */
           if (space_transform) {
-            BLI_space_transform_apply(space_transform, tmp_co);
-            BLI_space_transform_apply_normal(space_transform, tmp_no);
+            BLI_space_transform_apply_normal(space_transform, vnos_dst[i]);
           }
+        }
+
+        BVHTreeRayHit *rayhits = mesh_remap_bvhtree_query_raycast_batch(
+            &treedata,
+            (const float(*)[3])vcos_dst,
+            (const float(*)[3])vnos_dst,
+            numverts_dst,
+            ray_radius,
+            max_dist);
+
+        for (i = 0; i < numverts_dst; i++) {
+          const BVHTreeRayHit *rayhit = &rayhits[i];
 
-          if (mesh_remap_bvhtree_query_raycast(
-                  &treedata, &rayhit, tmp_co, tmp_no, ray_radius, max_dist, &hit_dist)) {
-            const MLoopTri *lt = &treedata.looptri[rayhit.index];
+          if (rayhit->index != -1) {
+            const MLoopTri *lt = &treedata.looptri[rayhit->index];
             MPoly *mp_src = &polys_src[lt->poly];
             const int sources_num = mesh_remap_interp_poly_data_get(mp_src,
                                                                     loops_src,
                                                                     (const float(*)[3])vcos_src,
-                                                                    rayhit.co,
+                                                                    rayhit->co,
                                                                     &tmp_buff_size,
                                                                     &vcos,
                                                                     false,
@@ -638,28 +726,25 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
                                                                     true,
                                                                     NULL);
 
-            mesh_remap_item_define(r_map, i, hit_dist, 0, sources_num, indices, weights);
+            mesh_remap_item_define(r_map, i, rayhit->dist, 0, sources_num, indices, weights);
           }
           else {
             /* No source for this dest vertex! */
             BKE_mesh_remap_item_define_invalid(r_map, i);
           }
         }
+
+        MEM_freeN(rayhits);
+        MEM_freeN(vnos_dst);
       }
       else {
-        nearest.index = -1;
+        BVHTreeNearest *nearest = mesh_remap_bvhtree_query_nearest_batch(
+            &treedata, (const float(*)[3])vcos_dst, numverts_dst, max_dist_sq);
 
         for (i = 0; i < numverts_dst; i++) {
-          copy_v3_v3(tmp_co, verts_dst[i].co);
-
-          /* Convert the vertex to tree coordinates, if needed. */
-          if (space_transform) {
-            BLI_space_transform_apply(space_transform, tmp_co);
-          }
-
-          if (mesh_remap_bvhtree_query_nearest(
-                  &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-            const MLoopTri *lt = &treedata.looptri[nearest.index];
+          if (nearest[i].index != -1) {
+            const float hit_dist = sqrtf(nearest[i].dist_sq);
+            const MLoopTri *lt = &treedata.looptri[nearest[i].index];
             MPoly *mp = &polys_src[lt->poly];
 
             if (mode == MREMAP_MODE_VERT_POLY_NEAREST) {
@@ -667,7 +752,7 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
               mesh_remap_interp_poly_data_get(mp,
                                               loops_src,
                                               (const float(*)[3])vcos_src,
-                                              nearest.co,
+                                              nearest[i].co,
                                               &tmp_buff_size,
                                               &vcos,
                                               false,
@@ -682,7 +767,7 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
               const int sources_num = mesh_remap_interp_poly_data_get(mp,
                                                                       loops_src,
                                                                       (const float(*)[3])vcos_src,
-                                                                      nearest.co,
+                                                                      nearest[i].co,
                                                                       &tmp_buff_size,
                                                                       &vcos,
                                                                       false,
@@ -699,6 +784,8 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
             BKE_mesh_remap_item_define_invalid(r_map, i);
           }
         }
+
+        MEM_freeN(nearest);
       }
 
       MEM_freeN(vcos_src);
@@ -711,6 +798,7 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
       memset(r_map->items, 0, sizeof(*r_map->items) * (size_t)numverts_dst);
     }
 
+    MEM_freeN(vcos_dst);
     free_bvhtree_from_mesh(&treedata);
   }
 }
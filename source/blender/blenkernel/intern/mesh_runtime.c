@@ -29,10 +29,12 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_object_types.h"
 
+#include "BLI_linklist.h"
 #include "BLI_math_geom.h"
 #include "BLI_threads.h"
 
 #include "BKE_bvhutils.h"
+#include "BKE_customdata.h"
 #include "BKE_library.h"
 #include "BKE_mesh.h"
 #include "BKE_mesh_runtime.h"
@@ -68,7 +70,10 @@ void BKE_mesh_runtime_reset_on_copy(Mesh *mesh, const int UNUSED(flag))
   runtime->subdiv_ccg = NULL;
   memset(&runtime->looptris, 0, sizeof(runtime->looptris));
   runtime->bvh_cache = NULL;
+  runtime->bvh_cache_prev = NULL;
+  runtime->topology_hash = 0;
   runtime->shrinkwrap_data = NULL;
+  runtime->normals_cache = NULL;
 
   mesh->runtime.eval_mutex = MEM_mallocN(sizeof(ThreadMutex), "mesh runtime eval_mutex");
   BLI_mutex_init(mesh->runtime.eval_mutex);
@@ -86,6 +91,7 @@ void BKE_mesh_runtime_clear_cache(Mesh *mesh)
     BKE_id_free(NULL, mesh->runtime.mesh_eval);
     mesh->runtime.mesh_eval = NULL;
   }
+  bvhcache_free(&mesh->runtime.bvh_cache_prev);
   BKE_mesh_runtime_clear_geometry(mesh);
   BKE_mesh_batch_cache_free(mesh);
   BKE_mesh_runtime_clear_edit_data(mesh);
@@ -228,6 +234,7 @@ bool BKE_mesh_runtime_clear_edit_data(Mesh *mesh)
 void BKE_mesh_runtime_clear_geometry(Mesh *mesh)
 {
   bvhcache_free(&mesh->runtime.bvh_cache);
+  mesh->runtime.topology_hash = 0;
   MEM_SAFE_FREE(mesh->runtime.looptris.array);
   /* TODO(sergey): Does this really belong here? */
   if (mesh->runtime.subdiv_ccg != NULL) {
@@ -235,6 +242,190 @@ void BKE_mesh_runtime_clear_geometry(Mesh *mesh)
     mesh->runtime.subdiv_ccg = NULL;
   }
   BKE_shrinkwrap_discard_boundary_data(mesh);
+  BKE_mesh_runtime_normals_tag_dirty(mesh);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Mesh Normals Cache
+ *
+ * Poly and loop normals are computed on demand and kept until the geometry changes, so they
+ * can be shared by the modifier stack, drawing and exporters. Code changing the geometry or
+ * custom normals of a mesh in place has to call #BKE_mesh_runtime_normals_tag_dirty.
+ *
+ * Returned arrays stay valid until the mesh is tagged dirty, which like any other change of the
+ * geometry must not happen while other threads use the mesh. Normals computed again, for other
+ * settings or because vertex normals were tagged dirty, are stored in new arrays, the previous
+ * ones are only freed with the cache. Access is synchronized by the #Mesh_Runtime.eval_mutex of
+ * the mesh, so unrelated meshes are handled in parallel.
+ * \{ */
+
+typedef struct MeshNormalsCache {
+  float (*poly_normals)[3];
+
+  /* Loop normals and the settings they were computed with. */
+  float (*loop_normals)[3];
+  float split_angle;
+  bool use_split_normals;
+
+  /* Normals were computed while vertex normals were tagged dirty. */
+  bool is_vert_normals_dirty;
+  /* Arrays of previous computations, which may still be used by readers. */
+  LinkNode *retired;
+} MeshNormalsCache;
+
+/* Vertex normals are tagged dirty by code deforming the mesh without tagging the cache. Normals
+ * computed before that are outdated, normals computed after that are kept until the cache is
+ * tagged dirty, so normals are not computed again for every call. */
+static bool mesh_normals_cache_is_valid(const Mesh *mesh)
+{
+  const MeshNormalsCache *cache = mesh->runtime.normals_cache;
+
+  return cache != NULL && cache->poly_normals != NULL &&
+         ((mesh->runtime.cd_dirty_vert & CD_MASK_NORMAL) == 0 || cache->is_vert_normals_dirty);
+}
+
+static bool mesh_normals_cache_loop_is_valid(const Mesh *mesh,
+                                             const bool use_split_normals,
+                                             const float split_angle)
+{
+  const MeshNormalsCache *cache = mesh->runtime.normals_cache;
+
+  return mesh_normals_cache_is_valid(mesh) && cache->loop_normals != NULL &&
+         cache->use_split_normals == use_split_normals && cache->split_angle == split_angle;
+}
+
+static void mesh_normals_cache_retire(MeshNormalsCache *cache, void *array)
+{
+  if (array != NULL) {
+    BLI_linklist_prepend(&cache->retired, array);
+  }
+}
+
+/* Get a cache matching the current geometry, must be called with the lock. */
+static MeshNormalsCache *mesh_normals_cache_ensure(Mesh *mesh)
+{
+  if (mesh->runtime.normals_cache == NULL) {
+    mesh->runtime.normals_cache = MEM_callocN(sizeof(MeshNormalsCache), __func__);
+  }
+
+  MeshNormalsCache *cache = mesh->runtime.normals_cache;
+
+  if (!mesh_normals_cache_is_valid(mesh)) {
+    /* Arrays returned before must stay valid, keep them until the cache is freed. */
+    mesh_normals_cache_retire(cache, cache->poly_normals);
+    mesh_normals_cache_retire(cache, cache->loop_normals);
+    cache->loop_normals = NULL;
+
+    float(*poly_normals)[3] = MEM_malloc_arrayN(
+        (size_t)mesh->totpoly, sizeof(*poly_normals), __func__);
+    BKE_mesh_calc_normals_poly(mesh->mvert,
+                               NULL,
+                               mesh->totvert,
+                               mesh->mloop,
+                               mesh->mpoly,
+                               mesh->totloop,
+                               mesh->totpoly,
+                               poly_normals,
+                               true);
+    cache->poly_normals = poly_normals;
+    cache->is_vert_normals_dirty = (mesh->runtime.cd_dirty_vert & CD_MASK_NORMAL) != 0;
+  }
+
+  return cache;
+}
+
+/**
+ * Free the cached normals, must be called when the geometry or custom normals change in place.
+ */
+void BKE_mesh_runtime_normals_tag_dirty(Mesh *mesh)
+{
+  MeshNormalsCache *cache = mesh->runtime.normals_cache;
+
+  if (cache != NULL) {
+    MEM_SAFE_FREE(cache->poly_normals);
+    MEM_SAFE_FREE(cache->loop_normals);
+    BLI_linklist_free(cache->retired, MEM_freeN);
+    MEM_freeN(cache);
+    mesh->runtime.normals_cache = NULL;
+  }
+}
+
+/**
+ * Get the poly normals, computing them if they are not cached yet.
+ * The result is owned by the mesh and must not be modified.
+ */
+const float (*BKE_mesh_runtime_poly_normals_ensure(Mesh *mesh))[3]
+{
+  BLI_mutex_lock(mesh->runtime.eval_mutex);
+  const float(*poly_normals)[3] = (const float(*)[3])mesh_normals_cache_ensure(mesh)->poly_normals;
+  BLI_mutex_unlock(mesh->runtime.eval_mutex);
+
+  return poly_normals;
+}
+
+/**
+ * Get the loop normals as computed by #BKE_mesh_normals_loop_split with the given settings,
+ * using the custom normals of the mesh. Computed if they are not cached yet with these settings.
+ * The result is owned by the mesh and must not be modified.
+ */
+const float (*BKE_mesh_runtime_loop_normals_ensure(Mesh *mesh,
+                                                   const bool use_split_normals,
+                                                   const float split_angle))[3]
+{
+  BLI_mutex_lock(mesh->runtime.eval_mutex);
+
+  if (!mesh_normals_cache_loop_is_valid(mesh, use_split_normals, split_angle)) {
+    MeshNormalsCache *cache = mesh_normals_cache_ensure(mesh);
+    short(*clnors)[2] = CustomData_get_layer(&mesh->ldata, CD_CUSTOMLOOPNORMAL);
+
+    /* Never written once returned, other threads may be reading normals of other settings. */
+    mesh_normals_cache_retire(cache, cache->loop_normals);
+    float(*loop_normals_new)[3] = MEM_malloc_arrayN(
+        (size_t)mesh->totloop, sizeof(*loop_normals_new), __func__);
+    BKE_mesh_normals_loop_split(mesh->mvert,
+                                mesh->totvert,
+                                mesh->medge,
+                                mesh->totedge,
+                                mesh->mloop,
+                                loop_normals_new,
+                                mesh->totloop,
+                                mesh->mpoly,
+                                (const float(*)[3])cache->poly_normals,
+                                mesh->totpoly,
+                                use_split_normals,
+                                split_angle,
+                                NULL,
+                                clnors,
+                                NULL);
+    cache->loop_normals = loop_normals_new;
+    cache->use_split_normals = use_split_normals;
+    cache->split_angle = split_angle;
+  }
+  const float(*loop_normals)[3] = (const float(*)[3])mesh->runtime.normals_cache->loop_normals;
+
+  BLI_mutex_unlock(mesh->runtime.eval_mutex);
+
+  return loop_normals;
+}
+
+/**
+ * Get the loop normals if they are cached with the given settings, NULL otherwise.
+ */
+const float (*BKE_mesh_runtime_loop_normals_get(Mesh *mesh,
+                                                const bool use_split_normals,
+                                                const float split_angle))[3]
+{
+  const float(*loop_normals)[3] = NULL;
+
+  BLI_mutex_lock(mesh->runtime.eval_mutex);
+  if (mesh_normals_cache_loop_is_valid(mesh, use_split_normals, split_angle)) {
+    loop_normals = (const float(*)[3])mesh->runtime.normals_cache->loop_normals;
+  }
+  BLI_mutex_unlock(mesh->runtime.eval_mutex);
+
+  return loop_normals;
 }
 
 /** \} */
@@ -249,6 +440,10 @@ void (*BKE_mesh_batch_cache_free_cb)(Mesh *me) = NULL;
 
 void BKE_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
 {
+  if (mode == BKE_MESH_BATCH_DIRTY_ALL) {
+    /* Geometry was edited in place. */
+    BKE_mesh_runtime_normals_tag_dirty(me);
+  }
   if (me->runtime.batch_cache) {
     BKE_mesh_batch_cache_dirty_tag_cb(me, mode);
   }
@@ -1177,6 +1177,7 @@ void BKE_mesh_strip_loose_faces(Mesh *me)
   if (a != b) {
     CustomData_free_elem(&me->fdata, b, a - b);
     me->totface = b;
+    BKE_mesh_update_customdata_pointers(me, false);
   }
 }
 
@@ -1226,6 +1227,7 @@ void BKE_mesh_strip_loose_polysloops(Mesh *me)
   if (a != b) {
     CustomData_free_elem(&me->pdata, b, a - b);
     me->totpoly = b;
+    BKE_mesh_update_customdata_pointers(me, false);
   }
 
   /* And now, get rid of invalid loops. */
@@ -1247,6 +1249,7 @@ void BKE_mesh_strip_loose_polysloops(Mesh *me)
   if (a != b) {
     CustomData_free_elem(&me->ldata, b, a - b);
     me->totloop = b;
+    BKE_mesh_update_customdata_pointers(me, false);
   }
 
   /* And now, update polys' start loop index. */
@@ -1281,6 +1284,7 @@ void BKE_mesh_strip_loose_edges(Mesh *me)
   if (a != b) {
     CustomData_free_elem(&me->edata, b, a - b);
     me->totedge = b;
+    BKE_mesh_update_customdata_pointers(me, false);
   }
 
   /* And now, update loops' edge indices. */
@@ -44,6 +44,7 @@
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_string_utils.h"
+#include "BLI_trace.h"
 
 #include "BLT_translation.h"
 
@@ -71,6 +72,8 @@
 
 #include "CLG_log.h"
 
+#include "PIL_time.h"
+
 static CLG_LogRef LOG = {"bke.modifier"};
 static ModifierTypeInfo *modifier_types[NUM_MODIFIER_TYPES] = {NULL};
 static VirtualModifierData virtualModifierCommonData;
@@ -948,6 +951,14 @@ void modifier_path_init(char *path, int path_maxlen, const char *name)
 
 /* wrapper around ModifierTypeInfo.applyModifier that ensures valid normals */
 
+static void modwrap_trace_span(const ModifierData *md,
+                               const ModifierEvalContext *ctx,
+                               double start_time)
+{
+  const char *name_parts[2] = {ctx->object->id.name + 2, md->name};
+  BLI_trace_span_add_parts("modifier", name_parts, 2, start_time, PIL_check_seconds_timer());
+}
+
 struct Mesh *modwrap_applyModifier(ModifierData *md,
                                    const ModifierEvalContext *ctx,
                                    struct Mesh *me)
@@ -955,10 +966,18 @@ struct Mesh *modwrap_applyModifier(ModifierData *md,
   const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
   BLI_assert(CustomData_has_layer(&me->pdata, CD_NORMAL) == false);
 
+  const bool do_trace = BLI_trace_is_recording();
+  const double start_time = do_trace ? PIL_check_seconds_timer() : 0.0;
+
   if (mti->dependsOnNormals && mti->dependsOnNormals(md)) {
     BKE_mesh_calc_normals(me);
   }
-  return mti->applyModifier(md, ctx, me);
+  Mesh *result = mti->applyModifier(md, ctx, me);
+
+  if (do_trace) {
+    modwrap_trace_span(md, ctx, start_time);
+  }
+  return result;
 }
 
 void modwrap_deformVerts(ModifierData *md,
@@ -970,10 +989,17 @@ void modwrap_deformVerts(ModifierData *md,
   const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
   BLI_assert(!me || CustomData_has_layer(&me->pdata, CD_NORMAL) == false);
 
+  const bool do_trace = BLI_trace_is_recording();
+  const double start_time = do_trace ? PIL_check_seconds_timer() : 0.0;
+
   if (me && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
     BKE_mesh_calc_normals(me);
   }
   mti->deformVerts(md, ctx, me, vertexCos, numVerts);
+
+  if (do_trace) {
+    modwrap_trace_span(md, ctx, start_time);
+  }
 }
 
 void modwrap_deformVertsEM(ModifierData *md,
@@ -986,10 +1012,17 @@ void modwrap_deformVertsEM(ModifierData *md,
   const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
   BLI_assert(!me || CustomData_has_layer(&me->pdata, CD_NORMAL) == false);
 
+  const bool do_trace = BLI_trace_is_recording();
+  const double start_time = do_trace ? PIL_check_seconds_timer() : 0.0;
+
   if (me && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
     BKE_mesh_calc_normals(me);
   }
   mti->deformVertsEM(md, ctx, em, me, vertexCos, numVerts);
+
+  if (do_trace) {
+    modwrap_trace_span(md, ctx, start_time);
+  }
 }
 
 /* end modifier callback wrappers */
@@ -0,0 +1,646 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup bke
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_action_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_color_types.h"
+#include "DNA_genfile.h"
+#include "DNA_key_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_sdna_types.h"
+
+#include "BLI_utildefines.h"
+
+#include "BLI_ghash.h"
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+
+#include "BKE_armature.h"
+#include "BKE_customdata.h"
+#include "BKE_key.h"
+#include "BKE_library.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_modifier_cache.h" /* own include */
+
+#define MODIFIER_CACHE_DEFAULT_LIMIT ((size_t)256 * 1024 * 1024)
+
+/* -------------------------------------------------------------------- */
+/** \name Hashing
+ * \{ */
+
+/* 64 bit MurmurHash, chained with the previous hash as seed. Keys are compared by hash only, so
+ * 32 bit hashes would collide too often. */
+uint64_t BKE_modifier_cache_hash_data(uint64_t hash, const void *data, size_t len)
+{
+  const uint64_t m = 0xc6a4a7935bd1e995ULL;
+  const int r = 47;
+  const unsigned char *bytes = data;
+  const size_t words_len = len / 8;
+  uint64_t h = hash ^ (len * m);
+
+  for (size_t i = 0; i < words_len; i++) {
+    uint64_t k;
+    memcpy(&k, bytes + i * 8, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  const unsigned char *tail = bytes + words_len * 8;
+  switch (len & 7) {
+    case 7:
+      h ^= (uint64_t)tail[6] << 48;
+      ATTR_FALLTHROUGH;
+    case 6:
+      h ^= (uint64_t)tail[5] << 40;
+      ATTR_FALLTHROUGH;
+    case 5:
+      h ^= (uint64_t)tail[4] << 32;
+      ATTR_FALLTHROUGH;
+    case 4:
+      h ^= (uint64_t)tail[3] << 24;
+      ATTR_FALLTHROUGH;
+    case 3:
+      h ^= (uint64_t)tail[2] << 16;
+      ATTR_FALLTHROUGH;
+    case 2:
+      h ^= (uint64_t)tail[1] << 8;
+      ATTR_FALLTHROUGH;
+    case 1:
+      h ^= (uint64_t)tail[0];
+      h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+static uint64_t hash_string(uint64_t hash, const char *str)
+{
+  return BKE_modifier_cache_hash_data(hash, str, strlen(str));
+}
+
+static bool hash_customdata(uint64_t *hash,
+                            const CustomData *data,
+                            int totelem,
+                            const bool skip_positions)
+{
+  uint64_t h = *hash;
+
+  for (int i = 0; i < data->totlayer; i++) {
+    const CustomDataLayer *layer = &data->layers[i];
+
+    h = BKE_modifier_cache_hash_data(h, &layer->type, sizeof(layer->type));
+    h = hash_string(h, layer->name);
+    if (layer->data == NULL) {
+      continue;
+    }
+
+    switch (layer->type) {
+      case CD_MVERT: {
+        if (!skip_positions) {
+          h = BKE_modifier_cache_hash_data(h, layer->data, sizeof(MVert) * (size_t)totelem);
+          break;
+        }
+        const MVert *mvert = layer->data;
+        for (int j = 0; j < totelem; j++) {
+          h = BKE_modifier_cache_hash_data(h, &mvert[j].flag, sizeof(mvert[j].flag));
+          h = BKE_modifier_cache_hash_data(h, &mvert[j].bweight, sizeof(mvert[j].bweight));
+        }
+        break;
+      }
+      case CD_MDEFORMVERT: {
+        const MDeformVert *dvert = layer->data;
+        for (int j = 0; j < totelem; j++) {
+          h = BKE_modifier_cache_hash_data(
+              h, dvert[j].dw, sizeof(*dvert[j].dw) * (size_t)dvert[j].totweight);
+        }
+        break;
+      }
+      case CD_MDISPS:
+      case CD_GRID_PAINT_MASK:
+      case CD_BM_ELEM_PYPTR:
+        /* Layers with allocated data per element, too expensive to hash. */
+        return false;
+      default:
+        h = BKE_modifier_cache_hash_data(
+            h, layer->data, (size_t)CustomData_sizeof(layer->type) * (size_t)totelem);
+        break;
+    }
+  }
+
+  *hash = h;
+  return true;
+}
+
+static bool hash_mesh(uint64_t *hash, const Mesh *me, const bool skip_positions)
+{
+  uint64_t h = *hash;
+
+  const int sizes[] = {
+      me->totvert, me->totedge, me->totface, me->totloop, me->totpoly, me->totcol};
+  h = BKE_modifier_cache_hash_data(h, sizes, sizeof(sizes));
+
+  /* Settings used for normals and texture coordinates. */
+  h = BKE_modifier_cache_hash_data(h, &me->flag, sizeof(me->flag));
+  h = BKE_modifier_cache_hash_data(h, &me->cd_flag, sizeof(me->cd_flag));
+  h = BKE_modifier_cache_hash_data(h, &me->smoothresh, sizeof(me->smoothresh));
+  h = BKE_modifier_cache_hash_data(h, &me->texflag, sizeof(me->texflag));
+  h = BKE_modifier_cache_hash_data(h, me->loc, sizeof(me->loc));
+  h = BKE_modifier_cache_hash_data(h, me->size, sizeof(me->size));
+  h = BKE_modifier_cache_hash_data(h, &me->texcomesh, sizeof(me->texcomesh));
+
+  if (!hash_customdata(&h, &me->vdata, me->totvert, skip_positions) ||
+      !hash_customdata(&h, &me->edata, me->totedge, false) ||
+      !hash_customdata(&h, &me->fdata, me->totface, false) ||
+      !hash_customdata(&h, &me->ldata, me->totloop, false) ||
+      !hash_customdata(&h, &me->pdata, me->totpoly, false)) {
+    return false;
+  }
+
+  *hash = h;
+  return true;
+}
+
+bool BKE_modifier_cache_hash_mesh(uint64_t *hash, const Object *ob, const Mesh *me)
+{
+  uint64_t h = *hash;
+
+  if (!hash_mesh(&h, me, false)) {
+    return false;
+  }
+
+  /* Vertex groups are used by name in modifier settings. */
+  LISTBASE_FOREACH (const bDeformGroup *, dg, &ob->defbase) {
+    h = hash_string(h, dg->name);
+  }
+
+  *hash = h;
+  return true;
+}
+
+bool BKE_modifier_cache_hash_mesh_without_positions(uint64_t *hash, const Mesh *me)
+{
+  return hash_mesh(hash, me, true);
+}
+
+static uint64_t hash_pose(uint64_t hash, const Object *ob_arm)
+{
+  const bArmature *arm = ob_arm->data;
+  uint64_t h = hash;
+
+  h = BKE_modifier_cache_hash_data(h, &arm->flag, sizeof(arm->flag));
+  h = BKE_modifier_cache_hash_data(h, &arm->deformflag, sizeof(arm->deformflag));
+
+  if (ob_arm->pose == NULL) {
+    return h;
+  }
+
+  LISTBASE_FOREACH (const bPoseChannel *, pchan, &ob_arm->pose->chanbase) {
+    h = hash_string(h, pchan->name);
+    h = BKE_modifier_cache_hash_data(h, pchan->chan_mat, sizeof(pchan->chan_mat));
+    h = BKE_modifier_cache_hash_data(h, pchan->pose_mat, sizeof(pchan->pose_mat));
+    h = BKE_modifier_cache_hash_data(
+        h, &pchan->runtime.deform_dual_quat, sizeof(pchan->runtime.deform_dual_quat));
+
+    if (pchan->runtime.bbone_deform_mats) {
+      h = BKE_modifier_cache_hash_data(h,
+                                       pchan->runtime.bbone_deform_mats,
+                                       sizeof(Mat4) * (2 + pchan->runtime.bbone_segments));
+    }
+
+    const Bone *bone = pchan->bone;
+    if (bone) {
+      /* Envelope and deform settings. */
+      const float bone_values[] = {bone->dist, bone->weight, bone->rad_head, bone->rad_tail};
+      h = BKE_modifier_cache_hash_data(h, &bone->flag, sizeof(bone->flag));
+      h = BKE_modifier_cache_hash_data(h, bone_values, sizeof(bone_values));
+      h = BKE_modifier_cache_hash_data(h, bone->arm_head, sizeof(bone->arm_head));
+      h = BKE_modifier_cache_hash_data(h, bone->arm_tail, sizeof(bone->arm_tail));
+    }
+  }
+
+  return h;
+}
+
+static uint64_t hash_key(uint64_t hash, const Key *key)
+{
+  uint64_t h = hash;
+
+  h = BKE_modifier_cache_hash_data(h, &key->type, sizeof(key->type));
+  h = BKE_modifier_cache_hash_data(h, &key->ctime, sizeof(key->ctime));
+
+  LISTBASE_FOREACH (const KeyBlock *, kb, &key->block) {
+    const float values[] = {kb->curval, kb->slidermin, kb->slidermax};
+    h = BKE_modifier_cache_hash_data(h, values, sizeof(values));
+    h = BKE_modifier_cache_hash_data(h, &kb->flag, sizeof(kb->flag));
+    h = BKE_modifier_cache_hash_data(h, &kb->relative, sizeof(kb->relative));
+    h = hash_string(h, kb->vgroup);
+    if (kb->data) {
+      h = BKE_modifier_cache_hash_data(h, kb->data, (size_t)key->elemsize * kb->totelem);
+    }
+  }
+
+  return h;
+}
+
+static uint64_t hash_curve_mapping(uint64_t hash, const SDNA *sdna, const CurveMapping *cumap);
+
+/* Hash the members of a DNA struct from offset_start on. Pointers are skipped: IDs are hashed
+ * through the dependencies of the modifier, other data is runtime data except for curves. */
+static uint64_t hash_dna_struct(
+    uint64_t hash, const SDNA *sdna, int struct_nr, const char *data, int offset_start)
+{
+  const short *sp = sdna->structs[struct_nr];
+  const int members_len = sp[1];
+  uint64_t h = hash;
+  int offset = 0;
+
+  for (int i = 0; i < members_len; i++) {
+    const short type = sp[2 + i * 2];
+    const short name = sp[3 + i * 2];
+    const int size = DNA_elem_size_nr(sdna, type, name);
+    const char *member = data + offset;
+    const char *member_name = sdna->names[name];
+    offset += size;
+
+    if (offset <= offset_start) {
+      continue;
+    }
+
+    if (member_name[0] == '*' || (member_name[0] == '(' && member_name[1] == '*')) {
+      if (member_name[1] != '*' && STREQ(sdna->types[type], "CurveMapping")) {
+        const CurveMapping *cumap = *(const CurveMapping **)member;
+        if (cumap) {
+          h = hash_curve_mapping(h, sdna, cumap);
+        }
+      }
+      continue;
+    }
+
+    const int member_struct_nr = DNA_struct_find_nr(sdna, sdna->types[type]);
+    if (member_struct_nr != -1) {
+      for (int j = 0; j < sdna->names_array_len[name]; j++) {
+        h = hash_dna_struct(h, sdna, member_struct_nr, member + j * sdna->types_size[type], 0);
+      }
+    }
+    else {
+      h = BKE_modifier_cache_hash_data(h, member, (size_t)size);
+    }
+  }
+
+  return h;
+}
+
+static uint64_t hash_curve_mapping(uint64_t hash, const SDNA *sdna, const CurveMapping *cumap)
+{
+  uint64_t h = hash_dna_struct(
+      hash, sdna, DNA_struct_find_nr(sdna, "CurveMapping"), (const char *)cumap, 0);
+  for (int i = 0; i < CM_TOT; i++) {
+    if (cumap->cm[i].curve) {
+      h = BKE_modifier_cache_hash_data(
+          h, cumap->cm[i].curve, sizeof(CurveMapPoint) * (size_t)cumap->cm[i].totpoint);
+    }
+  }
+  return h;
+}
+
+typedef struct HashIDLinkData {
+  uint64_t hash;
+  bool is_cacheable;
+  bool has_object_links;
+} HashIDLinkData;
+
+static void hash_id_link_cb(void *user_data,
+                            Object *UNUSED(ob),
+                            ID **idpoin,
+                            int UNUSED(cb_flag))
+{
+  HashIDLinkData *data = user_data;
+  ID *id = *idpoin;
+
+  if (id == NULL) {
+    return;
+  }
+  if (GS(id->name) != ID_OB) {
+    /* Textures, collections or cache files, their changes can't be detected. */
+    data->is_cacheable = false;
+    return;
+  }
+
+  /* Only transforms are hashed, not geometry. */
+  const Object *ob_link = (const Object *)id;
+  switch (ob_link->type) {
+    case OB_EMPTY:
+    case OB_CAMERA:
+    case OB_LAMP:
+      break;
+    case OB_ARMATURE:
+      data->hash = hash_pose(data->hash, ob_link);
+      break;
+    default:
+      data->is_cacheable = false;
+      return;
+  }
+
+  data->hash = BKE_modifier_cache_hash_data(data->hash, ob_link->obmat, sizeof(ob_link->obmat));
+  data->has_object_links = true;
+}
+
+bool BKE_modifier_cache_hash_modifier(uint64_t *hash, Object *ob, ModifierData *md)
+{
+  const ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+
+  if ((mti->flags & eModifierTypeFlag_UsesPointCache) ||
+      (mti->dependsOnTime && mti->dependsOnTime(md))) {
+    return false;
+  }
+
+  const SDNA *sdna = DNA_sdna_current_get();
+  const int struct_nr = (sdna) ? DNA_struct_find_nr(sdna, mti->structName) : -1;
+  if (struct_nr == -1) {
+    return false;
+  }
+
+  HashIDLinkData data = {*hash, true, false};
+
+  /* Expanding the panel doesn't change the result. */
+  const int header[] = {md->type, md->mode & ~eModifierMode_Expanded, md->flag};
+  data.hash = BKE_modifier_cache_hash_data(data.hash, header, sizeof(header));
+  data.hash = hash_dna_struct(data.hash, sdna, struct_nr, (const char *)md, sizeof(ModifierData));
+
+  if (mti->foreachIDLink) {
+    mti->foreachIDLink(md, ob, hash_id_link_cb, &data);
+  }
+  else if (mti->foreachObjectLink) {
+    mti->foreachObjectLink(md, ob, (ObjectWalkFunc)hash_id_link_cb, &data);
+  }
+
+  if (!data.is_cacheable) {
+    return false;
+  }
+
+  /* Linked objects are used relative to the object. */
+  if (data.has_object_links) {
+    data.hash = BKE_modifier_cache_hash_data(data.hash, ob->obmat, sizeof(ob->obmat));
+  }
+
+  if (md->type == eModifierType_ShapeKey) {
+    const Key *key = BKE_key_from_object(ob);
+    if (key) {
+      data.hash = hash_key(data.hash, key);
+    }
+  }
+
+  *hash = data.hash;
+  return true;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cache
+ * \{ */
+
+typedef struct ModifierCacheEntry {
+  struct ModifierCacheEntry *next, *prev;
+  uint64_t key;
+  ModifierCacheResult result;
+  size_t memory;
+} ModifierCacheEntry;
+
+static struct {
+  /* Entries by key. */
+  GHash *entries;
+  /* Least recently used first. */
+  ListBase lru;
+  size_t memory;
+  size_t memory_limit;
+  int hits, misses;
+} modifier_cache = {NULL, {NULL, NULL}, 0, MODIFIER_CACHE_DEFAULT_LIMIT, 0, 0};
+
+static ThreadMutex modifier_cache_lock = BLI_MUTEX_INITIALIZER;
+
+static uint modifier_cache_key_hash(const void *key)
+{
+  const uint64_t value = *(const uint64_t *)key;
+  return (uint)(value ^ (value >> 32));
+}
+
+static bool modifier_cache_key_cmp(const void *a, const void *b)
+{
+  return *(const uint64_t *)a != *(const uint64_t *)b;
+}
+
+static size_t customdata_memory(const CustomData *data, int totelem)
+{
+  size_t memory = 0;
+  for (int i = 0; i < data->totlayer; i++) {
+    memory += (size_t)CustomData_sizeof(data->layers[i].type) * totelem;
+  }
+  return memory;
+}
+
+static size_t mesh_memory(const Mesh *me)
+{
+  if (me == NULL) {
+    return 0;
+  }
+  return customdata_memory(&me->vdata, me->totvert) + customdata_memory(&me->edata, me->totedge) +
+         customdata_memory(&me->fdata, me->totface) + customdata_memory(&me->ldata, me->totloop) +
+         customdata_memory(&me->pdata, me->totpoly);
+}
+
+/* Layers are shared by reference, users make their own copy before modifying them. */
+static Mesh *mesh_copy_or_null(Mesh *me)
+{
+  if (me == NULL) {
+    return NULL;
+  }
+  Mesh *result;
+  BKE_id_copy_ex(
+      NULL, &me->id, (ID **)&result, LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE_UNOWNED);
+  return result;
+}
+
+static void result_copy(ModifierCacheResult *dst, const ModifierCacheResult *src, bool do_deform)
+{
+  dst->mesh = mesh_copy_or_null(src->mesh);
+  dst->mesh_orco = mesh_copy_or_null(src->mesh_orco);
+  dst->mesh_orco_cloth = mesh_copy_or_null(src->mesh_orco_cloth);
+  dst->mesh_deform = (do_deform) ? mesh_copy_or_null(src->mesh_deform) : NULL;
+}
+
+static void result_free(ModifierCacheResult *result)
+{
+  Mesh **meshes[] = {
+      &result->mesh, &result->mesh_orco, &result->mesh_orco_cloth, &result->mesh_deform};
+  for (int i = 0; i < ARRAY_SIZE(meshes); i++) {
+    if (*meshes[i]) {
+      BKE_id_free(NULL, *meshes[i]);
+      *meshes[i] = NULL;
+    }
+  }
+}
+
+static void entry_free(ModifierCacheEntry *entry)
+{
+  result_free(&entry->result);
+  MEM_freeN(entry);
+}
+
+bool BKE_modifier_cache_lookup(uint64_t key, bool need_deform, ModifierCacheResult *r_result)
+{
+  bool found = false;
+
+  BLI_mutex_lock(&modifier_cache_lock);
+
+  ModifierCacheEntry *entry = (modifier_cache.entries) ?
+                                  BLI_ghash_lookup(modifier_cache.entries, &key) :
+                                  NULL;
+  if (entry && (!need_deform || entry->result.mesh_deform)) {
+    /* Copied while locked, so it can't be freed meanwhile. */
+    result_copy(r_result, &entry->result, need_deform);
+    BLI_remlink(&modifier_cache.lru, entry);
+    BLI_addtail(&modifier_cache.lru, entry);
+    modifier_cache.hits++;
+    found = true;
+  }
+  else {
+    modifier_cache.misses++;
+  }
+
+  BLI_mutex_unlock(&modifier_cache_lock);
+
+  return found;
+}
+
+void BKE_modifier_cache_add(uint64_t key, const ModifierCacheResult *result)
+{
+  const size_t memory = mesh_memory(result->mesh) + mesh_memory(result->mesh_orco) +
+                        mesh_memory(result->mesh_orco_cloth) + mesh_memory(result->mesh_deform);
+
+  if (memory > modifier_cache.memory_limit) {
+    return;
+  }
+
+  ModifierCacheEntry *entry = MEM_callocN(sizeof(*entry), __func__);
+  entry->key = key;
+  entry->memory = memory;
+  result_copy(&entry->result, result, true);
+
+  ListBase evicted = {NULL, NULL};
+
+  BLI_mutex_lock(&modifier_cache_lock);
+
+  if (modifier_cache.entries == NULL) {
+    modifier_cache.entries = BLI_ghash_new(
+        modifier_cache_key_hash, modifier_cache_key_cmp, __func__);
+  }
+
+  if (BLI_ghash_haskey(modifier_cache.entries, &key)) {
+    /* Added by another evaluation of the same stack. */
+    BLI_addtail(&evicted, entry);
+  }
+  else {
+    BLI_ghash_insert(modifier_cache.entries, &entry->key, entry);
+    BLI_addtail(&modifier_cache.lru, entry);
+    modifier_cache.memory += memory;
+
+    while (modifier_cache.memory > modifier_cache.memory_limit) {
+      ModifierCacheEntry *oldest = modifier_cache.lru.first;
+      BLI_ghash_remove(modifier_cache.entries, &oldest->key, NULL, NULL);
+      BLI_remlink(&modifier_cache.lru, oldest);
+      modifier_cache.memory -= oldest->memory;
+      BLI_addtail(&evicted, oldest);
+    }
+  }
+
+  BLI_mutex_unlock(&modifier_cache_lock);
+
+  LISTBASE_FOREACH_MUTABLE (ModifierCacheEntry *, evicted_entry, &evicted) {
+    entry_free(evicted_entry);
+  }
+}
+
+void BKE_modifier_cache_clear(void)
+{
+  BLI_mutex_lock(&modifier_cache_lock);
+
+  LISTBASE_FOREACH_MUTABLE (ModifierCacheEntry *, entry, &modifier_cache.lru) {
+    entry_free(entry);
+  }
+  BLI_listbase_clear(&modifier_cache.lru);
+  if (modifier_cache.entries) {
+    BLI_ghash_free(modifier_cache.entries, NULL, NULL);
+    modifier_cache.entries = NULL;
+  }
+  modifier_cache.memory = 0;
+
+  BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+void BKE_modifier_cache_memory_limit_set(size_t limit)
+{
+  modifier_cache.memory_limit = limit;
+  if (modifier_cache.memory > limit) {
+    BKE_modifier_cache_clear();
+  }
+}
+
+size_t BKE_modifier_cache_memory_limit_get(void)
+{
+  return modifier_cache.memory_limit;
+}
+
+void BKE_modifier_cache_stats_get(ModifierCacheStats *r_stats)
+{
+  BLI_mutex_lock(&modifier_cache_lock);
+  r_stats->hits = modifier_cache.hits;
+  r_stats->misses = modifier_cache.misses;
+  r_stats->entries = BLI_listbase_count(&modifier_cache.lru);
+  r_stats->memory = modifier_cache.memory;
+  BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+void BKE_modifier_cache_stats_reset(void)
+{
+  BLI_mutex_lock(&modifier_cache_lock);
+  modifier_cache.hits = 0;
+  modifier_cache.misses = 0;
+  BLI_mutex_unlock(&modifier_cache_lock);
+}
+
+/** \} */
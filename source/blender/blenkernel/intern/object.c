@@ -67,6 +67,7 @@
 #include "BLT_translation.h"
 
 #include "BKE_pbvh.h"
+#include "BKE_bvhutils.h"
 #include "BKE_main.h"
 #include "BKE_global.h"
 #include "BKE_idprop.h"
@@ -440,6 +441,7 @@ void BKE_object_free_derived_caches(Object *ob)
   if (ob->runtime.mesh_eval != NULL) {
     if (ob->runtime.is_mesh_eval_owned) {
       Mesh *mesh_eval = ob->runtime.mesh_eval;
+      bvhcache_carry_over_store(&ob->runtime.bvh_cache_prev, mesh_eval);
       BKE_mesh_eval_delete(mesh_eval);
     }
     ob->runtime.mesh_eval = NULL;
@@ -535,6 +537,8 @@ void BKE_object_free(Object *ob)
   MEM_SAFE_FREE(ob->matbits);
   MEM_SAFE_FREE(ob->iuser);
   MEM_SAFE_FREE(ob->runtime.bb);
+  bvhcache_free(&ob->runtime.bvh_cache_prev);
+  MEM_SAFE_FREE(ob->runtime.modifier_cache_keys);
 
   BLI_freelistN(&ob->defbase);
   BLI_freelistN(&ob->fmaps);
@@ -3945,6 +3949,9 @@ void BKE_object_runtime_reset_on_copy(Object *object, const int UNUSED(flag))
   Object_Runtime *runtime = &object->runtime;
   runtime->mesh_eval = NULL;
   runtime->mesh_deform_eval = NULL;
+  runtime->bvh_cache_prev = NULL;
+  runtime->modifier_cache_keys = NULL;
+  runtime->modifier_cache_keys_num = 0;
   runtime->curve_cache = NULL;
   runtime->gpencil_cache = NULL;
 }
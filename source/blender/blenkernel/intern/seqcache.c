@@ -21,13 +21,22 @@
  */
 
 #include <stddef.h>
+#include <stdlib.h>
 #include <memory.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "zlib.h"
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "DNA_sequence_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 
+#include "IMB_colormanagement.h"
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
 
@@ -35,6 +44,12 @@
 #include "BLI_threads.h"
 #include "BLI_listbase.h"
 #include "BLI_ghash.h"
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
 
 #include "BKE_sequencer.h"
 #include "BKE_scene.h"
@@ -63,6 +78,23 @@
  * entries one by one in reverse order to their creation.
  *
  * User can exclude caching of some images. Such entries will have is_temp_cache set.
+ *
+ * Disk cache:
+ * When enabled, every permanent entry is also written to a directory in the user preferences,
+ * one compressed file per entry, so frames dropped from memory (and frames from previous
+ * sessions) can be read back instead of rendered again. Images read from disk are put into the
+ * memory cache like freshly rendered ones.
+ *
+ * Files are keyed by strip name instead of pointer, since pointers are not stable between
+ * sessions. The scene directory name contains #Editing.disk_cache_timestamp, which is changed
+ * (and the directory renamed) on every invalidation. A file opened from an older save points to
+ * a directory that no longer exists, so it can never read images of edits it doesn't contain.
+ * Directories of the same scene with other time stamps are removed once the cache is used.
+ *
+ * Size of the disk cache is limited per scene, least recently used files are removed first.
+ *
+ * Images are encoded and written by a background thread of the cache, so rendering doesn't wait
+ * for compression and disk access. Writes which were queued before an invalidation are dropped.
  */
 
 typedef struct SeqCache {
@@ -72,6 +104,7 @@ typedef struct SeqCache {
   struct BLI_mempool *items_pool;
   struct SeqCacheKey *last_key;
   size_t memory_used;
+  struct SeqDiskCache *disk_cache;
 } SeqCache;
 
 typedef struct SeqCacheItem {
@@ -94,6 +127,89 @@ typedef struct SeqCacheKey {
   int type;
 } SeqCacheKey;
 
+typedef struct SeqDiskCache {
+  /* Protects the index and directories. Images are read and written outside of it, files are
+   * only renamed, removed and indexed with it. */
+  ThreadMutex read_write_mutex;
+  /* Root directory of the blend file, scene directory for the current time stamp. */
+  char root[FILE_MAX];
+  char dir[FILE_MAX];
+  /* What the directories were made from, so they are only computed again when any changed. */
+  char dir_blendfile_path[FILE_MAX];
+  char dir_user_path[FILE_MAX];
+  char dir_scene_name[MAX_ID_NAME];
+  int64_t dir_timestamp;
+  /* Path relative to `dir` -> #SeqDiskCacheFile. */
+  struct GHash *files_hash;
+  /* Least recently used files first. */
+  ListBase files;
+  size_t size_total;
+
+  /* Queue of #SeqDiskCacheWrite and the thread writing them, started on first use. */
+  ThreadQueue *write_queue;
+  ListBase write_threads;
+  /* Queued writes which are not done yet and memory of their images, protected by
+   * `read_write_mutex`. */
+  int writes_pending;
+  size_t writes_pending_size;
+  /* Notified when a queued write is done. */
+  ThreadCondition writes_done_cond;
+} SeqDiskCache;
+
+typedef struct SeqDiskCacheFile {
+  struct SeqDiskCacheFile *next, *prev;
+  /* `<strip name>/<file name>` */
+  char relpath[FILE_MAXFILE * 2];
+  char seq_name[64];
+  int type;
+  int nfra;
+  size_t size;
+  int64_t mtime;
+} SeqDiskCacheFile;
+
+#define DCACHE_FILE_EXT ".dcf"
+#define DCACHE_FILE_MAGIC "SEQDCF"
+#define DCACHE_FILE_VERSION 1
+
+/* Written in native byte order, followed by the (compressed) byte and float buffers. */
+typedef struct SeqDiskCacheHeader {
+  char magic[8];
+  int version;
+
+  /* Cache key. */
+  char seq_name[64];
+  int type;
+  float nfra;
+  int rectx, recty;
+  int preview_render_size;
+  int view_id;
+  int motion_blur_samples;
+  float motion_blur_shutter;
+
+  /* Image. */
+  int x, y;
+  int planes;
+  int channels;
+  int has_rect;
+  int has_rect_float;
+  char rect_colorspace[64];
+  char float_colorspace[64];
+
+  int compression;
+  int _pad;
+  uint64_t size_raw;
+  uint64_t size_stored;
+} SeqDiskCacheHeader;
+
+typedef struct SeqDiskCacheWrite {
+  SeqDiskCacheHeader header;
+  /* Scene directory at the time the image was queued. */
+  char dir[FILE_MAX];
+  char relpath[FILE_MAXFILE * 2];
+  struct ImBuf *ibuf;
+  size_t ibuf_size;
+} SeqDiskCacheWrite;
+
 static ThreadMutex cache_create_lock = BLI_MUTEX_INITIALIZER;
 
 static bool seq_cmp_render_data(const SeqRenderData *a, const SeqRenderData *b)
@@ -432,6 +548,795 @@ static void seq_cache_set_temp_cache_linked(Scene *scene, SeqCacheKey *base)
   }
 }
 
+/* ************************** Disk cache *************************** */
+
+static bool seq_disk_cache_is_enabled(Main *bmain, Scene *scene)
+{
+  return (U.sequencer_disk_cache_dir[0] != '\0' && U.sequencer_disk_cache_size_limit > 0 &&
+          (scene->ed->cache_flag & SEQ_CACHE_DISK_CACHE_ENABLE) != 0 && bmain != NULL &&
+          BKE_main_blendfile_path(bmain)[0] != '\0');
+}
+
+static size_t seq_disk_cache_size_limit(void)
+{
+  return ((size_t)U.sequencer_disk_cache_size_limit) * 1024 * 1024 * 1024;
+}
+
+static void seq_disk_cache_safe_name(const char *name, char r_name[64])
+{
+  BLI_strncpy(r_name, name, 64);
+  BLI_filename_make_safe(r_name);
+}
+
+/* `<cache directory>/<blend file name>_<path hash>_seq_cache`, the hash keeps files with the
+ * same name in different directories apart. */
+static void seq_disk_cache_root_get(Main *bmain, char r_root[FILE_MAX])
+{
+  const char *blendfile_path = BKE_main_blendfile_path(bmain);
+  char dir[FILE_MAX], filename[FILE_MAXFILE], dirname[FILE_MAXFILE];
+
+  BLI_strncpy(dir, U.sequencer_disk_cache_dir, sizeof(dir));
+  BLI_path_abs(dir, blendfile_path);
+  BLI_split_file_part(blendfile_path, filename, sizeof(filename));
+  BLI_path_extension_replace(filename, sizeof(filename), "");
+  BLI_snprintf(dirname,
+               sizeof(dirname),
+               "%s_%08x_seq_cache",
+               filename,
+               BLI_hash_mm2((const unsigned char *)blendfile_path, strlen(blendfile_path), 0));
+  BLI_path_join(r_root, FILE_MAX, dir, dirname, NULL);
+}
+
+/* `<root>/<scene name>-<time stamp>` */
+static void seq_disk_cache_scene_dir_get(const char *root,
+                                         Scene *scene,
+                                         int64_t timestamp,
+                                         char r_dir[FILE_MAX])
+{
+  char scene_name[64], dirname[FILE_MAXFILE];
+
+  seq_disk_cache_safe_name(scene->id.name + 2, scene_name);
+  BLI_snprintf(dirname, sizeof(dirname), "%s-%lld", scene_name, (long long)timestamp);
+  BLI_path_join(r_dir, FILE_MAX, root, dirname, NULL);
+}
+
+/* `<strip name>/<type>-<size>-<preview size>-<view>-<motion blur>-<frame>.dcf` */
+static void seq_disk_cache_relpath_get(const SeqCacheKey *key, char r_relpath[FILE_MAXFILE * 2])
+{
+  const SeqRenderData *context = &key->context;
+  char seq_name[64];
+
+  seq_disk_cache_safe_name(key->seq->name + 2, seq_name);
+  BLI_snprintf(r_relpath,
+               FILE_MAXFILE * 2,
+               "%s%c%d-%dx%d-%d-%d-%d-%d-%d" DCACHE_FILE_EXT,
+               seq_name,
+               SEP,
+               key->type,
+               context->rectx,
+               context->recty,
+               context->preview_render_size,
+               context->view_id,
+               context->motion_blur_samples,
+               (int)(context->motion_blur_shutter * 100.0f),
+               (int)key->nfra);
+}
+
+static bool seq_disk_cache_relpath_parse(const char *relpath,
+                                         char r_seq_name[64],
+                                         int *r_type,
+                                         int *r_nfra)
+{
+  const char *filename = strchr(relpath, SEP);
+
+  if (filename == NULL || filename - relpath >= 64) {
+    return false;
+  }
+
+  BLI_strncpy(r_seq_name, relpath, filename - relpath + 1);
+  return sscanf(filename + 1, "%d-%*dx%*d-%*d-%*d-%*d-%*d-%d", r_type, r_nfra) == 2;
+}
+
+static void seq_disk_cache_file_remove(SeqDiskCache *disk_cache,
+                                       SeqDiskCacheFile *file,
+                                       bool delete_file)
+{
+  if (delete_file) {
+    char path[FILE_MAX];
+    BLI_path_join(path, sizeof(path), disk_cache->dir, file->relpath, NULL);
+    BLI_delete(path, false, false);
+  }
+
+  BLI_ghash_remove(disk_cache->files_hash, file->relpath, NULL, NULL);
+  BLI_remlink(&disk_cache->files, file);
+  disk_cache->size_total -= file->size;
+  MEM_freeN(file);
+}
+
+/* Add file as most recently used one. */
+static bool seq_disk_cache_file_add(SeqDiskCache *disk_cache,
+                                    const char *relpath,
+                                    size_t size,
+                                    int64_t mtime)
+{
+  SeqDiskCacheFile *file = BLI_ghash_lookup(disk_cache->files_hash, relpath);
+  if (file) {
+    seq_disk_cache_file_remove(disk_cache, file, false);
+  }
+
+  file = MEM_callocN(sizeof(SeqDiskCacheFile), "SeqDiskCacheFile");
+  BLI_strncpy(file->relpath, relpath, sizeof(file->relpath));
+  if (!seq_disk_cache_relpath_parse(relpath, file->seq_name, &file->type, &file->nfra)) {
+    MEM_freeN(file);
+    return false;
+  }
+  file->size = size;
+  file->mtime = mtime;
+
+  BLI_ghash_insert(disk_cache->files_hash, file->relpath, file);
+  BLI_addtail(&disk_cache->files, file);
+  disk_cache->size_total += size;
+  return true;
+}
+
+static void seq_disk_cache_index_clear(SeqDiskCache *disk_cache)
+{
+  BLI_ghash_clear(disk_cache->files_hash, NULL, NULL);
+  BLI_freelistN(&disk_cache->files);
+  disk_cache->size_total = 0;
+}
+
+static int seq_disk_cache_file_cmp_mtime(const void *a_, const void *b_)
+{
+  const SeqDiskCacheFile *a = a_;
+  const SeqDiskCacheFile *b = b_;
+
+  return (a->mtime > b->mtime) - (a->mtime < b->mtime);
+}
+
+/* Remove directories of the scene made for other time stamps, they can't be valid anymore. */
+static void seq_disk_cache_remove_stale_dirs(SeqDiskCache *disk_cache)
+{
+  if (!BLI_is_dir(disk_cache->root)) {
+    return;
+  }
+
+  const char *dirname = BLI_path_basename(disk_cache->dir);
+  const size_t prefix_len = strrchr(dirname, '-') - dirname + 1;
+  struct direntry *entries;
+  const uint entries_num = BLI_filelist_dir_contents(disk_cache->root, &entries);
+
+  for (uint i = 0; i < entries_num; i++) {
+    const char *relname = entries[i].relname;
+    const char *timestamp = relname + prefix_len;
+
+    if (S_ISDIR(entries[i].type) && !STREQ(relname, dirname) &&
+        STREQLEN(relname, dirname, prefix_len) && timestamp[0] != '\0' &&
+        strspn(timestamp, "0123456789") == strlen(timestamp)) {
+      char path[FILE_MAX];
+      BLI_path_join(path, sizeof(path), disk_cache->root, relname, NULL);
+      BLI_delete(path, true, true);
+    }
+  }
+
+  BLI_filelist_free(entries, entries_num);
+}
+
+static void seq_disk_cache_index_build(SeqDiskCache *disk_cache)
+{
+  if (!BLI_is_dir(disk_cache->dir)) {
+    return;
+  }
+
+  struct direntry *seq_dirs;
+  const uint seq_dirs_num = BLI_filelist_dir_contents(disk_cache->dir, &seq_dirs);
+
+  for (uint i = 0; i < seq_dirs_num; i++) {
+    if (!S_ISDIR(seq_dirs[i].type) || FILENAME_IS_CURRPAR(seq_dirs[i].relname)) {
+      continue;
+    }
+
+    char seq_dir[FILE_MAX];
+    struct direntry *files;
+    BLI_path_join(seq_dir, sizeof(seq_dir), disk_cache->dir, seq_dirs[i].relname, NULL);
+    const uint files_num = BLI_filelist_dir_contents(seq_dir, &files);
+
+    for (uint j = 0; j < files_num; j++) {
+      if (!S_ISREG(files[j].type)) {
+        continue;
+      }
+
+      char relpath[FILE_MAXFILE * 2];
+      BLI_snprintf(relpath, sizeof(relpath), "%s%c%s", seq_dirs[i].relname, SEP, files[j].relname);
+
+      /* Files which are not known or left behind by an interrupted write. */
+      if (!BLI_path_extension_check(relpath, DCACHE_FILE_EXT) ||
+          !seq_disk_cache_file_add(
+              disk_cache, relpath, (size_t)files[j].s.st_size, (int64_t)files[j].s.st_mtime)) {
+        char path[FILE_MAX];
+        BLI_path_join(path, sizeof(path), disk_cache->dir, relpath, NULL);
+        BLI_delete(path, false, false);
+      }
+    }
+
+    BLI_filelist_free(files, files_num);
+  }
+
+  BLI_filelist_free(seq_dirs, seq_dirs_num);
+  BLI_listbase_sort(&disk_cache->files, seq_disk_cache_file_cmp_mtime);
+}
+
+/* #Editing.disk_cache_timestamp is set by the render threads on first use, so it's only accessed
+ * atomically. */
+static int64_t seq_disk_cache_timestamp_get(Editing *ed)
+{
+  return atomic_add_and_fetch_int64(&ed->disk_cache_timestamp, 0);
+}
+
+/* Point the index to the scene directory for the current time stamp, it is rebuilt when the blend
+ * file, scene name or time stamp changed since the cache was used last. */
+static void seq_disk_cache_ensure_dir(SeqDiskCache *disk_cache, Main *bmain, Scene *scene)
+{
+  Editing *ed = scene->ed;
+  const char *blendfile_path = BKE_main_blendfile_path(bmain);
+  char root[FILE_MAX], dir[FILE_MAX];
+
+  int64_t timestamp = seq_disk_cache_timestamp_get(ed);
+  if (timestamp == 0) {
+    atomic_cas_int64(&ed->disk_cache_timestamp, 0, (int64_t)time(NULL));
+    timestamp = seq_disk_cache_timestamp_get(ed);
+  }
+
+  if (disk_cache->dir_timestamp == timestamp &&
+      STREQ(disk_cache->dir_scene_name, scene->id.name) &&
+      STREQ(disk_cache->dir_blendfile_path, blendfile_path) &&
+      STREQ(disk_cache->dir_user_path, U.sequencer_disk_cache_dir)) {
+    return;
+  }
+
+  seq_disk_cache_root_get(bmain, root);
+  seq_disk_cache_scene_dir_get(root, scene, timestamp, dir);
+  disk_cache->dir_timestamp = timestamp;
+  BLI_strncpy(disk_cache->dir_scene_name, scene->id.name, sizeof(disk_cache->dir_scene_name));
+  BLI_strncpy(
+      disk_cache->dir_blendfile_path, blendfile_path, sizeof(disk_cache->dir_blendfile_path));
+  BLI_strncpy(
+      disk_cache->dir_user_path, U.sequencer_disk_cache_dir, sizeof(disk_cache->dir_user_path));
+
+  if (STREQ(dir, disk_cache->dir)) {
+    return;
+  }
+
+  seq_disk_cache_index_clear(disk_cache);
+  BLI_strncpy(disk_cache->root, root, sizeof(disk_cache->root));
+  BLI_strncpy(disk_cache->dir, dir, sizeof(disk_cache->dir));
+  seq_disk_cache_remove_stale_dirs(disk_cache);
+  seq_disk_cache_index_build(disk_cache);
+}
+
+static void seq_disk_cache_enforce_limit(SeqDiskCache *disk_cache)
+{
+  const size_t size_limit = seq_disk_cache_size_limit();
+
+  while (disk_cache->size_total > size_limit && disk_cache->files.first) {
+    seq_disk_cache_file_remove(disk_cache, disk_cache->files.first, true);
+  }
+}
+
+static void seq_disk_cache_header_init(SeqDiskCacheHeader *header,
+                                       const SeqCacheKey *key,
+                                       ImBuf *ibuf)
+{
+  const SeqRenderData *context = &key->context;
+
+  memset(header, 0, sizeof(*header));
+  BLI_strncpy(header->magic, DCACHE_FILE_MAGIC, sizeof(header->magic));
+  header->version = DCACHE_FILE_VERSION;
+
+  BLI_strncpy(header->seq_name, key->seq->name + 2, sizeof(header->seq_name));
+  header->type = key->type;
+  header->nfra = key->nfra;
+  header->rectx = context->rectx;
+  header->recty = context->recty;
+  header->preview_render_size = context->preview_render_size;
+  header->view_id = context->view_id;
+  header->motion_blur_samples = context->motion_blur_samples;
+  header->motion_blur_shutter = context->motion_blur_shutter;
+
+  header->x = ibuf->x;
+  header->y = ibuf->y;
+  header->planes = ibuf->planes;
+  header->channels = ibuf->channels;
+  header->has_rect = ibuf->rect != NULL;
+  header->has_rect_float = ibuf->rect_float != NULL;
+  if (ibuf->rect) {
+    BLI_strncpy(header->rect_colorspace,
+                IMB_colormanagement_get_rect_colorspace(ibuf),
+                sizeof(header->rect_colorspace));
+  }
+  if (ibuf->rect_float) {
+    BLI_strncpy(header->float_colorspace,
+                IMB_colormanagement_get_float_colorspace(ibuf),
+                sizeof(header->float_colorspace));
+  }
+}
+
+static size_t seq_disk_cache_header_rect_size(const SeqDiskCacheHeader *header)
+{
+  return header->has_rect ? (size_t)header->x * header->y * sizeof(uint) : 0;
+}
+
+static size_t seq_disk_cache_header_rect_float_size(const SeqDiskCacheHeader *header)
+{
+  return header->has_rect_float ? (size_t)header->x * header->y * 4 * sizeof(float) : 0;
+}
+
+static bool seq_disk_cache_header_is_valid(const SeqDiskCacheHeader *header,
+                                           const SeqCacheKey *key)
+{
+  const SeqRenderData *context = &key->context;
+
+  return (STREQLEN(header->magic, DCACHE_FILE_MAGIC, sizeof(header->magic)) &&
+          header->version == DCACHE_FILE_VERSION &&
+          STREQLEN(header->seq_name, key->seq->name + 2, sizeof(header->seq_name)) &&
+          header->type == key->type && header->nfra == key->nfra &&
+          header->rectx == context->rectx && header->recty == context->recty &&
+          header->preview_render_size == context->preview_render_size &&
+          header->view_id == context->view_id &&
+          header->motion_blur_samples == context->motion_blur_samples &&
+          header->motion_blur_shutter == context->motion_blur_shutter && header->x > 0 &&
+          header->y > 0 && (header->has_rect || header->has_rect_float) &&
+          header->size_raw == seq_disk_cache_header_rect_size(header) +
+                                  seq_disk_cache_header_rect_float_size(header));
+}
+
+/* Compress image into a buffer to be written after the header, returns NULL when the image can't
+ * be stored. Caller frees `r_data_alloc`. */
+static const char *seq_disk_cache_encode(SeqDiskCacheHeader *header,
+                                         ImBuf *ibuf,
+                                         char **r_data_alloc)
+{
+  const size_t rect_size = seq_disk_cache_header_rect_size(header);
+  const size_t rect_float_size = seq_disk_cache_header_rect_float_size(header);
+  const char *raw;
+  char *raw_alloc = NULL;
+
+  *r_data_alloc = NULL;
+
+  /* Images read back are allocated with 4 channels. */
+  if (ibuf->rect_float && ibuf->channels != 4) {
+    return NULL;
+  }
+
+  header->size_raw = rect_size + rect_float_size;
+
+  if (rect_size && rect_float_size) {
+    raw_alloc = MEM_mallocN(header->size_raw, __func__);
+    memcpy(raw_alloc, ibuf->rect, rect_size);
+    memcpy(raw_alloc + rect_size, ibuf->rect_float, rect_float_size);
+    raw = raw_alloc;
+  }
+  else {
+    raw = (ibuf->rect) ? (const char *)ibuf->rect : (const char *)ibuf->rect_float;
+  }
+
+  header->compression = USER_SEQ_DISK_CACHE_COMPRESSION_NONE;
+  header->size_stored = header->size_raw;
+
+  if (U.sequencer_disk_cache_compression != USER_SEQ_DISK_CACHE_COMPRESSION_NONE) {
+    const bool high = (U.sequencer_disk_cache_compression == USER_SEQ_DISK_CACHE_COMPRESSION_HIGH);
+    const int level = high ? Z_BEST_COMPRESSION : Z_BEST_SPEED;
+    uLongf compressed_size = compressBound(header->size_raw);
+    char *compressed = MEM_mallocN(compressed_size, __func__);
+
+    if (compress2((Bytef *)compressed,
+                  &compressed_size,
+                  (const Bytef *)raw,
+                  header->size_raw,
+                  level) == Z_OK) {
+      MEM_SAFE_FREE(raw_alloc);
+      header->compression = U.sequencer_disk_cache_compression;
+      header->size_stored = compressed_size;
+      *r_data_alloc = compressed;
+      return compressed;
+    }
+    MEM_freeN(compressed);
+  }
+
+  *r_data_alloc = raw_alloc;
+  return raw;
+}
+
+/* Write to a temporary file, which is renamed once it's complete, so an interrupted write never
+ * leaves a truncated image. */
+static bool seq_disk_cache_write_file(const char *path_tmp,
+                                      const SeqDiskCacheHeader *header,
+                                      const char *data)
+{
+  bool ok = false;
+
+  BLI_make_existing_file(path_tmp);
+
+  FILE *file = BLI_fopen(path_tmp, "wb");
+  if (file == NULL) {
+    return false;
+  }
+
+  ok = (fwrite(header, sizeof(*header), 1, file) == 1 &&
+        fwrite(data, header->size_stored, 1, file) == 1);
+  ok = (fclose(file) == 0) && ok;
+
+  if (!ok) {
+    BLI_delete(path_tmp, false, false);
+  }
+
+  return ok;
+}
+
+static ImBuf *seq_disk_cache_read_file(const char *path, const SeqCacheKey *key)
+{
+  FILE *file = BLI_fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+
+  SeqDiskCacheHeader header;
+  ImBuf *ibuf = NULL;
+  char *data = NULL, *raw = NULL;
+
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      !seq_disk_cache_header_is_valid(&header, key)) {
+    fclose(file);
+    return NULL;
+  }
+
+  data = MEM_mallocN(header.size_stored, __func__);
+  if (fread(data, header.size_stored, 1, file) == 1) {
+    if (header.compression == USER_SEQ_DISK_CACHE_COMPRESSION_NONE) {
+      if (header.size_stored == header.size_raw) {
+        raw = data;
+      }
+    }
+    else {
+      uLongf raw_size = header.size_raw;
+      raw = MEM_mallocN(header.size_raw, __func__);
+      if (uncompress((Bytef *)raw, &raw_size, (const Bytef *)data, header.size_stored) != Z_OK ||
+          raw_size != header.size_raw) {
+        MEM_freeN(raw);
+        raw = NULL;
+      }
+    }
+  }
+  fclose(file);
+
+  if (raw) {
+    const size_t rect_size = seq_disk_cache_header_rect_size(&header);
+    ibuf = IMB_allocImBuf(header.x, header.y, header.planes, 0);
+
+    if (header.has_rect && imb_addrectImBuf(ibuf)) {
+      memcpy(ibuf->rect, raw, rect_size);
+      IMB_colormanagement_assign_rect_colorspace(ibuf, header.rect_colorspace);
+    }
+    if (header.has_rect_float && imb_addrectfloatImBuf(ibuf)) {
+      memcpy(ibuf->rect_float, raw + rect_size, seq_disk_cache_header_rect_float_size(&header));
+      IMB_colormanagement_assign_float_colorspace(ibuf, header.float_colorspace);
+    }
+
+    if ((header.has_rect && !ibuf->rect) || (header.has_rect_float && !ibuf->rect_float)) {
+      IMB_freeImBuf(ibuf);
+      ibuf = NULL;
+    }
+  }
+
+  if (raw && raw != data) {
+    MEM_freeN(raw);
+  }
+  MEM_freeN(data);
+
+  return ibuf;
+}
+
+static SeqDiskCache *seq_disk_cache_get_if_enabled(Main *bmain,
+                                                   Scene *scene,
+                                                   const SeqCacheKey *key)
+{
+  /* Frames in between whole frames (retiming) are not worth storing. */
+  if (!seq_disk_cache_is_enabled(bmain, scene) || key->nfra != floorf(key->nfra)) {
+    return NULL;
+  }
+
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+  return (cache) ? cache->disk_cache : NULL;
+}
+
+static void seq_disk_cache_write(SeqDiskCache *disk_cache, SeqDiskCacheWrite *write)
+{
+  char *data_alloc;
+  char path[FILE_MAX], path_tmp[FILE_MAX];
+
+  BLI_path_join(path, sizeof(path), write->dir, write->relpath, NULL);
+  BLI_snprintf(path_tmp, sizeof(path_tmp), "%s.tmp", path);
+
+  /* Compress and write outside of the lock, reading may happen in the meantime. */
+  const char *data = seq_disk_cache_encode(&write->header, write->ibuf, &data_alloc);
+  const bool is_written = data && seq_disk_cache_write_file(path_tmp, &write->header, data);
+
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+
+  /* The image is outdated when the cache was invalidated after it was queued. */
+  if (is_written) {
+    if (STREQ(write->dir, disk_cache->dir) && BLI_rename(path_tmp, path) == 0) {
+      seq_disk_cache_file_add(
+          disk_cache, write->relpath, sizeof(write->header) + write->header.size_stored, 0);
+      seq_disk_cache_enforce_limit(disk_cache);
+    }
+    else {
+      BLI_delete(path_tmp, false, false);
+    }
+  }
+
+  disk_cache->writes_pending--;
+  disk_cache->writes_pending_size -= write->ibuf_size;
+  BLI_condition_notify_all(&disk_cache->writes_done_cond);
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+
+  MEM_SAFE_FREE(data_alloc);
+}
+
+static void *seq_disk_cache_write_thread(void *data)
+{
+  SeqDiskCache *disk_cache = data;
+  SeqDiskCacheWrite *write;
+
+  while ((write = BLI_thread_queue_pop(disk_cache->write_queue))) {
+    seq_disk_cache_write(disk_cache, write);
+    IMB_freeImBuf(write->ibuf);
+    MEM_freeN(write);
+  }
+
+  return NULL;
+}
+
+static void seq_disk_cache_put(Main *bmain, Scene *scene, const SeqCacheKey *key, ImBuf *ibuf)
+{
+  SeqDiskCache *disk_cache = seq_disk_cache_get_if_enabled(bmain, scene, key);
+  if (disk_cache == NULL) {
+    return;
+  }
+
+  SeqDiskCacheWrite *write = MEM_mallocN(sizeof(SeqDiskCacheWrite), "SeqDiskCacheWrite");
+  seq_disk_cache_header_init(&write->header, key, ibuf);
+  seq_disk_cache_relpath_get(key, write->relpath);
+  IMB_refImBuf(ibuf);
+  write->ibuf = ibuf;
+  write->ibuf_size = IMB_get_size_in_memory(ibuf);
+
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+
+  /* Queued images are referenced until written, a single thread writes them. Block while the
+   * queue holds more than a part of the memory cache limit, so rendering faster than the disk
+   * can't grow memory usage without bounds. One write is always allowed. */
+  const size_t queue_size_limit = seq_cache_get_mem_total() / 4;
+  while (disk_cache->writes_pending > 0 &&
+         disk_cache->writes_pending_size + write->ibuf_size > queue_size_limit) {
+    BLI_condition_wait(&disk_cache->writes_done_cond, &disk_cache->read_write_mutex);
+  }
+
+  seq_disk_cache_ensure_dir(disk_cache, bmain, scene);
+  BLI_strncpy(write->dir, disk_cache->dir, sizeof(write->dir));
+  if (disk_cache->write_queue == NULL) {
+    disk_cache->write_queue = BLI_thread_queue_init();
+    BLI_threadpool_init(&disk_cache->write_threads, seq_disk_cache_write_thread, 1);
+    BLI_threadpool_insert(&disk_cache->write_threads, disk_cache);
+  }
+  disk_cache->writes_pending++;
+  disk_cache->writes_pending_size += write->ibuf_size;
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+
+  BLI_thread_queue_push(disk_cache->write_queue, write);
+}
+
+static void seq_disk_cache_write_wait(SeqDiskCache *disk_cache)
+{
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  while (disk_cache->writes_pending > 0) {
+    BLI_condition_wait(&disk_cache->writes_done_cond, &disk_cache->read_write_mutex);
+  }
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+}
+
+static ImBuf *seq_disk_cache_get(Main *bmain, Scene *scene, const SeqCacheKey *key)
+{
+  SeqDiskCache *disk_cache = seq_disk_cache_get_if_enabled(bmain, scene, key);
+  if (disk_cache == NULL) {
+    return NULL;
+  }
+
+  char relpath[FILE_MAXFILE * 2], dir[FILE_MAX], path[FILE_MAX];
+
+  seq_disk_cache_relpath_get(key, relpath);
+
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  seq_disk_cache_ensure_dir(disk_cache, bmain, scene);
+  const bool is_indexed = BLI_ghash_haskey(disk_cache->files_hash, relpath);
+  BLI_strncpy(dir, disk_cache->dir, sizeof(dir));
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+
+  if (!is_indexed) {
+    return NULL;
+  }
+
+  /* Read outside of the lock. Files are replaced by renaming, so an image being written or
+   * removed meanwhile is either read completely or not at all. */
+  BLI_path_join(path, sizeof(path), dir, relpath, NULL);
+  ImBuf *ibuf = seq_disk_cache_read_file(path, key);
+
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+  /* The file may have been removed or invalidated while it was read. */
+  SeqDiskCacheFile *file = STREQ(dir, disk_cache->dir) ?
+                               BLI_ghash_lookup(disk_cache->files_hash, relpath) :
+                               NULL;
+  if (file) {
+    if (ibuf) {
+      /* Mark as most recently used, also for following sessions. */
+      BLI_remlink(&disk_cache->files, file);
+      BLI_addtail(&disk_cache->files, file);
+      BLI_file_touch(path);
+    }
+    else {
+      seq_disk_cache_file_remove(disk_cache, file, true);
+    }
+  }
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+
+  return ibuf;
+}
+
+/* Unique strip names to strips, for files of strips that can't be found by name NULL is used. */
+static GHash *seq_disk_cache_sequences_by_name(Editing *ed)
+{
+  GHash *seqs_by_name = BLI_ghash_str_new(__func__);
+  Sequence *seq;
+
+  SEQ_BEGIN (ed, seq) {
+    char seq_name[64];
+    void **val_p;
+
+    seq_disk_cache_safe_name(seq->name + 2, seq_name);
+    if (BLI_ghash_ensure_p(seqs_by_name, BLI_strdup(seq_name), &val_p)) {
+      *val_p = NULL;
+    }
+    else {
+      *val_p = seq;
+    }
+  }
+  SEQ_END;
+
+  return seqs_by_name;
+}
+
+/* Give the scene directory a new time stamp and remove files of invalidated images. Like the
+ * memory cache, final images in `range_start..range_end` are removed, as well as source images of
+ * `seq` in range of `seq_changed`. Without `seq` all files are removed. */
+static void seq_disk_cache_invalidate(Scene *scene,
+                                      Sequence *seq,
+                                      Sequence *seq_changed,
+                                      int range_start,
+                                      int range_end,
+                                      int invalidate_composite,
+                                      int invalidate_source)
+{
+  Editing *ed = scene->ed;
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+
+  /* Disk cache was never used, also the case for copies of the scene made for evaluation. */
+  const int64_t timestamp_old = (ed) ? seq_disk_cache_timestamp_get(ed) : 0;
+  if (timestamp_old == 0) {
+    return;
+  }
+
+  int64_t timestamp = (int64_t)time(NULL);
+  if (timestamp <= timestamp_old) {
+    timestamp = timestamp_old + 1;
+  }
+
+  if (cache == NULL) {
+    atomic_cas_int64(&ed->disk_cache_timestamp, timestamp_old, timestamp);
+    return;
+  }
+
+  SeqDiskCache *disk_cache = cache->disk_cache;
+  char dir[FILE_MAX];
+
+  BLI_mutex_lock(&disk_cache->read_write_mutex);
+
+  /* When the index is not for the current directory, it is rebuilt on next use, which also
+   * removes the directory of the old time stamp. */
+  bool index_is_valid = false;
+  if (disk_cache->root[0] != '\0') {
+    seq_disk_cache_scene_dir_get(disk_cache->root, scene, timestamp_old, dir);
+    index_is_valid = STREQ(dir, disk_cache->dir);
+  }
+
+  atomic_cas_int64(&ed->disk_cache_timestamp, timestamp_old, timestamp);
+
+  if (!index_is_valid) {
+    BLI_mutex_unlock(&disk_cache->read_write_mutex);
+    return;
+  }
+
+  seq_disk_cache_scene_dir_get(disk_cache->root, scene, timestamp, dir);
+
+  if (seq == NULL) {
+    BLI_delete(disk_cache->dir, true, true);
+    seq_disk_cache_index_clear(disk_cache);
+  }
+  else if (BLI_is_dir(disk_cache->dir) && BLI_rename(disk_cache->dir, dir) != 0) {
+    BLI_delete(disk_cache->dir, true, true);
+    seq_disk_cache_index_clear(disk_cache);
+  }
+  BLI_strncpy(disk_cache->dir, dir, sizeof(disk_cache->dir));
+  disk_cache->dir_timestamp = timestamp;
+
+  if (seq && disk_cache->files.first) {
+    GHash *seqs_by_name = seq_disk_cache_sequences_by_name(ed);
+    SeqDiskCacheFile *file, *file_next;
+
+    for (file = disk_cache->files.first; file; file = file_next) {
+      file_next = file->next;
+
+      Sequence *file_seq = BLI_ghash_lookup(seqs_by_name, file->seq_name);
+      bool remove = (file_seq == NULL);
+
+      if (file_seq) {
+        const int file_cfra = file_seq->start + file->nfra;
+
+        if (file->type & invalidate_composite && file_cfra >= range_start &&
+            file_cfra <= range_end) {
+          remove = true;
+        }
+        if (file->type & invalidate_source && file_seq == seq &&
+            file_cfra >= seq_changed->startdisp && file_cfra <= seq_changed->enddisp) {
+          remove = true;
+        }
+      }
+
+      if (remove) {
+        seq_disk_cache_file_remove(disk_cache, file, true);
+      }
+    }
+
+    BLI_ghash_free(seqs_by_name, MEM_freeN, NULL);
+  }
+
+  BLI_mutex_unlock(&disk_cache->read_write_mutex);
+}
+
+static SeqDiskCache *seq_disk_cache_create(void)
+{
+  SeqDiskCache *disk_cache = MEM_callocN(sizeof(SeqDiskCache), "SeqDiskCache");
+  BLI_mutex_init(&disk_cache->read_write_mutex);
+  BLI_condition_init(&disk_cache->writes_done_cond);
+  disk_cache->files_hash = BLI_ghash_str_new("SeqDiskCache files");
+  return disk_cache;
+}
+
+/* Only the index is freed, files are kept for following sessions. */
+static void seq_disk_cache_free(SeqDiskCache *disk_cache)
+{
+  if (disk_cache->write_queue) {
+    /* Queued images are written before the thread ends. */
+    BLI_thread_queue_nowait(disk_cache->write_queue);
+    BLI_threadpool_end(&disk_cache->write_threads);
+    BLI_thread_queue_free(disk_cache->write_queue);
+  }
+  seq_disk_cache_index_clear(disk_cache);
+  BLI_ghash_free(disk_cache->files_hash, NULL, NULL);
+  BLI_condition_end(&disk_cache->writes_done_cond);
+  BLI_mutex_end(&disk_cache->read_write_mutex);
+  MEM_freeN(disk_cache);
+}
+
 static void BKE_sequencer_cache_create(Scene *scene)
 {
   BLI_mutex_lock(&cache_create_lock);
@@ -441,6 +1346,7 @@ static void BKE_sequencer_cache_create(Scene *scene)
     cache->items_pool = BLI_mempool_create(sizeof(SeqCacheItem), 0, 64, BLI_MEMPOOL_NOP);
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
     cache->last_key = NULL;
+    cache->disk_cache = seq_disk_cache_create();
     BLI_mutex_init(&cache->iterator_mutex);
     scene->ed->cache = cache;
   }
@@ -481,6 +1387,7 @@ void BKE_sequencer_cache_destruct(Scene *scene)
   BLI_ghash_free(cache->hash, seq_cache_keyfree, seq_cache_valfree);
   BLI_mempool_destroy(cache->keys_pool);
   BLI_mempool_destroy(cache->items_pool);
+  seq_disk_cache_free(cache->disk_cache);
   BLI_mutex_end(&cache->iterator_mutex);
   MEM_freeN(cache);
   scene->ed->cache = NULL;
@@ -493,6 +1400,14 @@ void BKE_sequencer_cache_cleanup_all(Main *bmain)
   }
 }
 void BKE_sequencer_cache_cleanup(Scene *scene)
+{
+  BKE_sequencer_prefetch_stop(scene);
+  seq_disk_cache_invalidate(scene, NULL, NULL, 0, 0, 0, 0);
+  BKE_sequencer_cache_cleanup_memory(scene);
+}
+
+/* Free images in memory, without invalidating the disk cache. */
+void BKE_sequencer_cache_cleanup_memory(Scene *scene)
 {
   BKE_sequencer_prefetch_stop(scene);
 
@@ -520,13 +1435,6 @@ void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
                                           Sequence *seq_changed,
                                           int invalidate_types)
 {
-  SeqCache *cache = seq_cache_get_from_scene(scene);
-  if (!cache) {
-    return;
-  }
-
-  seq_cache_lock(scene);
-
   int range_start = seq_changed->startdisp;
   int range_end = seq_changed->enddisp;
 
@@ -542,6 +1450,16 @@ void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
   int invalidate_source = invalidate_types & (SEQ_CACHE_STORE_RAW | SEQ_CACHE_STORE_PREPROCESSED |
                                               SEQ_CACHE_STORE_COMPOSITE);
 
+  seq_disk_cache_invalidate(
+      scene, seq, seq_changed, range_start, range_end, invalidate_composite, invalidate_source);
+
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+  if (!cache) {
+    return;
+  }
+
+  seq_cache_lock(scene);
+
   GHashIterator gh_iter;
   BLI_ghashIterator_init(&gh_iter, cache->hash);
   while (!BLI_ghashIterator_done(&gh_iter)) {
@@ -572,10 +1490,16 @@ void BKE_sequencer_cache_cleanup_sequence(Scene *scene,
   seq_cache_unlock(scene);
 }
 
-struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
-                                      Sequence *seq,
-                                      float cfra,
-                                      int type)
+static void seq_cache_put_ex(const SeqRenderData *context,
+                             Sequence *seq,
+                             float cfra,
+                             int type,
+                             ImBuf *i,
+                             float cost,
+                             bool use_disk_cache);
+
+static ImBuf *seq_cache_get_ex(
+    const SeqRenderData *context, Sequence *seq, float cfra, int type, bool use_disk_cache)
 {
   Scene *scene = context->scene;
 
@@ -587,16 +1511,14 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
 
   if (!scene->ed->cache) {
     BKE_sequencer_cache_create(scene);
-    return NULL;
   }
 
   seq_cache_lock(scene);
   SeqCache *cache = seq_cache_get_from_scene(scene);
   ImBuf *ibuf = NULL;
+  SeqCacheKey key;
 
   if (cache && seq) {
-    SeqCacheKey key;
-
     key.seq = seq;
     key.context = *context;
     key.nfra = cfra - seq->start;
@@ -606,9 +1528,26 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
   }
   seq_cache_unlock(scene);
 
+  if (ibuf == NULL && cache && seq && use_disk_cache) {
+    ibuf = seq_disk_cache_get(context->bmain, scene, &key);
+
+    /* Keep the image in memory too, without writing it to disk again. */
+    if (ibuf && (type != SEQ_CACHE_STORE_FINAL_OUT || BKE_sequencer_cache_recycle_item(scene))) {
+      seq_cache_put_ex(context, seq, cfra, type, ibuf, 0.0f, false);
+    }
+  }
+
   return ibuf;
 }
 
+struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context,
+                                      Sequence *seq,
+                                      float cfra,
+                                      int type)
+{
+  return seq_cache_get_ex(context, seq, cfra, type, true);
+}
+
 bool BKE_sequencer_cache_put_if_possible(
     const SeqRenderData *context, Sequence *seq, float cfra, int type, ImBuf *ibuf, float cost)
 {
@@ -627,12 +1566,27 @@ bool BKE_sequencer_cache_put_if_possible(
   else {
     seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key);
     scene->ed->cache->last_key = NULL;
+
+    /* Memory is full, but the image can still be stored on disk. */
+    if (ibuf && seq && !context->skip_cache && !context->is_proxy_render) {
+      SeqCacheKey key;
+      key.seq = seq;
+      key.context = *context;
+      key.nfra = cfra - seq->start;
+      key.type = type;
+      seq_disk_cache_put(context->bmain, scene, &key, ibuf);
+    }
     return false;
   }
 }
 
-void BKE_sequencer_cache_put(
-    const SeqRenderData *context, Sequence *seq, float cfra, int type, ImBuf *i, float cost)
+static void seq_cache_put_ex(const SeqRenderData *context,
+                             Sequence *seq,
+                             float cfra,
+                             int type,
+                             ImBuf *i,
+                             float cost,
+                             bool use_disk_cache)
 {
   Scene *scene = context->scene;
 
@@ -647,7 +1601,7 @@ void BKE_sequencer_cache_put(
   }
 
   /* Prevent reinserting, it breaks cache key linking */
-  ImBuf *test = BKE_sequencer_cache_get(context, seq, cfra, type);
+  ImBuf *test = seq_cache_get_ex(context, seq, cfra, type, false);
   if (test) {
     IMB_freeImBuf(test);
     return;
@@ -714,7 +1668,21 @@ void BKE_sequencer_cache_put(
     cache->last_key = NULL;
   }
 
+  /* Key may be recycled by other threads once the cache is unlocked. */
+  const SeqCacheKey key_copy = *key;
+  const bool is_temp_cache = key->is_temp_cache;
+
   seq_cache_unlock(scene);
+
+  if (use_disk_cache && !is_temp_cache) {
+    seq_disk_cache_put(context->bmain, scene, &key_copy, i);
+  }
+}
+
+void BKE_sequencer_cache_put(
+    const SeqRenderData *context, Sequence *seq, float cfra, int type, ImBuf *i, float cost)
+{
+  seq_cache_put_ex(context, seq, cfra, type, i, cost, true);
 }
 
 void BKE_sequencer_cache_iterate(
@@ -753,3 +1721,13 @@ bool BKE_sequencer_cache_is_full(Scene *scene)
 
   return memory_total < cache->memory_used;
 }
+
+void BKE_sequencer_cache_disk_write_wait(Scene *scene)
+{
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+  if (!cache) {
+    return;
+  }
+
+  seq_disk_cache_write_wait(cache->disk_cache);
+}
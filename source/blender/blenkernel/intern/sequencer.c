@@ -43,10 +43,12 @@
 #include "BLI_math.h"
 #include "BLI_fileops.h"
 #include "BLI_listbase.h"
+#include "BLI_ghash.h"
 #include "BLI_linklist.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_string_utf8.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
@@ -3976,6 +3978,130 @@ static ImBuf *seq_render_strip_stack_apply_effect(
   return out;
 }
 
+/* Strips which can be rendered while other strips of the stack are rendered. */
+static bool seq_render_strip_is_threadsafe(Sequence *seq)
+{
+  switch (seq->type) {
+    /* Render other scenes, possibly with OpenGL. */
+    case SEQ_TYPE_SCENE:
+    /* Use the movie clip cache, which is not meant to be filled from multiple threads. */
+    case SEQ_TYPE_MOVIECLIP:
+    /* Render strips of other channels. */
+    case SEQ_TYPE_ADJUSTMENT:
+    case SEQ_TYPE_MULTICAM:
+    /* Draw with the shared font of the render. */
+    case SEQ_TYPE_TEXT:
+      return false;
+  }
+
+  for (Sequence *iseq = seq->seqbase.first; iseq; iseq = iseq->next) {
+    if (!seq_render_strip_is_threadsafe(iseq)) {
+      return false;
+    }
+  }
+
+  Sequence *inputs[] = {seq->seq1, seq->seq2, seq->seq3};
+  for (int i = 0; i < ARRAY_SIZE(inputs); i++) {
+    if (inputs[i] && !seq_render_strip_is_threadsafe(inputs[i])) {
+      return false;
+    }
+  }
+
+  for (SequenceModifierData *smd = seq->modifiers.first; smd; smd = smd->next) {
+    if (smd->mask_sequence && !seq_render_strip_is_threadsafe(smd->mask_sequence)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* Add all strips rendered for `seq` to `used`, returns false when a strip was already added,
+ * rendering it from multiple threads would use its movie handle at the same time. */
+static bool seq_render_strip_tag_used(Sequence *seq, GSet *used)
+{
+  if (!BLI_gset_add(used, seq)) {
+    return false;
+  }
+
+  for (Sequence *iseq = seq->seqbase.first; iseq; iseq = iseq->next) {
+    if (!seq_render_strip_tag_used(iseq, used)) {
+      return false;
+    }
+  }
+
+  Sequence *inputs[] = {seq->seq1, seq->seq2, seq->seq3};
+  for (int i = 0; i < ARRAY_SIZE(inputs); i++) {
+    if (inputs[i] && !seq_render_strip_tag_used(inputs[i], used)) {
+      return false;
+    }
+  }
+
+  for (SequenceModifierData *smd = seq->modifiers.first; smd; smd = smd->next) {
+    if (smd->mask_sequence && !seq_render_strip_tag_used(smd->mask_sequence, used)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* Strips of the stack can be rendered in parallel when they don't share any input. */
+static bool seq_render_strip_stack_can_thread(const SeqRenderData *context,
+                                              Sequence **seq_arr,
+                                              const bool *do_render,
+                                              int count)
+{
+  int render_count = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (do_render[i]) {
+      if (!seq_render_strip_is_threadsafe(seq_arr[i])) {
+        return false;
+      }
+      render_count++;
+    }
+  }
+
+  if (render_count < 2 || BKE_render_num_threads(&context->scene->r) < 2) {
+    return false;
+  }
+
+  GSet *used = BLI_gset_ptr_new(__func__);
+  bool can_thread = true;
+
+  for (int i = 0; i < count && can_thread; i++) {
+    if (do_render[i]) {
+      can_thread = seq_render_strip_tag_used(seq_arr[i], used);
+    }
+  }
+
+  BLI_gset_free(used, NULL);
+  return can_thread;
+}
+
+typedef struct RenderStripStackData {
+  const SeqRenderData *context;
+  const SeqRenderState *state;
+  Sequence **seq_arr;
+  const bool *do_render;
+  ImBuf **ibufs;
+  float cfra;
+} RenderStripStackData;
+
+static void seq_render_strip_stack_task(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  RenderStripStackData *data = userdata;
+
+  if (data->do_render[i]) {
+    /* Scene strips are never rendered here, but keep the list of parents per thread anyway. */
+    SeqRenderState state = *data->state;
+    data->ibufs[i] = seq_render_strip(data->context, &state, data->seq_arr[i], data->cfra);
+  }
+}
+
 static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
                                      SeqRenderState *state,
                                      ListBase *seqbasep,
@@ -3983,6 +4109,8 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
                                      int chanshown)
 {
   Sequence *seq_arr[MAXSEQ + 1];
+  ImBuf *ibufs[MAXSEQ + 1] = {NULL};
+  bool do_render[MAXSEQ + 1] = {false};
   int count;
   int i;
   ImBuf *out = NULL;
@@ -3994,8 +4122,9 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
     return NULL;
   }
 
+  /* Find the lowest strip that has to be rendered: the first one from the top which is cached or
+   * doesn't blend with the strips below it. */
   for (i = count - 1; i >= 0; i--) {
-    int early_out;
     Sequence *seq = seq_arr[i];
 
     out = BKE_sequencer_cache_get(context, seq, cfra, SEQ_CACHE_STORE_COMPOSITE);
@@ -4004,52 +4133,85 @@ static ImBuf *seq_render_strip_stack(const SeqRenderData *context,
       break;
     }
     if (seq->blend_mode == SEQ_BLEND_REPLACE) {
-      out = seq_render_strip(context, state, seq, cfra);
+      do_render[i] = true;
       break;
     }
 
-    early_out = seq_get_early_out_for_blend_mode(seq);
+    const int early_out = seq_get_early_out_for_blend_mode(seq);
+    if (ELEM(early_out, EARLY_NO_INPUT, EARLY_USE_INPUT_2)) {
+      do_render[i] = true;
+      break;
+    }
+    if (i == 0) {
+      do_render[i] = (early_out == EARLY_DO_EFFECT);
+      break;
+    }
+  }
 
-    switch (early_out) {
-      case EARLY_NO_INPUT:
-      case EARLY_USE_INPUT_2:
-        out = seq_render_strip(context, state, seq, cfra);
-        break;
-      case EARLY_USE_INPUT_1:
-        if (i == 0) {
-          out = IMB_allocImBuf(context->rectx, context->recty, 32, IB_rect);
-        }
-        break;
-      case EARLY_DO_EFFECT:
-        if (i == 0) {
-          begin = seq_estimate_render_cost_begin();
+  const int base = i;
 
-          ImBuf *ibuf1 = IMB_allocImBuf(context->rectx, context->recty, 32, IB_rect);
-          ImBuf *ibuf2 = seq_render_strip(context, state, seq, cfra);
+  for (i = base + 1; i < count; i++) {
+    do_render[i] = (seq_get_early_out_for_blend_mode(seq_arr[i]) == EARLY_DO_EFFECT);
+  }
 
-          out = seq_render_strip_stack_apply_effect(context, seq, cfra, ibuf1, ibuf2);
+  /* Render the strips first, only blending them has to happen in order. */
+  if (seq_render_strip_stack_can_thread(context, seq_arr, do_render, count)) {
+    RenderStripStackData data = {
+        .context = context,
+        .state = state,
+        .seq_arr = seq_arr,
+        .do_render = do_render,
+        .ibufs = ibufs,
+        .cfra = cfra,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(base, count, &data, seq_render_strip_stack_task, &settings);
+  }
+  else {
+    for (i = base; i < count; i++) {
+      if (do_render[i]) {
+        ibufs[i] = seq_render_strip(context, state, seq_arr[i], cfra);
+      }
+    }
+  }
 
-          float cost = seq_estimate_render_cost_end(context->scene, begin);
-          BKE_sequencer_cache_put(context, seq_arr[i], cfra, SEQ_CACHE_STORE_COMPOSITE, out, cost);
+  if (out == NULL) {
+    Sequence *seq = seq_arr[base];
+    const int early_out = (seq->blend_mode == SEQ_BLEND_REPLACE) ?
+                              EARLY_NO_INPUT :
+                              seq_get_early_out_for_blend_mode(seq);
 
-          IMB_freeImBuf(ibuf1);
-          IMB_freeImBuf(ibuf2);
-        }
-        break;
+    if (early_out == EARLY_USE_INPUT_1) {
+      out = IMB_allocImBuf(context->rectx, context->recty, 32, IB_rect);
     }
-    if (out) {
-      break;
+    else if (early_out == EARLY_DO_EFFECT) {
+      begin = seq_estimate_render_cost_begin();
+
+      ImBuf *ibuf1 = IMB_allocImBuf(context->rectx, context->recty, 32, IB_rect);
+      ImBuf *ibuf2 = ibufs[base];
+
+      out = seq_render_strip_stack_apply_effect(context, seq, cfra, ibuf1, ibuf2);
+
+      float cost = seq_estimate_render_cost_end(context->scene, begin);
+      BKE_sequencer_cache_put(context, seq, cfra, SEQ_CACHE_STORE_COMPOSITE, out, cost);
+
+      IMB_freeImBuf(ibuf1);
+      IMB_freeImBuf(ibuf2);
+    }
+    else {
+      out = ibufs[base];
     }
   }
 
-  i++;
-  for (; i < count; i++) {
+  for (i = base + 1; i < count; i++) {
     begin = seq_estimate_render_cost_begin();
     Sequence *seq = seq_arr[i];
 
-    if (seq_get_early_out_for_blend_mode(seq) == EARLY_DO_EFFECT) {
+    if (do_render[i]) {
       ImBuf *ibuf1 = out;
-      ImBuf *ibuf2 = seq_render_strip(context, state, seq, cfra);
+      ImBuf *ibuf2 = ibufs[i];
 
       out = seq_render_strip_stack_apply_effect(context, seq, cfra, ibuf1, ibuf2);
 
@@ -4439,7 +4601,13 @@ void BKE_sequencer_free_imbuf(Scene *scene, ListBase *seqbase, bool for_render)
 {
   Sequence *seq;
 
-  BKE_sequencer_cache_cleanup(scene);
+  /* Rendering doesn't change strips, images on disk stay valid. */
+  if (for_render) {
+    BKE_sequencer_cache_cleanup_memory(scene);
+  }
+  else {
+    BKE_sequencer_cache_cleanup(scene);
+  }
   BKE_sequencer_prefetch_stop(scene);
 
   for (seq = seqbase->first; seq; seq = seq->next) {
@@ -6094,5 +6262,5 @@ void BKE_sequencer_all_free_anim_ibufs(Scene *scene, int cfra)
     return;
   }
   sequencer_all_free_anim_ibufs(&ed->seqbase, cfra);
-  BKE_sequencer_cache_cleanup(scene);
+  BKE_sequencer_cache_cleanup_memory(scene);
 }
@@ -99,6 +99,11 @@ typedef struct ShrinkwrapCalcCBData {
 
   float *proj_axis;
   SpaceTransform *local2aux;
+
+  /* Batched nearest searches: vertex influence, coordinates in target space and results. */
+  float *weights;
+  float (*tree_cos)[3];
+  BVHTreeNearest *nearest;
 } ShrinkwrapCalcCBData;
 
 /* Checks if the modifier needs target normals with these settings. */
@@ -338,55 +343,83 @@ void BKE_shrinkwrap_compute_boundary_data(struct Mesh *mesh)
 }
 
 /*
- * Shrinkwrap to the nearest vertex
+ * Batched nearest searches
  *
- * it builds a kdtree of vertexs we can attach to and then
- * for each vertex performs a nearest vertex search on the tree
+ * The vertices are converted to target space first, then the nearest searches are done for all of
+ * them at once with #BLI_bvhtree_find_nearest_batch, which orders them for coherence.
  */
-static void shrinkwrap_calc_nearest_vertex_cb_ex(void *__restrict userdata,
+static void shrinkwrap_calc_nearest_gather_cb_ex(void *__restrict userdata,
                                                  const int i,
-                                                 const TaskParallelTLS *__restrict tls)
+                                                 const TaskParallelTLS *__restrict UNUSED(tls))
 {
   ShrinkwrapCalcCBData *data = userdata;
 
   ShrinkwrapCalcData *calc = data->calc;
-  BVHTreeFromMesh *treeData = &data->tree->treeData;
-  BVHTreeNearest *nearest = tls->userdata_chunk;
-
-  float *co = calc->vertexCos[i];
-  float tmp_co[3];
+  float *tmp_co = data->tree_cos[i];
   float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
 
   if (calc->invert_vgroup) {
     weight = 1.0f - weight;
   }
+  data->weights[i] = weight;
 
-  if (weight == 0.0f) {
-    return;
-  }
+  data->nearest[i].index = -1;
+  /* A zero distance prunes the whole search for vertices which aren't affected. */
+  data->nearest[i].dist_sq = (weight == 0.0f) ? 0.0f : FLT_MAX;
 
   /* Convert the vertex to tree coordinates */
   if (calc->vert) {
     copy_v3_v3(tmp_co, calc->vert[i].co);
   }
   else {
-    copy_v3_v3(tmp_co, co);
+    copy_v3_v3(tmp_co, calc->vertexCos[i]);
   }
   BLI_space_transform_apply(&calc->local2target, tmp_co);
+}
 
-  /* Use local proximity heuristics (to reduce the nearest search)
-   *
-   * If we already had an hit before.. we assume this vertex is going to have a close hit to that
-   * other vertex so we can initiate the "nearest.dist" with the expected value to that last hit.
-   * This will lead in pruning of the search tree. */
-  if (nearest->index != -1) {
-    nearest->dist_sq = len_squared_v3v3(tmp_co, nearest->co);
-  }
-  else {
-    nearest->dist_sq = FLT_MAX;
-  }
+static void shrinkwrap_calc_nearest_batch_begin(ShrinkwrapCalcData *calc,
+                                                ShrinkwrapCalcCBData *data)
+{
+  data->weights = MEM_malloc_arrayN((size_t)calc->numVerts, sizeof(*data->weights), __func__);
+  data->tree_cos = MEM_malloc_arrayN((size_t)calc->numVerts, sizeof(*data->tree_cos), __func__);
+  data->nearest = MEM_malloc_arrayN((size_t)calc->numVerts, sizeof(*data->nearest), __func__);
 
-  BLI_bvhtree_find_nearest(treeData->tree, tmp_co, nearest, treeData->nearest_callback, treeData);
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (calc->numVerts > BKE_MESH_OMP_LIMIT);
+  BLI_task_parallel_range(
+      0, calc->numVerts, data, shrinkwrap_calc_nearest_gather_cb_ex, &settings);
+}
+
+static void shrinkwrap_calc_nearest_batch_end(ShrinkwrapCalcCBData *data)
+{
+  MEM_freeN(data->weights);
+  MEM_freeN(data->tree_cos);
+  MEM_freeN(data->nearest);
+}
+
+/*
+ * Shrinkwrap to the nearest vertex
+ *
+ * it builds a kdtree of vertexs we can attach to and then
+ * for each vertex performs a nearest vertex search on the tree
+ */
+static void shrinkwrap_calc_nearest_vertex_cb_ex(void *__restrict userdata,
+                                                 const int i,
+                                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ShrinkwrapCalcCBData *data = userdata;
+
+  ShrinkwrapCalcData *calc = data->calc;
+  const BVHTreeNearest *nearest = &data->nearest[i];
+
+  float *co = calc->vertexCos[i];
+  float tmp_co[3];
+  float weight = data->weights[i];
+
+  if (weight == 0.0f) {
+    return;
+  }
 
   /* Found the nearest vertex */
   if (nearest->index != -1) {
@@ -407,23 +440,29 @@ static void shrinkwrap_calc_nearest_vertex_cb_ex(void *__restrict userdata,
 
 static void shrinkwrap_calc_nearest_vertex(ShrinkwrapCalcData *calc)
 {
-  BVHTreeNearest nearest = NULL_BVHTreeNearest;
-
-  /* Setup nearest */
-  nearest.index = -1;
-  nearest.dist_sq = FLT_MAX;
+  BVHTreeFromMesh *treeData = &calc->tree->treeData;
 
   ShrinkwrapCalcCBData data = {
       .calc = calc,
       .tree = calc->tree,
   };
+  shrinkwrap_calc_nearest_batch_begin(calc, &data);
+
+  BLI_bvhtree_find_nearest_batch(treeData->tree,
+                                 (const float(*)[3])data.tree_cos,
+                                 calc->numVerts,
+                                 data.nearest,
+                                 treeData->nearest_callback,
+                                 treeData,
+                                 0);
+
   TaskParallelSettings settings;
   BLI_parallel_range_settings_defaults(&settings);
   settings.use_threading = (calc->numVerts > BKE_MESH_OMP_LIMIT);
-  settings.userdata_chunk = &nearest;
-  settings.userdata_chunk_size = sizeof(nearest);
   BLI_task_parallel_range(
       0, calc->numVerts, &data, shrinkwrap_calc_nearest_vertex_cb_ex, &settings);
+
+  shrinkwrap_calc_nearest_batch_end(&data);
 }
 
 /*
@@ -1149,24 +1188,10 @@ static void shrinkwrap_calc_nearest_surface_point_cb_ex(void *__restrict userdat
   }
   BLI_space_transform_apply(&calc->local2target, tmp_co);
 
-  /* Use local proximity heuristics (to reduce the nearest search)
-   *
-   * If we already had an hit before.. we assume this vertex is going to have a close hit to that
-   * other vertex so we can initiate the "nearest.dist" with the expected value to that last hit.
-   * This will lead in pruning of the search tree. */
-  if (nearest->index != -1) {
-    if (calc->smd->shrinkType == MOD_SHRINKWRAP_TARGET_PROJECT) {
-      /* Heuristic doesn't work because of additional restrictions. */
-      nearest->index = -1;
-      nearest->dist_sq = FLT_MAX;
-    }
-    else {
-      nearest->dist_sq = len_squared_v3v3(tmp_co, nearest->co);
-    }
-  }
-  else {
-    nearest->dist_sq = FLT_MAX;
-  }
+  /* Only used for target projection (simple nearest is batched), where local proximity
+   * heuristics don't work because of additional restrictions. */
+  nearest->index = -1;
+  nearest->dist_sq = FLT_MAX;
 
   BKE_shrinkwrap_find_nearest_surface(data->tree, nearest, tmp_co, calc->smd->shrinkType);
 
@@ -1374,8 +1399,66 @@ void BKE_shrinkwrap_snap_point_to_surface(const struct ShrinkwrapTreeData *tree,
   }
 }
 
+static void shrinkwrap_calc_nearest_surface_point_batch_cb_ex(
+    void *__restrict userdata, const int i, const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ShrinkwrapCalcCBData *data = userdata;
+
+  ShrinkwrapCalcData *calc = data->calc;
+  const BVHTreeNearest *nearest = &data->nearest[i];
+  const float weight = data->weights[i];
+
+  if (weight == 0.0f || nearest->index == -1) {
+    return;
+  }
+
+  float *co = calc->vertexCos[i];
+  float tmp_co[3];
+
+  BKE_shrinkwrap_snap_point_to_surface(data->tree,
+                                       NULL,
+                                       calc->smd->shrinkMode,
+                                       nearest->index,
+                                       nearest->co,
+                                       nearest->no,
+                                       calc->keepDist,
+                                       data->tree_cos[i],
+                                       tmp_co);
+
+  /* Convert the coordinates back to mesh coordinates */
+  BLI_space_transform_invert(&calc->local2target, tmp_co);
+  interp_v3_v3v3(co, co, tmp_co, weight); /* linear interpolation */
+}
+
 static void shrinkwrap_calc_nearest_surface_point(ShrinkwrapCalcData *calc)
 {
+  if (calc->smd->shrinkType != MOD_SHRINKWRAP_TARGET_PROJECT) {
+    /* Simple nearest, which can be done for all vertices at once. */
+    ShrinkwrapCalcCBData data = {
+        .calc = calc,
+        .tree = calc->tree,
+    };
+    shrinkwrap_calc_nearest_batch_begin(calc, &data);
+
+    BVHTreeFromMesh *treeData = &calc->tree->treeData;
+    BLI_bvhtree_find_nearest_batch(calc->tree->bvh,
+                                   (const float(*)[3])data.tree_cos,
+                                   calc->numVerts,
+                                   data.nearest,
+                                   treeData->nearest_callback,
+                                   treeData,
+                                   0);
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (calc->numVerts > BKE_MESH_OMP_LIMIT);
+    BLI_task_parallel_range(
+        0, calc->numVerts, &data, shrinkwrap_calc_nearest_surface_point_batch_cb_ex, &settings);
+
+    shrinkwrap_calc_nearest_batch_end(&data);
+    return;
+  }
+
   BVHTreeNearest nearest = NULL_BVHTreeNearest;
 
   /* Setup nearest */
@@ -30,17 +30,42 @@
 #include "DNA_key_types.h"
 
 #include "BLI_alloca.h"
+#include "BLI_math_base.h"
 #include "BLI_math_vector.h"
+#include "BLI_task.h"
 
 #include "BKE_customdata.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
 #include "BKE_key.h"
+#include "BKE_library.h"
+#include "BKE_modifier_cache.h"
 #include "BKE_subdiv.h"
 #include "BKE_subdiv_eval.h"
 #include "BKE_subdiv_foreach.h"
 
 #include "MEM_guardedalloc.h"
 
+/* =============================================================================
+ * Vertex samples.
+ */
+
+/* Point of the limit surface at which a subdivided vertex is evaluated. */
+typedef struct SubdivVertexSample {
+  int ptex_face_index;
+  float u, v;
+} SubdivVertexSample;
+
+typedef struct SubdivMeshVertexSamples {
+  int num_vertices;
+  /* Sample of the position of every vertex, also used for normals of inner vertices. */
+  SubdivVertexSample *position_samples;
+  /* Normals of vertices along coarse edges and corners are averaged over samples of all the
+   * adjacent ptex faces. Samples of a vertex start at its offset, inner vertices have none. */
+  int *normal_sample_offsets;
+  SubdivVertexSample *normal_samples;
+} SubdivMeshVertexSamples;
+
 /* =============================================================================
  * Subdivision context.
  */
@@ -76,6 +101,15 @@ typedef struct SubdivMeshContext {
    * when it's not possible is when displacement is used. */
   bool can_evaluate_normals;
   bool have_displacement;
+  /* Vertex samples which are being gathered, NULL when not requested. */
+  SubdivMeshVertexSamples *vertex_samples;
+  /* Normal samples in traversal order, with their vertex indices. */
+  SubdivVertexSample *traversed_normal_samples;
+  int *traversed_normal_sample_vertices;
+  int num_traversed_normal_samples;
+  int traversed_normal_samples_size;
+  /* Set when there are vertices which are not evaluated from the limit surface. */
+  bool have_non_limit_vertices;
 } SubdivMeshContext;
 
 static void subdiv_mesh_ctx_cache_uv_layers(SubdivMeshContext *ctx)
@@ -117,6 +151,106 @@ static void subdiv_mesh_context_free(SubdivMeshContext *ctx)
 {
   MEM_SAFE_FREE(ctx->accumulated_normals);
   MEM_SAFE_FREE(ctx->accumulated_counters);
+  MEM_SAFE_FREE(ctx->traversed_normal_samples);
+  MEM_SAFE_FREE(ctx->traversed_normal_sample_vertices);
+  if (ctx->vertex_samples != NULL) {
+    BKE_subdiv_mesh_vertex_samples_free(ctx->vertex_samples);
+  }
+}
+
+/* =============================================================================
+ * Vertex samples gathering.
+ */
+
+static void subdiv_mesh_vertex_samples_prepare(SubdivMeshContext *ctx, int num_vertices)
+{
+  SubdivMeshVertexSamples *vertex_samples = ctx->vertex_samples;
+  if (vertex_samples == NULL) {
+    return;
+  }
+  vertex_samples->num_vertices = num_vertices;
+  vertex_samples->position_samples = MEM_malloc_arrayN(
+      num_vertices, sizeof(*vertex_samples->position_samples), "subdiv position samples");
+}
+
+static void subdiv_mesh_vertex_samples_set_position(const SubdivMeshContext *ctx,
+                                                    const int ptex_face_index,
+                                                    const float u,
+                                                    const float v,
+                                                    const int subdiv_vertex_index)
+{
+  if (ctx->vertex_samples == NULL) {
+    return;
+  }
+  SubdivVertexSample *sample = &ctx->vertex_samples->position_samples[subdiv_vertex_index];
+  sample->ptex_face_index = ptex_face_index;
+  sample->u = u;
+  sample->v = v;
+}
+
+/* Is only called from the single threaded part of the traversal. */
+static void subdiv_mesh_vertex_samples_add_normal(SubdivMeshContext *ctx,
+                                                  const int ptex_face_index,
+                                                  const float u,
+                                                  const float v,
+                                                  const int subdiv_vertex_index)
+{
+  if (ctx->vertex_samples == NULL) {
+    return;
+  }
+  if (ctx->num_traversed_normal_samples == ctx->traversed_normal_samples_size) {
+    ctx->traversed_normal_samples_size = max_ii(1024, ctx->traversed_normal_samples_size * 2);
+    ctx->traversed_normal_samples = MEM_reallocN(
+        ctx->traversed_normal_samples,
+        sizeof(*ctx->traversed_normal_samples) * ctx->traversed_normal_samples_size);
+    ctx->traversed_normal_sample_vertices = MEM_reallocN(
+        ctx->traversed_normal_sample_vertices,
+        sizeof(*ctx->traversed_normal_sample_vertices) * ctx->traversed_normal_samples_size);
+  }
+  SubdivVertexSample *sample = &ctx->traversed_normal_samples[ctx->num_traversed_normal_samples];
+  sample->ptex_face_index = ptex_face_index;
+  sample->u = u;
+  sample->v = v;
+  ctx->traversed_normal_sample_vertices[ctx->num_traversed_normal_samples] = subdiv_vertex_index;
+  ctx->num_traversed_normal_samples++;
+}
+
+/* Group normal samples by vertex, and pass ownership of the samples to the caller. */
+static SubdivMeshVertexSamples *subdiv_mesh_vertex_samples_finish(SubdivMeshContext *ctx)
+{
+  SubdivMeshVertexSamples *vertex_samples = ctx->vertex_samples;
+  if (vertex_samples == NULL) {
+    return NULL;
+  }
+  ctx->vertex_samples = NULL;
+  if (ctx->have_non_limit_vertices || vertex_samples->position_samples == NULL) {
+    BKE_subdiv_mesh_vertex_samples_free(vertex_samples);
+    return NULL;
+  }
+  const int num_vertices = vertex_samples->num_vertices;
+  const int num_samples = ctx->num_traversed_normal_samples;
+  int *offsets = MEM_calloc_arrayN(
+      (size_t)num_vertices + 1, sizeof(int), "subdiv normal sample offsets");
+  for (int i = 0; i < num_samples; i++) {
+    offsets[ctx->traversed_normal_sample_vertices[i] + 1]++;
+  }
+  for (int i = 0; i < num_vertices; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+  /* Stable counting sort, so samples are averaged in the same order as on creation. */
+  SubdivVertexSample *normal_samples = MEM_malloc_arrayN(
+      (size_t)max_ii(num_samples, 1), sizeof(*normal_samples), "subdiv normal samples");
+  int *counters = MEM_calloc_arrayN(
+      (size_t)num_vertices, sizeof(int), "subdiv normal sample counters");
+  for (int i = 0; i < num_samples; i++) {
+    const int vertex_index = ctx->traversed_normal_sample_vertices[i];
+    normal_samples[offsets[vertex_index] + counters[vertex_index]++] =
+        ctx->traversed_normal_samples[i];
+  }
+  MEM_freeN(counters);
+  vertex_samples->normal_sample_offsets = offsets;
+  vertex_samples->normal_samples = normal_samples;
+  return vertex_samples;
 }
 
 /* =============================================================================
@@ -510,6 +644,7 @@ static bool subdiv_mesh_topology_info(const SubdivForeachContext *foreach_contex
       subdiv_context->coarse_mesh, num_vertices, num_edges, 0, num_loops, num_polygons, mask);
   subdiv_mesh_ctx_cache_custom_data_layers(subdiv_context);
   subdiv_mesh_prepare_accumulator(subdiv_context, num_vertices);
+  subdiv_mesh_vertex_samples_prepare(subdiv_context, num_vertices);
   return true;
 }
 
@@ -625,6 +760,7 @@ static void subdiv_mesh_vertex_every_corner_or_edge(const SubdivForeachContext *
   MVert *subdiv_mvert = subdiv_mesh->mvert;
   MVert *subdiv_vert = &subdiv_mvert[subdiv_vertex_index];
   subdiv_accumulate_vertex_normal_and_displacement(ctx, ptex_face_index, u, v, subdiv_vert);
+  subdiv_mesh_vertex_samples_add_normal(ctx, ptex_face_index, u, v, subdiv_vertex_index);
 }
 
 static void subdiv_mesh_vertex_every_corner(const SubdivForeachContext *foreach_context,
@@ -675,6 +811,7 @@ static void subdiv_mesh_vertex_corner(const SubdivForeachContext *foreach_contex
   MVert *subdiv_vert = &subdiv_mvert[subdiv_vertex_index];
   evaluate_vertex_and_apply_displacement_copy(
       ctx, ptex_face_index, u, v, coarse_vert, subdiv_vert);
+  subdiv_mesh_vertex_samples_set_position(ctx, ptex_face_index, u, v, subdiv_vertex_index);
 }
 
 static void subdiv_mesh_ensure_vertex_interpolation(SubdivMeshContext *ctx,
@@ -726,6 +863,7 @@ static void subdiv_mesh_vertex_edge(const SubdivForeachContext *foreach_context,
   subdiv_mesh_ensure_vertex_interpolation(ctx, tls, coarse_poly, coarse_corner);
   evaluate_vertex_and_apply_displacement_interpolate(
       ctx, ptex_face_index, u, v, &tls->vertex_interpolation, subdiv_vert);
+  subdiv_mesh_vertex_samples_set_position(ctx, ptex_face_index, u, v, subdiv_vertex_index);
 }
 
 static bool subdiv_mesh_is_center_vertex(const MPoly *coarse_poly, const float u, const float v)
@@ -776,6 +914,7 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
   eval_final_point_and_vertex_normal(
       subdiv, ptex_face_index, u, v, subdiv_vert->co, subdiv_vert->no);
   subdiv_mesh_tag_center_vertex(coarse_poly, subdiv_vert, u, v);
+  subdiv_mesh_vertex_samples_set_position(ctx, ptex_face_index, u, v, subdiv_vertex_index);
 }
 
 /* =============================================================================
@@ -972,6 +1111,7 @@ static void subdiv_mesh_vertex_loose(const SubdivForeachContext *foreach_context
   MVert *subdiv_mvert = subdiv_mesh->mvert;
   MVert *subdiv_vertex = &subdiv_mvert[subdiv_vertex_index];
   subdiv_vertex_data_copy(ctx, coarse_vertex, subdiv_vertex);
+  ctx->have_non_limit_vertices = true;
 }
 
 /* Get neighbor edges of the given one.
@@ -1122,6 +1262,7 @@ static void subdiv_mesh_vertex_of_loose_edge(const struct SubdivForeachContext *
   /* Reset normal, initialize it in a similar way as edit mode does for a
    * vertices adjacent to a loose edges. */
   normal_float_to_short_v3(subdiv_vertex->no, subdiv_vertex->co);
+  ctx->have_non_limit_vertices = true;
 }
 
 /* =============================================================================
@@ -1162,6 +1303,17 @@ Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
                          const SubdivToMeshSettings *settings,
                          const Mesh *coarse_mesh)
 {
+  return BKE_subdiv_to_mesh_ex(subdiv, settings, coarse_mesh, NULL);
+}
+
+Mesh *BKE_subdiv_to_mesh_ex(Subdiv *subdiv,
+                            const SubdivToMeshSettings *settings,
+                            const Mesh *coarse_mesh,
+                            SubdivMeshVertexSamples **r_vertex_samples)
+{
+  if (r_vertex_samples != NULL) {
+    *r_vertex_samples = NULL;
+  }
   BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH);
   /* Make sure evaluator is up to date with possible new topology, and that
    * it is refined for the new positions of coarse vertices. */
@@ -1183,6 +1335,10 @@ Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
   subdiv_context.subdiv = subdiv;
   subdiv_context.have_displacement = (subdiv->displacement_evaluator != NULL);
   subdiv_context.can_evaluate_normals = !subdiv_context.have_displacement;
+  if (r_vertex_samples != NULL && subdiv_context.can_evaluate_normals) {
+    subdiv_context.vertex_samples = MEM_callocN(sizeof(SubdivMeshVertexSamples),
+                                                "subdiv mesh vertex samples");
+  }
   /* Multi-threaded traversal/evaluation. */
   BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH_GEOMETRY);
   SubdivForeachContext foreach_context;
@@ -1199,7 +1355,174 @@ Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
   if (!subdiv_context.can_evaluate_normals) {
     result->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
   }
+  if (r_vertex_samples != NULL) {
+    *r_vertex_samples = subdiv_mesh_vertex_samples_finish(&subdiv_context);
+  }
   /* Free used memory. */
   subdiv_mesh_context_free(&subdiv_context);
   return result;
 }
+
+/* =============================================================================
+ * Update of vertices for new coarse positions.
+ */
+
+typedef struct SubdivMeshVerticesUpdateData {
+  Subdiv *subdiv;
+  const SubdivMeshVertexSamples *vertex_samples;
+  MVert *mvert;
+} SubdivMeshVerticesUpdateData;
+
+static void subdiv_mesh_vertices_update_task(void *__restrict userdata,
+                                             const int vertex_index,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SubdivMeshVerticesUpdateData *data = userdata;
+  Subdiv *subdiv = data->subdiv;
+  const SubdivMeshVertexSamples *vertex_samples = data->vertex_samples;
+  const SubdivVertexSample *sample = &vertex_samples->position_samples[vertex_index];
+  const int first_normal_sample = vertex_samples->normal_sample_offsets[vertex_index];
+  const int num_normal_samples = vertex_samples->normal_sample_offsets[vertex_index + 1] -
+                                 first_normal_sample;
+  MVert *subdiv_vert = &data->mvert[vertex_index];
+  if (num_normal_samples == 0) {
+    BKE_subdiv_eval_limit_point_and_short_normal(
+        subdiv, sample->ptex_face_index, sample->u, sample->v, subdiv_vert->co, subdiv_vert->no);
+    return;
+  }
+  BKE_subdiv_eval_limit_point(
+      subdiv, sample->ptex_face_index, sample->u, sample->v, subdiv_vert->co);
+  /* Same averaging as subdiv_accumulate_vertex_normal_and_displacement(). */
+  float N[3] = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < num_normal_samples; i++) {
+    const SubdivVertexSample *normal_sample =
+        &vertex_samples->normal_samples[first_normal_sample + i];
+    float dummy_P[3], dPdu[3], dPdv[3], sample_N[3];
+    BKE_subdiv_eval_limit_point_and_derivatives(subdiv,
+                                                normal_sample->ptex_face_index,
+                                                normal_sample->u,
+                                                normal_sample->v,
+                                                dummy_P,
+                                                dPdu,
+                                                dPdv);
+    cross_v3_v3v3(sample_N, dPdu, dPdv);
+    normalize_v3(sample_N);
+    add_v3_v3(N, sample_N);
+  }
+  normalize_v3(N);
+  normal_float_to_short_v3(subdiv_vert->no, N);
+}
+
+bool BKE_subdiv_mesh_vertices_update(Subdiv *subdiv,
+                                     const SubdivMeshVertexSamples *vertex_samples,
+                                     const Mesh *coarse_mesh,
+                                     Mesh *subdiv_mesh)
+{
+  BLI_assert(subdiv_mesh->totvert == vertex_samples->num_vertices);
+  BLI_assert(subdiv->displacement_evaluator == NULL);
+  BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH);
+  /* Only refines the evaluator, topology is known to match. */
+  if (!BKE_subdiv_eval_update_from_mesh(subdiv, coarse_mesh, NULL)) {
+    BKE_subdiv_stats_end(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH);
+    return false;
+  }
+  BKE_subdiv_stats_begin(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH_GEOMETRY);
+  SubdivMeshVerticesUpdateData data = {
+      .subdiv = subdiv,
+      .vertex_samples = vertex_samples,
+      .mvert = subdiv_mesh->mvert,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(
+      0, subdiv_mesh->totvert, &data, subdiv_mesh_vertices_update_task, &settings);
+  BKE_subdiv_stats_end(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH_GEOMETRY);
+  /* Caches derived from vertex positions are invalid now. */
+  BKE_mesh_runtime_clear_geometry(subdiv_mesh);
+  BKE_subdiv_stats_end(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH);
+  return true;
+}
+
+void BKE_subdiv_mesh_vertex_samples_free(SubdivMeshVertexSamples *vertex_samples)
+{
+  MEM_SAFE_FREE(vertex_samples->position_samples);
+  MEM_SAFE_FREE(vertex_samples->normal_sample_offsets);
+  MEM_SAFE_FREE(vertex_samples->normal_samples);
+  MEM_freeN(vertex_samples);
+}
+
+/* =============================================================================
+ * Cached result.
+ */
+
+/* Layers are shared with the cache (see #CD_SHARE_UNOWNED), the modifier stack makes them single
+ * user before following modifiers modify their input in place. Vertices are not shared, they are
+ * re-evaluated in place and normals are written to them after the modifier stack. */
+static Mesh *subdiv_mesh_cache_copy(const Mesh *mesh_cache)
+{
+  Mesh *result;
+  BKE_id_copy_ex(NULL,
+                 &mesh_cache->id,
+                 (ID **)&result,
+                 LIB_ID_COPY_LOCALIZE | LIB_ID_COPY_CD_SHARE_UNOWNED);
+  result->mvert = CustomData_duplicate_referenced_layer(
+      &result->vdata, CD_MVERT, result->totvert);
+  return result;
+}
+
+Mesh *BKE_subdiv_to_mesh_cached(Subdiv *subdiv,
+                                const SubdivToMeshSettings *settings,
+                                const Mesh *coarse_mesh,
+                                SubdivMeshCache *cache)
+{
+  uint64_t coarse_mesh_hash = 0;
+  if (!BKE_modifier_cache_hash_mesh_without_positions(&coarse_mesh_hash, coarse_mesh)) {
+    BKE_subdiv_mesh_cache_free(cache);
+    return BKE_subdiv_to_mesh(subdiv, settings, coarse_mesh);
+  }
+  if (BKE_subdiv_mesh_cache_is_valid(cache, subdiv, settings, coarse_mesh_hash)) {
+    Mesh *result = subdiv_mesh_cache_copy(cache->mesh);
+    if (BKE_subdiv_mesh_vertices_update(subdiv, cache->vertex_samples, coarse_mesh, result)) {
+      return result;
+    }
+    BKE_id_free(NULL, result);
+  }
+  BKE_subdiv_mesh_cache_free(cache);
+  SubdivMeshVertexSamples *vertex_samples;
+  Mesh *result = BKE_subdiv_to_mesh_ex(subdiv, settings, coarse_mesh, &vertex_samples);
+  if (vertex_samples == NULL) {
+    /* Loose geometry or displacement, vertices can't be updated from the samples. */
+    return result;
+  }
+  cache->mesh = result;
+  cache->vertex_samples = vertex_samples;
+  cache->subdiv_settings = subdiv->settings;
+  cache->mesh_settings = *settings;
+  cache->coarse_mesh_hash = coarse_mesh_hash;
+  return subdiv_mesh_cache_copy(result);
+}
+
+bool BKE_subdiv_mesh_cache_is_valid(const SubdivMeshCache *cache,
+                                    const Subdiv *subdiv,
+                                    const SubdivToMeshSettings *settings,
+                                    const uint64_t coarse_mesh_hash)
+{
+  return cache->mesh != NULL && cache->coarse_mesh_hash == coarse_mesh_hash &&
+         BKE_subdiv_settings_equal(&cache->subdiv_settings, &subdiv->settings) &&
+         cache->subdiv_settings.use_creases == subdiv->settings.use_creases &&
+         cache->mesh_settings.resolution == settings->resolution &&
+         cache->mesh_settings.use_optimal_display == settings->use_optimal_display;
+}
+
+void BKE_subdiv_mesh_cache_free(SubdivMeshCache *cache)
+{
+  if (cache->mesh != NULL) {
+    BKE_id_free(NULL, cache->mesh);
+    cache->mesh = NULL;
+  }
+  if (cache->vertex_samples != NULL) {
+    BKE_subdiv_mesh_vertex_samples_free(cache->vertex_samples);
+    cache->vertex_samples = NULL;
+  }
+}
@@ -98,6 +98,11 @@ enum {
   /* Use a priority queue to process nodes in the optimal order (for slow callbacks) */
   BVH_NEAREST_OPTIMAL_ORDER = (1 << 0),
 };
+enum {
+  /* Split nodes with a binned surface area heuristic instead of the median,
+   * slower to build but faster to query. */
+  BVH_BALANCE_SAH = (1 << 0),
+};
 enum {
   /* calculate IsectRayPrecalc data */
   BVH_RAYCAST_WATERTIGHT = (1 << 0),
@@ -149,6 +154,7 @@ void BLI_bvhtree_free(BVHTree *tree);
 /* construct: first insert points, then call balance */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
 void BLI_bvhtree_balance(BVHTree *tree);
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag);
 
 /* update: first update points/nodes, then call update_tree to refit the bounding volumes */
 bool BLI_bvhtree_update_node(
@@ -231,6 +237,24 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
                               BVHTree_RayCastCallback callback,
                               void *userdata);
 
+/* batched queries, sorted for coherence and run in parallel */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int num,
+                                    BVHTreeNearest *nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag);
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                const int num,
+                                float radius,
+                                BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag);
+
 float BLI_bvhtree_bb_raycast(const float bv[6],
                              const float light_start[3],
                              const float light_end[3],
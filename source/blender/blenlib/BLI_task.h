@@ -36,8 +36,10 @@ struct BLI_mempool;
 
 /* Task Scheduler
  *
- * Central scheduler that holds running threads ready to execute tasks. A single
- * queue holds the task from all pools.
+ * Central scheduler that holds running threads ready to execute tasks. Every
+ * thread has its own work-stealing deque of tasks, idle threads steal tasks from
+ * the deques of other threads. A global queue is used for tasks pushed from
+ * threads which are not managed by the scheduler.
  *
  * Init/exit must be called before/after any task pools are created/freed, and
  * must be called from the main threads. All other scheduler and pool functions
@@ -115,6 +117,7 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 /* Delayed push, use that to reduce thread overhead by accumulating
  * all new tasks into local queue first and pushing it to scheduler
  * from within a single mutex lock.
+ * Has no effect for scheduler threads, which push tasks to their own deque without locks.
  */
 void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id);
 void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id);
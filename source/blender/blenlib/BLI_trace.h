@@ -0,0 +1,85 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+#ifndef __BLI_TRACE_H__
+#define __BLI_TRACE_H__
+
+/** \file
+ * \ingroup bli
+ *
+ * Timeline recorder of timed spans, written as Chrome trace JSON which can be opened in
+ * `chrome://tracing` or Perfetto.
+ *
+ * Every thread records into its own buffer, without any locking. Writing and freeing the trace
+ * must happen while no other thread is recording.
+ */
+
+#include "BLI_compiler_compat.h"
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Only to be read through BLI_trace_is_recording(). */
+extern bool BLI_trace_recording_flag;
+
+/* Cheap check to be done before timing anything or building span names, so there is no
+ * overhead when not recording. */
+BLI_INLINE bool BLI_trace_is_recording(void)
+{
+  return BLI_trace_recording_flag;
+}
+
+/* Start recording, clearing spans of a previous recording. */
+void BLI_trace_begin(void);
+/* Stop recording, recorded spans are kept until BLI_trace_free(). */
+void BLI_trace_end(void);
+void BLI_trace_free(void);
+
+/* Add a span to the buffer of the calling thread. Times are from PIL_check_seconds_timer().
+ * The category and name are not copied, they must be static strings. */
+void BLI_trace_span_add(const char *category,
+                        const char *name,
+                        double start_time,
+                        double end_time);
+/* Same as BLI_trace_span_add(), every `%d` in the static name is replaced by the next of the
+ * integer ids when the trace is written. Avoids formatting names for spans recorded often. */
+void BLI_trace_span_add_ids(const char *category,
+                            const char *name,
+                            const int *ids,
+                            int ids_num,
+                            double start_time,
+                            double end_time);
+/* Same as BLI_trace_span_add(), with a name made of up to 4 non-empty parts separated by
+ * spaces. The parts are copied, for names which might not exist any more when the trace is
+ * written. */
+void BLI_trace_span_add_parts(const char *category,
+                              const char **name_parts,
+                              int name_parts_num,
+                              double start_time,
+                              double end_time);
+
+bool BLI_trace_write(const char *filepath);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLI_TRACE_H__ */
@@ -84,10 +84,12 @@ typedef struct BVHNode {
 #ifdef USE_SKIP_LINKS
   struct BVHNode *skip[2];
 #endif
-  float *bv;      /* Bounding volume of all nodes, max 13 axis */
-  int index;      /* face, edge, vertex index */
-  char totnode;   /* how many nodes are used, used for speedup */
-  char main_axis; /* Axis used to split this node */
+  float *bv;          /* Bounding volume of all nodes, max 13 axis */
+  float *children_bv; /* Branches: bounds of the children on the first 3 axis, [6][tree_type] */
+  int index;          /* face, edge, vertex index */
+  char totnode;       /* how many nodes are used, used for speedup */
+  char main_axis;     /* Axis used to split this node */
+  char sah_split;     /* Split by #bvh_sah_build, queries visit the nearest children first */
 } BVHNode;
 
 /* keep under 26 bytes for speed purposes */
@@ -99,14 +101,16 @@ struct BVHTree {
   float epsilon;       /* epslion is used for inflation of the k-dop      */
   int totleaf;         /* leafs */
   int totbranch;
+  int nodes_num;    /* allocated nodes */
+  int branches_num; /* allocated children bounds of branches */
   axis_t start_axis, stop_axis; /* bvhtree_kdop_axes array indices according to axis */
   axis_t axis;                  /* kdop type (6 => OBB, 7 => AABB, ...) */
   char tree_type;               /* type of tree (4 => quadtree) */
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 40),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -134,7 +138,8 @@ typedef struct BVHNearestData {
   void *userdata;
   float proj[13]; /* coordinates projection over axis */
   BVHTreeNearest nearest;
-
+  /* Leaf that last improved #nearest, used to seed the next query of a batch. */
+  BVHNode *nearest_leaf;
 } BVHNearestData;
 
 typedef struct BVHRayCastData {
@@ -155,6 +160,8 @@ typedef struct BVHRayCastData {
   int index[6];
 
   BVHTreeRayHit hit;
+  /* Leaf that last improved #hit, used to seed the next query of a batch. */
+  BVHNode *hit_leaf;
 } BVHRayCastData;
 
 typedef struct BVHNearestProjectedData {
@@ -430,6 +437,23 @@ static char get_largest_axis(const float *bv)
   }
 }
 
+/**
+ * Copy the bounds of the children into the parent, so the traversal can test all of them
+ * from one contiguous block, without reading the child nodes.
+ */
+static void node_children_bv_update(const BVHTree *tree, BVHNode *node)
+{
+  const int tree_type = tree->tree_type;
+  float *children_bv = node->children_bv;
+
+  for (int i = 0; i < node->totnode; i++) {
+    const float *bv = node->children[i]->bv;
+    for (int j = 0; j < 6; j++) {
+      children_bv[j * tree_type + i] = bv[j];
+    }
+  }
+}
+
 /**
  * bottom-up update of bvh node BV
  * join the children on the parent BV */
@@ -458,6 +482,8 @@ static void node_join(BVHTree *tree, BVHNode *node)
       break;
     }
   }
+
+  node_children_bv_update(tree, node);
 }
 
 #ifdef USE_PRINT_TREE
@@ -857,19 +883,379 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
   }
 }
 
+/**
+ * Binned SAH build
+ *
+ * Alternative to the implicit tree, used by #BLI_bvhtree_balance_ex with #BVH_BALANCE_SAH.
+ * Each branch gets up to tree_type children by splitting the child with the most leafs again,
+ * at the position where the surface area heuristic (evaluated on binned centroids) is lowest.
+ *
+ * The resulting tree isn't complete, so branches are given ranges of slots instead of implicit
+ * positions: a branch with N leafs never needs more than N - 1 branches (including itself) and
+ * its children get the slots after its own. This keeps the parents before their children,
+ * as #BLI_bvhtree_update_tree expects, and lets the sub-trees be built in parallel.
+ * Only the first 3 axis (x, y & z) are used to evaluate the splits.
+ */
+
+#define BVH_SAH_BINS 16
+
+typedef struct BVHSahBin {
+  float min[3], max[3];
+  int count;
+} BVHSahBin;
+
+static void bvh_sah_bin_init(BVHSahBin *bin)
+{
+  INIT_MINMAX(bin->min, bin->max);
+  bin->count = 0;
+}
+
+static void bvh_sah_bin_add(BVHSahBin *bin, const float min[3], const float max[3], int count)
+{
+  if (count == 0) {
+    /* Empty bins have inverted bounds. */
+    return;
+  }
+  minmax_v3v3_v3(bin->min, bin->max, min);
+  minmax_v3v3_v3(bin->min, bin->max, max);
+  bin->count += count;
+}
+
+static float bvh_sah_bin_area(const BVHSahBin *bin)
+{
+  float size[3];
+  sub_v3_v3v3(size, bin->max, bin->min);
+  return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+BLI_INLINE float bvh_sah_centroid(const BVHNode *leaf, const int axis)
+{
+  return (leaf->bv[2 * axis] + leaf->bv[2 * axis + 1]) * 0.5f;
+}
+
+BLI_INLINE int bvh_sah_bin_index(const float centroid, const float min, const float scale)
+{
+  return min_ii((int)((centroid - min) * scale), BVH_SAH_BINS - 1);
+}
+
+/**
+ * Partition the leafs from \a begin to \a end (exclusive) along the lowest cost split.
+ * \return The first leaf of the second part.
+ */
+static int bvh_sah_split(BVHNode **leafs_array, int begin, int end, char *r_axis)
+{
+  float centroid_min[3], centroid_max[3];
+  INIT_MINMAX(centroid_min, centroid_max);
+  for (int i = begin; i < end; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      const float centroid = bvh_sah_centroid(leafs_array[i], axis);
+      CLAMP_MAX(centroid_min[axis], centroid);
+      CLAMP_MIN(centroid_max[axis], centroid);
+    }
+  }
+
+  float best_cost = FLT_MAX;
+  int best_axis = -1, best_bin = 0;
+  float best_scale = 0.0f;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = centroid_max[axis] - centroid_min[axis];
+    if (!(extent > 0.0f)) {
+      continue;
+    }
+    const float scale = (float)BVH_SAH_BINS / extent;
+
+    BVHSahBin bins[BVH_SAH_BINS];
+    for (int b = 0; b < BVH_SAH_BINS; b++) {
+      bvh_sah_bin_init(&bins[b]);
+    }
+    for (int i = begin; i < end; i++) {
+      const float *bv = leafs_array[i]->bv;
+      const float min[3] = {bv[0], bv[2], bv[4]};
+      const float max[3] = {bv[1], bv[3], bv[5]};
+      const int b = bvh_sah_bin_index(
+          bvh_sah_centroid(leafs_array[i], axis), centroid_min[axis], scale);
+      bvh_sah_bin_add(&bins[b], min, max, 1);
+    }
+
+    /* Cost of the right side of each split, sweeping from the last bin. */
+    float right_cost[BVH_SAH_BINS];
+    BVHSahBin accum;
+    bvh_sah_bin_init(&accum);
+    for (int b = BVH_SAH_BINS - 1; b > 0; b--) {
+      bvh_sah_bin_add(&accum, bins[b].min, bins[b].max, bins[b].count);
+      right_cost[b] = accum.count ? bvh_sah_bin_area(&accum) * (float)accum.count : 0.0f;
+    }
+
+    bvh_sah_bin_init(&accum);
+    for (int b = 1; b < BVH_SAH_BINS; b++) {
+      bvh_sah_bin_add(&accum, bins[b - 1].min, bins[b - 1].max, bins[b - 1].count);
+      if (accum.count == 0 || accum.count == end - begin) {
+        continue;
+      }
+      const float cost = bvh_sah_bin_area(&accum) * (float)accum.count + right_cost[b];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_bin = b;
+        best_scale = scale;
+      }
+    }
+  }
+
+  if (best_axis == -1) {
+    /* All centroids are the same, any split is as good as another. */
+    *r_axis = 0;
+    return (begin + end) / 2;
+  }
+
+  int i = begin, j = end - 1;
+  while (i <= j) {
+    const int b = bvh_sah_bin_index(
+        bvh_sah_centroid(leafs_array[i], best_axis), centroid_min[best_axis], best_scale);
+    if (b < best_bin) {
+      i++;
+    }
+    else {
+      SWAP(BVHNode *, leafs_array[i], leafs_array[j]);
+      j--;
+    }
+  }
+
+  *r_axis = (char)best_axis;
+  return i;
+}
+
+typedef struct BVHSahBuildData {
+  const BVHTree *tree;
+  BVHNode **leafs_array;
+  BVHNode *branches_array;
+} BVHSahBuildData;
+
+typedef struct BVHSahChildrenData {
+  const BVHSahBuildData *data;
+  BVHNode *parent;
+  int slot[MAX_TREETYPE];
+  int range[MAX_TREETYPE + 1];
+} BVHSahChildrenData;
+
+static void bvh_sah_build_branch(const BVHSahBuildData *data,
+                                 BVHNode *parent,
+                                 int slot,
+                                 int begin,
+                                 int end);
+
+static void bvh_sah_build_children_task_cb(void *__restrict userdata,
+                                           const int k,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHSahChildrenData *children = userdata;
+  const int begin = children->range[k], end = children->range[k + 1];
+
+  if (end - begin > 1) {
+    bvh_sah_build_branch(children->data, children->parent, children->slot[k], begin, end);
+  }
+}
+
+static void bvh_sah_build_branch(const BVHSahBuildData *data,
+                                 BVHNode *parent,
+                                 int slot,
+                                 int begin,
+                                 int end)
+{
+  const BVHTree *tree = data->tree;
+  BVHNode *node = &data->branches_array[slot];
+
+  node->parent = parent;
+  refit_kdop_hull(tree, node, begin, end);
+
+  /* Split the child with the most leafs until there are enough children,
+   * the children stay ordered along the splits. */
+  BVHSahChildrenData children = {.data = data, .parent = node};
+  int children_len = 1;
+  children.range[0] = begin;
+  children.range[1] = end;
+
+  while (children_len < tree->tree_type) {
+    int k_split = 0;
+    for (int k = 1; k < children_len; k++) {
+      if (children.range[k + 1] - children.range[k] >
+          children.range[k_split + 1] - children.range[k_split]) {
+        k_split = k;
+      }
+    }
+    if (children.range[k_split + 1] - children.range[k_split] < 2) {
+      break;
+    }
+
+    char axis;
+    const int split = bvh_sah_split(
+        data->leafs_array, children.range[k_split], children.range[k_split + 1], &axis);
+    if (children_len == 1) {
+      node->main_axis = axis;
+    }
+    node->sah_split = true;
+
+    memmove(&children.range[k_split + 2],
+            &children.range[k_split + 1],
+            sizeof(*children.range) * (size_t)(children_len - k_split));
+    children.range[k_split + 1] = split;
+    children_len++;
+  }
+
+  /* Give the slots after this branch to the child branches. */
+  int child_slot = slot + 1;
+  for (int k = 0; k < children_len; k++) {
+    const int child_begin = children.range[k], child_end = children.range[k + 1];
+    if (child_end - child_begin > 1) {
+      node->children[k] = &data->branches_array[child_slot];
+      children.slot[k] = child_slot;
+      child_slot += child_end - child_begin - 1;
+    }
+    else {
+      node->children[k] = data->leafs_array[child_begin];
+      node->children[k]->parent = node;
+    }
+  }
+  node->totnode = (char)children_len;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (end - begin > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, children_len, &children, bvh_sah_build_children_task_cb, &settings);
+}
+
+/**
+ * Build the tree on \a branches_array, which must have room for `num_leafs - 1` branches.
+ * \return The number of branches, which are linked in the nodes array from the given offset.
+ */
+static int bvh_sah_build(BVHTree *tree,
+                         BVHNode *branches_array,
+                         BVHNode **leafs_array,
+                         int num_leafs)
+{
+  BLI_assert(num_leafs > 1);
+
+  BVHSahBuildData data = {
+      .tree = tree,
+      .leafs_array = leafs_array,
+      .branches_array = branches_array,
+  };
+  bvh_sah_build_branch(&data, NULL, 0, 0, num_leafs);
+
+  /* Link the used slots (the others were skipped), keeping the parents first. */
+  int totbranch = 0;
+  for (int slot = 0; slot < num_leafs - 1; slot++) {
+    if (branches_array[slot].totnode != 0) {
+      tree->nodes[tree->totleaf + totbranch] = &branches_array[slot];
+      totbranch++;
+    }
+  }
+  return totbranch;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
 
+/**
+ * Allocate the arrays for \a numnodes nodes, of which up to \a numbranches can be branches.
+ * The bounds of the children of branches are stored after the bounds of all nodes.
+ */
+static bool bvhtree_nodes_alloc(BVHTree *tree, int numnodes, int numbranches)
+{
+  const int axis = tree->axis;
+  const int tree_type = tree->tree_type;
+  const int numbv = axis * numnodes + 6 * tree_type * numbranches;
+
+  tree->nodes = MEM_callocN(sizeof(BVHNode *) * (size_t)numnodes, "BVHNodes");
+  tree->nodebv = MEM_callocN(sizeof(float) * (size_t)numbv, "BVHNodeBV");
+  tree->nodechild = MEM_callocN(sizeof(BVHNode *) * (size_t)(tree_type * numnodes), "BVHNodeBV");
+  tree->nodearray = MEM_callocN(sizeof(BVHNode) * (size_t)numnodes, "BVHNodeArray");
+
+  if (UNLIKELY((!tree->nodes) || (!tree->nodebv) || (!tree->nodechild) || (!tree->nodearray))) {
+    return false;
+  }
+
+  /* link the dynamic bv and child links */
+  for (int i = 0; i < numnodes; i++) {
+    tree->nodearray[i].bv = &tree->nodebv[i * axis];
+    tree->nodearray[i].children = &tree->nodechild[i * tree_type];
+  }
+  tree->nodes_num = numnodes;
+  tree->branches_num = numbranches;
+  return true;
+}
+
+/**
+ * \return The number of branches the allocated arrays can hold.
+ */
+static int bvhtree_branches_max(const BVHTree *tree)
+{
+  return min_ii(tree->nodes_num - tree->totleaf, tree->branches_num);
+}
+
+/**
+ * Reallocate the arrays to hold \a numbranches branches after the leafs,
+ * only valid before the tree is balanced.
+ */
+static void bvhtree_nodes_grow(BVHTree *tree, int numbranches)
+{
+  BVHTree tree_old = *tree;
+  const int numnodes = tree->totleaf + numbranches;
+
+  BLI_assert(tree->totbranch == 0);
+
+  if (UNLIKELY(!bvhtree_nodes_alloc(tree, numnodes, numbranches))) {
+    /* Keep the tree as it was. */
+    MEM_SAFE_FREE(tree->nodes);
+    MEM_SAFE_FREE(tree->nodearray);
+    MEM_SAFE_FREE(tree->nodebv);
+    MEM_SAFE_FREE(tree->nodechild);
+    *tree = tree_old;
+    return;
+  }
+
+  for (int i = 0; i < tree->totleaf; i++) {
+    const BVHNode *leaf_old = &tree_old.nodearray[i];
+    BVHNode *leaf = &tree->nodearray[i];
+    memcpy(leaf->bv, leaf_old->bv, sizeof(*leaf->bv) * (size_t)tree->axis);
+    leaf->index = leaf_old->index;
+    tree->nodes[i] = &tree->nodearray[tree_old.nodes[i] - tree_old.nodearray];
+  }
+
+  MEM_freeN(tree_old.nodes);
+  MEM_freeN(tree_old.nodearray);
+  MEM_freeN(tree_old.nodebv);
+  MEM_freeN(tree_old.nodechild);
+}
+
+/**
+ * Give each branch its block of children bounds and fill it.
+ */
+static void bvhtree_children_bv_init(BVHTree *tree)
+{
+  float *children_bv = &tree->nodebv[tree->axis * tree->nodes_num];
+
+  BLI_assert(tree->totbranch <= bvhtree_branches_max(tree));
+
+  for (int i = 0; i < tree->totbranch; i++) {
+    BVHNode *node = tree->nodes[tree->totleaf + i];
+    node->children_bv = &children_bv[i * 6 * tree->tree_type];
+    node_children_bv_update(tree, node);
+  }
+}
+
 /**
  * \note many callers don't check for ``NULL`` return.
  */
 BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
 {
   BVHTree *tree;
-  int numnodes, i;
+  int numnodes;
 
   BLI_assert(tree_type >= 2 && tree_type <= MAX_TREETYPE);
 
@@ -916,20 +1302,9 @@ BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
     /* Allocate arrays */
     numnodes = maxsize + implicit_needed_branches(tree_type, maxsize) + tree_type;
 
-    tree->nodes = MEM_callocN(sizeof(BVHNode *) * (size_t)numnodes, "BVHNodes");
-    tree->nodebv = MEM_callocN(sizeof(float) * (size_t)(axis * numnodes), "BVHNodeBV");
-    tree->nodechild = MEM_callocN(sizeof(BVHNode *) * (size_t)(tree_type * numnodes), "BVHNodeBV");
-    tree->nodearray = MEM_callocN(sizeof(BVHNode) * (size_t)numnodes, "BVHNodeArray");
-
-    if (UNLIKELY((!tree->nodes) || (!tree->nodebv) || (!tree->nodechild) || (!tree->nodearray))) {
+    if (UNLIKELY(!bvhtree_nodes_alloc(tree, numnodes, numnodes - maxsize))) {
       goto fail;
     }
-
-    /* link the dynamic bv and child links */
-    for (i = 0; i < numnodes; i++) {
-      tree->nodearray[i].bv = &tree->nodebv[i * axis];
-      tree->nodearray[i].children = &tree->nodechild[i * tree_type];
-    }
   }
   return tree;
 
@@ -951,23 +1326,47 @@ void BLI_bvhtree_free(BVHTree *tree)
 
 void BLI_bvhtree_balance(BVHTree *tree)
 {
-  BVHNode **leafs_array = tree->nodes;
+  BLI_bvhtree_balance_ex(tree, 0);
+}
 
+/**
+ * \param flag: #BVH_BALANCE_SAH to build a tree with better quality for queries.
+ */
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag)
+{
   /* This function should only be called once
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->totbranch == 0);
 
-  /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+  /* The splits are evaluated on the x, y & z axis only. */
+  bool use_sah = (flag & BVH_BALANCE_SAH) && (tree->totleaf > 1) && (tree->start_axis == 0);
+  if (use_sah && bvhtree_branches_max(tree) < tree->totleaf - 1) {
+    /* Unlike in the implicit tree, branches may have less than tree_type children. */
+    bvhtree_nodes_grow(tree, tree->totleaf - 1);
+    use_sah = (bvhtree_branches_max(tree) >= tree->totleaf - 1);
+  }
 
-  /* current code expects the branches to be linked to the nodes array
-   * we perform that linkage here */
-  tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
-  for (int i = 0; i < tree->totbranch; i++) {
-    tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
+  BVHNode **leafs_array = tree->nodes;
+
+  if (use_sah) {
+    tree->totbranch = bvh_sah_build(
+        tree, tree->nodearray + tree->totleaf, leafs_array, tree->totleaf);
+  }
+  else {
+    /* Build the implicit tree */
+    non_recursive_bvh_div_nodes(
+        tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+
+    /* current code expects the branches to be linked to the nodes array
+     * we perform that linkage here */
+    tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
+    for (int i = 0; i < tree->totbranch; i++) {
+      tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
+    }
   }
 
+  bvhtree_children_bv_init(tree);
+
 #ifdef USE_SKIP_LINKS
   build_skip_links(tree, tree->nodes[tree->totleaf], NULL, NULL);
 #endif
@@ -1416,41 +1815,98 @@ static float calc_nearest_point_squared(const float proj[3], BVHNode *node, floa
   return len_squared_v3v3(proj, nearest);
 }
 
+/**
+ * Order the indices of the children closer than \a dist_max to visit them.
+ *
+ * Children of median splits keep the order along the split axis (reversed when \a reverse is set),
+ * since it decides which of equally near leafs is found.
+ * Children of #BVH_BALANCE_SAH splits are sorted by distance.
+ * \return The number of children in \a r_order.
+ */
+static int children_order(const BVHNode *node,
+                          const float dist[],
+                          const float dist_max,
+                          const bool reverse,
+                          int r_order[])
+{
+  const int totnode = node->totnode;
+  int order_len = 0;
+  if (!node->sah_split) {
+    for (int k = 0; k < totnode; k++) {
+      const int i = reverse ? (totnode - 1 - k) : k;
+      if (dist[i] < dist_max) {
+        r_order[order_len++] = i;
+      }
+    }
+    return order_len;
+  }
+
+  for (int i = 0; i < totnode; i++) {
+    if (dist[i] < dist_max) {
+      int j = order_len++;
+      for (; j > 0 && dist[r_order[j - 1]] > dist[i]; j--) {
+        r_order[j] = r_order[j - 1];
+      }
+      r_order[j] = i;
+    }
+  }
+  return order_len;
+}
+
 /* Depth first search method */
 static void dfs_find_nearest_dfs(BVHNearestData *data, BVHNode *node)
 {
   if (node->totnode == 0) {
     if (data->callback) {
+      const float dist_sq = data->nearest.dist_sq;
       data->callback(data->userdata, node->index, data->co, &data->nearest);
+      if (data->nearest.dist_sq < dist_sq) {
+        data->nearest_leaf = node;
+      }
     }
     else {
       data->nearest.index = node->index;
       data->nearest.dist_sq = calc_nearest_point_squared(data->proj, node, data->nearest.co);
+      data->nearest_leaf = node;
     }
   }
   else {
-    /* Better heuristic to pick the closest node to dive on */
+    const int tree_type = data->tree->tree_type;
+    const float *children_bv = node->children_bv;
+    float dist_sq[MAX_TREETYPE];
     int i;
-    float nearest[3];
-
-    if (data->proj[node->main_axis] <= node->children[0]->bv[node->main_axis * 2 + 1]) {
 
+    /* Same as #calc_nearest_point_squared for all children at once. */
+    for (i = 0; i != node->totnode; i++) {
+      dist_sq[i] = 0.0f;
+    }
+    for (int axis = 0; axis != 3; axis++) {
+      const float *bv_min = &children_bv[(2 * axis) * tree_type];
+      const float *bv_max = &children_bv[(2 * axis + 1) * tree_type];
+      const float proj = data->proj[axis];
       for (i = 0; i != node->totnode; i++) {
-        if (calc_nearest_point_squared(data->proj, node->children[i], nearest) >=
-            data->nearest.dist_sq) {
-          continue;
+        float val = proj;
+        if (bv_min[i] > val) {
+          val = bv_min[i];
         }
-        dfs_find_nearest_dfs(data, node->children[i]);
+        if (bv_max[i] < val) {
+          val = bv_max[i];
+        }
+        dist_sq[i] += (val - proj) * (val - proj);
       }
     }
-    else {
-      for (i = node->totnode - 1; i >= 0; i--) {
-        if (calc_nearest_point_squared(data->proj, node->children[i], nearest) >=
-            data->nearest.dist_sq) {
-          continue;
-        }
-        dfs_find_nearest_dfs(data, node->children[i]);
+
+    /* Dive into the closest children first, their results prune the search of the others. */
+    const bool reverse = !(data->proj[node->main_axis] <=
+                           node->children[0]->bv[node->main_axis * 2 + 1]);
+    int order[MAX_TREETYPE];
+    const int order_len = children_order(node, dist_sq, data->nearest.dist_sq, reverse, order);
+
+    for (i = 0; i != order_len; i++) {
+      if (dist_sq[order[i]] >= data->nearest.dist_sq) {
+        continue;
       }
+      dfs_find_nearest_dfs(data, node->children[order[i]]);
     }
   }
 }
@@ -1470,11 +1926,16 @@ static void heap_find_nearest_inner(BVHNearestData *data, HeapSimple *heap, BVHN
 {
   if (node->totnode == 0) {
     if (data->callback) {
+      const float dist_sq = data->nearest.dist_sq;
       data->callback(data->userdata, node->index, data->co, &data->nearest);
+      if (data->nearest.dist_sq < dist_sq) {
+        data->nearest_leaf = node;
+      }
     }
     else {
       data->nearest.index = node->index;
       data->nearest.dist_sq = calc_nearest_point_squared(data->proj, node, data->nearest.co);
+      data->nearest_leaf = node;
     }
   }
   else {
@@ -1737,10 +2198,59 @@ static float fast_ray_nearest_hit(const BVHRayCastData *data, const BVHNode *nod
   }
 }
 
-static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
+static void dfs_raycast_node(BVHRayCastData *data, BVHNode *node, float dist);
+
+/**
+ * Same as #dfs_raycast on each child, with #fast_ray_nearest_hit done for all children at once
+ * and the children visited in the order of #children_order.
+ */
+static void dfs_raycast_children(BVHRayCastData *data, BVHNode *node)
 {
-  int i;
+  const int tree_type = data->tree->tree_type;
+  float t1[3][MAX_TREETYPE], t2[3][MAX_TREETYPE];
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float *bv_1 = &node->children_bv[data->index[2 * axis] * tree_type];
+    const float *bv_2 = &node->children_bv[data->index[2 * axis + 1] * tree_type];
+    const float origin = data->ray.origin[axis];
+    const float idot_axis = data->idot_axis[axis];
+    for (int i = 0; i < node->totnode; i++) {
+      t1[axis][i] = (bv_1[i] - origin) * idot_axis;
+      t2[axis][i] = (bv_2[i] - origin) * idot_axis;
+    }
+  }
 
+  float dist[MAX_TREETYPE];
+  for (int i = 0; i < node->totnode; i++) {
+    const float t1x = t1[0][i], t2x = t2[0][i];
+    const float t1y = t1[1][i], t2y = t2[1][i];
+    const float t1z = t1[2][i], t2z = t2[2][i];
+
+    if ((t1x > t2y || t2x < t1y || t1x > t2z || t2x < t1z || t1y > t2z || t2y < t1z) ||
+        (t2x < 0.0f || t2y < 0.0f || t2z < 0.0f) ||
+        (t1x > data->hit.dist || t1y > data->hit.dist || t1z > data->hit.dist)) {
+      dist[i] = FLT_MAX;
+    }
+    else {
+      dist[i] = max_fff(t1x, t1y, t1z);
+    }
+  }
+
+  /* Dive into the children along the ray, hits in the first ones prune the others. */
+  const bool reverse = !(data->ray_dot_axis[node->main_axis] > 0.0f);
+  int order[MAX_TREETYPE];
+  const int order_len = children_order(node, dist, data->hit.dist, reverse, order);
+
+  for (int i = 0; i < order_len; i++) {
+    if (dist[order[i]] >= data->hit.dist) {
+      continue;
+    }
+    dfs_raycast_node(data, node->children[order[i]], dist[order[i]]);
+  }
+}
+
+static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
+{
   /* ray-bv is really fast.. and simple tests revealed its worth to test it
    * before calling the ray-primitive functions */
   /* XXX: temporary solution for particles until fast_ray_nearest_hit supports ray.radius */
@@ -1750,16 +2260,34 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
     return;
   }
 
+  dfs_raycast_node(data, node, dist);
+}
+
+/**
+ * Visit a node whose bounds are hit at \a dist.
+ */
+static void dfs_raycast_node(BVHRayCastData *data, BVHNode *node, float dist)
+{
+  int i;
+
   if (node->totnode == 0) {
     if (data->callback) {
+      const float hit_dist = data->hit.dist;
       data->callback(data->userdata, node->index, &data->ray, &data->hit);
+      if (data->hit.dist < hit_dist) {
+        data->hit_leaf = node;
+      }
     }
     else {
       data->hit.index = node->index;
       data->hit.dist = dist;
       madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist);
+      data->hit_leaf = node;
     }
   }
+  else if (data->ray.radius == 0.0f) {
+    dfs_raycast_children(data, node);
+  }
   else {
     /* pick loop direction to dive into the tree (based on ray direction and split axis) */
     if (data->ray_dot_axis[node->main_axis] > 0.0f) {
@@ -1984,6 +2512,305 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_find_nearest_batch / BLI_bvhtree_ray_cast_batch
+ *
+ * Queries are sorted along a Morton curve through their coordinates, so that consecutive queries
+ * walk mostly the same nodes, and split in chunks which are processed in parallel.
+ * Within a chunk, the leaf found by the previous query is tested first:
+ * for coherent queries it is often the result, which then prunes nearly all of the traversal.
+ * Only the distance found for that leaf is kept to prune the traversal, which finds the leaf
+ * again unless another one is nearer. So of equally near leaves, the one found first is the
+ * same as without the seed, as long as the tree is traversed depth first.
+ *
+ * \{ */
+
+/* Number of consecutive (sorted) queries handled by one task. */
+#define BVH_BATCH_CHUNK_SIZE 256
+
+/* Spread the lower 10 bits of \a x so there are two zero bits between each of them. */
+static uint bvh_batch_morton_expand(uint x)
+{
+  x &= 0x3ff;
+  x = (x | (x << 16)) & 0x030000ff;
+  x = (x | (x << 8)) & 0x0300f00f;
+  x = (x | (x << 4)) & 0x030c30c3;
+  x = (x | (x << 2)) & 0x09249249;
+  return x;
+}
+
+/**
+ * \return The order of the queries along a Morton curve through their bounds,
+ * or NULL when there are too few queries for the sorting to pay off.
+ */
+static uint *bvh_batch_query_order(const float (*co)[3], const int num)
+{
+  if (num <= BVH_BATCH_CHUNK_SIZE) {
+    return NULL;
+  }
+
+  float min[3], max[3], scale[3];
+  INIT_MINMAX(min, max);
+  for (int i = 0; i < num; i++) {
+    minmax_v3v3_v3(min, max, co[i]);
+  }
+  for (int axis = 0; axis < 3; axis++) {
+    scale[axis] = (max[axis] > min[axis]) ? 1023.0f / (max[axis] - min[axis]) : 0.0f;
+  }
+
+  uint *keys = MEM_malloc_arrayN((size_t)num, sizeof(*keys), __func__);
+  uint *order = MEM_malloc_arrayN((size_t)num, sizeof(*order), __func__);
+  uint *keys_tmp = MEM_malloc_arrayN((size_t)num, sizeof(*keys_tmp), __func__);
+  uint *order_tmp = MEM_malloc_arrayN((size_t)num, sizeof(*order_tmp), __func__);
+
+  for (int i = 0; i < num; i++) {
+    uint key = 0;
+    for (int axis = 0; axis < 3; axis++) {
+      const uint cell = (uint)((co[i][axis] - min[axis]) * scale[axis]);
+      key |= bvh_batch_morton_expand(cell) << (2 - axis);
+    }
+    keys[i] = key;
+    order[i] = (uint)i;
+  }
+
+  /* Least significant digit radix sort, 8 bits per pass (keys use 30 bits). */
+  for (uint shift = 0; shift < 32; shift += 8) {
+    uint offset[257] = {0};
+    for (int i = 0; i < num; i++) {
+      offset[((keys[i] >> shift) & 0xff) + 1]++;
+    }
+    for (int digit = 0; digit < 256; digit++) {
+      offset[digit + 1] += offset[digit];
+    }
+    for (int i = 0; i < num; i++) {
+      const uint dst = offset[(keys[i] >> shift) & 0xff]++;
+      keys_tmp[dst] = keys[i];
+      order_tmp[dst] = order[i];
+    }
+    SWAP(uint *, keys, keys_tmp);
+    SWAP(uint *, order, order_tmp);
+  }
+
+  MEM_freeN(keys);
+  MEM_freeN(keys_tmp);
+  MEM_freeN(order_tmp);
+
+  return order;
+}
+
+static void bvh_batch_parallel_range(const int num,
+                                     void *userdata,
+                                     TaskParallelRangeFunc func)
+{
+  const int chunks_num = (num + BVH_BATCH_CHUNK_SIZE - 1) / BVH_BATCH_CHUNK_SIZE;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (num > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, chunks_num, userdata, func, &settings);
+}
+
+typedef struct BVHNearestBatchData {
+  const BVHTree *tree;
+  const float (*co)[3];
+  const uint *order;
+  int num;
+  BVHTreeNearest *nearest;
+  BVHTree_NearestPointCallback callback;
+  void *userdata;
+  int flag;
+} BVHNearestBatchData;
+
+static void bvhtree_find_nearest_batch_cb(void *__restrict userdata,
+                                          const int chunk,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHNearestBatchData *batch = userdata;
+  const BVHTree *tree = batch->tree;
+  BVHNode *root = tree->nodes[tree->totleaf];
+  BVHNode *seed_leaf = NULL;
+
+  const int start = chunk * BVH_BATCH_CHUNK_SIZE;
+  const int end = min_ii(start + BVH_BATCH_CHUNK_SIZE, batch->num);
+
+  BVHNearestData data;
+  data.tree = tree;
+  data.callback = batch->callback;
+  data.userdata = batch->userdata;
+
+  for (int i = start; i < end; i++) {
+    const int index = batch->order ? (int)batch->order[i] : i;
+
+    data.co = batch->co[index];
+    for (axis_t axis_iter = tree->start_axis; axis_iter != tree->stop_axis; axis_iter++) {
+      data.proj[axis_iter] = dot_v3v3(data.co, bvhtree_kdop_axes[axis_iter]);
+    }
+    data.nearest = batch->nearest[index];
+    data.nearest_leaf = NULL;
+
+    if (seed_leaf) {
+      dfs_find_nearest_begin(&data, seed_leaf);
+      if (data.nearest_leaf) {
+        data.nearest.index = -1;
+        data.nearest.dist_sq = nextafterf(data.nearest.dist_sq, FLT_MAX);
+      }
+    }
+    if (batch->flag & BVH_NEAREST_OPTIMAL_ORDER) {
+      heap_find_nearest_begin(&data, root);
+    }
+    else {
+      dfs_find_nearest_begin(&data, root);
+    }
+
+    batch->nearest[index] = data.nearest;
+    if (data.nearest_leaf) {
+      seed_leaf = data.nearest_leaf;
+    }
+  }
+}
+
+/**
+ * Find the nearest node for each of the \a num coordinates in \a co,
+ * gives the same results as calling #BLI_bvhtree_find_nearest_ex for each of them.
+ * Of equally near nodes the same one is found, except with #BVH_NEAREST_OPTIMAL_ORDER,
+ * where it may be another one.
+ *
+ * \param nearest: Array of \a num items, which must be initialized like the \a nearest argument
+ * of #BLI_bvhtree_find_nearest_ex (index -1 and the maximum squared distance), and receives
+ * the results.
+ * \note The \a callback is called from multiple threads.
+ */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    const int num,
+                                    BVHTreeNearest *nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag)
+{
+  if (num == 0 || tree->nodes[tree->totleaf] == NULL) {
+    return;
+  }
+
+  BVHNearestBatchData batch = {
+      .tree = tree,
+      .co = co,
+      .order = bvh_batch_query_order(co, num),
+      .num = num,
+      .nearest = nearest,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+
+  bvh_batch_parallel_range(num, &batch, bvhtree_find_nearest_batch_cb);
+
+  if (batch.order) {
+    MEM_freeN((void *)batch.order);
+  }
+}
+
+typedef struct BVHRayCastBatchData {
+  const BVHTree *tree;
+  const float (*co)[3];
+  const float (*dir)[3];
+  float radius;
+  const uint *order;
+  int num;
+  BVHTreeRayHit *hits;
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+  int flag;
+} BVHRayCastBatchData;
+
+static void bvhtree_ray_cast_batch_cb(void *__restrict userdata,
+                                      const int chunk,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRayCastBatchData *batch = userdata;
+  const BVHTree *tree = batch->tree;
+  BVHNode *root = tree->nodes[tree->totleaf];
+  BVHNode *seed_leaf = NULL;
+
+  const int start = chunk * BVH_BATCH_CHUNK_SIZE;
+  const int end = min_ii(start + BVH_BATCH_CHUNK_SIZE, batch->num);
+
+  BVHRayCastData data;
+  data.tree = tree;
+  data.callback = batch->callback;
+  data.userdata = batch->userdata;
+  data.ray.radius = batch->radius;
+
+  for (int i = start; i < end; i++) {
+    const int index = batch->order ? (int)batch->order[i] : i;
+
+    BLI_ASSERT_UNIT_V3(batch->dir[index]);
+    copy_v3_v3(data.ray.origin, batch->co[index]);
+    copy_v3_v3(data.ray.direction, batch->dir[index]);
+    bvhtree_ray_cast_data_precalc(&data, batch->flag);
+    data.hit = batch->hits[index];
+    data.hit_leaf = NULL;
+
+    if (seed_leaf) {
+      dfs_raycast(&data, seed_leaf);
+      if (data.hit_leaf) {
+        data.hit.index = -1;
+        data.hit.dist = nextafterf(data.hit.dist, FLT_MAX);
+      }
+    }
+    dfs_raycast(&data, root);
+
+    batch->hits[index] = data.hit;
+    if (data.hit_leaf) {
+      seed_leaf = data.hit_leaf;
+    }
+  }
+}
+
+/**
+ * Cast \a num rays, gives the same results as calling #BLI_bvhtree_ray_cast_ex for each of them,
+ * also which of equally near nodes is hit.
+ *
+ * \param hits: Array of \a num items, which must be initialized like the \a hit argument
+ * of #BLI_bvhtree_ray_cast_ex (index -1 and the maximum distance), and receives the results.
+ * \note The \a callback is called from multiple threads.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                const int num,
+                                float radius,
+                                BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag)
+{
+  if (num == 0 || tree->nodes[tree->totleaf] == NULL) {
+    return;
+  }
+
+  BVHRayCastBatchData batch = {
+      .tree = tree,
+      .co = co,
+      .dir = dir,
+      .radius = radius,
+      .order = bvh_batch_query_order(co, num),
+      .num = num,
+      .hits = hits,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+
+  bvh_batch_parallel_range(num, &batch, bvhtree_ray_cast_batch_cb);
+
+  if (batch.order) {
+    MEM_freeN((void *)batch.order);
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
@@ -29,14 +29,20 @@
  *  - Literals:
  *      floating point and decimal integer.
  *  - Constants:
- *      pi, True, False
+ *      pi, tau, e, True, False
  *  - Operators:
- *      +, -, *, /, ==, !=, <, <=, >, >=, and, or, not, ternary if
+ *      +, -, *, /, //, %, **, ==, !=, <, <=, >, >=, and, or, not, ternary if
  *  - Functions:
  *      min, max, radians, degrees,
- *      abs, fabs, floor, ceil, trunc, int,
- *      sin, cos, tan, asin, acos, atan, atan2,
- *      exp, log, sqrt, pow, fmod
+ *      abs, fabs, floor, ceil, trunc, int, round, float, bool,
+ *      sin, cos, tan, asin, acos, atan, atan2, hypot,
+ *      sinh, cosh, tanh, asinh, acosh, atanh,
+ *      exp, expm1, log, log10, log2, log1p, sqrt, pow, fmod, copysign
+ *
+ * The expression is parsed into code for a stack machine, folding constant
+ * sub-expressions on the way. That code is then translated into a program for
+ * a register machine, which reads constants and parameters directly instead of
+ * pushing them on a stack, and has common arithmetic inlined.
  *
  * The implementation has no global state and can be used multi-threaded.
  */
@@ -93,6 +99,7 @@ typedef enum eOpCode {
 typedef double (*UnaryOpFunc)(double);
 typedef double (*BinaryOpFunc)(double, double);
 
+/* Operation of the stack machine code produced by the parser. */
 typedef struct ExprOp {
   eOpCode opcode;
 
@@ -107,11 +114,74 @@ typedef struct ExprOp {
   } arg;
 } ExprOp;
 
+typedef enum eRegOpCode {
+  /* Copy: (dst = a) */
+  REGOP_MOVE,
+  /* Inlined arithmetic: (dst = -a), (dst = a + b), ... */
+  REGOP_NEGATE,
+  REGOP_ADD,
+  REGOP_SUB,
+  REGOP_MUL,
+  REGOP_DIV,
+  /* Inlined logic and comparisons: (dst = !a), (dst = a == b), ... */
+  REGOP_NOT,
+  REGOP_EQ,
+  REGOP_NE,
+  REGOP_LT,
+  REGOP_LE,
+  REGOP_GT,
+  REGOP_GE,
+  /* Minimum and maximum of two values: (dst = min(a, b)) */
+  REGOP_MIN,
+  REGOP_MAX,
+  /* Function calls: (dst = func1(a)), (dst = func2(a, b)) */
+  REGOP_FUNC1,
+  REGOP_FUNC2,
+  /* Jump (pc += jmp_offset) */
+  REGOP_JMP,
+  /* Jump if a is zero. */
+  REGOP_JMP_ELSE,
+  /* (dst = a) and jump if a is nonzero */
+  REGOP_JMP_OR,
+  /* (dst = a) and jump if a is zero */
+  REGOP_JMP_AND,
+  /* For comparison chaining: (dst = 0) and jump IF NOT func2(a, b) ELSE (dst = b) */
+  REGOP_CMP_CHAIN,
+} eRegOpCode;
+
+/* Operation of the register machine, unused operands are -1. */
+typedef struct ExprRegOp {
+  short opcode;
+  short dst, a, b;
+
+  int jmp_offset;
+
+  union {
+    void *ptr;
+    UnaryOpFunc func1;
+    BinaryOpFunc func2;
+  } func;
+} ExprRegOp;
+
+/* Limit of registers, so they can be allocated on the stack. */
+#define MAX_REGISTERS 1000
+
+/* The registers are the constants, then the parameters, then temporary values. */
 struct ExprPyLike_Parsed {
   int ops_count;
-  int max_stack;
 
-  ExprOp ops[];
+  /* Number of registers, zero if parsing failed. */
+  int registers_len;
+  int consts_len;
+  int params_len;
+
+  /* Register holding the result after evaluation. */
+  int result;
+
+  /* Values of the constant registers. */
+  double *consts;
+
+  ExprRegOp ops[];
 };
 
 /** \} */
@@ -131,13 +201,14 @@ void BLI_expr_pylike_free(ExprPyLike_Parsed *expr)
 /** Check if the parsing result is valid for evaluation. */
 bool BLI_expr_pylike_is_valid(ExprPyLike_Parsed *expr)
 {
-  return expr != NULL && expr->ops_count > 0;
+  return expr != NULL && expr->registers_len > 0;
 }
 
 /** Check if the parsed expression always evaluates to the same value. */
 bool BLI_expr_pylike_is_constant(ExprPyLike_Parsed *expr)
 {
-  return expr != NULL && expr->ops_count == 1 && expr->ops[0].opcode == OPCODE_CONST;
+  return BLI_expr_pylike_is_valid(expr) && expr->ops_count == 0 &&
+         expr->result < expr->consts_len;
 }
 
 /** Check if the parsed expression uses the parameter with the given index. */
@@ -145,12 +216,18 @@ bool BLI_expr_pylike_is_using_param(ExprPyLike_Parsed *expr, int index)
 {
   int i;
 
-  if (expr == NULL) {
+  if (!BLI_expr_pylike_is_valid(expr) || index < 0 || index >= expr->params_len) {
     return false;
   }
 
+  const int reg = expr->consts_len + index;
+
+  if (expr->result == reg) {
+    return true;
+  }
+
   for (i = 0; i < expr->ops_count; i++) {
-    if (expr->ops[i].opcode == OPCODE_PARAMETER && expr->ops[i].arg.ival == index) {
+    if (expr->ops[i].a == reg || expr->ops[i].b == reg) {
       return true;
     }
   }
@@ -161,7 +238,7 @@ bool BLI_expr_pylike_is_using_param(ExprPyLike_Parsed *expr, int index)
 /** \} */
 
 /* -------------------------------------------------------------------- */
-/** \name Stack Machine Evaluation
+/** \name Register Machine Evaluation
  * \{ */
 
 /**
@@ -179,90 +256,116 @@ eExprPyLike_EvalStatus BLI_expr_pylike_eval(ExprPyLike_Parsed *expr,
     return EXPR_PYLIKE_INVALID;
   }
 
-#define FAIL_IF(condition) \
-  if (condition) { \
-    return EXPR_PYLIKE_FATAL_ERROR; \
-  } \
-  ((void)0)
+  if (expr->registers_len > MAX_REGISTERS || param_values_len < expr->params_len) {
+    return EXPR_PYLIKE_FATAL_ERROR;
+  }
 
-  /* Check the stack requirement is at least remotely sane and allocate on the actual stack. */
-  FAIL_IF(expr->max_stack <= 0 || expr->max_stack > 1000);
+  /* Operands were checked to be in range when compiling. */
+  double *regs = BLI_array_alloca(regs, expr->registers_len);
 
-  double *stack = BLI_array_alloca(stack, expr->max_stack);
+  memcpy(regs, expr->consts, sizeof(double) * expr->consts_len);
+  if (expr->params_len > 0) {
+    memcpy(regs + expr->consts_len, param_values, sizeof(double) * expr->params_len);
+  }
 
   /* Evaluate expression. */
-  ExprOp *ops = expr->ops;
-  int sp = 0, pc;
+  const ExprRegOp *op = expr->ops, *op_end = expr->ops + expr->ops_count;
 
-  feclearexcept(FE_ALL_EXCEPT);
+  /* Clearing is much slower than testing, and the flags are usually clear already. */
+  if (fetestexcept(FE_DIVBYZERO | FE_INVALID)) {
+    feclearexcept(FE_ALL_EXCEPT);
+  }
+
+  for (; op < op_end; op++) {
+    switch (op->opcode) {
+      case REGOP_MOVE:
+        regs[op->dst] = regs[op->a];
+        break;
 
-  for (pc = 0; pc >= 0 && pc < expr->ops_count; pc++) {
-    switch (ops[pc].opcode) {
       /* Arithmetic */
-      case OPCODE_CONST:
-        FAIL_IF(sp >= expr->max_stack);
-        stack[sp++] = ops[pc].arg.dval;
+      case REGOP_NEGATE:
+        regs[op->dst] = -regs[op->a];
         break;
-      case OPCODE_PARAMETER:
-        FAIL_IF(sp >= expr->max_stack || ops[pc].arg.ival >= param_values_len);
-        stack[sp++] = param_values[ops[pc].arg.ival];
+      case REGOP_ADD:
+        regs[op->dst] = regs[op->a] + regs[op->b];
         break;
-      case OPCODE_FUNC1:
-        FAIL_IF(sp < 1);
-        stack[sp - 1] = ops[pc].arg.func1(stack[sp - 1]);
+      case REGOP_SUB:
+        regs[op->dst] = regs[op->a] - regs[op->b];
         break;
-      case OPCODE_FUNC2:
-        FAIL_IF(sp < 2);
-        stack[sp - 2] = ops[pc].arg.func2(stack[sp - 2], stack[sp - 1]);
-        sp--;
+      case REGOP_MUL:
+        regs[op->dst] = regs[op->a] * regs[op->b];
         break;
-      case OPCODE_MIN:
-        FAIL_IF(sp < ops[pc].arg.ival);
-        for (int j = 1; j < ops[pc].arg.ival; j++, sp--) {
-          CLAMP_MAX(stack[sp - 2], stack[sp - 1]);
-        }
+      case REGOP_DIV:
+        regs[op->dst] = regs[op->a] / regs[op->b];
         break;
-      case OPCODE_MAX:
-        FAIL_IF(sp < ops[pc].arg.ival);
-        for (int j = 1; j < ops[pc].arg.ival; j++, sp--) {
-          CLAMP_MIN(stack[sp - 2], stack[sp - 1]);
-        }
+
+      /* Logic and comparisons */
+      case REGOP_NOT:
+        regs[op->dst] = regs[op->a] ? 0.0 : 1.0;
+        break;
+      case REGOP_EQ:
+        regs[op->dst] = regs[op->a] == regs[op->b] ? 1.0 : 0.0;
+        break;
+      case REGOP_NE:
+        regs[op->dst] = regs[op->a] != regs[op->b] ? 1.0 : 0.0;
+        break;
+      case REGOP_LT:
+        regs[op->dst] = regs[op->a] < regs[op->b] ? 1.0 : 0.0;
+        break;
+      case REGOP_LE:
+        regs[op->dst] = regs[op->a] <= regs[op->b] ? 1.0 : 0.0;
+        break;
+      case REGOP_GT:
+        regs[op->dst] = regs[op->a] > regs[op->b] ? 1.0 : 0.0;
+        break;
+      case REGOP_GE:
+        regs[op->dst] = regs[op->a] >= regs[op->b] ? 1.0 : 0.0;
         break;
 
-      /* Jumps */
-      case OPCODE_JMP:
-        pc += ops[pc].jmp_offset;
+      /* Same as CLAMP_MAX and CLAMP_MIN of a by b. */
+      case REGOP_MIN:
+        regs[op->dst] = (regs[op->a] > regs[op->b]) ? regs[op->b] : regs[op->a];
         break;
-      case OPCODE_JMP_ELSE:
-        FAIL_IF(sp < 1);
-        if (!stack[--sp]) {
-          pc += ops[pc].jmp_offset;
-        }
+      case REGOP_MAX:
+        regs[op->dst] = (regs[op->a] < regs[op->b]) ? regs[op->b] : regs[op->a];
         break;
-      case OPCODE_JMP_OR:
-      case OPCODE_JMP_AND:
-        FAIL_IF(sp < 1);
-        if (!stack[sp - 1] == !(ops[pc].opcode == OPCODE_JMP_OR)) {
-          pc += ops[pc].jmp_offset;
+
+      /* Function calls */
+      case REGOP_FUNC1:
+        regs[op->dst] = op->func.func1(regs[op->a]);
+        break;
+      case REGOP_FUNC2:
+        regs[op->dst] = op->func.func2(regs[op->a], regs[op->b]);
+        break;
+
+      /* Jumps, only forward as checked when compiling. */
+      case REGOP_JMP:
+        op += op->jmp_offset;
+        break;
+      case REGOP_JMP_ELSE:
+        if (!regs[op->a]) {
+          op += op->jmp_offset;
         }
-        else {
-          sp--;
+        break;
+      case REGOP_JMP_OR:
+      case REGOP_JMP_AND:
+        if (!regs[op->a] == !(op->opcode == REGOP_JMP_OR)) {
+          regs[op->dst] = regs[op->a];
+          op += op->jmp_offset;
         }
         break;
 
       /* For chaining comparisons, i.e. "a < b < c" as "a < b and b < c" */
-      case OPCODE_CMP_CHAIN:
-        FAIL_IF(sp < 2);
+      case REGOP_CMP_CHAIN:
         /* If comparison fails, return 0 and jump to end. */
-        if (!ops[pc].arg.func2(stack[sp - 2], stack[sp - 1])) {
-          stack[sp - 2] = 0.0;
-          pc += ops[pc].jmp_offset;
+        if (!op->func.func2(regs[op->a], regs[op->b])) {
+          regs[op->dst] = 0.0;
+          op += op->jmp_offset;
         }
-        /* Otherwise keep b on the stack and proceed. */
+        /* Otherwise keep b and proceed. */
         else {
-          stack[sp - 2] = stack[sp - 1];
+          regs[op->dst] = regs[op->b];
         }
-        sp--;
         break;
 
       default:
@@ -270,11 +373,7 @@ eExprPyLike_EvalStatus BLI_expr_pylike_eval(ExprPyLike_Parsed *expr,
     }
   }
 
-  FAIL_IF(sp != 1 || pc != expr->ops_count);
-
-#undef FAIL_IF
-
-  *r_result = stack[0];
+  *r_result = regs[expr->result];
 
   /* Detect floating point evaluation errors. */
   int flags = fetestexcept(FE_DIVBYZERO | FE_INVALID);
@@ -316,6 +415,41 @@ static double op_sub(double a, double b)
   return a - b;
 }
 
+/* Python modulo: result has the sign of the divisor. */
+static double op_mod(double a, double b)
+{
+  double mod = fmod(a, b);
+
+  if (mod) {
+    if ((b < 0) != (mod < 0)) {
+      mod += b;
+    }
+  }
+  else {
+    mod = copysign(0.0, b);
+  }
+
+  return mod;
+}
+
+/* Python floor division, computed the same way as float.__floordiv__ for consistent rounding. */
+static double op_floordiv(double a, double b)
+{
+  double mod = fmod(a, b);
+  double div = (a - mod) / b;
+
+  if (mod && (b < 0) != (mod < 0)) {
+    div -= 1.0;
+  }
+
+  if (div) {
+    double floordiv = floor(div);
+    return (div - floordiv > 0.5) ? floordiv + 1.0 : floordiv;
+  }
+
+  return copysign(0.0, a / b);
+}
+
 static double op_radians(double arg)
 {
   return arg * M_PI / 180.0;
@@ -326,6 +460,33 @@ static double op_degrees(double arg)
   return arg * 180.0 / M_PI;
 }
 
+/* Python rounding: halfway cases are rounded to even. */
+static double op_round(double arg)
+{
+  double result = round(arg);
+
+  if (fabs(arg - result) == 0.5) {
+    result = 2.0 * round(arg / 2.0);
+  }
+
+  return result;
+}
+
+static double op_float(double arg)
+{
+  return arg;
+}
+
+static double op_bool(double arg)
+{
+  return arg ? 1.0 : 0.0;
+}
+
+static double op_log_base(double arg, double base)
+{
+  return log(arg) / log(base);
+}
+
 static double op_not(double a)
 {
   return a ? 0.0 : 1.0;
@@ -367,7 +528,13 @@ typedef struct BuiltinConstDef {
 } BuiltinConstDef;
 
 static BuiltinConstDef builtin_consts[] = {
-    {"pi", M_PI}, {"True", 1.0}, {"False", 0.0}, {NULL, 0.0}};
+    {"pi", M_PI},
+    {"tau", 2.0 * M_PI},
+    {"e", M_E},
+    {"True", 1.0},
+    {"False", 0.0},
+    {NULL, 0.0},
+};
 
 typedef struct BuiltinOpDef {
   const char *name;
@@ -391,6 +558,9 @@ static BuiltinOpDef builtin_ops[] = {
     {"ceil", OPCODE_FUNC1, ceil},
     {"trunc", OPCODE_FUNC1, trunc},
     {"int", OPCODE_FUNC1, trunc},
+    {"round", OPCODE_FUNC1, op_round},
+    {"float", OPCODE_FUNC1, op_float},
+    {"bool", OPCODE_FUNC1, op_bool},
     {"sin", OPCODE_FUNC1, sin},
     {"cos", OPCODE_FUNC1, cos},
     {"tan", OPCODE_FUNC1, tan},
@@ -398,11 +568,25 @@ static BuiltinOpDef builtin_ops[] = {
     {"acos", OPCODE_FUNC1, acos},
     {"atan", OPCODE_FUNC1, atan},
     {"atan2", OPCODE_FUNC2, atan2},
+    {"hypot", OPCODE_FUNC2, hypot},
+    {"sinh", OPCODE_FUNC1, sinh},
+    {"cosh", OPCODE_FUNC1, cosh},
+    {"tanh", OPCODE_FUNC1, tanh},
+    {"asinh", OPCODE_FUNC1, asinh},
+    {"acosh", OPCODE_FUNC1, acosh},
+    {"atanh", OPCODE_FUNC1, atanh},
     {"exp", OPCODE_FUNC1, exp},
+    {"expm1", OPCODE_FUNC1, expm1},
+    /* Variants with different argument count must be next to each other. */
     {"log", OPCODE_FUNC1, log},
+    {"log", OPCODE_FUNC2, op_log_base},
+    {"log10", OPCODE_FUNC1, log10},
+    {"log2", OPCODE_FUNC1, log2},
+    {"log1p", OPCODE_FUNC1, log1p},
     {"sqrt", OPCODE_FUNC1, sqrt},
     {"pow", OPCODE_FUNC2, pow},
     {"fmod", OPCODE_FUNC2, fmod},
+    {"copysign", OPCODE_FUNC2, copysign},
     {NULL, OPCODE_CONST, NULL},
 };
 
@@ -433,6 +617,8 @@ static BuiltinOpDef builtin_ops[] = {
 #define TOKEN_NOT MAKE_CHAR2('N', 'O')
 #define TOKEN_IF MAKE_CHAR2('I', 'F')
 #define TOKEN_ELSE MAKE_CHAR2('E', 'L')
+#define TOKEN_POW MAKE_CHAR2('*', '*')
+#define TOKEN_FLOORDIV MAKE_CHAR2('/', '/')
 
 static const char *token_eq_characters = "!=><";
 static const char *token_characters = "~`!@#$%^&*+-=/\\?:;<>(){}[]|.,\"'";
@@ -632,6 +818,13 @@ static bool parse_next_token(ExprParseState *state)
     return (end == out);
   }
 
+  /* ** and // tokens */
+  if (state->cur[0] == state->cur[1] && ELEM(state->cur[0], '*', '/')) {
+    state->token = MAKE_CHAR2(state->cur[0], state->cur[1]);
+    state->cur += 2;
+    return true;
+  }
+
   /* ?= tokens */
   if (state->cur[1] == '=' && strchr(token_eq_characters, state->cur[0])) {
     state->token = MAKE_CHAR2(state->cur[0], state->cur[1]);
@@ -711,19 +904,11 @@ static int parse_function_args(ExprParseState *state)
   }
 }
 
-static bool parse_unary(ExprParseState *state)
+static bool parse_primary(ExprParseState *state)
 {
   int i;
 
   switch (state->token) {
-    case '+':
-      return parse_next_token(state) && parse_unary(state);
-
-    case '-':
-      CHECK_ERROR(parse_next_token(state) && parse_unary(state));
-      parse_add_func(state, OPCODE_FUNC1, 1, op_negate);
-      return true;
-
     case '(':
       return parse_next_token(state) && parse_expr(state) && state->token == ')' &&
              parse_next_token(state);
@@ -755,6 +940,12 @@ static bool parse_unary(ExprParseState *state)
         if (STREQ(state->tokenbuf, builtin_ops[i].name)) {
           int args = parse_function_args(state);
 
+          /* Pick the variant for the argument count. */
+          while (args != (builtin_ops[i].op == OPCODE_FUNC1 ? 1 : 2) &&
+                 builtin_ops[i + 1].name && STREQ(builtin_ops[i + 1].name, builtin_ops[i].name)) {
+            i++;
+          }
+
           return parse_add_func(state, builtin_ops[i].op, args, builtin_ops[i].funcptr);
         }
       }
@@ -783,6 +974,37 @@ static bool parse_unary(ExprParseState *state)
   }
 }
 
+static bool parse_unary(ExprParseState *state);
+
+static bool parse_power(ExprParseState *state)
+{
+  CHECK_ERROR(parse_primary(state));
+
+  /* Right associative, and binds tighter than unary operators on the left. */
+  if (state->token == TOKEN_POW) {
+    CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+    parse_add_func(state, OPCODE_FUNC2, 2, pow);
+  }
+
+  return true;
+}
+
+static bool parse_unary(ExprParseState *state)
+{
+  switch (state->token) {
+    case '+':
+      return parse_next_token(state) && parse_unary(state);
+
+    case '-':
+      CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+      parse_add_func(state, OPCODE_FUNC1, 1, op_negate);
+      return true;
+
+    default:
+      return parse_power(state);
+  }
+}
+
 static bool parse_mul(ExprParseState *state)
 {
   CHECK_ERROR(parse_unary(state));
@@ -799,6 +1021,16 @@ static bool parse_mul(ExprParseState *state)
         parse_add_func(state, OPCODE_FUNC2, 2, op_div);
         break;
 
+      case TOKEN_FLOORDIV:
+        CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+        parse_add_func(state, OPCODE_FUNC2, 2, op_floordiv);
+        break;
+
+      case '%':
+        CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+        parse_add_func(state, OPCODE_FUNC2, 2, op_mod);
+        break;
+
       default:
         return true;
     }
@@ -977,6 +1209,301 @@ static bool parse_expr(ExprParseState *state)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Register Allocation
+ *
+ * Every slot of the evaluation stack gets its own temporary register. Constants and parameters
+ * pushed on the stack are not copied, the operations consuming them read their registers
+ * directly. Values of all slots are copied to the temporary registers before jumps and at jump
+ * targets, so that the location of values doesn't depend on the path taken.
+ * \{ */
+
+typedef struct InlineOpDef {
+  void *funcptr;
+  eRegOpCode op;
+} InlineOpDef;
+
+static InlineOpDef inline_ops[] = {
+    {op_negate, REGOP_NEGATE},
+    {op_add, REGOP_ADD},
+    {op_sub, REGOP_SUB},
+    {op_mul, REGOP_MUL},
+    {op_div, REGOP_DIV},
+    {op_not, REGOP_NOT},
+    {op_eq, REGOP_EQ},
+    {op_ne, REGOP_NE},
+    {op_lt, REGOP_LT},
+    {op_le, REGOP_LE},
+    {op_gt, REGOP_GT},
+    {op_ge, REGOP_GE},
+    {NULL, REGOP_MOVE},
+};
+
+typedef struct ExprRegState {
+  /* Register operations, with jump offsets temporarily set to the target stack operation. */
+  ExprRegOp *ops;
+  int ops_count;
+
+  /* Register holding the value of each evaluation stack slot. */
+  int *slots;
+  int sp;
+
+  /* First temporary register. */
+  int temps_start;
+} ExprRegState;
+
+static ExprRegOp *reg_add_op(ExprRegState *state, eRegOpCode code, int dst, int a, int b)
+{
+  ExprRegOp *op = &state->ops[state->ops_count++];
+  memset(op, 0, sizeof(ExprRegOp));
+  op->opcode = code;
+  op->dst = dst;
+  op->a = a;
+  op->b = b;
+  return op;
+}
+
+/* Move values of the stack slots into their temporary registers. */
+static void reg_store_slots(ExprRegState *state, int count)
+{
+  for (int i = 0; i < count; i++) {
+    if (state->slots[i] != state->temps_start + i) {
+      reg_add_op(state, REGOP_MOVE, state->temps_start + i, state->slots[i], -1);
+      state->slots[i] = state->temps_start + i;
+    }
+  }
+}
+
+static eRegOpCode reg_func_opcode(void *funcptr, eRegOpCode fallback)
+{
+  for (int i = 0; inline_ops[i].funcptr; i++) {
+    if (inline_ops[i].funcptr == funcptr) {
+      return inline_ops[i].op;
+    }
+  }
+
+  return fallback;
+}
+
+/* Compile the stack machine code into the register machine program, NULL on failure. */
+static ExprPyLike_Parsed *reg_compile(const ExprParseState *pstate)
+{
+  const ExprOp *ops = pstate->ops;
+  const int ops_count = pstate->ops_count;
+
+  ExprPyLike_Parsed *expr = NULL;
+  ExprRegState state;
+  memset(&state, 0, sizeof(state));
+
+  double *consts = MEM_mallocN(sizeof(double) * ops_count, __func__);
+  int *op_regs = MEM_mallocN(sizeof(int) * ops_count, __func__);
+  int *new_pc = MEM_mallocN(sizeof(int) * (ops_count + 1), __func__);
+  bool *is_target = MEM_callocN(sizeof(bool) * (ops_count + 1), __func__);
+
+  /* Gather constants without duplicates and the parameters used, and find jump targets. */
+  int consts_len = 0, params_len = 0;
+
+  for (int pc = 0; pc < ops_count; pc++) {
+    switch (ops[pc].opcode) {
+      case OPCODE_CONST: {
+        const double value = ops[pc].arg.dval;
+        int i = 0;
+        while (i < consts_len && memcmp(&consts[i], &value, sizeof(double)) != 0) {
+          i++;
+        }
+        if (i == consts_len) {
+          consts[consts_len++] = value;
+        }
+        op_regs[pc] = i;
+        break;
+      }
+      case OPCODE_PARAMETER:
+        CLAMP_MIN(params_len, ops[pc].arg.ival + 1);
+        break;
+      case OPCODE_JMP:
+      case OPCODE_JMP_ELSE:
+      case OPCODE_JMP_OR:
+      case OPCODE_JMP_AND:
+      case OPCODE_CMP_CHAIN: {
+        const int target = pc + 1 + ops[pc].jmp_offset;
+        if (target <= pc || target > ops_count) {
+          goto finally;
+        }
+        is_target[target] = true;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  state.temps_start = consts_len + params_len;
+
+  const int registers_len = state.temps_start + pstate->max_stack;
+  if (registers_len > MAX_REGISTERS) {
+    goto finally;
+  }
+
+  /* Each stack operation and the end result in at most one move per stack slot, and one
+   * operation per stack slot for min and max. */
+  state.ops = MEM_mallocN(sizeof(ExprRegOp) * (ops_count + 1) * (pstate->max_stack * 2 + 1),
+                          __func__);
+  state.slots = MEM_mallocN(sizeof(int) * pstate->max_stack, __func__);
+
+#define FAIL_IF(condition) \
+  if (condition) { \
+    goto finally; \
+  } \
+  ((void)0)
+
+  for (int pc = 0;; pc++) {
+    if (is_target[pc]) {
+      reg_store_slots(&state, state.sp);
+    }
+
+    new_pc[pc] = state.ops_count;
+
+    if (pc == ops_count) {
+      break;
+    }
+
+    const ExprOp *op = &ops[pc];
+    const int sp = state.sp;
+    int *slots = state.slots;
+    ExprRegOp *reg_op;
+
+    switch (op->opcode) {
+      case OPCODE_CONST:
+        FAIL_IF(sp >= pstate->max_stack);
+        slots[state.sp++] = op_regs[pc];
+        break;
+      case OPCODE_PARAMETER:
+        FAIL_IF(sp >= pstate->max_stack);
+        slots[state.sp++] = consts_len + op->arg.ival;
+        break;
+      case OPCODE_FUNC1:
+        FAIL_IF(sp < 1);
+        reg_op = reg_add_op(&state,
+                            reg_func_opcode(op->arg.ptr, REGOP_FUNC1),
+                            state.temps_start + sp - 1,
+                            slots[sp - 1],
+                            -1);
+        reg_op->func.ptr = op->arg.ptr;
+        slots[sp - 1] = reg_op->dst;
+        break;
+      case OPCODE_FUNC2:
+        FAIL_IF(sp < 2);
+        reg_op = reg_add_op(&state,
+                            reg_func_opcode(op->arg.ptr, REGOP_FUNC2),
+                            state.temps_start + sp - 2,
+                            slots[sp - 2],
+                            slots[sp - 1]);
+        reg_op->func.ptr = op->arg.ptr;
+        slots[sp - 2] = reg_op->dst;
+        state.sp--;
+        break;
+      case OPCODE_MIN:
+      case OPCODE_MAX: {
+        FAIL_IF(op->arg.ival < 1 || sp < op->arg.ival);
+        /* Reduce from the last argument, in the same order as the stack machine. */
+        const int base = sp - op->arg.ival;
+        for (int i = sp - 2; i >= base; i--) {
+          reg_add_op(&state,
+                     (op->opcode == OPCODE_MIN) ? REGOP_MIN : REGOP_MAX,
+                     state.temps_start + i,
+                     slots[i],
+                     slots[i + 1]);
+          slots[i] = state.temps_start + i;
+        }
+        state.sp = base + 1;
+        break;
+      }
+
+      /* Jumps */
+      case OPCODE_JMP:
+        FAIL_IF(sp < 1);
+        reg_store_slots(&state, sp);
+        reg_add_op(&state, REGOP_JMP, -1, -1, -1)->jmp_offset = pc + 1 + op->jmp_offset;
+        /* The value is on the stack after the jump target instead. */
+        state.sp--;
+        break;
+      case OPCODE_JMP_ELSE:
+        FAIL_IF(sp < 1);
+        reg_store_slots(&state, sp - 1);
+        reg_op = reg_add_op(&state, REGOP_JMP_ELSE, -1, slots[sp - 1], -1);
+        reg_op->jmp_offset = pc + 1 + op->jmp_offset;
+        state.sp--;
+        break;
+      case OPCODE_JMP_OR:
+      case OPCODE_JMP_AND:
+        FAIL_IF(sp < 1);
+        reg_store_slots(&state, sp - 1);
+        reg_op = reg_add_op(&state,
+                            (op->opcode == OPCODE_JMP_OR) ? REGOP_JMP_OR : REGOP_JMP_AND,
+                            state.temps_start + sp - 1,
+                            slots[sp - 1],
+                            -1);
+        reg_op->jmp_offset = pc + 1 + op->jmp_offset;
+        state.sp--;
+        break;
+      case OPCODE_CMP_CHAIN:
+        FAIL_IF(sp < 2);
+        reg_store_slots(&state, sp - 2);
+        reg_op = reg_add_op(
+            &state, REGOP_CMP_CHAIN, state.temps_start + sp - 2, slots[sp - 2], slots[sp - 1]);
+        reg_op->func.ptr = op->arg.ptr;
+        reg_op->jmp_offset = pc + 1 + op->jmp_offset;
+        slots[sp - 2] = reg_op->dst;
+        state.sp--;
+        break;
+
+      default:
+        goto finally;
+    }
+  }
+
+  FAIL_IF(state.sp != 1);
+
+#undef FAIL_IF
+
+  /* Resolve jump targets. */
+  for (int i = 0; i < state.ops_count; i++) {
+    if (ELEM(state.ops[i].opcode,
+             REGOP_JMP,
+             REGOP_JMP_ELSE,
+             REGOP_JMP_OR,
+             REGOP_JMP_AND,
+             REGOP_CMP_CHAIN)) {
+      state.ops[i].jmp_offset = new_pc[state.ops[i].jmp_offset] - (i + 1);
+    }
+  }
+
+  int bytesize = sizeof(ExprPyLike_Parsed) + state.ops_count * sizeof(ExprRegOp) +
+                 consts_len * sizeof(double);
+
+  expr = MEM_mallocN(bytesize, "ExprPyLike_Parsed");
+  expr->ops_count = state.ops_count;
+  expr->registers_len = registers_len;
+  expr->consts_len = consts_len;
+  expr->params_len = params_len;
+  expr->result = state.slots[0];
+  expr->consts = (double *)&expr->ops[state.ops_count];
+
+  memcpy(expr->ops, state.ops, state.ops_count * sizeof(ExprRegOp));
+  memcpy(expr->consts, consts, consts_len * sizeof(double));
+
+finally:
+  MEM_SAFE_FREE(state.ops);
+  MEM_SAFE_FREE(state.slots);
+  MEM_freeN(consts);
+  MEM_freeN(op_regs);
+  MEM_freeN(new_pc);
+  MEM_freeN(is_target);
+  return expr;
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Main Parsing Function
  * \{ */
@@ -1006,20 +1533,15 @@ ExprPyLike_Parsed *BLI_expr_pylike_parse(const char *expression,
   state.ops = MEM_mallocN(state.max_ops * sizeof(ExprOp), __func__);
 
   /* Parse the expression. */
-  ExprPyLike_Parsed *expr;
+  ExprPyLike_Parsed *expr = NULL;
 
   if (parse_next_token(&state) && parse_expr(&state) && state.token == 0) {
     BLI_assert(state.stack_ptr == 1);
 
-    int bytesize = sizeof(ExprPyLike_Parsed) + state.ops_count * sizeof(ExprOp);
-
-    expr = MEM_mallocN(bytesize, "ExprPyLike_Parsed");
-    expr->ops_count = state.ops_count;
-    expr->max_stack = state.max_stack;
-
-    memcpy(expr->ops, state.ops, state.ops_count * sizeof(ExprOp));
+    expr = reg_compile(&state);
   }
-  else {
+
+  if (expr == NULL) {
     /* Always return a non-NULL object so that parse failure can be cached. */
     expr = MEM_callocN(sizeof(ExprPyLike_Parsed), "ExprPyLike_Parsed(empty)");
   }
@@ -45,11 +45,13 @@
  */
 #define MEMPOOL_SIZE 256
 
-/* Number of tasks which are pushed directly to local thread queue.
+/* Number of tasks which fit into per-thread work-stealing deque.
  *
- * This allows thread to fetch next task without locking the whole queue.
+ * When the deque of a thread is full tasks are pushed to the scheduler's global queue instead.
+ * Must be a power of two.
  */
-#define LOCAL_QUEUE_SIZE 1
+#define DEQUE_SIZE 2048
+#define DEQUE_MASK (DEQUE_SIZE - 1)
 
 /* Number of tasks which are allowed to be scheduled in a delayed manner.
  *
@@ -138,12 +140,6 @@ typedef struct TaskThreadLocalStorage {
    */
   TaskMemPool task_mempool;
 
-  /* Local queue keeps thread alive by keeping small amount of tasks ready
-   * to be picked up without causing global thread locks for synchronization.
-   */
-  int num_local_queue;
-  Task *local_queue[LOCAL_QUEUE_SIZE];
-
   /* Thread can be marked for delayed tasks push. This is helpful when it's
    * know that lots of subsequent task pushed will happen from the same thread
    * without "interrupting" for task execution.
@@ -151,16 +147,52 @@ typedef struct TaskThreadLocalStorage {
    * We try to accumulate as much tasks as possible in a local queue without
    * any locks first, and then we push all of them into a scheduler's queue
    * from within a single mutex lock.
+   *
+   * Only used by threads which do not have own deque (see TaskDeque), all the
+   * other threads are pushing tasks without locks anyway.
    */
   bool do_delayed_push;
   int num_delayed_queue;
   Task *delayed_queue[DELAYED_QUEUE_SIZE];
 } TaskThreadLocalStorage;
 
+/* Chase-Lev work-stealing deque.
+ *
+ * Every scheduler thread (including the main thread) owns one deque. The owner pushes and pops
+ * tasks at the bottom end without any locks, so freshly pushed (and likely cache-hot) tasks are
+ * executed first. Other threads steal the oldest tasks from the top end, using a single CAS.
+ *
+ * Only the owner thread modifies `bottom`, `top` is only ever advanced by a CAS.
+ * All modifications go through atomic operations, which are full memory barriers.
+ */
+typedef struct TaskDeque {
+  int64_t top;
+  /* Keep the ends on separate cache lines, thieves only touch `bottom` for reading. */
+  char _pad[64 - sizeof(int64_t)];
+  int64_t bottom;
+
+  Task *volatile tasks[DEQUE_SIZE];
+  /* Pool of every task, allows to check whether stealing a task makes sense without
+   * de-referencing the task pointer which might already be freed by the time it is read. */
+  TaskPool *volatile pools[DEQUE_SIZE];
+} TaskDeque;
+
 struct TaskPool {
   TaskScheduler *scheduler;
 
+  /* Number of tasks which are not finished yet.
+   *
+   * Only drops to zero while num_mutex is held, which allows waiters to safely assume nobody
+   * accesses the pool anymore once they've seen zero from within the same lock.
+   */
   volatile size_t num;
+  /* Number of tasks which are pushed to one of scheduler queues but not picked up yet. */
+  volatile size_t num_queued;
+  /* Number of threads waiting for the pool in work_and_wait() or cancel(). */
+  volatile int num_waiters;
+  /* Incremented every time waiters are notified, so they don't miss notifications
+   * which happened while they were looking for tasks. */
+  volatile int notify_epoch;
   ThreadMutex num_mutex;
   ThreadCondition num_cond;
 
@@ -207,10 +239,17 @@ struct TaskScheduler {
   int num_threads;
   bool background_thread_only;
 
+  /* Global queue, used by threads which are not managed by the scheduler, when deque of a
+   * thread overflows, and for all tasks in the background thread only mode. */
   ListBase queue;
   ThreadMutex queue_mutex;
   ThreadCondition queue_cond;
 
+  /* Number of tasks in the global queue and all deques which are not picked up yet. */
+  volatile int num_queued;
+  /* Number of worker threads sleeping on queue_cond. */
+  volatile int num_sleeping;
+
   ThreadMutex startup_mutex;
   ThreadCondition startup_cond;
   volatile int num_thread_started;
@@ -224,7 +263,10 @@ struct TaskScheduler {
 typedef struct TaskThread {
   TaskScheduler *scheduler;
   int id;
+  /* State of the pseudo-random generator used to pick a victim for stealing. */
+  uint steal_seed;
   TaskThreadLocalStorage tls;
+  TaskDeque deque;
 } TaskThread;
 
 /* Helper */
@@ -326,17 +368,138 @@ static void task_free(TaskPool *pool, Task *task, const int thread_id)
   }
 }
 
+/* Work-stealing deque */
+
+static void task_deque_init(TaskDeque *deque)
+{
+  deque->top = 0;
+  deque->bottom = 0;
+}
+
+BLI_INLINE bool task_deque_is_empty(TaskDeque *deque)
+{
+  return *(volatile int64_t *)&deque->bottom <= *(volatile int64_t *)&deque->top;
+}
+
+/* Push task to the bottom of the deque, must only be called by the owner thread.
+ * Returns false if the deque is full. */
+static bool task_deque_push(TaskDeque *deque, Task *task)
+{
+  const int64_t bottom = deque->bottom;
+  const int64_t top = *(volatile int64_t *)&deque->top;
+  if (bottom - top >= DEQUE_SIZE) {
+    return false;
+  }
+  deque->tasks[bottom & DEQUE_MASK] = task;
+  deque->pools[bottom & DEQUE_MASK] = task->pool;
+  /* Publish the task to the thieves. */
+  atomic_add_and_fetch_int64(&deque->bottom, 1);
+  return true;
+}
+
+/* Pop the most recently pushed task from the bottom of the deque, must only be called by the
+ * owner thread. */
+static Task *task_deque_pop(TaskDeque *deque)
+{
+  /* The owner is the only one who adds tasks, so an empty deque can not become non-empty
+   * behind our back. */
+  if (task_deque_is_empty(deque)) {
+    return NULL;
+  }
+  const int64_t bottom = atomic_sub_and_fetch_int64(&deque->bottom, 1);
+  const int64_t top = *(volatile int64_t *)&deque->top;
+  Task *task = NULL;
+  if (top <= bottom) {
+    task = deque->tasks[bottom & DEQUE_MASK];
+    if (top == bottom) {
+      /* Last task in the deque, race against thieves for it. */
+      if (atomic_cas_int64(&deque->top, top, top + 1) != top) {
+        task = NULL;
+      }
+      atomic_add_and_fetch_int64(&deque->bottom, 1);
+    }
+  }
+  else {
+    /* Thieves took the last task. */
+    atomic_add_and_fetch_int64(&deque->bottom, 1);
+  }
+  return task;
+}
+
+/* Steal the oldest task from the top of the deque, can be called from any thread.
+ * If the pool is given, only a task from this pool will be stolen. */
+static Task *task_deque_steal(TaskDeque *deque, TaskPool *pool)
+{
+  if (task_deque_is_empty(deque)) {
+    return NULL;
+  }
+  const int64_t top = atomic_fetch_and_add_int64(&deque->top, 0);
+  const int64_t bottom = atomic_fetch_and_add_int64(&deque->bottom, 0);
+  if (top >= bottom) {
+    return NULL;
+  }
+  if (pool != NULL && deque->pools[top & DEQUE_MASK] != pool) {
+    return NULL;
+  }
+  Task *task = deque->tasks[top & DEQUE_MASK];
+  /* The slot can only be re-used by the owner after top has been advanced, so a successful CAS
+   * guarantees the task we've read is the one we've claimed. */
+  if (atomic_cas_int64(&deque->top, top, top + 1) != top) {
+    return NULL;
+  }
+  return task;
+}
+
 /* Task Scheduler */
 
+/* Get scheduler thread which is executing the calling code, or NULL if the calling thread is not
+ * managed by the scheduler (in which case it has no deque and uses global queue instead). */
+BLI_INLINE TaskThread *task_scheduler_current_thread(TaskScheduler *scheduler)
+{
+  if (BLI_thread_is_main()) {
+    return &scheduler->task_threads[0];
+  }
+  if (scheduler->background_thread_only) {
+    /* Single worker only handles background pools and never steals, all its tasks are going via
+     * the global queue. */
+    return NULL;
+  }
+  return pthread_getspecific(scheduler->tls_id_key);
+}
+
+/* Wake up threads which are waiting for the pool, so they can help executing its new tasks,
+ * or notice that all the tasks are done.
+ *
+ * The caller must guarantee the pool can not be finished while this function is running. */
+static void task_pool_notify_waiters(TaskPool *pool)
+{
+  if (atomic_fetch_and_add_int32((int32_t *)&pool->num_waiters, 0) == 0) {
+    return;
+  }
+  BLI_mutex_lock(&pool->num_mutex);
+  atomic_add_and_fetch_int32((int32_t *)&pool->notify_epoch, 1);
+  BLI_condition_notify_all(&pool->num_cond);
+  BLI_mutex_unlock(&pool->num_mutex);
+}
+
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
 {
+  /* Fast path: counter does not reach zero, no need in any locks. */
+  size_t num = pool->num;
+  while (num > done) {
+    const size_t prev_num = atomic_cas_z((size_t *)&pool->num, num, num - done);
+    if (prev_num == num) {
+      return;
+    }
+    num = prev_num;
+  }
+
   BLI_mutex_lock(&pool->num_mutex);
 
   BLI_assert(pool->num >= done);
 
-  pool->num -= done;
-
-  if (pool->num == 0) {
+  if (atomic_sub_and_fetch_z((size_t *)&pool->num, done) == 0) {
+    atomic_add_and_fetch_int32((int32_t *)&pool->notify_epoch, 1);
     BLI_condition_notify_all(&pool->num_cond);
   }
 
@@ -345,15 +508,89 @@ static void task_pool_num_decrease(TaskPool *pool, size_t done)
 
 static void task_pool_num_increase(TaskPool *pool, size_t new)
 {
-  BLI_mutex_lock(&pool->num_mutex);
+  atomic_add_and_fetch_z((size_t *)&pool->num, new);
+  atomic_add_and_fetch_z((size_t *)&pool->num_queued, new);
+}
 
-  pool->num += new;
-  BLI_condition_notify_all(&pool->num_cond);
+/* Account for a task which was taken out of a queue for execution. */
+BLI_INLINE void task_scheduler_task_taken(TaskScheduler *scheduler, Task *task)
+{
+  atomic_sub_and_fetch_int32((int32_t *)&scheduler->num_queued, 1);
+  atomic_sub_and_fetch_z((size_t *)&task->pool->num_queued, 1);
+}
 
-  BLI_mutex_unlock(&pool->num_mutex);
+/* Wake up a sleeping worker, if any, after a task was pushed to a deque. */
+static void task_scheduler_wake_worker(TaskScheduler *scheduler)
+{
+  if (atomic_fetch_and_add_int32((int32_t *)&scheduler->num_sleeping, 0) == 0) {
+    return;
+  }
+  BLI_mutex_lock(&scheduler->queue_mutex);
+  BLI_condition_notify_one(&scheduler->queue_cond);
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+}
+
+/* Run the task and free it, tasks of a canceled pool are discarded without running. */
+static void task_run_and_free(Task *task, const int thread_id)
+{
+  TaskPool *pool = task->pool;
+
+  if (!pool->do_cancel) {
+    task->run(pool, task->taskdata, thread_id);
+  }
+
+  /* delete task */
+  task_free(pool, task, thread_id);
+
+  /* notify pool task was done, this must be the last access to the pool */
+  task_pool_num_decrease(pool, 1);
+}
+
+/* Pop a task from the global queue without waiting, optionally only a task from the given pool. */
+static Task *task_scheduler_global_pop(TaskScheduler *scheduler, TaskPool *pool)
+{
+  /* Cheap early output, avoids lock when global queue is not used. */
+  if (*(void *volatile *)&scheduler->queue.first == NULL) {
+    return NULL;
+  }
+
+  Task *task;
+  BLI_mutex_lock(&scheduler->queue_mutex);
+  for (task = scheduler->queue.first; task != NULL; task = task->next) {
+    if (pool == NULL || task->pool == pool) {
+      BLI_remlink(&scheduler->queue, task);
+      break;
+    }
+  }
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+
+  return task;
+}
+
+/* Try to steal a task from deques of other threads, starting from a pseudo-random victim so
+ * that thieves are spread over the deques. */
+static Task *task_scheduler_steal(TaskScheduler *scheduler, TaskThread *thread, TaskPool *pool)
+{
+  const int num_deques = scheduler->num_threads + 1;
+  int victim = 0;
+  if (thread != NULL) {
+    thread->steal_seed = thread->steal_seed * 1103515245u + 12345u;
+    victim = (int)((thread->steal_seed >> 16) % (uint)num_deques);
+  }
+  for (int i = 0; i < num_deques; i++, victim = (victim + 1) % num_deques) {
+    TaskThread *victim_thread = &scheduler->task_threads[victim];
+    if (victim_thread == thread) {
+      continue;
+    }
+    Task *task = task_deque_steal(&victim_thread->deque, pool);
+    if (task != NULL) {
+      return task;
+    }
+  }
+  return NULL;
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+static bool task_scheduler_thread_wait_pop_background(TaskScheduler *scheduler, Task **task)
 {
   bool found_task = false;
   BLI_mutex_lock(&scheduler->queue_mutex);
@@ -401,26 +638,46 @@ static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task
 
   BLI_mutex_unlock(&scheduler->queue_mutex);
 
+  task_scheduler_task_taken(scheduler, *task);
+
   return true;
 }
 
-BLI_INLINE void handle_local_queue(TaskThreadLocalStorage *tls, const int thread_id)
+static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler,
+                                           TaskThread *thread,
+                                           Task **task)
 {
-  BLI_assert(!tls->do_delayed_push);
-  while (tls->num_local_queue > 0) {
-    /* We pop task from queue before handling it so handler of the task can
-     * push next job to the local queue.
-     */
-    tls->num_local_queue--;
-    Task *local_task = tls->local_queue[tls->num_local_queue];
-    /* TODO(sergey): Double-check work_and_wait() doesn't handle other's
-     * pool tasks.
-     */
-    TaskPool *local_pool = local_task->pool;
-    local_task->run(local_pool, local_task->taskdata, thread_id);
-    task_free(local_pool, local_task, thread_id);
+  if (scheduler->background_thread_only) {
+    return task_scheduler_thread_wait_pop_background(scheduler, task);
+  }
+
+  while (!scheduler->do_exit) {
+    /* Own tasks first, then steal from others, global queue is the last resort. */
+    *task = task_deque_pop(&thread->deque);
+    if (*task == NULL) {
+      *task = task_scheduler_steal(scheduler, thread, NULL);
+    }
+    if (*task == NULL) {
+      *task = task_scheduler_global_pop(scheduler, NULL);
+    }
+    if (*task != NULL) {
+      task_scheduler_task_taken(scheduler, *task);
+      return true;
+    }
+
+    /* Nothing to do, sleep until new tasks are pushed.
+     * Pushing side increments num_queued before checking num_sleeping, and we do it the other
+     * way around, so either we see the new task or the pusher sees us sleeping. */
+    BLI_mutex_lock(&scheduler->queue_mutex);
+    atomic_add_and_fetch_int32((int32_t *)&scheduler->num_sleeping, 1);
+    if (scheduler->num_queued <= 0 && !scheduler->do_exit) {
+      BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+    }
+    atomic_sub_and_fetch_int32((int32_t *)&scheduler->num_sleeping, 1);
+    BLI_mutex_unlock(&scheduler->queue_mutex);
   }
-  BLI_assert(!tls->do_delayed_push);
+
+  return false;
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
@@ -442,27 +699,26 @@ static void *task_scheduler_thread_run(void *thread_p)
   BLI_mutex_unlock(&scheduler->startup_mutex);
 
   /* keep popping off tasks */
-  while (task_scheduler_thread_wait_pop(scheduler, &task)) {
-    TaskPool *pool = task->pool;
-
-    /* run task */
+  while (task_scheduler_thread_wait_pop(scheduler, thread, &task)) {
     BLI_assert(!tls->do_delayed_push);
-    task->run(pool, task->taskdata, thread_id);
+    task_run_and_free(task, thread_id);
     BLI_assert(!tls->do_delayed_push);
-
-    /* delete task */
-    task_free(pool, task, thread_id);
-
-    /* Handle all tasks from local queue. */
-    handle_local_queue(tls, thread_id);
-
-    /* notify pool task was done */
-    task_pool_num_decrease(pool, 1);
   }
 
+  UNUSED_VARS_NDEBUG(tls);
+
   return NULL;
 }
 
+static void task_thread_init(TaskScheduler *scheduler, TaskThread *thread, int id)
+{
+  thread->scheduler = scheduler;
+  thread->id = id;
+  thread->steal_seed = (uint)id;
+  initialize_task_tls(&thread->tls);
+  task_deque_init(&thread->deque);
+}
+
 TaskScheduler *BLI_task_scheduler_create(int num_threads)
 {
   TaskScheduler *scheduler = MEM_callocN(sizeof(TaskScheduler), "TaskScheduler");
@@ -496,8 +752,8 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
   scheduler->task_threads = MEM_mallocN(sizeof(TaskThread) * (num_threads + 1),
                                         "TaskScheduler task threads");
 
-  /* Initialize TLS for main thread. */
-  initialize_task_tls(&scheduler->task_threads[0].tls);
+  /* Initialize TLS and deque for main thread. */
+  task_thread_init(scheduler, &scheduler->task_threads[0], 0);
 
   pthread_key_create(&scheduler->tls_id_key, NULL);
 
@@ -510,9 +766,7 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 
     for (i = 0; i < num_threads; i++) {
       TaskThread *thread = &scheduler->task_threads[i + 1];
-      thread->scheduler = scheduler;
-      thread->id = i + 1;
-      initialize_task_tls(&thread->tls);
+      task_thread_init(scheduler, thread, i + 1);
 
       if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
         fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
@@ -562,8 +816,15 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
   /* Delete task thread data */
   if (scheduler->task_threads) {
     for (int i = 0; i < scheduler->num_threads + 1; i++) {
-      TaskThreadLocalStorage *tls = &scheduler->task_threads[i].tls;
-      free_task_tls(tls);
+      TaskThread *thread = &scheduler->task_threads[i];
+
+      /* delete leftover tasks */
+      while ((task = task_deque_steal(&thread->deque, NULL))) {
+        task_data_free(task, 0);
+        MEM_freeN(task);
+      }
+
+      free_task_tls(&thread->tls);
     }
 
     MEM_freeN(scheduler->task_threads);
@@ -589,22 +850,62 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
   return scheduler->num_threads + 1;
 }
 
+/* Add already counted tasks to the global queue. */
+static void task_scheduler_global_push(TaskScheduler *scheduler,
+                                       Task **tasks,
+                                       int num_tasks,
+                                       TaskPriority priority)
+{
+  BLI_mutex_lock(&scheduler->queue_mutex);
+
+  for (int i = 0; i < num_tasks; i++) {
+    if (priority == TASK_PRIORITY_HIGH) {
+      BLI_addhead(&scheduler->queue, tasks[i]);
+    }
+    else {
+      BLI_addtail(&scheduler->queue, tasks[i]);
+    }
+  }
+
+  if (num_tasks == 1) {
+    BLI_condition_notify_one(&scheduler->queue_cond);
+  }
+  else {
+    BLI_condition_notify_all(&scheduler->queue_cond);
+  }
+  BLI_mutex_unlock(&scheduler->queue_mutex);
+}
+
 static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
-  task_pool_num_increase(task->pool, 1);
+  TaskPool *pool = task->pool;
 
-  /* add task to queue */
-  BLI_mutex_lock(&scheduler->queue_mutex);
+  /* Extra reference keeps the pool alive until waiters are notified, otherwise the task could
+   * be executed by another thread and the pool freed before we're done here. */
+  atomic_add_and_fetch_z((size_t *)&pool->num, 1);
+  task_pool_num_increase(pool, 1);
+  atomic_add_and_fetch_int32((int32_t *)&scheduler->num_queued, 1);
 
-  if (priority == TASK_PRIORITY_HIGH) {
-    BLI_addhead(&scheduler->queue, task);
+  /* Push to the deque of the current thread, which is cheapest push ever. There is no priority
+   * within a deque: the owner executes tasks in LIFO order and other threads steal the oldest
+   * ones. */
+  TaskThread *thread = task_scheduler_current_thread(scheduler);
+  if (scheduler->background_thread_only && pool->run_in_background) {
+    /* Must be visible to the background thread, which only looks into the global queue. */
+    thread = NULL;
+  }
+  if (thread != NULL && task_deque_push(&thread->deque, task)) {
+    task_scheduler_wake_worker(scheduler);
   }
   else {
-    BLI_addtail(&scheduler->queue, task);
+    /* Do push to a global execution pool, slowest possible method,
+     * causes quite reasonable amount of threading overhead.
+     */
+    task_scheduler_global_push(scheduler, &task, 1, priority);
   }
 
-  BLI_condition_notify_one(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
+  task_pool_notify_waiters(pool);
+  task_pool_num_decrease(pool, 1);
 }
 
 static void task_scheduler_push_all(TaskScheduler *scheduler,
@@ -616,16 +917,14 @@ static void task_scheduler_push_all(TaskScheduler *scheduler,
     return;
   }
 
+  atomic_add_and_fetch_z((size_t *)&pool->num, 1);
   task_pool_num_increase(pool, num_tasks);
+  atomic_add_and_fetch_int32((int32_t *)&scheduler->num_queued, num_tasks);
 
-  BLI_mutex_lock(&scheduler->queue_mutex);
-
-  for (int i = 0; i < num_tasks; i++) {
-    BLI_addhead(&scheduler->queue, tasks[i]);
-  }
+  task_scheduler_global_push(scheduler, tasks, num_tasks, TASK_PRIORITY_HIGH);
 
-  BLI_condition_notify_all(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
+  task_pool_notify_waiters(pool);
+  task_pool_num_decrease(pool, 1);
 }
 
 static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
@@ -649,10 +948,138 @@ static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
 
   BLI_mutex_unlock(&scheduler->queue_mutex);
 
+  if (done == 0) {
+    return;
+  }
+
+  atomic_sub_and_fetch_int32((int32_t *)&scheduler->num_queued, (int32_t)done);
+  atomic_sub_and_fetch_z((size_t *)&pool->num_queued, done);
+
   /* notify done */
   task_pool_num_decrease(pool, done);
 }
 
+/* Move an already counted task to the global queue, where any worker can pick it up. */
+static void task_scheduler_move_to_global(TaskScheduler *scheduler, Task *task)
+{
+  /* The task is still counted in its pool, but an extra reference is needed because the pool
+   * could be finished as soon as the task is visible in the queue. */
+  TaskPool *task_pool = task->pool;
+  atomic_add_and_fetch_z((size_t *)&task_pool->num, 1);
+  task_scheduler_global_push(scheduler, &task, 1, TASK_PRIORITY_LOW);
+  task_pool_notify_waiters(task_pool);
+  task_pool_num_decrease(task_pool, 1);
+}
+
+/* Move tasks which are not from the given pool from the top of the deques to the global queue.
+ *
+ * Threads waiting for a pool only execute tasks of that pool, but those might be stuck in a deque
+ * underneath tasks of other pools, where they can not be stolen from. Moving the blocking tasks
+ * away makes them reachable, without the waiting thread running any unrelated tasks itself.
+ *
+ * Returns true if any task was moved. If a task of the given pool is found it is returned in
+ * r_task instead, ready to be executed. */
+static bool task_scheduler_unblock_pool_tasks(TaskScheduler *scheduler,
+                                              TaskPool *pool,
+                                              Task **r_task)
+{
+  bool has_moved = false;
+  *r_task = NULL;
+
+  for (int i = 0; i < scheduler->num_threads + 1; i++) {
+    Task *task = task_deque_steal(&scheduler->task_threads[i].deque, NULL);
+    if (task == NULL) {
+      continue;
+    }
+    if (task->pool == pool) {
+      *r_task = task;
+      return true;
+    }
+
+    task_scheduler_move_to_global(scheduler, task);
+    has_moved = true;
+  }
+
+  return has_moved;
+}
+
+/* Find a task of the pool for a waiting thread. */
+static Task *task_pool_find_task(TaskPool *pool, TaskThread *thread)
+{
+  TaskScheduler *scheduler = pool->scheduler;
+  Task *task;
+
+  if (thread != NULL) {
+    while ((task = task_deque_pop(&thread->deque))) {
+      if (task->pool == pool) {
+        return task;
+      }
+      /* Task of another pool was pushed on top of ours, let other threads handle it. */
+      task_scheduler_move_to_global(scheduler, task);
+    }
+  }
+
+  task = task_scheduler_steal(scheduler, thread, pool);
+  if (task == NULL) {
+    task = task_scheduler_global_pop(scheduler, pool);
+  }
+  return task;
+}
+
+/* Execute tasks of the pool from the calling thread until all of them are done.
+ *
+ * Only tasks of this pool are executed here: running an unrelated task while the caller
+ * might be holding a lock could easily lead to a deadlock. This makes waiting safe for
+ * nested pools created from inside of tasks.
+ */
+static void task_pool_work_until_done(TaskPool *pool)
+{
+  TaskScheduler *scheduler = pool->scheduler;
+  TaskThread *thread = task_scheduler_current_thread(scheduler);
+  TaskThreadLocalStorage *tls = get_task_tls(pool, pool->thread_id);
+
+  atomic_add_and_fetch_int32((int32_t *)&pool->num_waiters, 1);
+
+  while (true) {
+    const int notify_epoch = atomic_fetch_and_add_int32((int32_t *)&pool->notify_epoch, 0);
+
+    if (pool->num != 0) {
+      Task *task = task_pool_find_task(pool, thread);
+      if (task == NULL && pool->num_queued != 0) {
+        /* Some tasks are queued, but not reachable. */
+        if (task_scheduler_unblock_pool_tasks(scheduler, pool, &task) && task == NULL) {
+          continue;
+        }
+      }
+      if (task != NULL) {
+        task_scheduler_task_taken(scheduler, task);
+
+        /* run task */
+        BLI_assert(!tls->do_delayed_push);
+        task_run_and_free(task, pool->thread_id);
+        BLI_assert(!tls->do_delayed_push);
+        continue;
+      }
+    }
+
+    /* Nothing to be done by this thread, wait until other threads are done or push new tasks. */
+    BLI_mutex_lock(&pool->num_mutex);
+    const bool is_done = (pool->num == 0);
+    if (!is_done && notify_epoch == pool->notify_epoch) {
+      BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+    }
+    BLI_mutex_unlock(&pool->num_mutex);
+
+    if (is_done) {
+      break;
+    }
+  }
+
+  atomic_sub_and_fetch_int32((int32_t *)&pool->num_waiters, 1);
+
+  UNUSED_VARS_NDEBUG(tls);
+}
+
 /* Task Pool */
 
 static TaskPool *task_pool_create_ex(TaskScheduler *scheduler,
@@ -677,6 +1104,9 @@ static TaskPool *task_pool_create_ex(TaskScheduler *scheduler,
 
   pool->scheduler = scheduler;
   pool->num = 0;
+  pool->num_queued = 0;
+  pool->num_waiters = 0;
+  pool->notify_epoch = 0;
   pool->do_cancel = false;
   pool->do_work = false;
   pool->is_suspended = is_suspended;
@@ -827,31 +1257,20 @@ static void task_pool_push(TaskPool *pool,
     atomic_fetch_and_add_z(&pool->num_suspended, 1);
     return;
   }
-  /* Populate to any local queue first, this is cheapest push ever. */
-  if (task_can_use_local_queues(pool, thread_id)) {
+  /* If we are in the delayed tasks push mode, we push tasks to a
+   * temporary local queue first without any locks, and then move them
+   * to global execution queue with a single lock.
+   */
+  if (task_can_use_local_queues(pool, thread_id) &&
+      task_scheduler_current_thread(pool->scheduler) == NULL) {
     ASSERT_THREAD_ID(pool->scheduler, thread_id);
     TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
-    /* Try to push to a local execution queue.
-     * These tasks will be picked up next.
-     */
-    if (tls->num_local_queue < LOCAL_QUEUE_SIZE) {
-      tls->local_queue[tls->num_local_queue] = task;
-      tls->num_local_queue++;
-      return;
-    }
-    /* If we are in the delayed tasks push mode, we push tasks to a
-     * temporary local queue first without any locks, and then move them
-     * to global execution queue with a single lock.
-     */
     if (tls->do_delayed_push && tls->num_delayed_queue < DELAYED_QUEUE_SIZE) {
       tls->delayed_queue[tls->num_delayed_queue] = task;
       tls->num_delayed_queue++;
       return;
     }
   }
-  /* Do push to a global execution pool, slowest possible method,
-   * causes quite reasonable amount of threading overhead.
-   */
   task_scheduler_push(pool->scheduler, task, priority);
 }
 
@@ -883,83 +1302,21 @@ void BLI_task_pool_push_from_thread(TaskPool *pool,
 
 void BLI_task_pool_work_and_wait(TaskPool *pool)
 {
-  TaskThreadLocalStorage *tls = get_task_tls(pool, pool->thread_id);
-  TaskScheduler *scheduler = pool->scheduler;
-
   if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
-    if (pool->num_suspended) {
-      task_pool_num_increase(pool, pool->num_suspended);
-      BLI_mutex_lock(&scheduler->queue_mutex);
-
-      BLI_movelisttolist(&scheduler->queue, &pool->suspended_queue);
-
-      BLI_condition_notify_all(&scheduler->queue_cond);
-      BLI_mutex_unlock(&scheduler->queue_mutex);
-
-      pool->num_suspended = 0;
+    /* Push all suspended tasks to the deque of this thread, so other threads can start stealing
+     * them while we're busy with the most recently pushed ones. */
+    Task *task;
+    while ((task = BLI_pophead(&pool->suspended_queue))) {
+      task_scheduler_push(pool->scheduler, task, TASK_PRIORITY_HIGH);
     }
+    pool->num_suspended = 0;
   }
 
   pool->do_work = true;
 
   ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
 
-  handle_local_queue(tls, pool->thread_id);
-
-  BLI_mutex_lock(&pool->num_mutex);
-
-  while (pool->num != 0) {
-    Task *task, *work_task = NULL;
-    bool found_task = false;
-
-    BLI_mutex_unlock(&pool->num_mutex);
-
-    BLI_mutex_lock(&scheduler->queue_mutex);
-
-    /* find task from this pool. if we get a task from another pool,
-     * we can get into deadlock */
-
-    for (task = scheduler->queue.first; task; task = task->next) {
-      if (task->pool == pool) {
-        work_task = task;
-        found_task = true;
-        BLI_remlink(&scheduler->queue, task);
-        break;
-      }
-    }
-
-    BLI_mutex_unlock(&scheduler->queue_mutex);
-
-    /* if found task, do it, otherwise wait until other tasks are done */
-    if (found_task) {
-      /* run task */
-      BLI_assert(!tls->do_delayed_push);
-      work_task->run(pool, work_task->taskdata, pool->thread_id);
-      BLI_assert(!tls->do_delayed_push);
-
-      /* delete task */
-      task_free(pool, task, pool->thread_id);
-
-      /* Handle all tasks from local queue. */
-      handle_local_queue(tls, pool->thread_id);
-
-      /* notify pool task was done */
-      task_pool_num_decrease(pool, 1);
-    }
-
-    BLI_mutex_lock(&pool->num_mutex);
-    if (pool->num == 0) {
-      break;
-    }
-
-    if (!found_task) {
-      BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
-    }
-  }
-
-  BLI_mutex_unlock(&pool->num_mutex);
-
-  BLI_assert(tls->num_local_queue == 0);
+  task_pool_work_until_done(pool);
 }
 
 void BLI_task_pool_work_wait_and_reset(TaskPool *pool)
@@ -976,12 +1333,9 @@ void BLI_task_pool_cancel(TaskPool *pool)
 
   task_scheduler_clear(pool->scheduler, pool);
 
-  /* wait until all entries are cleared */
-  BLI_mutex_lock(&pool->num_mutex);
-  while (pool->num) {
-    BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
-  }
-  BLI_mutex_unlock(&pool->num_mutex);
+  /* Wait until all entries are cleared. Tasks which are still in the deques are freed without
+   * being executed once they are popped. */
+  task_pool_work_until_done(pool);
 
   pool->do_cancel = false;
 }
@@ -0,0 +1,314 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_memarena.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BLI_trace.h" /* own include */
+
+#include "PIL_time.h"
+
+#include "atomic_ops.h"
+
+#define TRACE_IDS_MAX 3
+#define TRACE_NAME_PARTS_MAX 4
+#define TRACE_CHUNK_SIZE 1024
+
+/* Names are only formatted when writing, recording a span only stores pointers and numbers. */
+typedef struct TraceSpan {
+  const char *category;
+  /* Static string, or a copy in the names arena of the thread. */
+  const char *name;
+  double start_time;
+  double end_time;
+  int ids[TRACE_IDS_MAX];
+  int ids_num;
+} TraceSpan;
+
+typedef struct TraceChunk {
+  struct TraceChunk *next;
+  int num_spans;
+  TraceSpan spans[TRACE_CHUNK_SIZE];
+} TraceChunk;
+
+/* Spans recorded by a single thread, only ever modified by that thread. */
+typedef struct TraceThread {
+  struct TraceThread *next;
+  unsigned int index;
+  bool is_main;
+  TraceChunk *first_chunk;
+  TraceChunk *last_chunk;
+  /* Copies of names which are not static, created on first use. */
+  MemArena *names_arena;
+} TraceThread;
+
+bool BLI_trace_recording_flag = false;
+
+static struct {
+  /* Threads are added by atomically prepending to this list. */
+  TraceThread *threads;
+  unsigned int num_threads;
+  /* Increased for every recording, so threads notice their local buffer is from an earlier one
+   * without accessing it. */
+  int session;
+  double start_time;
+} trace = {NULL};
+
+static ThreadLocal(void *) trace_tls_thread;
+static ThreadLocal(void *) trace_tls_session;
+
+static TraceThread *trace_thread_ensure(void)
+{
+  TraceThread *thread = BLI_thread_local_get(trace_tls_thread);
+  if (thread != NULL && POINTER_AS_INT(BLI_thread_local_get(trace_tls_session)) == trace.session) {
+    return thread;
+  }
+
+  thread = MEM_callocN(sizeof(TraceThread), __func__);
+  thread->index = atomic_fetch_and_add_uint32(&trace.num_threads, 1);
+  thread->is_main = BLI_thread_is_main();
+  TraceThread *head;
+  do {
+    head = trace.threads;
+    thread->next = head;
+  } while (atomic_cas_ptr((void **)&trace.threads, head, thread) != head);
+
+  BLI_thread_local_set(trace_tls_thread, thread);
+  BLI_thread_local_set(trace_tls_session, POINTER_FROM_INT(trace.session));
+  return thread;
+}
+
+static TraceSpan *trace_span_new(TraceThread *thread)
+{
+  TraceChunk *chunk = thread->last_chunk;
+  if (chunk == NULL || chunk->num_spans == TRACE_CHUNK_SIZE) {
+    chunk = MEM_mallocN(sizeof(TraceChunk), __func__);
+    chunk->next = NULL;
+    chunk->num_spans = 0;
+    if (thread->last_chunk) {
+      thread->last_chunk->next = chunk;
+    }
+    else {
+      thread->first_chunk = chunk;
+    }
+    thread->last_chunk = chunk;
+  }
+  return &chunk->spans[chunk->num_spans++];
+}
+
+void BLI_trace_span_add(const char *category,
+                        const char *name,
+                        double start_time,
+                        double end_time)
+{
+  BLI_trace_span_add_ids(category, name, NULL, 0, start_time, end_time);
+}
+
+void BLI_trace_span_add_ids(const char *category,
+                            const char *name,
+                            const int *ids,
+                            int ids_num,
+                            double start_time,
+                            double end_time)
+{
+  if (!BLI_trace_recording_flag) {
+    return;
+  }
+  BLI_assert(ids_num <= TRACE_IDS_MAX);
+
+  TraceSpan *span = trace_span_new(trace_thread_ensure());
+  span->category = category;
+  span->name = name;
+  span->start_time = start_time;
+  span->end_time = end_time;
+  span->ids_num = MIN2(ids_num, TRACE_IDS_MAX);
+  for (int i = 0; i < span->ids_num; i++) {
+    span->ids[i] = ids[i];
+  }
+}
+
+void BLI_trace_span_add_parts(const char *category,
+                              const char **name_parts,
+                              int name_parts_num,
+                              double start_time,
+                              double end_time)
+{
+  if (!BLI_trace_recording_flag) {
+    return;
+  }
+
+  BLI_assert(name_parts_num <= TRACE_NAME_PARTS_MAX);
+  name_parts_num = MIN2(name_parts_num, TRACE_NAME_PARTS_MAX);
+
+  /* Measure every part only once, this runs for every depsgraph operation. */
+  size_t part_lens[TRACE_NAME_PARTS_MAX];
+  size_t name_len = 0;
+  for (int i = 0; i < name_parts_num; i++) {
+    part_lens[i] = strlen(name_parts[i]);
+    name_len += part_lens[i] + 1;
+  }
+
+  TraceThread *thread = trace_thread_ensure();
+  if (thread->names_arena == NULL) {
+    thread->names_arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
+  }
+  char *name = BLI_memarena_alloc(thread->names_arena, MAX2(name_len, 1));
+
+  size_t len = 0;
+  for (int i = 0; i < name_parts_num; i++) {
+    if (part_lens[i] == 0) {
+      continue;
+    }
+    if (len != 0) {
+      name[len++] = ' ';
+    }
+    memcpy(name + len, name_parts[i], part_lens[i]);
+    len += part_lens[i];
+  }
+  name[len] = '\0';
+
+  TraceSpan *span = trace_span_new(thread);
+  span->category = category;
+  span->name = name;
+  span->start_time = start_time;
+  span->end_time = end_time;
+  span->ids_num = 0;
+}
+
+void BLI_trace_begin(void)
+{
+  static bool tls_created = false;
+  if (!tls_created) {
+    BLI_thread_local_create(trace_tls_thread);
+    BLI_thread_local_create(trace_tls_session);
+    tls_created = true;
+  }
+
+  BLI_trace_free();
+  trace.start_time = PIL_check_seconds_timer();
+  BLI_trace_recording_flag = true;
+}
+
+void BLI_trace_end(void)
+{
+  BLI_trace_recording_flag = false;
+}
+
+void BLI_trace_free(void)
+{
+  TraceThread *thread = trace.threads;
+  while (thread) {
+    TraceThread *thread_next = thread->next;
+    TraceChunk *chunk = thread->first_chunk;
+    while (chunk) {
+      TraceChunk *chunk_next = chunk->next;
+      MEM_freeN(chunk);
+      chunk = chunk_next;
+    }
+    if (thread->names_arena) {
+      BLI_memarena_free(thread->names_arena);
+    }
+    MEM_freeN(thread);
+    thread = thread_next;
+  }
+  trace.threads = NULL;
+  trace.num_threads = 0;
+  trace.session++;
+}
+
+static void trace_write_name(FILE *f, const TraceSpan *span)
+{
+  fputc('"', f);
+  int id_index = 0;
+  for (const char *str = span->name; *str; str++) {
+    if (str[0] == '%' && str[1] == 'd' && id_index < span->ids_num) {
+      fprintf(f, "%d", span->ids[id_index++]);
+      str++;
+    }
+    else if (*str == '"' || *str == '\\') {
+      fputc('\\', f);
+      fputc(*str, f);
+    }
+    else if ((unsigned char)*str < ' ') {
+      fputc(' ', f);
+    }
+    else {
+      fputc(*str, f);
+    }
+  }
+  fputc('"', f);
+}
+
+bool BLI_trace_write(const char *filepath)
+{
+  FILE *f = BLI_fopen(filepath, "w");
+  if (f == NULL) {
+    return false;
+  }
+
+  /* Times are written in microseconds, since the start of the recording. */
+  fputs("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [", f);
+  bool is_first = true;
+  for (TraceThread *thread = trace.threads; thread; thread = thread->next) {
+    char thread_name[32];
+    if (thread->is_main) {
+      BLI_strncpy(thread_name, "Main Thread", sizeof(thread_name));
+    }
+    else {
+      BLI_snprintf(thread_name, sizeof(thread_name), "Thread %u", thread->index);
+    }
+    fprintf(f,
+            "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, "
+            "\"args\": {\"name\": \"%s\"}}",
+            is_first ? "" : ",",
+            thread->index,
+            thread_name);
+    is_first = false;
+
+    for (TraceChunk *chunk = thread->first_chunk; chunk; chunk = chunk->next) {
+      for (int i = 0; i < chunk->num_spans; i++) {
+        const TraceSpan *span = &chunk->spans[i];
+        fputs(",\n{\"name\": ", f);
+        trace_write_name(f, span);
+        fprintf(f,
+                ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, "
+                "\"tid\": %u}",
+                span->category,
+                (span->start_time - trace.start_time) * 1e6,
+                (span->end_time - span->start_time) * 1e6,
+                thread->index);
+      }
+    }
+  }
+  fputs("\n]}\n", f);
+
+  return (fclose(f) == 0);
+}
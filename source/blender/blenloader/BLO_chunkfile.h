@@ -0,0 +1,70 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __BLO_CHUNKFILE_H__
+#define __BLO_CHUNKFILE_H__
+
+/** \file
+ * \ingroup blenloader
+ *
+ * Chunked, seekable compression for .blend files.
+ *
+ * The uncompressed stream is split into chunks which are deflated independently
+ * (in parallel when writing), followed by a table of chunks and a footer.
+ * This allows the reader to only decompress the chunks it needs
+ * and the writer to copy chunks which didn't change from a previous version of the file.
+ */
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ChunkFileWriter ChunkFileWriter;
+typedef struct ChunkFileReader ChunkFileReader;
+
+typedef struct ChunkFileWriteStats {
+  /** Size of the uncompressed stream. */
+  uint64_t raw_size;
+  /** Size of the file on disk. */
+  uint64_t file_size;
+  uint num_chunks;
+  /** Chunks copied from the reference file without compressing them again. */
+  uint num_chunks_reused;
+} ChunkFileWriteStats;
+
+/** Length of the header needed by #BLO_chunkfile_header_check. */
+#define BLO_CHUNKFILE_MAGIC_LEN 8
+
+bool BLO_chunkfile_header_check(const void *header, size_t header_len);
+
+ChunkFileWriter *BLO_chunkfile_writer_open(const char *filepath, const char *reference_filepath);
+bool BLO_chunkfile_writer_write(ChunkFileWriter *writer, const void *data, size_t data_len);
+void BLO_chunkfile_writer_segment_end(ChunkFileWriter *writer);
+bool BLO_chunkfile_writer_close(ChunkFileWriter *writer, ChunkFileWriteStats *r_stats);
+
+ChunkFileReader *BLO_chunkfile_reader_open(int file);
+int64_t BLO_chunkfile_reader_read(ChunkFileReader *reader, void *buffer, size_t buffer_len);
+int64_t BLO_chunkfile_reader_seek(ChunkFileReader *reader, int64_t offset, int whence);
+uint BLO_chunkfile_reader_chunks_decoded(const ChunkFileReader *reader);
+void BLO_chunkfile_reader_close(ChunkFileReader *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLO_CHUNKFILE_H__ */
@@ -74,8 +74,10 @@ typedef struct WorkspaceConfigFileData {
 } WorkspaceConfigFileData;
 
 struct BlendFileReadParams {
-  uint skip_flags : 2; /* eBLOReadSkip */
+  uint skip_flags : 3; /* eBLOReadSkip */
   uint is_startup : 1;
+  /** Only read this data-block and the ones it uses (see #BLO_read_from_file_id), may be NULL. */
+  const char *root_idname;
 };
 
 /* skip reading some data-block types (may want to skip screen data too). */
@@ -83,12 +85,19 @@ typedef enum eBLOReadSkip {
   BLO_READ_SKIP_NONE = 0,
   BLO_READ_SKIP_USERDEF = (1 << 0),
   BLO_READ_SKIP_DATA = (1 << 1),
+  /** Only read the window-manager, workspaces, screens, the active scene
+   * and the data-blocks they use, other data-blocks are skipped without reading their data. */
+  BLO_READ_SKIP_UNUSED = (1 << 2),
 } eBLOReadSkip;
 #define BLO_READ_SKIP_ALL (BLO_READ_SKIP_USERDEF | BLO_READ_SKIP_DATA)
 
 BlendFileData *BLO_read_from_file(const char *filepath,
                                   eBLOReadSkip skip_flags,
                                   struct ReportList *reports);
+BlendFileData *BLO_read_from_file_id(const char *filepath,
+                                     const char *idname,
+                                     eBLOReadSkip skip_flags,
+                                     struct ReportList *reports);
 BlendFileData *BLO_read_from_memory(const void *mem,
                                     int memsize,
                                     eBLOReadSkip skip_flags,
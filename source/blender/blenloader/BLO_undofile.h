@@ -25,6 +25,7 @@
  * \ingroup blenloader
  */
 
+struct MemFileSharedChunk;
 struct Scene;
 
 typedef struct {
@@ -32,12 +33,15 @@ typedef struct {
   const char *buf;
   /** Size in bytes. */
   unsigned int size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** When true, the memory is shared with a chunk of a previous #MemFile. */
   bool is_identical;
+  /** Reference counted storage of #MemFileChunk.buf, shared by all chunks with equal content. */
+  struct MemFileSharedChunk *shared;
 } MemFileChunk;
 
 typedef struct MemFile {
   ListBase chunks;
+  /** Size of the chunks which weren't shared with any other #MemFile when written. */
   size_t size;
 } MemFile;
 
@@ -62,5 +66,6 @@ extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
                                          struct Main *bmain,
                                          struct Scene **r_scene);
 extern bool BLO_memfile_write_file(struct MemFile *memfile, const char *filename);
+extern void BLO_memfile_store_stats(unsigned int *r_chunks_num, size_t *r_size);
 
 #endif /* __BLO_UNDOFILE_H__ */
@@ -0,0 +1,786 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup blenloader
+ *
+ * File layout (native endian, the reader rejects files written with a different byte order):
+ *
+ * - #ChunkFileHeader
+ * - Compressed chunks, back to back.
+ * - Table of #ChunkFileEntry, one for each chunk, in stream order.
+ * - #ChunkFileFooter
+ *
+ * Writing:
+ * Chunks are cut when they reach #CHUNK_SIZE_MAX, or at a segment boundary
+ * (see #BLO_chunkfile_writer_segment_end) once they reach #CHUNK_SIZE_MIN.
+ * Since segments match data-block boundaries, an edit to one data-block
+ * only changes the chunks containing it.
+ *
+ * Full chunks are collected in batches, one batch is compressed by the task scheduler
+ * while the next one is being filled. When a reference file is given (typically the file
+ * being overwritten), chunks with identical content are copied from it instead of compressed.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "zlib.h"
+
+#ifndef _WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#  include "BLI_winstuff.h"
+#endif
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_fileops.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "BLO_chunkfile.h"
+
+/* keep last */
+#include "BLI_strict_flags.h"
+
+#define CHUNK_SIZE_MIN (1 << 18) /* 256kb */
+#define CHUNK_SIZE_MAX (1 << 20) /* 1mb */
+/** Limit memory use, each chunk in a batch holds its raw and compressed data. */
+#define CHUNK_BATCH_MAX 32
+
+#define CHUNKFILE_VERSION 1
+#define CHUNKFILE_ENDIAN_TEST 0x01020304
+
+static const char chunkfile_magic[BLO_CHUNKFILE_MAGIC_LEN] = {
+    'B', 'L', 'E', 'N', 'D', 'Z', 'C', 'K'};
+
+typedef struct ChunkFileHeader {
+  char magic[BLO_CHUNKFILE_MAGIC_LEN];
+  uint32_t version;
+  uint32_t endian_test;
+} ChunkFileHeader;
+
+typedef struct ChunkFileEntry {
+  /** Offset in the uncompressed stream. */
+  uint64_t raw_offset;
+  /** Offset of the (compressed) data in the file. */
+  uint64_t file_offset;
+  uint32_t raw_size;
+  uint32_t file_size;
+  /** Hash of the uncompressed data, used to find identical chunks. */
+  uint32_t hash;
+  /** #eChunkFileEntryFlag. */
+  uint32_t flag;
+} ChunkFileEntry;
+
+typedef enum eChunkFileEntryFlag {
+  /** Data didn't compress, it's stored as-is. */
+  CHUNK_STORED = (1 << 0),
+} eChunkFileEntryFlag;
+
+typedef struct ChunkFileFooter {
+  uint64_t table_offset;
+  uint64_t raw_size;
+  uint32_t num_chunks;
+  uint32_t version;
+  char magic[BLO_CHUNKFILE_MAGIC_LEN];
+} ChunkFileFooter;
+
+bool BLO_chunkfile_header_check(const void *header, size_t header_len)
+{
+  return memcmp(header, chunkfile_magic, MIN2(header_len, sizeof(chunkfile_magic))) == 0;
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Utilities
+ * \{ */
+
+static bool chunkfile_read_at(int file, uint64_t offset, void *buf, size_t len)
+{
+  if (lseek(file, (off_t)offset, SEEK_SET) != (off_t)offset) {
+    return false;
+  }
+  return read(file, buf, (uint)len) == (int64_t)len;
+}
+
+static bool chunkfile_write(int file, const void *buf, size_t len)
+{
+  return write(file, buf, (uint)len) == (int64_t)len;
+}
+
+/**
+ * Read and validate the table of an existing chunk file.
+ *
+ * \return The table (owned by the caller) or NULL if the file isn't a valid chunk file.
+ */
+static ChunkFileEntry *chunkfile_table_read(int file, uint *r_table_len, uint64_t *r_raw_size)
+{
+  ChunkFileHeader header;
+  ChunkFileFooter footer;
+
+  const off_t file_size = lseek(file, 0, SEEK_END);
+  if (file_size < (off_t)(sizeof(header) + sizeof(footer))) {
+    return NULL;
+  }
+  if (!chunkfile_read_at(file, 0, &header, sizeof(header)) ||
+      !chunkfile_read_at(
+          file, (uint64_t)file_size - sizeof(footer), &footer, sizeof(footer))) {
+    return NULL;
+  }
+  if (!BLO_chunkfile_header_check(header.magic, sizeof(header.magic)) ||
+      !BLO_chunkfile_header_check(footer.magic, sizeof(footer.magic)) ||
+      (header.version != CHUNKFILE_VERSION) || (footer.version != CHUNKFILE_VERSION) ||
+      (header.endian_test != CHUNKFILE_ENDIAN_TEST)) {
+    return NULL;
+  }
+
+  const uint64_t table_size = (uint64_t)footer.num_chunks * sizeof(ChunkFileEntry);
+  if (footer.table_offset + table_size + sizeof(footer) != (uint64_t)file_size) {
+    return NULL;
+  }
+
+  ChunkFileEntry *table = MEM_malloc_arrayN(
+      MAX2(footer.num_chunks, 1u), sizeof(*table), "ChunkFileEntry table");
+  if (!chunkfile_read_at(file, footer.table_offset, table, (size_t)table_size)) {
+    MEM_freeN(table);
+    return NULL;
+  }
+
+  /* Chunks must cover the stream without gaps, within the size limits we read with. */
+  uint64_t raw_offset = 0;
+  for (uint i = 0; i < footer.num_chunks; i++) {
+    const ChunkFileEntry *entry = &table[i];
+    if ((entry->raw_offset != raw_offset) || (entry->raw_size == 0) ||
+        (entry->raw_size > CHUNK_SIZE_MAX) ||
+        (entry->file_size > compressBound(CHUNK_SIZE_MAX)) ||
+        (entry->file_offset + entry->file_size > footer.table_offset)) {
+      MEM_freeN(table);
+      return NULL;
+    }
+    raw_offset += entry->raw_size;
+  }
+  if (raw_offset != footer.raw_size) {
+    MEM_freeN(table);
+    return NULL;
+  }
+
+  *r_table_len = footer.num_chunks;
+  *r_raw_size = footer.raw_size;
+  return table;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Writing
+ * \{ */
+
+typedef struct WriteChunk {
+  ChunkFileEntry entry;
+  /** Uncompressed data (#CHUNK_SIZE_MAX). */
+  char *raw;
+  /** Compressed data, or the data copied from the reference file. */
+  char *data;
+  /** Points to #WriteChunk.raw or #WriteChunk.data. */
+  const char *data_out;
+  bool is_reused;
+} WriteChunk;
+
+/** Previous version of the file, to copy unchanged chunks from. */
+typedef struct ChunkFileReference {
+  int file;
+  /** Reading the file from multiple threads. */
+  ThreadMutex mutex;
+  /** Sorted by #ChunkFileEntry.hash. */
+  ChunkFileEntry *table;
+  uint table_len;
+} ChunkFileReference;
+
+struct ChunkFileWriter {
+  int file;
+  uint64_t file_offset;
+  uint64_t raw_offset;
+  bool error;
+
+  /** Chunks are filled in `batch[batch_fill]` while `batch[!batch_fill]` is compressed. */
+  WriteChunk *batch[2];
+  uint batch_len;
+  int batch_fill;
+  /** Number of chunks ended in the batch being filled. */
+  uint batch_used;
+  /** Number of chunks in the batch being compressed. */
+  uint batch_pending;
+
+  TaskPool *task_pool;
+
+  ChunkFileEntry *table;
+  uint table_len, table_len_alloc;
+
+  ChunkFileReference *reference;
+
+  ChunkFileWriteStats stats;
+};
+
+static int chunkfile_entry_cmp_hash(const void *a_v, const void *b_v)
+{
+  const ChunkFileEntry *a = a_v, *b = b_v;
+  if (a->hash != b->hash) {
+    return (a->hash < b->hash) ? -1 : 1;
+  }
+  if (a->raw_size != b->raw_size) {
+    return (a->raw_size < b->raw_size) ? -1 : 1;
+  }
+  return 0;
+}
+
+static ChunkFileReference *chunkfile_reference_open(const char *filepath)
+{
+  const int file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+  if (file == -1) {
+    return NULL;
+  }
+
+  uint table_len;
+  uint64_t raw_size;
+  ChunkFileEntry *table = chunkfile_table_read(file, &table_len, &raw_size);
+  if (table == NULL) {
+    close(file);
+    return NULL;
+  }
+
+  qsort(table, table_len, sizeof(*table), chunkfile_entry_cmp_hash);
+
+  ChunkFileReference *reference = MEM_mallocN(sizeof(*reference), __func__);
+  reference->file = file;
+  reference->table = table;
+  reference->table_len = table_len;
+  BLI_mutex_init(&reference->mutex);
+  return reference;
+}
+
+static void chunkfile_reference_close(ChunkFileReference *reference)
+{
+  close(reference->file);
+  BLI_mutex_end(&reference->mutex);
+  MEM_freeN(reference->table);
+  MEM_freeN(reference);
+}
+
+/**
+ * Check the (compressed) data of \a entry from the reference file matches \a raw.
+ */
+static bool chunkfile_reference_data_equals(const ChunkFileEntry *entry,
+                                            const char *data,
+                                            const char *raw)
+{
+  if (entry->flag & CHUNK_STORED) {
+    return (entry->file_size == entry->raw_size) && (memcmp(data, raw, entry->raw_size) == 0);
+  }
+
+  /* Inflate in small steps, bailing out on the first difference. */
+  char buf[1 << 14];
+  z_stream strm = {NULL};
+  bool is_equal = true;
+  uint raw_offset = 0;
+
+  if (inflateInit(&strm) != Z_OK) {
+    return false;
+  }
+  strm.next_in = (Bytef *)data;
+  strm.avail_in = entry->file_size;
+
+  int ret = Z_OK;
+  while (is_equal && (ret == Z_OK)) {
+    strm.next_out = (Bytef *)buf;
+    strm.avail_out = sizeof(buf);
+    ret = inflate(&strm, Z_NO_FLUSH);
+    const uint len = (uint)sizeof(buf) - strm.avail_out;
+    if (!ELEM(ret, Z_OK, Z_STREAM_END) || (raw_offset + len > entry->raw_size) ||
+        (memcmp(buf, raw + raw_offset, len) != 0)) {
+      is_equal = false;
+    }
+    raw_offset += len;
+  }
+  inflateEnd(&strm);
+
+  return is_equal && (ret == Z_STREAM_END) && (raw_offset == entry->raw_size);
+}
+
+/**
+ * Find a chunk identical to \a chunk in the reference file, copying its data when found.
+ */
+static bool chunkfile_reference_find(ChunkFileReference *reference, WriteChunk *chunk)
+{
+  const ChunkFileEntry *table = reference->table;
+  uint first = 0, last = reference->table_len;
+
+  /* Lower bound. */
+  while (first < last) {
+    const uint mid = first + (last - first) / 2;
+    if (chunkfile_entry_cmp_hash(&table[mid], &chunk->entry) < 0) {
+      first = mid + 1;
+    }
+    else {
+      last = mid;
+    }
+  }
+
+  for (uint i = first;
+       (i < reference->table_len) && (chunkfile_entry_cmp_hash(&table[i], &chunk->entry) == 0);
+       i++) {
+    const ChunkFileEntry *entry = &table[i];
+
+    BLI_mutex_lock(&reference->mutex);
+    const bool ok = chunkfile_read_at(
+        reference->file, entry->file_offset, chunk->data, entry->file_size);
+    BLI_mutex_unlock(&reference->mutex);
+
+    if (ok && chunkfile_reference_data_equals(entry, chunk->data, chunk->raw)) {
+      chunk->entry.file_size = entry->file_size;
+      chunk->entry.flag = entry->flag;
+      chunk->data_out = chunk->data;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void chunkfile_compress_task(TaskPool *__restrict pool,
+                                    void *taskdata,
+                                    int UNUSED(threadid))
+{
+  ChunkFileWriter *writer = BLI_task_pool_userdata(pool);
+  WriteChunk *chunk = taskdata;
+  ChunkFileEntry *entry = &chunk->entry;
+
+  entry->hash = BLI_hash_mm2((const uchar *)chunk->raw, entry->raw_size, 0);
+
+  chunk->is_reused = (writer->reference != NULL) &&
+                     chunkfile_reference_find(writer->reference, chunk);
+  if (chunk->is_reused) {
+    return;
+  }
+
+  uLongf data_len = compressBound(CHUNK_SIZE_MAX);
+  if ((compress2((Bytef *)chunk->data,
+                 &data_len,
+                 (const Bytef *)chunk->raw,
+                 entry->raw_size,
+                 Z_BEST_SPEED) == Z_OK) &&
+      (data_len < entry->raw_size)) {
+    entry->file_size = (uint32_t)data_len;
+    entry->flag = 0;
+    chunk->data_out = chunk->data;
+  }
+  else {
+    entry->file_size = entry->raw_size;
+    entry->flag = CHUNK_STORED;
+    chunk->data_out = chunk->raw;
+  }
+}
+
+/** Write the chunks of the batch being compressed, once compression finished. */
+static void chunkfile_writer_batch_finish(ChunkFileWriter *writer)
+{
+  if (writer->batch_pending == 0) {
+    return;
+  }
+
+  BLI_task_pool_work_and_wait(writer->task_pool);
+
+  WriteChunk *batch = writer->batch[!writer->batch_fill];
+  for (uint i = 0; i < writer->batch_pending; i++) {
+    WriteChunk *chunk = &batch[i];
+
+    if (!writer->error) {
+      chunk->entry.file_offset = writer->file_offset;
+      if (chunkfile_write(writer->file, chunk->data_out, chunk->entry.file_size)) {
+        writer->file_offset += chunk->entry.file_size;
+      }
+      else {
+        writer->error = true;
+      }
+    }
+
+    if (writer->table_len == writer->table_len_alloc) {
+      writer->table_len_alloc = MAX2(writer->table_len_alloc * 2, 64u);
+      writer->table = MEM_reallocN(writer->table,
+                                   sizeof(*writer->table) * writer->table_len_alloc);
+    }
+    writer->table[writer->table_len++] = chunk->entry;
+
+    writer->stats.num_chunks++;
+    if (chunk->is_reused) {
+      writer->stats.num_chunks_reused++;
+    }
+  }
+  writer->batch_pending = 0;
+}
+
+/** Start compressing the batch being filled, and continue filling the other one. */
+static void chunkfile_writer_batch_submit(ChunkFileWriter *writer)
+{
+  chunkfile_writer_batch_finish(writer);
+
+  WriteChunk *batch = writer->batch[writer->batch_fill];
+  for (uint i = 0; i < writer->batch_used; i++) {
+    BLI_task_pool_push(
+        writer->task_pool, chunkfile_compress_task, &batch[i], false, TASK_PRIORITY_HIGH);
+  }
+
+  writer->batch_pending = writer->batch_used;
+  writer->batch_used = 0;
+  writer->batch_fill = !writer->batch_fill;
+
+  /* Reset the chunk to be filled. */
+  writer->batch[writer->batch_fill][0].entry.raw_size = 0;
+}
+
+static void chunkfile_writer_chunk_end(ChunkFileWriter *writer)
+{
+  WriteChunk *chunk = &writer->batch[writer->batch_fill][writer->batch_used];
+  if (chunk->entry.raw_size == 0) {
+    return;
+  }
+
+  chunk->entry.raw_offset = writer->raw_offset;
+  writer->raw_offset += chunk->entry.raw_size;
+
+  writer->batch_used++;
+  if (writer->batch_used == writer->batch_len) {
+    chunkfile_writer_batch_submit(writer);
+  }
+  else {
+    writer->batch[writer->batch_fill][writer->batch_used].entry.raw_size = 0;
+  }
+}
+
+/**
+ * \param reference_filepath: Optional existing chunk file, chunks identical to the ones
+ * in this file are copied instead of compressed.
+ */
+ChunkFileWriter *BLO_chunkfile_writer_open(const char *filepath, const char *reference_filepath)
+{
+  const int file = BLI_open(filepath, O_BINARY | O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (file == -1) {
+    return NULL;
+  }
+
+  ChunkFileWriter *writer = MEM_callocN(sizeof(*writer), __func__);
+  writer->file = file;
+
+  ChunkFileHeader header;
+  memcpy(header.magic, chunkfile_magic, sizeof(header.magic));
+  header.version = CHUNKFILE_VERSION;
+  header.endian_test = CHUNKFILE_ENDIAN_TEST;
+  if (!chunkfile_write(file, &header, sizeof(header))) {
+    writer->error = true;
+  }
+  writer->file_offset = sizeof(header);
+
+  if (reference_filepath != NULL) {
+    writer->reference = chunkfile_reference_open(reference_filepath);
+  }
+
+  TaskScheduler *scheduler = BLI_task_scheduler_get();
+  writer->task_pool = BLI_task_pool_create(scheduler, writer);
+
+  /* Two chunks per thread keeps all threads busy while the batch is filled. */
+  writer->batch_len = (uint)CLAMPIS(
+      BLI_task_scheduler_num_threads(scheduler) * 2, 2, CHUNK_BATCH_MAX);
+
+  for (int i = 0; i < 2; i++) {
+    writer->batch[i] = MEM_calloc_arrayN(writer->batch_len, sizeof(WriteChunk), __func__);
+    for (uint j = 0; j < writer->batch_len; j++) {
+      writer->batch[i][j].raw = MEM_mallocN(CHUNK_SIZE_MAX, "WriteChunk.raw");
+      writer->batch[i][j].data = MEM_mallocN(compressBound(CHUNK_SIZE_MAX), "WriteChunk.data");
+    }
+  }
+
+  return writer;
+}
+
+bool BLO_chunkfile_writer_write(ChunkFileWriter *writer, const void *data, size_t data_len)
+{
+  const char *data_step = data;
+
+  while (data_len > 0) {
+    WriteChunk *chunk = &writer->batch[writer->batch_fill][writer->batch_used];
+    const uint len = (uint)MIN2(data_len, (size_t)(CHUNK_SIZE_MAX - chunk->entry.raw_size));
+
+    memcpy(chunk->raw + chunk->entry.raw_size, data_step, len);
+    chunk->entry.raw_size += len;
+    data_step += len;
+    data_len -= len;
+
+    if (chunk->entry.raw_size == CHUNK_SIZE_MAX) {
+      chunkfile_writer_chunk_end(writer);
+    }
+  }
+
+  return !writer->error;
+}
+
+/**
+ * Hint that the data written so far is a logical unit (a data-block for e.g.),
+ * the current chunk is ended here unless it's smaller than #CHUNK_SIZE_MIN.
+ */
+void BLO_chunkfile_writer_segment_end(ChunkFileWriter *writer)
+{
+  const WriteChunk *chunk = &writer->batch[writer->batch_fill][writer->batch_used];
+  if (chunk->entry.raw_size >= CHUNK_SIZE_MIN) {
+    chunkfile_writer_chunk_end(writer);
+  }
+}
+
+/**
+ * Finish writing the file and free the \a writer.
+ *
+ * \return success.
+ */
+bool BLO_chunkfile_writer_close(ChunkFileWriter *writer, ChunkFileWriteStats *r_stats)
+{
+  chunkfile_writer_chunk_end(writer);
+  if (writer->batch_used != 0) {
+    chunkfile_writer_batch_submit(writer);
+  }
+  chunkfile_writer_batch_finish(writer);
+
+  ChunkFileFooter footer;
+  footer.table_offset = writer->file_offset;
+  footer.raw_size = writer->raw_offset;
+  footer.num_chunks = writer->table_len;
+  footer.version = CHUNKFILE_VERSION;
+  memcpy(footer.magic, chunkfile_magic, sizeof(footer.magic));
+
+  if (!writer->error) {
+    const size_t table_size = sizeof(*writer->table) * writer->table_len;
+    if ((table_size && !chunkfile_write(writer->file, writer->table, table_size)) ||
+        !chunkfile_write(writer->file, &footer, sizeof(footer))) {
+      writer->error = true;
+    }
+    writer->file_offset += table_size + sizeof(footer);
+  }
+
+  if (close(writer->file) == -1) {
+    writer->error = true;
+  }
+
+  writer->stats.raw_size = writer->raw_offset;
+  writer->stats.file_size = writer->file_offset;
+  if (r_stats) {
+    *r_stats = writer->stats;
+  }
+
+  const bool ok = !writer->error;
+
+  BLI_task_pool_free(writer->task_pool);
+  if (writer->reference) {
+    chunkfile_reference_close(writer->reference);
+  }
+  for (int i = 0; i < 2; i++) {
+    for (uint j = 0; j < writer->batch_len; j++) {
+      MEM_freeN(writer->batch[i][j].raw);
+      MEM_freeN(writer->batch[i][j].data);
+    }
+    MEM_freeN(writer->batch[i]);
+  }
+  MEM_SAFE_FREE(writer->table);
+  MEM_freeN(writer);
+
+  return ok;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Reading
+ * \{ */
+
+struct ChunkFileReader {
+  int file;
+  ChunkFileEntry *table;
+  uint table_len;
+  uint64_t raw_size;
+  /** Current position in the uncompressed stream. */
+  uint64_t raw_offset;
+
+  /** Index of the chunk in #ChunkFileReader.raw, -1 when none is. */
+  int chunk_index;
+  char *raw;
+  char *data;
+
+  uint chunks_decoded;
+};
+
+/**
+ * \param file: File descriptor, stays owned by the caller.
+ * \return NULL when \a file isn't a valid chunk file.
+ */
+ChunkFileReader *BLO_chunkfile_reader_open(int file)
+{
+  uint table_len;
+  uint64_t raw_size;
+  ChunkFileEntry *table = chunkfile_table_read(file, &table_len, &raw_size);
+  if (table == NULL) {
+    return NULL;
+  }
+
+  ChunkFileReader *reader = MEM_callocN(sizeof(*reader), __func__);
+  reader->file = file;
+  reader->table = table;
+  reader->table_len = table_len;
+  reader->raw_size = raw_size;
+  reader->chunk_index = -1;
+  reader->raw = MEM_mallocN(CHUNK_SIZE_MAX, "ChunkFileReader.raw");
+  reader->data = MEM_mallocN(compressBound(CHUNK_SIZE_MAX), "ChunkFileReader.data");
+  return reader;
+}
+
+/** Decode the chunk containing the current position. */
+static bool chunkfile_reader_chunk_load(ChunkFileReader *reader)
+{
+  const ChunkFileEntry *table = reader->table;
+
+  /* Most reads are sequential. */
+  uint index = (reader->chunk_index == -1) ? 0 : (uint)reader->chunk_index;
+  if ((index + 1 < reader->table_len) &&
+      (reader->raw_offset == table[index].raw_offset + table[index].raw_size)) {
+    index++;
+  }
+  else {
+    /* Upper bound minus one. */
+    uint first = 0, last = reader->table_len;
+    while (first < last) {
+      const uint mid = first + (last - first) / 2;
+      if (table[mid].raw_offset <= reader->raw_offset) {
+        first = mid + 1;
+      }
+      else {
+        last = mid;
+      }
+    }
+    index = first - 1;
+  }
+
+  const ChunkFileEntry *entry = &table[index];
+  BLI_assert(reader->raw_offset - entry->raw_offset < entry->raw_size);
+
+  reader->chunk_index = -1;
+  if (!chunkfile_read_at(reader->file,
+                         entry->file_offset,
+                         (entry->flag & CHUNK_STORED) ? reader->raw : reader->data,
+                         entry->file_size)) {
+    return false;
+  }
+  if ((entry->flag & CHUNK_STORED) == 0) {
+    uLongf raw_size = entry->raw_size;
+    if ((uncompress((Bytef *)reader->raw,
+                    &raw_size,
+                    (const Bytef *)reader->data,
+                    entry->file_size) != Z_OK) ||
+        (raw_size != entry->raw_size)) {
+      return false;
+    }
+  }
+
+  reader->chunk_index = (int)index;
+  reader->chunks_decoded++;
+  return true;
+}
+
+/**
+ * \return The number of bytes read, or -1 on error.
+ */
+int64_t BLO_chunkfile_reader_read(ChunkFileReader *reader, void *buffer, size_t buffer_len)
+{
+  char *buffer_step = buffer;
+  int64_t len_read = 0;
+
+  while ((buffer_len > 0) && (reader->raw_offset < reader->raw_size)) {
+    const ChunkFileEntry *entry = (reader->chunk_index != -1) ?
+                                      &reader->table[reader->chunk_index] :
+                                      NULL;
+    if ((entry == NULL) || (reader->raw_offset < entry->raw_offset) ||
+        (reader->raw_offset >= entry->raw_offset + entry->raw_size)) {
+      if (!chunkfile_reader_chunk_load(reader)) {
+        return -1;
+      }
+      entry = &reader->table[reader->chunk_index];
+    }
+
+    const uint chunk_offset = (uint)(reader->raw_offset - entry->raw_offset);
+    const size_t len = MIN2(buffer_len, (size_t)(entry->raw_size - chunk_offset));
+    memcpy(buffer_step, reader->raw + chunk_offset, len);
+
+    buffer_step += len;
+    buffer_len -= len;
+    len_read += (int64_t)len;
+    reader->raw_offset += len;
+  }
+
+  return len_read;
+}
+
+/**
+ * Seeking is cheap, chunks are only decoded once data is read from them.
+ *
+ * \return The new position in the uncompressed stream, or -1 on error.
+ */
+int64_t BLO_chunkfile_reader_seek(ChunkFileReader *reader, int64_t offset, int whence)
+{
+  int64_t base;
+  switch (whence) {
+    case SEEK_SET:
+      base = 0;
+      break;
+    case SEEK_CUR:
+      base = (int64_t)reader->raw_offset;
+      break;
+    case SEEK_END:
+      base = (int64_t)reader->raw_size;
+      break;
+    default:
+      return -1;
+  }
+  if (base + offset < 0) {
+    return -1;
+  }
+  reader->raw_offset = (uint64_t)(base + offset);
+  return (int64_t)reader->raw_offset;
+}
+
+uint BLO_chunkfile_reader_chunks_decoded(const ChunkFileReader *reader)
+{
+  return reader->chunks_decoded;
+}
+
+void BLO_chunkfile_reader_close(ChunkFileReader *reader)
+{
+  MEM_freeN(reader->table);
+  MEM_freeN(reader->raw);
+  MEM_freeN(reader->data);
+  MEM_freeN(reader);
+}
+
+/** \} */
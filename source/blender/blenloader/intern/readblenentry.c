@@ -324,6 +324,34 @@ BlendFileData *BLO_read_from_file(const char *filepath,
   return bfd;
 }
 
+/**
+ * Open a blender file, only reading a single data-block and the data-blocks it uses
+ * (as #BLO_READ_SKIP_UNUSED does for the active scene).
+ * When \a idname is a scene it's used as the active scene.
+ *
+ * \param idname: The data-block name, including the ID code (e.g. "SCScene").
+ * \return The data of the file, the data-block may not be found.
+ */
+BlendFileData *BLO_read_from_file_id(const char *filepath,
+                                     const char *idname,
+                                     eBLOReadSkip skip_flags,
+                                     ReportList *reports)
+{
+  BlendFileData *bfd = NULL;
+  FileData *fd;
+
+  fd = blo_filedata_from_file(filepath, reports);
+  if (fd) {
+    fd->reports = reports;
+    fd->skip_flags = skip_flags | BLO_READ_SKIP_UNUSED;
+    fd->read_root_idname = idname;
+    bfd = blo_read_file_internal(fd, filepath);
+    blo_filedata_free(fd);
+  }
+
+  return bfd;
+}
+
 /**
  * Open a blender file from memory. The function returns NULL
  * and sets a report in the list if it cannot open the file.
@@ -124,6 +124,7 @@
 #include "BKE_library_override.h"
 #include "BKE_library_query.h"
 #include "BKE_main.h"  // for Main
+#include "BKE_main_namemap.h"
 #include "BKE_material.h"
 #include "BKE_mesh.h"  // for ME_ defines (patching)
 #include "BKE_mesh_runtime.h"
@@ -151,6 +152,7 @@
 
 #include "BLO_blend_defs.h"
 #include "BLO_blend_validate.h"
+#include "BLO_chunkfile.h"
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
 
@@ -243,6 +245,7 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname);
 static void direct_link_modifiers(FileData *fd, ListBase *lb, Object *ob);
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name);
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname);
+static void expand_doit_library(void *fdhandle, Main *mainvar, void *old);
 
 #ifdef USE_COLLECTION_COMPAT_28
 static void expand_scene_collection(FileData *fd, Main *mainvar, SceneCollection *sc);
@@ -506,6 +509,13 @@ static void add_main_to_main(Main *mainvar, Main *from)
   set_listbasepointers(mainvar, lbarray);
   a = set_listbasepointers(from, fromarray);
   while (a--) {
+    /* Only local IDs are indexed by name, skip the loop when neither main has an index. */
+    if (from->name_map != NULL || mainvar->name_map != NULL) {
+      for (ID *id = fromarray[a]->first; id; id = id->next) {
+        BKE_main_namemap_remove_name(from, id);
+        BKE_main_namemap_add_name(mainvar, id);
+      }
+    }
     BLI_movelisttolist(lbarray[a], fromarray[a]);
   }
 }
@@ -1171,6 +1181,28 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
   return (readsize);
 }
 
+/* Chunked file reading. */
+
+static int fd_read_chunked_from_file(FileData *filedata, void *buffer, uint size)
+{
+  int readsize = (int)BLO_chunkfile_reader_read(filedata->chunkfile, buffer, size);
+
+  if (readsize < 0) {
+    readsize = EOF;
+  }
+  else {
+    filedata->file_offset += readsize;
+  }
+
+  return (readsize);
+}
+
+static off64_t fd_seek_chunked_from_file(FileData *filedata, off64_t offset, int whence)
+{
+  filedata->file_offset = BLO_chunkfile_reader_seek(filedata->chunkfile, offset, whence);
+  return filedata->file_offset;
+}
+
 /* Memory reading. */
 
 static int fd_read_from_memory(FileData *filedata, void *buffer, uint size)
@@ -1297,6 +1329,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  ChunkFileReader *chunkfile = NULL;
 
   char header[7];
 
@@ -1342,6 +1375,24 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
     }
   }
 
+  /* Chunked file. */
+  if ((read_fn == NULL) && BLO_chunkfile_header_check(header, sizeof(header))) {
+    chunkfile = BLO_chunkfile_reader_open(file);
+    if (chunkfile == NULL) {
+      BKE_reportf(reports,
+                  RPT_WARNING,
+                  "Unable to read '%s': %s",
+                  filepath,
+                  TIP_("invalid or truncated compressed file"));
+      return NULL;
+    }
+    else {
+      /* Seeking is cheap, only the chunks being read are decompressed. */
+      read_fn = fd_read_chunked_from_file;
+      seek_fn = fd_seek_chunked_from_file;
+    }
+  }
+
   if (read_fn == NULL) {
     BKE_reportf(reports, RPT_WARNING, "Unrecognized file format '%s'", filepath);
     return NULL;
@@ -1351,6 +1402,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+  fd->chunkfile = chunkfile;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1499,6 +1551,10 @@ FileData *blo_filedata_from_memfile(MemFile *memfile, ReportList *reports)
 void blo_filedata_free(FileData *fd)
 {
   if (fd) {
+    if (fd->chunkfile != NULL) {
+      BLO_chunkfile_reader_close(fd->chunkfile);
+    }
+
     if (fd->filedes != -1) {
       close(fd->filedes);
     }
@@ -3048,6 +3104,7 @@ static void direct_link_fcurves(FileData *fd, ListBase *list)
     /* curve data */
     fcu->bezt = newdataadr(fd, fcu->bezt);
     fcu->fpt = newdataadr(fd, fcu->fpt);
+    fcu->eval_cache = NULL;
 
     /* rna path */
     fcu->rna_path = newdataadr(fd, fcu->rna_path);
@@ -4063,6 +4120,7 @@ static void direct_link_key(FileData *fd, Key *key)
   direct_link_animdata(fd, key->adt);
 
   key->refkey = newdataadr(fd, key->refkey);
+  key->sparse_data = NULL;
 
   for (kb = key->block.first; kb; kb = kb->next) {
     kb->data = newdataadr(fd, kb->data);
@@ -5033,7 +5091,7 @@ static void direct_link_customdata(FileData *fd, CustomData *data, int count)
       layer->flag &= ~CD_FLAG_IN_MEMORY;
     }
 
-    layer->flag &= ~CD_FLAG_NOFREE;
+    layer->flag &= ~(CD_FLAG_NOFREE | CD_FLAG_SHARED | CD_FLAG_SHARED_COPY_ON_WRITE);
 
     if (CustomData_verify_versions(data, i)) {
       layer->data = newdataadr(fd, layer->data);
@@ -9931,6 +9989,45 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 /** \name Read File (Internal)
  * \{ */
 
+/**
+ * Data-blocks read up-front with #BLO_READ_SKIP_UNUSED,
+ * the data-blocks they use are read when expanding them.
+ */
+static bool read_file_is_root_id(FileData *fd, BlendFileData *bfd, BHead *bhead)
+{
+  /* Needed to read linked data-blocks. */
+  if (bhead->code == ID_LI) {
+    return true;
+  }
+
+  if (fd->read_root_idname != NULL) {
+    if (!STREQ(blo_bhead_id_name(fd, bhead), fd->read_root_idname)) {
+      return false;
+    }
+    if (bhead->code == ID_SCE) {
+      bfd->curscene = (Scene *)bhead->old;
+      bfd->curscreen = NULL;
+      bfd->cur_view_layer = NULL;
+    }
+    return true;
+  }
+
+  switch (bhead->code) {
+    case ID_WM:
+    case ID_WS:
+    case ID_SCR:
+      return true;
+    case ID_SCE:
+      /* Files saved without a window-manager have no active scene, use the first one. */
+      if (bfd->curscene == NULL) {
+        bfd->curscene = (Scene *)bhead->old;
+      }
+      return (bhead->old == bfd->curscene);
+    default:
+      return false;
+  }
+}
+
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
   BHead *bhead = blo_bhead_first(fd);
@@ -9996,7 +10093,8 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
         break;
 
       case ID_LINK_PLACEHOLDER:
-        if (fd->skip_flags & BLO_READ_SKIP_DATA) {
+        if (fd->skip_flags & (BLO_READ_SKIP_DATA | BLO_READ_SKIP_UNUSED)) {
+          /* Unused placeholders are read when expanding. */
           bhead = blo_bhead_next(fd, bhead);
         }
         else {
@@ -10017,12 +10115,28 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
         if (fd->skip_flags & BLO_READ_SKIP_DATA) {
           bhead = blo_bhead_next(fd, bhead);
         }
+        else if (fd->skip_flags & BLO_READ_SKIP_UNUSED) {
+          if (read_file_is_root_id(fd, bfd, bhead)) {
+            bhead = read_libblock(
+                fd, bfd->main, bhead, LIB_TAG_LOCAL | LIB_TAG_NEED_EXPAND, false, NULL);
+          }
+          else {
+            bhead = blo_bhead_next(fd, bhead);
+          }
+        }
         else {
           bhead = read_libblock(fd, bfd->main, bhead, LIB_TAG_LOCAL, false, NULL);
         }
     }
   }
 
+  /* Read the data-blocks used by the ones read so far, the same way linking does. */
+  if ((fd->skip_flags & (BLO_READ_SKIP_DATA | BLO_READ_SKIP_UNUSED)) == BLO_READ_SKIP_UNUSED) {
+    BLO_main_expander(expand_doit_library);
+    BLO_expand_main(fd, bfd->main);
+    bfd->main->is_read_partial = true;
+  }
+
   /* do before read_libraries, but skip undo case */
   if (fd->memfile == NULL) {
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
@@ -10074,6 +10188,9 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     link_global(fd, bfd); /* as last */
   }
 
+  /* IDs were added and renamed by reading and versioning, index names again when needed. */
+  BKE_main_namemap_clear(bfd->main);
+
   fd->mainlist = NULL; /* Safety, this is local variable, shall not be used afterward. */
 
   return bfd;
@@ -10257,7 +10374,7 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
                        RPT_WARNING,
                        TIP_("LIB: Data refers to main .blend file: '%s' from %s"),
                        idname,
-                       mainvar->curlib->filepath);
+                       mainvar->curlib ? mainvar->curlib->filepath : fd->relabase);
       return;
     }
 
@@ -10265,8 +10382,14 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
 
     if (id == NULL) {
       /* ID has not been read yet, add placeholder to the main of the
-       * library it belongs to, so that it will be read later. */
-      read_libblock(fd, libmain, bhead, LIB_TAG_INDIRECT, false, NULL);
+       * library it belongs to, so that it will be read later.
+       * From the main file (see #BLO_READ_SKIP_UNUSED) it's linked directly. */
+      if (mainvar->curlib == NULL) {
+        read_libblock(fd, libmain, bhead, 0, true, NULL);
+      }
+      else {
+        read_libblock(fd, libmain, bhead, LIB_TAG_INDIRECT, false, NULL);
+      }
       // commented because this can print way too much
       // if (G.debug & G_DEBUG) printf("expand_doit: other lib %s\n", lib->name);
 
@@ -10321,7 +10444,12 @@ static void expand_doit_library(void *fdhandle, Main *mainvar, void *old)
 
     ID *id = is_yet_read(fd, mainvar, bhead);
     if (id == NULL) {
-      read_libblock(fd, mainvar, bhead, LIB_TAG_NEED_EXPAND | LIB_TAG_INDIRECT, false, NULL);
+      read_libblock(fd,
+                    mainvar,
+                    bhead,
+                    LIB_TAG_NEED_EXPAND | (mainvar->curlib ? LIB_TAG_INDIRECT : LIB_TAG_LOCAL),
+                    false,
+                    NULL);
     }
     else {
       /* Convert any previously read weak link to regular link
@@ -11228,6 +11356,13 @@ static void expand_gpencil(FileData *fd, Main *mainvar, bGPdata *gpd)
   }
 }
 
+static void expand_windowmanager(FileData *fd, Main *mainvar, wmWindowManager *wm)
+{
+  for (wmWindow *win = wm->windows.first; win; win = win->next) {
+    expand_doit(fd, mainvar, win->scene);
+  }
+}
+
 static void expand_workspace(FileData *fd, Main *mainvar, WorkSpace *workspace)
 {
   ListBase *layouts = BKE_workspace_layouts_get(workspace);
@@ -11358,6 +11493,9 @@ void BLO_expand_main(void *fdhandle, Main *mainvar)
             case ID_WS:
               expand_workspace(fd, mainvar, (WorkSpace *)id);
               break;
+            case ID_WM:
+              expand_windowmanager(fd, mainvar, (wmWindowManager *)id);
+              break;
             default:
               break;
           }
@@ -11778,8 +11916,10 @@ static void split_main_newid(Main *mainptr, Main *main_newid)
       idnext = id->next;
 
       if (id->tag & LIB_TAG_NEW) {
+        BKE_main_namemap_remove_name(mainptr, id);
         BLI_remlink(lbarray[i], id);
         BLI_addtail(lbarray_newid[i], id);
+        BKE_main_namemap_add_name(main_newid, id);
       }
     }
   }
@@ -11842,6 +11982,9 @@ static void library_link_end(Main *mainl,
   mainvar = (*fd)->mainlist->first;
   MEM_freeN((*fd)->mainlist);
 
+  /* Linked and versioned IDs were added to the main, index names again when needed. */
+  BKE_main_namemap_clear(mainvar);
+
   /* After all data has been read and versioned, uses LIB_TAG_NEW. */
   ntreeUpdateAllNew(mainvar);
 
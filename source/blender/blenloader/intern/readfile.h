@@ -81,6 +81,8 @@ typedef struct FileData {
 
   /** Variables needed for reading from file. */
   gzFile gzfiledes;
+  /** Reading from a chunked file (see `BLO_chunkfile.h`), uses #FileData.filedes. */
+  struct ChunkFileReader *chunkfile;
   /** Gzip stream for memory decompression. */
   z_stream strm;
 
@@ -101,6 +103,9 @@ typedef struct FileData {
 
   /** Optionally skip some data-blocks when they're not needed. */
   eBLOReadSkip skip_flags;
+  /** With #BLO_READ_SKIP_UNUSED, the only data-block to read (along with the ones it uses),
+   * NULL to use the active scene & UI. */
+  const char *read_root_idname;
 
   struct OldNewMap *datamap;
   struct OldNewMap *globmap;
@@ -41,6 +41,9 @@
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_threads.h"
 
 #include "BLO_undofile.h"
 #include "BLO_readfile.h"
@@ -52,15 +55,113 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/**
+ * Chunk storage shared by all memfiles, chunks are looked up by content so identical data
+ * is only stored once, no matter in which step or at which position it was written.
+ */
+typedef struct MemFileSharedChunk {
+  /** Data, allocated along with this struct. */
+  const char *buf;
+  uint size;
+  uint hash;
+  /** Number of #MemFileChunk using this. */
+  uint users;
+} MemFileSharedChunk;
+
+static struct {
+  GSet *chunks;
+  ThreadMutex lock;
+} g_memfile_store = {NULL, BLI_MUTEX_INITIALIZER};
+
+static uint memfile_shared_chunk_hash(const void *key)
+{
+  const MemFileSharedChunk *shared = key;
+  return shared->hash;
+}
+
+static bool memfile_shared_chunk_cmp(const void *a, const void *b)
+{
+  const MemFileSharedChunk *shared_a = a;
+  const MemFileSharedChunk *shared_b = b;
+  return (shared_a->size != shared_b->size) ||
+         (memcmp(shared_a->buf, shared_b->buf, shared_a->size) != 0);
+}
+
+/**
+ * \return A shared chunk with the content of \a buf, with a new user.
+ * \param r_is_new: Set when no chunk with this content existed.
+ */
+static MemFileSharedChunk *memfile_shared_chunk_ensure(const char *buf, uint size, bool *r_is_new)
+{
+  MemFileSharedChunk key = {
+      .buf = buf,
+      .size = size,
+      .hash = BLI_hash_mm2((const uchar *)buf, size, 0),
+  };
+  MemFileSharedChunk *shared;
+  void **shared_p;
+
+  BLI_mutex_lock(&g_memfile_store.lock);
+
+  if (g_memfile_store.chunks == NULL) {
+    g_memfile_store.chunks = BLI_gset_new(
+        memfile_shared_chunk_hash, memfile_shared_chunk_cmp, __func__);
+  }
+
+  *r_is_new = !BLI_gset_ensure_p_ex(g_memfile_store.chunks, &key, &shared_p);
+  if (*r_is_new) {
+    shared = MEM_mallocN(sizeof(*shared) + size, "MemFileSharedChunk");
+    char *buf_new = (char *)(shared + 1);
+    memcpy(buf_new, buf, size);
+    shared->buf = buf_new;
+    shared->size = size;
+    shared->hash = key.hash;
+    shared->users = 0;
+    *shared_p = shared;
+  }
+  else {
+    shared = *shared_p;
+  }
+  shared->users++;
+
+  BLI_mutex_unlock(&g_memfile_store.lock);
+
+  return shared;
+}
+
+static void memfile_shared_chunk_user_add(MemFileSharedChunk *shared)
+{
+  BLI_mutex_lock(&g_memfile_store.lock);
+  shared->users++;
+  BLI_mutex_unlock(&g_memfile_store.lock);
+}
+
+static void memfile_shared_chunk_user_remove(MemFileSharedChunk *shared)
+{
+  BLI_mutex_lock(&g_memfile_store.lock);
+
+  BLI_assert(shared->users > 0);
+  if (--shared->users == 0) {
+    BLI_gset_remove(g_memfile_store.chunks, shared, NULL);
+    MEM_freeN(shared);
+
+    /* Don't keep the set around when there is no undo data. */
+    if (BLI_gset_len(g_memfile_store.chunks) == 0) {
+      BLI_gset_free(g_memfile_store.chunks, NULL);
+      g_memfile_store.chunks = NULL;
+    }
+  }
+
+  BLI_mutex_unlock(&g_memfile_store.lock);
+}
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    memfile_shared_chunk_user_remove(chunk->shared);
     MEM_freeN(chunk);
   }
   memfile->size = 0;
@@ -70,26 +171,33 @@ void BLO_memfile_free(MemFile *memfile)
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  MemFileChunk *fc, *sc;
-
-  fc = first->chunks.first;
-  sc = second->chunks.first;
-  while (fc || sc) {
-    if (fc && sc) {
-      if (sc->is_identical) {
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-    }
-    if (fc) {
-      fc = fc->next;
-    }
-    if (sc) {
-      sc = sc->next;
+  /* Chunks are reference counted, 'second' keeps the ones it uses. */
+  UNUSED_VARS(second);
+
+  BLO_memfile_free(first);
+}
+
+/**
+ * Number of chunks stored for all memfiles and their total size in bytes.
+ */
+void BLO_memfile_store_stats(uint *r_chunks_num, size_t *r_size)
+{
+  uint chunks_num = 0;
+  size_t size = 0;
+
+  BLI_mutex_lock(&g_memfile_store.lock);
+  if (g_memfile_store.chunks != NULL) {
+    GSetIterator gs_iter;
+    GSET_ITER (gs_iter, g_memfile_store.chunks) {
+      const MemFileSharedChunk *shared = BLI_gsetIterator_getKey(&gs_iter);
+      chunks_num++;
+      size += shared->size;
     }
   }
+  BLI_mutex_unlock(&g_memfile_store.lock);
 
-  BLO_memfile_free(first);
+  *r_chunks_num = chunks_num;
+  *r_size = size;
 }
 
 void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChunk **compchunk_step)
@@ -98,27 +206,33 @@ void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChun
   curchunk->size = size;
   curchunk->buf = NULL;
   curchunk->is_identical = false;
+  curchunk->shared = NULL;
   BLI_addtail(&memfile->chunks, curchunk);
 
-  /* we compare compchunk with buf */
+  /* we compare compchunk with buf, most chunks are unchanged and at the same position */
   if (*compchunk_step != NULL) {
     MemFileChunk *compchunk = *compchunk_step;
     if (compchunk->size == curchunk->size) {
       if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
+        curchunk->shared = compchunk->shared;
         curchunk->is_identical = true;
+        memfile_shared_chunk_user_add(curchunk->shared);
       }
     }
     *compchunk_step = compchunk->next;
   }
 
-  /* not equal... */
-  if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+  /* not equal at this position, look for equal content anywhere... */
+  if (curchunk->shared == NULL) {
+    bool is_new;
+    curchunk->shared = memfile_shared_chunk_ensure(buf, size, &is_new);
+    curchunk->is_identical = !is_new;
+    if (is_new) {
+      memfile->size += size;
+    }
   }
+
+  curchunk->buf = curchunk->shared->buf;
 }
 
 struct Main *BLO_memfile_main_get(struct MemFile *memfile,
@@ -83,7 +83,7 @@ static ID *rename_id_for_versioning(Main *bmain,
   if (id != NULL) {
     BLI_strncpy(id->name + 2, name_dst, sizeof(id->name) - 2);
     /* We know it's unique, this just sorts. */
-    BLI_libblock_ensure_unique_name(bmain, id->name);
+    BLI_libblock_ensure_unique_name(bmain, id);
   }
   return id;
 }
@@ -385,7 +385,7 @@ void BLO_update_defaults_startup_blend(Main *bmain, const char *app_template)
     if (layout->screen) {
       bScreen *screen = layout->screen;
       BLI_strncpy(screen->id.name + 2, workspace->id.name + 2, sizeof(screen->id.name) - 2);
-      BLI_libblock_ensure_unique_name(bmain, screen->id.name);
+      BLI_libblock_ensure_unique_name(bmain, &screen->id);
     }
 
     /* For some reason we have unused screens, needed until re-saving.
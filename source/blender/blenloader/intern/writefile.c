@@ -170,6 +170,7 @@
 
 #include "BLO_blend_defs.h"
 #include "BLO_blend_validate.h"
+#include "BLO_chunkfile.h"
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
 #include "BLO_writefile.h"
@@ -200,6 +201,7 @@
 typedef enum {
   WW_WRAP_NONE = 1,
   WW_WRAP_ZLIB,
+  WW_WRAP_CHUNKED,
 } eWriteWrapType;
 
 typedef struct WriteWrap WriteWrap;
@@ -208,14 +210,20 @@ struct WriteWrap {
   bool (*open)(WriteWrap *ww, const char *filepath);
   bool (*close)(WriteWrap *ww);
   size_t (*write)(WriteWrap *ww, const char *data, size_t data_len);
+  /* Optional, called at the end of each data-block. */
+  void (*segment_end)(WriteWrap *ww);
 
   /* Buffer output (we only want when output isn't already buffered). */
   bool use_buf;
 
+  /* Optional, the previous version of the file (may not exist). */
+  const char *reference_filepath;
+
   /* internal */
   union {
     int file_handle;
     gzFile gz_handle;
+    ChunkFileWriter *chunk_handle;
   } _user_data;
 };
 
@@ -273,6 +281,47 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+/* chunked */
+#define FILE_HANDLE(ww) (ww)->_user_data.chunk_handle
+
+static bool ww_open_chunked(WriteWrap *ww, const char *filepath)
+{
+  ChunkFileWriter *writer;
+
+  writer = BLO_chunkfile_writer_open(filepath, ww->reference_filepath);
+
+  if (writer != NULL) {
+    FILE_HANDLE(ww) = writer;
+    return true;
+  }
+  else {
+    return false;
+  }
+}
+static bool ww_close_chunked(WriteWrap *ww)
+{
+  ChunkFileWriteStats stats;
+  const bool ok = BLO_chunkfile_writer_close(FILE_HANDLE(ww), &stats);
+
+  if (G.debug & G_DEBUG_IO) {
+    printf("Chunked write: %u chunks (%u unchanged), %.2f MB -> %.2f MB\n",
+           stats.num_chunks,
+           stats.num_chunks_reused,
+           (double)stats.raw_size / (1024.0 * 1024.0),
+           (double)stats.file_size / (1024.0 * 1024.0));
+  }
+  return ok;
+}
+static size_t ww_write_chunked(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  return BLO_chunkfile_writer_write(FILE_HANDLE(ww), buf, buf_len) ? buf_len : 0;
+}
+static void ww_segment_end_chunked(WriteWrap *ww)
+{
+  BLO_chunkfile_writer_segment_end(FILE_HANDLE(ww));
+}
+#undef FILE_HANDLE
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
@@ -287,6 +336,14 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
       r_ww->use_buf = false;
       break;
     }
+    case WW_WRAP_CHUNKED: {
+      r_ww->open = ww_open_chunked;
+      r_ww->close = ww_close_chunked;
+      r_ww->write = ww_write_chunked;
+      r_ww->segment_end = ww_segment_end_chunked;
+      r_ww->use_buf = false;
+      break;
+    }
     default: {
       r_ww->open = ww_open_none;
       r_ww->close = ww_close_none;
@@ -399,6 +456,23 @@ static void mywrite_flush(WriteData *wd)
   }
 }
 
+/**
+ * Mark the end of a data-block, lets the #WriteWrap split compressed output at this point.
+ *
+ * For undo, each data-block gets its own chunks, so adding or removing one
+ * doesn't change the chunks of the data-blocks after it (which can then be shared).
+ */
+static void mywrite_segment_end(WriteData *wd)
+{
+  if (wd->use_memfile) {
+    mywrite_flush(wd);
+  }
+  else if (wd->ww && wd->ww->segment_end) {
+    mywrite_flush(wd);
+    wd->ww->segment_end(wd->ww);
+  }
+}
+
 /**
  * Low level WRITE(2) wrapper that buffers data
  * \param adr: Pointer to new chunk of data
@@ -3955,6 +4029,8 @@ static bool write_file_handle(Main *mainvar,
         if (do_override) {
           BKE_override_library_operations_store_end(override_storage, id);
         }
+
+        mywrite_segment_end(wd);
       }
 
       mywrite_flush(wd);
@@ -4066,7 +4142,10 @@ bool BLO_write_file(Main *mainvar,
   /* open temporary file, so we preserve the original in case we crash */
   BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
-  if (write_flags & G_FILE_COMPRESS) {
+  if (write_flags & G_FILE_COMPRESS_CHUNKED) {
+    ww_type = WW_WRAP_CHUNKED;
+  }
+  else if (write_flags & G_FILE_COMPRESS) {
     ww_type = WW_WRAP_ZLIB;
   }
   else {
@@ -4075,6 +4154,9 @@ bool BLO_write_file(Main *mainvar,
 
   ww_handle_init(ww_type, &ww);
 
+  /* Unchanged chunks can be copied from the file we're about to replace. */
+  ww.reference_filepath = filepath;
+
   if (ww.open(&ww, tempname) == false) {
     BKE_reportf(
         reports, RPT_ERROR, "Cannot open file %s for writing: %s", tempname, strerror(errno));
@@ -4117,9 +4199,12 @@ bool BLO_write_file(Main *mainvar,
   }
 
   /* actual file writing */
-  const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
+  bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
 
-  ww.close(&ww);
+  /* Chunked writing only flushes the last chunks on close. */
+  if (ww.close(&ww) == false) {
+    err = true;
+  }
 
   if (UNLIKELY(path_list_backup)) {
     BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
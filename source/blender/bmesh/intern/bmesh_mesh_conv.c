@@ -81,6 +81,7 @@
 #include "BLI_listbase.h"
 #include "BLI_alloca.h"
 #include "BLI_math_vector.h"
+#include "BLI_task.h"
 
 #include "BKE_mesh.h"
 #include "BKE_mesh_runtime.h"
@@ -555,16 +556,170 @@ BLI_INLINE void bmesh_quick_edgedraw_flag(MEdge *med, BMEdge *e)
   }
 }
 
+/* Number of elements converted by a task, custom-data is copied layer by layer for these. */
+#define BM_MESH_CONV_CHUNK_SIZE 1024
+
+/* Run \a func for every chunk of \a totelem elements. */
+static void bm_mesh_conv_chunks_parallel(void *userdata, int totelem, TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  settings.use_threading = (totelem >= BM_OMP_LIMIT);
+  BLI_task_parallel_range(0,
+                          (totelem + BM_MESH_CONV_CHUNK_SIZE - 1) / BM_MESH_CONV_CHUNK_SIZE,
+                          userdata,
+                          func,
+                          &settings);
+}
+
+typedef struct BMToMeshData {
+  BMesh *bm;
+  Mesh *me;
+
+  int cd_vert_bweight_offset;
+  int cd_edge_bweight_offset;
+  int cd_edge_crease_offset;
+} BMToMeshData;
+
+static void bm_mesh_bm_to_me_verts_cb(void *__restrict userdata,
+                                      const int chunk,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BMToMeshData *data = userdata;
+  BMesh *bm = data->bm;
+  Mesh *me = data->me;
+  const int start = chunk * BM_MESH_CONV_CHUNK_SIZE;
+  const int end = min_ii(start + BM_MESH_CONV_CHUNK_SIZE, bm->totvert);
+  void *blocks[BM_MESH_CONV_CHUNK_SIZE];
+
+  for (int i = start; i < end; i++) {
+    BMVert *v = bm->vtable[i];
+    MVert *mvert = &me->mvert[i];
+
+    copy_v3_v3(mvert->co, v->co);
+    normal_float_to_short_v3(mvert->no, v->no);
+
+    mvert->flag = BM_vert_flag_to_mflag(v);
+
+    BM_elem_index_set(v, i); /* set_inline */
+
+    if (data->cd_vert_bweight_offset != -1) {
+      mvert->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(v, data->cd_vert_bweight_offset);
+    }
+
+    blocks[i - start] = v->head.data;
+
+    BM_CHECK_ELEMENT(v);
+  }
+
+  /* Copy over custom-data. */
+  CustomData_from_bmesh_block_range(&bm->vdata, &me->vdata, blocks, start, end - start);
+}
+
+/* Runs once vertex indices are set. */
+static void bm_mesh_bm_to_me_edges_cb(void *__restrict userdata,
+                                      const int chunk,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BMToMeshData *data = userdata;
+  BMesh *bm = data->bm;
+  Mesh *me = data->me;
+  const int start = chunk * BM_MESH_CONV_CHUNK_SIZE;
+  const int end = min_ii(start + BM_MESH_CONV_CHUNK_SIZE, bm->totedge);
+  void *blocks[BM_MESH_CONV_CHUNK_SIZE];
+
+  for (int i = start; i < end; i++) {
+    BMEdge *e = bm->etable[i];
+    MEdge *med = &me->medge[i];
+
+    med->v1 = (uint)BM_elem_index_get(e->v1);
+    med->v2 = (uint)BM_elem_index_get(e->v2);
+
+    med->flag = BM_edge_flag_to_mflag(e);
+
+    BM_elem_index_set(e, i); /* set_inline */
+
+    bmesh_quick_edgedraw_flag(med, e);
+
+    if (data->cd_edge_crease_offset != -1) {
+      med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, data->cd_edge_crease_offset);
+    }
+    if (data->cd_edge_bweight_offset != -1) {
+      med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, data->cd_edge_bweight_offset);
+    }
+
+    blocks[i - start] = e->head.data;
+
+    BM_CHECK_ELEMENT(e);
+  }
+
+  /* Copy over custom-data. */
+  CustomData_from_bmesh_block_range(&bm->edata, &me->edata, blocks, start, end - start);
+}
+
+/* Runs once vertex and edge indices are set, and #MPoly.loopstart and totloop are known. */
+static void bm_mesh_bm_to_me_faces_cb(void *__restrict userdata,
+                                      const int chunk,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BMToMeshData *data = userdata;
+  BMesh *bm = data->bm;
+  Mesh *me = data->me;
+  const int start = chunk * BM_MESH_CONV_CHUNK_SIZE;
+  const int end = min_ii(start + BM_MESH_CONV_CHUNK_SIZE, bm->totface);
+  const int loop_start = me->mpoly[start].loopstart;
+  const int loop_end = me->mpoly[end - 1].loopstart + me->mpoly[end - 1].totloop;
+  void *blocks[BM_MESH_CONV_CHUNK_SIZE];
+  void **loop_blocks = MEM_mallocN(sizeof(void *) * (size_t)(loop_end - loop_start), __func__);
+
+  for (int i = start; i < end; i++) {
+    BMFace *f = bm->ftable[i];
+    MPoly *mpoly = &me->mpoly[i];
+    BMLoop *l_iter, *l_first;
+    int j = mpoly->loopstart;
+
+    mpoly->mat_nr = f->mat_nr;
+    mpoly->flag = BM_face_flag_to_mflag(f);
+
+    BM_elem_index_set(f, i); /* set_inline */
+
+    l_iter = l_first = BM_FACE_FIRST_LOOP(f);
+    do {
+      MLoop *mloop = &me->mloop[j];
+      mloop->e = (uint)BM_elem_index_get(l_iter->e);
+      mloop->v = (uint)BM_elem_index_get(l_iter->v);
+
+      BM_elem_index_set(l_iter, j); /* set_inline */
+
+      loop_blocks[j - loop_start] = l_iter->head.data;
+
+      j++;
+      BM_CHECK_ELEMENT(l_iter);
+      BM_CHECK_ELEMENT(l_iter->e);
+      BM_CHECK_ELEMENT(l_iter->v);
+    } while ((l_iter = l_iter->next) != l_first);
+
+    blocks[i - start] = f->head.data;
+
+    BM_CHECK_ELEMENT(f);
+  }
+
+  /* Copy over custom-data. */
+  CustomData_from_bmesh_block_range(
+      &bm->ldata, &me->ldata, loop_blocks, loop_start, loop_end - loop_start);
+  CustomData_from_bmesh_block_range(&bm->pdata, &me->pdata, blocks, start, end - start);
+
+  MEM_freeN(loop_blocks);
+}
+
 /**
  *
  * \param bmain: May be NULL in case \a calc_object_remap parameter option is not set.
  */
 void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMeshParams *params)
 {
-  MEdge *med;
-  BMVert *v, *eve;
-  BMEdge *e;
-  BMFace *f;
+  BMVert *eve;
   BMIter iter;
   int i, j;
 
@@ -583,7 +738,8 @@ void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMesh
 #if 0
   oldverts = MEM_dupallocN(me->mvert);
 #else
-    oldverts = me->mvert;
+    /* Evaluated copies may share the array, which would keep using it. */
+    oldverts = CustomData_duplicate_referenced_layer(&me->vdata, CD_MVERT, me->totvert);
     me->mvert = NULL;
     CustomData_update_typemap(&me->vdata);
     CustomData_set_layer(&me->vdata, CD_MVERT, NULL);
@@ -631,91 +787,33 @@ void BM_mesh_bm_to_me(Main *bmain, BMesh *bm, Mesh *me, const struct BMeshToMesh
   /* This is called again, 'dotess' arg is used there. */
   BKE_mesh_update_customdata_pointers(me, 0);
 
-  i = 0;
-  BM_ITER_MESH (v, &iter, bm, BM_VERTS_OF_MESH) {
-    copy_v3_v3(mvert->co, v->co);
-    normal_float_to_short_v3(mvert->no, v->no);
-
-    mvert->flag = BM_vert_flag_to_mflag(v);
-
-    BM_elem_index_set(v, i); /* set_inline */
-
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->vdata, &me->vdata, v->head.data, i);
-
-    if (cd_vert_bweight_offset != -1) {
-      mvert->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(v, cd_vert_bweight_offset);
-    }
+  /* Elements are converted in parallel, in the order of the element tables. */
+  BM_mesh_elem_table_ensure(bm, BM_VERT | BM_EDGE | BM_FACE);
 
-    i++;
-    mvert++;
+  BMToMeshData data = {
+      .bm = bm,
+      .me = me,
+      .cd_vert_bweight_offset = cd_vert_bweight_offset,
+      .cd_edge_bweight_offset = cd_edge_bweight_offset,
+      .cd_edge_crease_offset = cd_edge_crease_offset,
+  };
 
-    BM_CHECK_ELEMENT(v);
-  }
+  bm_mesh_conv_chunks_parallel(&data, bm->totvert, bm_mesh_bm_to_me_verts_cb);
   bm->elem_index_dirty &= ~BM_VERT;
 
-  med = medge;
-  i = 0;
-  BM_ITER_MESH (e, &iter, bm, BM_EDGES_OF_MESH) {
-    med->v1 = BM_elem_index_get(e->v1);
-    med->v2 = BM_elem_index_get(e->v2);
-
-    med->flag = BM_edge_flag_to_mflag(e);
-
-    BM_elem_index_set(e, i); /* set_inline */
-
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->edata, &me->edata, e->head.data, i);
-
-    bmesh_quick_edgedraw_flag(med, e);
-
-    if (cd_edge_crease_offset != -1) {
-      med->crease = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_crease_offset);
-    }
-    if (cd_edge_bweight_offset != -1) {
-      med->bweight = BM_ELEM_CD_GET_FLOAT_AS_UCHAR(e, cd_edge_bweight_offset);
-    }
-
-    i++;
-    med++;
-    BM_CHECK_ELEMENT(e);
-  }
+  bm_mesh_conv_chunks_parallel(&data, bm->totedge, bm_mesh_bm_to_me_edges_cb);
   bm->elem_index_dirty &= ~BM_EDGE;
 
-  i = 0;
-  j = 0;
-  BM_ITER_MESH (f, &iter, bm, BM_FACES_OF_MESH) {
-    BMLoop *l_iter, *l_first;
-    mpoly->loopstart = j;
-    mpoly->totloop = f->len;
-    mpoly->mat_nr = f->mat_nr;
-    mpoly->flag = BM_face_flag_to_mflag(f);
-
-    l_iter = l_first = BM_FACE_FIRST_LOOP(f);
-    do {
-      mloop->e = BM_elem_index_get(l_iter->e);
-      mloop->v = BM_elem_index_get(l_iter->v);
-
-      /* Copy over custom-data. */
-      CustomData_from_bmesh_block(&bm->ldata, &me->ldata, l_iter->head.data, j);
-
-      j++;
-      mloop++;
-      BM_CHECK_ELEMENT(l_iter);
-      BM_CHECK_ELEMENT(l_iter->e);
-      BM_CHECK_ELEMENT(l_iter->v);
-    } while ((l_iter = l_iter->next) != l_first);
-
-    if (f == bm->act_face) {
-      me->act_face = i;
-    }
-
-    /* Copy over custom-data. */
-    CustomData_from_bmesh_block(&bm->pdata, &me->pdata, f->head.data, i);
+  for (i = 0, j = 0; i < bm->totface; i++) {
+    mpoly[i].loopstart = j;
+    mpoly[i].totloop = bm->ftable[i]->len;
+    j += bm->ftable[i]->len;
+  }
+  bm_mesh_conv_chunks_parallel(&data, bm->totface, bm_mesh_bm_to_me_faces_cb);
+  bm->elem_index_dirty &= ~(BM_FACE | BM_LOOP);
 
-    i++;
-    mpoly++;
-    BM_CHECK_ELEMENT(f);
+  if (bm->act_face) {
+    me->act_face = BM_elem_index_get(bm->act_face);
   }
 
   /* Patch hook indices and vertex parents. */
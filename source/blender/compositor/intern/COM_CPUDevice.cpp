@@ -18,6 +18,10 @@
 
 #include "COM_CPUDevice.h"
 
+#include "BLI_trace.h"
+
+#include "PIL_time.h"
+
 CPUDevice::CPUDevice(int thread_id) : Device(), m_thread_id(thread_id)
 {
 }
@@ -27,10 +31,18 @@ void CPUDevice::execute(WorkPackage *work)
   const unsigned int chunkNumber = work->getChunkNumber();
   ExecutionGroup *executionGroup = work->getExecutionGroup();
   rcti rect;
+  const bool do_trace = BLI_trace_is_recording();
+  const double start_time = do_trace ? PIL_check_seconds_timer() : 0.0;
 
   executionGroup->determineChunkRect(&rect, chunkNumber);
 
   executionGroup->getOutputOperation()->executeRegion(&rect, chunkNumber);
 
+  if (do_trace) {
+    const int ids[1] = {(int)chunkNumber};
+    BLI_trace_span_add_ids(
+        "compositor", "Chunk %d", ids, 1, start_time, PIL_check_seconds_timer());
+  }
+
   executionGroup->finalizeChunkExecution(chunkNumber, NULL);
 }
@@ -264,6 +264,10 @@ class CompositorContext {
   {
     return this->m_fastCalculation;
   }
+  bool isFullFrame() const
+  {
+    return (this->getbNodeTree()->flag & NTREE_COM_FULL_FRAME) != 0;
+  }
   bool isGroupnodeBufferEnabled() const
   {
     return (this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER) != 0;
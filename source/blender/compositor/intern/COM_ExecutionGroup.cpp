@@ -36,6 +36,7 @@
 #include "MEM_guardedalloc.h"
 #include "BLI_math.h"
 #include "BLI_string.h"
+#include "BLI_trace.h"
 #include "BLT_translation.h"
 #include "PIL_time.h"
 #include "WM_api.h"
@@ -367,10 +368,61 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
   }
   DebugInfo::execution_group_finished(this);
   DebugInfo::graphviz(graph);
+  traceExecution();
 
   MEM_freeN(chunkOrder);
 }
 
+void ExecutionGroup::traceExecution()
+{
+  if (!BLI_trace_is_recording()) {
+    return;
+  }
+  const int ids[3] = {(int)this->m_width, (int)this->m_height, (int)this->m_numberOfChunks};
+  BLI_trace_span_add_ids("compositor",
+                         "Execution Group %dx%d, %d chunks",
+                         ids,
+                         3,
+                         this->m_executionStartTime,
+                         PIL_check_seconds_timer());
+}
+
+void ExecutionGroup::executeFullFrame(ExecutionSystem *graph)
+{
+  const CompositorContext &context = graph->getContext();
+  const bNodeTree *bTree = context.getbNodeTree();
+  if (this->m_width == 0 || this->m_height == 0 || this->m_numberOfChunks == 0) {
+    return;
+  }
+  if (bTree->test_break && bTree->test_break(bTree->tbh)) {
+    return;
+  }
+
+  this->m_executionStartTime = PIL_check_seconds_timer();
+  this->m_chunksFinished = 0;
+  this->m_bTree = bTree;
+
+  DebugInfo::execution_group_started(this);
+
+  /* All inputs are available, chunks only split the work between the devices. */
+  unsigned int chunkNumber;
+  for (chunkNumber = 0; chunkNumber < this->m_numberOfChunks; chunkNumber++) {
+    scheduleChunk(chunkNumber);
+  }
+
+  /* The work queue is empty before the last chunks are finished, wait for all of them so the
+   * input buffers can be freed afterwards. */
+  WorkScheduler::wait_executed();
+  BLI_assert(this->m_chunksFinished == this->m_numberOfChunks);
+
+  if (bTree->update_draw) {
+    bTree->update_draw(bTree->udh);
+  }
+
+  DebugInfo::execution_group_finished(this);
+  traceExecution();
+}
+
 MemoryBuffer **ExecutionGroup::getInputBuffersOpenCL(int chunkNumber)
 {
   rcti rect;
@@ -248,6 +248,11 @@ class ExecutionGroup {
                                         ReadBufferOperation *readOperation,
                                         rcti *output);
 
+  /**
+   * \brief add the execution of this group to the trace, when recording
+   */
+  void traceExecution();
+
  public:
   // constructors
   ExecutionGroup();
@@ -396,6 +401,16 @@ class ExecutionGroup {
    */
   void execute(ExecutionSystem *system);
 
+  /**
+   * \brief calculate all chunks of this ExecutionGroup at once
+   * \note the ExecutionGroup's this group depends on must have been executed before,
+   * so no dependencies between chunks need to be resolved.
+   * This method will return when all chunks have been calculated.
+   * \see ExecutionSystem.executeGroupFullFrame
+   * \param system:
+   */
+  void executeFullFrame(ExecutionSystem *system);
+
   /**
    * \brief this method determines the MemoryProxy's where this execution group depends on.
    * \note After this method determineDependingAreaOfInterest can be called to determine
@@ -180,10 +180,32 @@ void ExecutionSystem::execute()
 
   WorkScheduler::start(this->m_context);
 
-  executeGroups(COM_PRIORITY_HIGH);
-  if (!this->getContext().isFastCalculation()) {
-    executeGroups(COM_PRIORITY_MEDIUM);
-    executeGroups(COM_PRIORITY_LOW);
+  if (this->m_context.isFullFrame()) {
+    std::set<ExecutionGroup *> executedGroups;
+    std::map<MemoryProxy *, int> bufferReaders;
+    for (index = 0; index < this->m_groups.size(); index++) {
+      vector<MemoryProxy *> memoryProxies;
+      this->m_groups[index]->determineDependingMemoryProxies(&memoryProxies);
+      std::set<MemoryProxy *> uniqueMemoryProxies(memoryProxies.begin(), memoryProxies.end());
+      for (std::set<MemoryProxy *>::iterator iter = uniqueMemoryProxies.begin();
+           iter != uniqueMemoryProxies.end();
+           ++iter) {
+        bufferReaders[*iter]++;
+      }
+    }
+
+    executeGroupsFullFrame(COM_PRIORITY_HIGH, executedGroups, bufferReaders);
+    if (!this->getContext().isFastCalculation()) {
+      executeGroupsFullFrame(COM_PRIORITY_MEDIUM, executedGroups, bufferReaders);
+      executeGroupsFullFrame(COM_PRIORITY_LOW, executedGroups, bufferReaders);
+    }
+  }
+  else {
+    executeGroups(COM_PRIORITY_HIGH);
+    if (!this->getContext().isFastCalculation()) {
+      executeGroups(COM_PRIORITY_MEDIUM);
+      executeGroups(COM_PRIORITY_LOW);
+    }
   }
 
   WorkScheduler::finish();
@@ -212,6 +234,61 @@ void ExecutionSystem::executeGroups(CompositorPriority priority)
   }
 }
 
+void ExecutionSystem::executeGroupsFullFrame(CompositorPriority priority,
+                                             std::set<ExecutionGroup *> &executedGroups,
+                                             std::map<MemoryProxy *, int> &bufferReaders)
+{
+  unsigned int index;
+  vector<ExecutionGroup *> executionGroups;
+  this->findOutputExecutionGroup(&executionGroups, priority);
+
+  for (index = 0; index < executionGroups.size(); index++) {
+    ExecutionGroup *group = executionGroups[index];
+    if (!executeGroupFullFrame(group, executedGroups, bufferReaders)) {
+      break;
+    }
+  }
+}
+
+bool ExecutionSystem::executeGroupFullFrame(ExecutionGroup *group,
+                                            std::set<ExecutionGroup *> &executedGroups,
+                                            std::map<MemoryProxy *, int> &bufferReaders)
+{
+  if (executedGroups.count(group)) {
+    return true;
+  }
+
+  vector<MemoryProxy *> memoryProxies;
+  group->determineDependingMemoryProxies(&memoryProxies);
+  std::set<MemoryProxy *> uniqueMemoryProxies(memoryProxies.begin(), memoryProxies.end());
+
+  /* Depth first, so all input buffers are complete when the group is executed. */
+  for (std::set<MemoryProxy *>::iterator iter = uniqueMemoryProxies.begin();
+       iter != uniqueMemoryProxies.end();
+       ++iter) {
+    if (!executeGroupFullFrame((*iter)->getExecutor(), executedGroups, bufferReaders)) {
+      return false;
+    }
+  }
+
+  const bNodeTree *editingtree = this->m_context.getbNodeTree();
+  if (editingtree->test_break && editingtree->test_break(editingtree->tbh)) {
+    return false;
+  }
+
+  group->executeFullFrame(this);
+  executedGroups.insert(group);
+
+  for (std::set<MemoryProxy *>::iterator iter = uniqueMemoryProxies.begin();
+       iter != uniqueMemoryProxies.end();
+       ++iter) {
+    if (--bufferReaders[*iter] == 0) {
+      (*iter)->free();
+    }
+  }
+  return true;
+}
+
 void ExecutionSystem::findOutputExecutionGroup(vector<ExecutionGroup *> *result,
                                                CompositorPriority priority) const
 {
@@ -28,6 +28,9 @@ class ExecutionGroup;
 #include "COM_ExecutionGroup.h"
 #include "COM_NodeOperation.h"
 
+#include <map>
+#include <set>
+
 /**
  * \page execution Execution model
  * In order to get to an efficient model for execution, several steps are being done. these steps
@@ -108,6 +111,14 @@ class ExecutionGroup;
  * \see ExecutionSystem.addReadWriteBufferOperations
  * \see NodeOperation.isComplex
  * \see ExecutionGroup class representing the ExecutionGroup
+ *
+ * \section EM_FullFrame Full frame execution
+ * By default the chunks of the output groups are scheduled, and the chunks of the groups they
+ * depend on are scheduled on demand for the area of interest.
+ * When NTREE_COM_FULL_FRAME is set every group is executed for its full frame, after the groups
+ * it depends on. The chunks of a group are then only used to spread the work over the devices,
+ * and buffers are freed when the last group reading them has been executed.
+ * \see ExecutionSystem.executeGroupFullFrame
  */
 
 /**
@@ -189,6 +200,20 @@ class ExecutionSystem {
  private:
   void executeGroups(CompositorPriority priority);
 
+  /**
+   * \brief execute the output groups of a priority a full frame at a time
+   * Groups are executed after the groups they depend on, buffers are freed as soon as all
+   * groups reading them have been executed.
+   * \param executedGroups: groups which have been executed, skipped when needed again
+   * \param bufferReaders: number of groups that still have to read each buffer
+   */
+  void executeGroupsFullFrame(CompositorPriority priority,
+                              std::set<ExecutionGroup *> &executedGroups,
+                              std::map<MemoryProxy *, int> &bufferReaders);
+  bool executeGroupFullFrame(ExecutionGroup *group,
+                             std::set<ExecutionGroup *> &executedGroups,
+                             std::map<MemoryProxy *, int> &bufferReaders);
+
   /* allow the DebugInfo class to look at internals */
   friend class DebugInfo;
 
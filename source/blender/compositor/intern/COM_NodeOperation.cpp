@@ -150,6 +150,37 @@ NodeOperation *NodeOperation::getInputOperation(unsigned int inputSocketIndex)
   }
 }
 
+void NodeOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  const rcti *output_rect = output->getRect();
+  const int num_channels = output->get_num_channels();
+  float *buffer = output->getBuffer();
+  float color[4];
+
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    float *row = buffer + ((y - output_rect->ymin) * output->getWidth() +
+                           (rect->xmin - output_rect->xmin)) *
+                              num_channels;
+    for (int x = rect->xmin; x < rect->xmax; x++) {
+      /* Read to a full color, operations with fewer channels may still write all four. */
+      this->readSampled(color, x, y, COM_PS_NEAREST);
+      memcpy(row, color, sizeof(float) * num_channels);
+      row += num_channels;
+    }
+  }
+}
+
+MemoryBuffer *NodeOperation::readInputRect(unsigned int inputSocketIndex, const rcti *rect)
+{
+  NodeOperation *operation = this->getInputOperation(inputSocketIndex);
+  BLI_assert(operation != NULL);
+  rcti buffer_rect = *rect;
+  MemoryBuffer *buffer = new MemoryBuffer(this->getInputSocket(inputSocketIndex)->getDataType(),
+                                          &buffer_rect);
+  operation->executeRect(buffer, rect);
+  return buffer;
+}
+
 void NodeOperation::getConnectedInputSockets(Inputs *sockets)
 {
   for (Inputs::const_iterator it = m_inputs.begin(); it != m_inputs.end(); ++it) {
@@ -203,6 +203,27 @@ class NodeOperation : public SocketReader {
   {
   }
 
+  /**
+   * \brief calculate all pixels of a rectangle at once
+   * \ingroup execution
+   *
+   * Buffer operations (see #isBufferOperation) override this to process whole rows at once,
+   * reading their inputs with #readInputRect.
+   * The default implementation calls #executePixelSampled for every pixel.
+   * \param output: the buffer to write to, its rect must contain \a rect
+   * \param rect: the area to calculate
+   */
+  virtual void executeRect(MemoryBuffer *output, const rcti *rect);
+
+  /**
+   * \brief does this operation implement #executeRect with a buffer-level kernel
+   * \note only non-complex operations can be buffer operations.
+   */
+  virtual bool isBufferOperation() const
+  {
+    return false;
+  }
+
   /**
    * \brief when a chunk is executed by an OpenCLDevice, this method is called
    * \ingroup execution
@@ -399,6 +420,12 @@ class NodeOperation : public SocketReader {
   SocketReader *getInputSocketReader(unsigned int inputSocketindex);
   NodeOperation *getInputOperation(unsigned int inputSocketindex);
 
+  /**
+   * \brief calculate an input of this operation for a rectangle
+   * \return a temporary MemoryBuffer of the input socket data type, owned by the caller
+   */
+  MemoryBuffer *readInputRect(unsigned int inputSocketindex, const rcti *rect);
+
   void deinitMutex();
   void initMutex();
   void lockMutex();
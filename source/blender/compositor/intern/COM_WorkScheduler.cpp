@@ -55,6 +55,10 @@ static bool g_cpuInitialized = false;
 /// \brief all scheduled work for the cpu
 static ThreadQueue *g_cpuqueue;
 static ThreadQueue *g_gpuqueue;
+/// \brief number of scheduled work packages that are not executed yet
+static int g_work_pending = 0;
+static ThreadMutex g_work_mutex;
+static ThreadCondition g_work_executed_cond;
 #  ifdef COM_OPENCL_ENABLED
 static cl_context g_context;
 static cl_program g_program;
@@ -72,6 +76,16 @@ static bool g_openclInitialized = false;
 #endif
 
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+static void work_executed()
+{
+  BLI_mutex_lock(&g_work_mutex);
+  g_work_pending--;
+  if (g_work_pending == 0) {
+    BLI_condition_notify_all(&g_work_executed_cond);
+  }
+  BLI_mutex_unlock(&g_work_mutex);
+}
+
 void *WorkScheduler::thread_execute_cpu(void *data)
 {
   CPUDevice *device = (CPUDevice *)data;
@@ -80,6 +94,7 @@ void *WorkScheduler::thread_execute_cpu(void *data)
   while ((work = (WorkPackage *)BLI_thread_queue_pop(g_cpuqueue))) {
     device->execute(work);
     delete work;
+    work_executed();
   }
 
   return NULL;
@@ -93,6 +108,7 @@ void *WorkScheduler::thread_execute_gpu(void *data)
   while ((work = (WorkPackage *)BLI_thread_queue_pop(g_gpuqueue))) {
     device->execute(work);
     delete work;
+    work_executed();
   }
 
   return NULL;
@@ -107,6 +123,9 @@ void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
   device.execute(package);
   delete package;
 #elif COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+  BLI_mutex_lock(&g_work_mutex);
+  g_work_pending++;
+  BLI_mutex_unlock(&g_work_mutex);
 #  ifdef COM_OPENCL_ENABLED
   if (group->isOpenCL() && g_openclActive) {
     BLI_thread_queue_push(g_gpuqueue, package);
@@ -124,6 +143,9 @@ void WorkScheduler::start(CompositorContext &context)
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
   unsigned int index;
+  g_work_pending = 0;
+  BLI_mutex_init(&g_work_mutex);
+  BLI_condition_init(&g_work_executed_cond);
   g_cpuqueue = BLI_thread_queue_init();
   BLI_threadpool_init(&g_cputhreads, thread_execute_cpu, g_cpudevices.size());
   for (index = 0; index < g_cpudevices.size(); index++) {
@@ -162,6 +184,16 @@ void WorkScheduler::finish()
 #  endif
 #endif
 }
+void WorkScheduler::wait_executed()
+{
+#if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+  BLI_mutex_lock(&g_work_mutex);
+  while (g_work_pending > 0) {
+    BLI_condition_wait(&g_work_executed_cond, &g_work_mutex);
+  }
+  BLI_mutex_unlock(&g_work_mutex);
+#endif
+}
 void WorkScheduler::stop()
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
@@ -177,6 +209,8 @@ void WorkScheduler::stop()
     g_gpuqueue = NULL;
   }
 #  endif
+  BLI_condition_end(&g_work_executed_cond);
+  BLI_mutex_end(&g_work_mutex);
 #endif
 }
 
@@ -102,6 +102,14 @@ class WorkScheduler {
    */
   static void finish();
 
+  /**
+   * \brief wait until all scheduled work packages are executed.
+   *
+   * Unlike finish, which returns once the queues are empty, this blocks until the last popped
+   * work package is done as well.
+   */
+  static void wait_executed();
+
   /**
    * \brief Are there OpenCL capable GPU devices initialized?
    * the result of this method is stored in the CompositorContext
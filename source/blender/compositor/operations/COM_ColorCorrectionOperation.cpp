@@ -40,16 +40,10 @@ void ColorCorrectionOperation::initExecution()
   this->m_inputMask = this->getInputSocketReader(1);
 }
 
-void ColorCorrectionOperation::executePixelSampled(float output[4],
-                                                   float x,
-                                                   float y,
-                                                   PixelSampler sampler)
+void ColorCorrectionOperation::correctPixel(float output[4],
+                                            const float inputImageColor[4],
+                                            float mask) const
 {
-  float inputImageColor[4];
-  float inputMask[4];
-  this->m_inputImage->readSampled(inputImageColor, x, y, sampler);
-  this->m_inputMask->readSampled(inputMask, x, y, sampler);
-
   float level = (inputImageColor[0] + inputImageColor[1] + inputImageColor[2]) / 3.0f;
   float contrast = this->m_data->master.contrast;
   float saturation = this->m_data->master.saturation;
@@ -58,7 +52,7 @@ void ColorCorrectionOperation::executePixelSampled(float output[4],
   float lift = this->m_data->master.lift;
   float r, g, b;
 
-  float value = inputMask[0];
+  float value = mask;
   value = min(1.0f, value);
   const float mvalue = 1.0f - value;
 
@@ -147,6 +141,41 @@ void ColorCorrectionOperation::executePixelSampled(float output[4],
   output[3] = inputImageColor[3];
 }
 
+void ColorCorrectionOperation::executePixelSampled(float output[4],
+                                                   float x,
+                                                   float y,
+                                                   PixelSampler sampler)
+{
+  float inputImageColor[4];
+  float inputMask[4];
+  this->m_inputImage->readSampled(inputImageColor, x, y, sampler);
+  this->m_inputMask->readSampled(inputMask, x, y, sampler);
+  correctPixel(output, inputImageColor, inputMask[0]);
+}
+
+void ColorCorrectionOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  MemoryBuffer *inputImage = this->readInputRect(0, rect);
+  MemoryBuffer *inputMask = this->readInputRect(1, rect);
+
+  const rcti *output_rect = output->getRect();
+  const int width = BLI_rcti_size_x(rect);
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    const int row_offset = (y - rect->ymin) * width;
+    const float *color = inputImage->getBuffer() + row_offset * 4;
+    const float *mask = inputMask->getBuffer() + row_offset;
+    float *row = output->getBuffer() + ((y - output_rect->ymin) * output->getWidth() +
+                                        (rect->xmin - output_rect->xmin)) *
+                                           4;
+    for (int i = 0; i < width; i++, row += 4, color += 4) {
+      correctPixel(row, color, mask[i]);
+    }
+  }
+
+  delete inputImage;
+  delete inputMask;
+}
+
 void ColorCorrectionOperation::deinitExecution()
 {
   this->m_inputImage = NULL;
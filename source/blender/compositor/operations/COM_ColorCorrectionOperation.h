@@ -33,6 +33,8 @@ class ColorCorrectionOperation : public NodeOperation {
   bool m_greenChannelEnabled;
   bool m_blueChannelEnabled;
 
+  inline void correctPixel(float output[4], const float inputImageColor[4], float mask) const;
+
  public:
   ColorCorrectionOperation();
 
@@ -41,6 +43,12 @@ class ColorCorrectionOperation : public NodeOperation {
    */
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 
+  void executeRect(MemoryBuffer *output, const rcti *rect);
+  bool isBufferOperation() const
+  {
+    return true;
+  }
+
   /**
    * Initialize the execution
    */
@@ -22,9 +22,141 @@ extern "C" {
 #include "IMB_colormanagement.h"
 }
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+/* ******** Convert Row Kernels ******** */
+
+/* The SSE2 loops process four pixels at once. They do the same operations in the same order as
+ * the per pixel functions, so results are the same bit for bit. Vectors are three floats, so
+ * reading or writing four floats at once only happens where a next pixel follows in the row. */
+
+static void convert_value_to_color_row(float *output, const float *input, int width)
+{
+  for (int i = 0; i < width; i++, output += 4) {
+#ifdef __SSE2__
+    _mm_storeu_ps(output, _mm_set_ps(1.0f, input[i], input[i], input[i]));
+#else
+    output[0] = output[1] = output[2] = input[i];
+    output[3] = 1.0f;
+#endif
+  }
+}
+
+static void convert_color_to_value_row(float *output, const float *input, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 third = _mm_set1_ps(3.0f);
+  for (; i + 4 <= width; i += 4, input += 16) {
+    __m128 r = _mm_loadu_ps(&input[0]);
+    __m128 g = _mm_loadu_ps(&input[4]);
+    __m128 b = _mm_loadu_ps(&input[8]);
+    __m128 a = _mm_loadu_ps(&input[12]);
+    _MM_TRANSPOSE4_PS(r, g, b, a);
+    _mm_storeu_ps(&output[i], _mm_div_ps(_mm_add_ps(_mm_add_ps(r, g), b), third));
+  }
+#endif
+  for (; i < width; i++, input += 4) {
+    output[i] = (input[0] + input[1] + input[2]) / 3.0f;
+  }
+}
+
+static void convert_color_to_bw_row(float *output, const float *input, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  /* Coefficients of the luminance, exactly as multiplied by IMB_colormanagement_get_luminance. */
+  const float unit_rgb[3][3] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+  const __m128 coefficient_r = _mm_set1_ps(IMB_colormanagement_get_luminance(unit_rgb[0]));
+  const __m128 coefficient_g = _mm_set1_ps(IMB_colormanagement_get_luminance(unit_rgb[1]));
+  const __m128 coefficient_b = _mm_set1_ps(IMB_colormanagement_get_luminance(unit_rgb[2]));
+  for (; i + 4 <= width; i += 4, input += 16) {
+    __m128 r = _mm_loadu_ps(&input[0]);
+    __m128 g = _mm_loadu_ps(&input[4]);
+    __m128 b = _mm_loadu_ps(&input[8]);
+    __m128 a = _mm_loadu_ps(&input[12]);
+    _MM_TRANSPOSE4_PS(r, g, b, a);
+    const __m128 rg = _mm_add_ps(_mm_mul_ps(coefficient_r, r), _mm_mul_ps(coefficient_g, g));
+    _mm_storeu_ps(&output[i], _mm_add_ps(rg, _mm_mul_ps(coefficient_b, b)));
+  }
+#endif
+  for (; i < width; i++, input += 4) {
+    output[i] = IMB_colormanagement_get_luminance(input);
+  }
+}
+
+static void convert_color_to_vector_row(float *output, const float *input, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  /* The fourth float is overwritten by the next pixel. */
+  for (; i + 1 < width; i++, output += 3, input += 4) {
+    _mm_storeu_ps(output, _mm_loadu_ps(input));
+  }
+#endif
+  for (; i < width; i++, output += 3, input += 4) {
+    copy_v3_v3(output, input);
+  }
+}
+
+static void convert_value_to_vector_row(float *output, const float *input, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  /* The fourth float is overwritten by the next pixel. */
+  for (; i + 1 < width; i++, output += 3) {
+    _mm_storeu_ps(output, _mm_set1_ps(input[i]));
+  }
+#endif
+  for (; i < width; i++, output += 3) {
+    output[0] = output[1] = output[2] = input[i];
+  }
+}
+
+static void convert_vector_to_color_row(float *output, const float *input, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 one = _mm_set1_ps(1.0f);
+  /* The fourth float read belongs to the next pixel, it's replaced by the alpha. */
+  for (; i + 1 < width; i++, output += 4, input += 3) {
+    const __m128 vector = _mm_loadu_ps(input);
+    _mm_storeu_ps(output,
+                  _mm_shuffle_ps(vector, _mm_unpackhi_ps(vector, one), _MM_SHUFFLE(1, 0, 1, 0)));
+  }
+#endif
+  for (; i < width; i++, output += 4, input += 3) {
+    copy_v3_v3(output, input);
+    output[3] = 1.0f;
+  }
+}
+
+static void convert_vector_to_value_row(float *output, const float *input, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 third = _mm_set1_ps(3.0f);
+  /* The fourth float read of the last of the four pixels belongs to the next pixel. */
+  for (; i + 4 < width; i += 4, input += 12) {
+    __m128 x = _mm_loadu_ps(&input[0]);
+    __m128 y = _mm_loadu_ps(&input[3]);
+    __m128 z = _mm_loadu_ps(&input[6]);
+    __m128 w = _mm_loadu_ps(&input[9]);
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(&output[i], _mm_div_ps(_mm_add_ps(_mm_add_ps(x, y), z), third));
+  }
+#endif
+  for (; i < width; i++, input += 3) {
+    output[i] = (input[0] + input[1] + input[2]) / 3.0f;
+  }
+}
+
 ConvertBaseOperation::ConvertBaseOperation()
 {
   this->m_inputOperation = NULL;
+  this->m_rowFunction = NULL;
 }
 
 void ConvertBaseOperation::initExecution()
@@ -37,12 +169,36 @@ void ConvertBaseOperation::deinitExecution()
   this->m_inputOperation = NULL;
 }
 
+void ConvertBaseOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  if (this->m_rowFunction == NULL) {
+    NodeOperation::executeRect(output, rect);
+    return;
+  }
+
+  MemoryBuffer *input = this->readInputRect(0, rect);
+
+  const rcti *output_rect = output->getRect();
+  const int width = BLI_rcti_size_x(rect);
+  const int num_channels = output->get_num_channels();
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    float *row = output->getBuffer() + ((y - output_rect->ymin) * output->getWidth() +
+                                        (rect->xmin - output_rect->xmin)) *
+                                           num_channels;
+    this->m_rowFunction(
+        row, input->getBuffer() + (y - rect->ymin) * width * input->get_num_channels(), width);
+  }
+
+  delete input;
+}
+
 /* ******** Value to Color ******** */
 
 ConvertValueToColorOperation::ConvertValueToColorOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_COLOR);
+  this->m_rowFunction = convert_value_to_color_row;
 }
 
 void ConvertValueToColorOperation::executePixelSampled(float output[4],
@@ -62,6 +218,7 @@ ConvertColorToValueOperation::ConvertColorToValueOperation() : ConvertBaseOperat
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->m_rowFunction = convert_color_to_value_row;
 }
 
 void ConvertColorToValueOperation::executePixelSampled(float output[4],
@@ -80,6 +237,7 @@ ConvertColorToBWOperation::ConvertColorToBWOperation() : ConvertBaseOperation()
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->m_rowFunction = convert_color_to_bw_row;
 }
 
 void ConvertColorToBWOperation::executePixelSampled(float output[4],
@@ -98,6 +256,7 @@ ConvertColorToVectorOperation::ConvertColorToVectorOperation() : ConvertBaseOper
 {
   this->addInputSocket(COM_DT_COLOR);
   this->addOutputSocket(COM_DT_VECTOR);
+  this->m_rowFunction = convert_color_to_vector_row;
 }
 
 void ConvertColorToVectorOperation::executePixelSampled(float output[4],
@@ -116,6 +275,7 @@ ConvertValueToVectorOperation::ConvertValueToVectorOperation() : ConvertBaseOper
 {
   this->addInputSocket(COM_DT_VALUE);
   this->addOutputSocket(COM_DT_VECTOR);
+  this->m_rowFunction = convert_value_to_vector_row;
 }
 
 void ConvertValueToVectorOperation::executePixelSampled(float output[4],
@@ -134,6 +294,7 @@ ConvertVectorToColorOperation::ConvertVectorToColorOperation() : ConvertBaseOper
 {
   this->addInputSocket(COM_DT_VECTOR);
   this->addOutputSocket(COM_DT_COLOR);
+  this->m_rowFunction = convert_vector_to_color_row;
 }
 
 void ConvertVectorToColorOperation::executePixelSampled(float output[4],
@@ -151,6 +312,7 @@ ConvertVectorToValueOperation::ConvertVectorToValueOperation() : ConvertBaseOper
 {
   this->addInputSocket(COM_DT_VECTOR);
   this->addOutputSocket(COM_DT_VALUE);
+  this->m_rowFunction = convert_vector_to_value_row;
 }
 
 void ConvertVectorToValueOperation::executePixelSampled(float output[4],
@@ -22,14 +22,31 @@
 #include "COM_NodeOperation.h"
 
 class ConvertBaseOperation : public NodeOperation {
+ public:
+  /**
+   * Convert a row of \a width pixels.
+   */
+  typedef void (*ConvertRowFunction)(float *output, const float *input, int width);
+
  protected:
   SocketReader *m_inputOperation;
 
+  /**
+   * Kernel used by #executeRect, NULL when the conversion only supports per pixel execution.
+   */
+  ConvertRowFunction m_rowFunction;
+
  public:
   ConvertBaseOperation();
 
   void initExecution();
   void deinitExecution();
+
+  void executeRect(MemoryBuffer *output, const rcti *rect);
+  bool isBufferOperation() const
+  {
+    return this->m_rowFunction != NULL;
+  }
 };
 
 class ConvertValueToColorOperation : public ConvertBaseOperation {
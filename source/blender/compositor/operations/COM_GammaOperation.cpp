@@ -33,6 +33,16 @@ void GammaOperation::initExecution()
   this->m_inputGammaProgram = this->getInputSocketReader(1);
 }
 
+static inline void gamma_correct(float output[4], const float inputValue[4], const float gamma)
+{
+  /* check for negative to avoid nan's */
+  output[0] = inputValue[0] > 0.0f ? powf(inputValue[0], gamma) : inputValue[0];
+  output[1] = inputValue[1] > 0.0f ? powf(inputValue[1], gamma) : inputValue[1];
+  output[2] = inputValue[2] > 0.0f ? powf(inputValue[2], gamma) : inputValue[2];
+
+  output[3] = inputValue[3];
+}
+
 void GammaOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
   float inputValue[4];
@@ -40,13 +50,30 @@ void GammaOperation::executePixelSampled(float output[4], float x, float y, Pixe
 
   this->m_inputProgram->readSampled(inputValue, x, y, sampler);
   this->m_inputGammaProgram->readSampled(inputGamma, x, y, sampler);
-  const float gamma = inputGamma[0];
-  /* check for negative to avoid nan's */
-  output[0] = inputValue[0] > 0.0f ? powf(inputValue[0], gamma) : inputValue[0];
-  output[1] = inputValue[1] > 0.0f ? powf(inputValue[1], gamma) : inputValue[1];
-  output[2] = inputValue[2] > 0.0f ? powf(inputValue[2], gamma) : inputValue[2];
+  gamma_correct(output, inputValue, inputGamma[0]);
+}
 
-  output[3] = inputValue[3];
+void GammaOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  MemoryBuffer *inputValue = this->readInputRect(0, rect);
+  MemoryBuffer *inputGamma = this->readInputRect(1, rect);
+
+  const rcti *output_rect = output->getRect();
+  const int width = BLI_rcti_size_x(rect);
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    const int row_offset = (y - rect->ymin) * width;
+    const float *color = inputValue->getBuffer() + row_offset * 4;
+    const float *gamma = inputGamma->getBuffer() + row_offset;
+    float *row = output->getBuffer() + ((y - output_rect->ymin) * output->getWidth() +
+                                        (rect->xmin - output_rect->xmin)) *
+                                           4;
+    for (int i = 0; i < width; i++, row += 4, color += 4) {
+      gamma_correct(row, color, gamma[i]);
+    }
+  }
+
+  delete inputValue;
+  delete inputGamma;
 }
 
 void GammaOperation::deinitExecution()
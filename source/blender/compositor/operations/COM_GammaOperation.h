@@ -36,6 +36,12 @@ class GammaOperation : public NodeOperation {
    */
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 
+  void executeRect(MemoryBuffer *output, const rcti *rect);
+  bool isBufferOperation() const
+  {
+    return true;
+  }
+
   /**
    * Initialize the execution
    */
@@ -21,6 +21,118 @@ extern "C" {
 #include "BLI_math.h"
 }
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+/* ******** Math Row Kernels ******** */
+
+/* Process four values per register, the remainder of the row one by one. */
+
+static void math_add_row(float *output, const float *value1, const float *value2, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  for (; i + 4 <= width; i += 4) {
+    _mm_storeu_ps(&output[i],
+                  _mm_add_ps(_mm_loadu_ps(&value1[i]), _mm_loadu_ps(&value2[i])));
+  }
+#endif
+  for (; i < width; i++) {
+    output[i] = value1[i] + value2[i];
+  }
+}
+
+static void math_subtract_row(float *output, const float *value1, const float *value2, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  for (; i + 4 <= width; i += 4) {
+    _mm_storeu_ps(&output[i],
+                  _mm_sub_ps(_mm_loadu_ps(&value1[i]), _mm_loadu_ps(&value2[i])));
+  }
+#endif
+  for (; i < width; i++) {
+    output[i] = value1[i] - value2[i];
+  }
+}
+
+static void math_multiply_row(float *output, const float *value1, const float *value2, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  for (; i + 4 <= width; i += 4) {
+    _mm_storeu_ps(&output[i],
+                  _mm_mul_ps(_mm_loadu_ps(&value1[i]), _mm_loadu_ps(&value2[i])));
+  }
+#endif
+  for (; i < width; i++) {
+    output[i] = value1[i] * value2[i];
+  }
+}
+
+static void math_divide_row(float *output, const float *value1, const float *value2, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= width; i += 4) {
+    const __m128 divisor = _mm_loadu_ps(&value2[i]);
+    const __m128 result = _mm_div_ps(_mm_loadu_ps(&value1[i]), divisor);
+    /* We don't want to divide by zero. */
+    _mm_storeu_ps(&output[i], _mm_andnot_ps(_mm_cmpeq_ps(divisor, zero), result));
+  }
+#endif
+  for (; i < width; i++) {
+    output[i] = (value2[i] == 0) ? 0.0f : value1[i] / value2[i];
+  }
+}
+
+static void math_minimum_row(float *output, const float *value1, const float *value2, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  /* The first operand is returned for NaN and equal values, like std::min(value1, value2). */
+  for (; i + 4 <= width; i += 4) {
+    _mm_storeu_ps(&output[i],
+                  _mm_min_ps(_mm_loadu_ps(&value2[i]), _mm_loadu_ps(&value1[i])));
+  }
+#endif
+  for (; i < width; i++) {
+    output[i] = min(value1[i], value2[i]);
+  }
+}
+
+static void math_maximum_row(float *output, const float *value1, const float *value2, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  /* The first operand is returned for NaN and equal values, like std::max(value1, value2). */
+  for (; i + 4 <= width; i += 4) {
+    _mm_storeu_ps(&output[i],
+                  _mm_max_ps(_mm_loadu_ps(&value2[i]), _mm_loadu_ps(&value1[i])));
+  }
+#endif
+  for (; i < width; i++) {
+    output[i] = max(value1[i], value2[i]);
+  }
+}
+
+static void math_clamp_row(float *output, int width)
+{
+  int i = 0;
+#ifdef __SSE2__
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (; i + 4 <= width; i += 4) {
+    _mm_storeu_ps(&output[i], _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(&output[i]))));
+  }
+#endif
+  for (; i < width; i++) {
+    CLAMP(output[i], 0.0f, 1.0f);
+  }
+}
+
 MathBaseOperation::MathBaseOperation() : NodeOperation()
 {
   this->addInputSocket(COM_DT_VALUE);
@@ -31,6 +143,7 @@ MathBaseOperation::MathBaseOperation() : NodeOperation()
   this->m_inputValue2Operation = NULL;
   this->m_inputValue3Operation = NULL;
   this->m_useClamp = false;
+  this->m_rowFunction = NULL;
 }
 
 void MathBaseOperation::initExecution()
@@ -47,6 +160,35 @@ void MathBaseOperation::deinitExecution()
   this->m_inputValue3Operation = NULL;
 }
 
+void MathBaseOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  if (this->m_rowFunction == NULL) {
+    NodeOperation::executeRect(output, rect);
+    return;
+  }
+
+  MemoryBuffer *inputValue1 = this->readInputRect(0, rect);
+  MemoryBuffer *inputValue2 = this->readInputRect(1, rect);
+
+  const rcti *output_rect = output->getRect();
+  const int width = BLI_rcti_size_x(rect);
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    const int row_offset = (y - rect->ymin) * width;
+    float *row = output->getBuffer() + (y - output_rect->ymin) * output->getWidth() +
+                 (rect->xmin - output_rect->xmin);
+    this->m_rowFunction(row,
+                        inputValue1->getBuffer() + row_offset,
+                        inputValue2->getBuffer() + row_offset,
+                        width);
+    if (this->m_useClamp) {
+      math_clamp_row(row, width);
+    }
+  }
+
+  delete inputValue1;
+  delete inputValue2;
+}
+
 void MathBaseOperation::determineResolution(unsigned int resolution[2],
                                             unsigned int preferredResolution[2])
 {
@@ -72,6 +214,11 @@ void MathBaseOperation::clampIfNeeded(float *color)
   }
 }
 
+MathAddOperation::MathAddOperation() : MathBaseOperation()
+{
+  this->m_rowFunction = math_add_row;
+}
+
 void MathAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
 {
   float inputValue1[4];
@@ -85,6 +232,11 @@ void MathAddOperation::executePixelSampled(float output[4], float x, float y, Pi
   clampIfNeeded(output);
 }
 
+MathSubtractOperation::MathSubtractOperation() : MathBaseOperation()
+{
+  this->m_rowFunction = math_subtract_row;
+}
+
 void MathSubtractOperation::executePixelSampled(float output[4],
                                                 float x,
                                                 float y,
@@ -101,6 +253,11 @@ void MathSubtractOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+MathMultiplyOperation::MathMultiplyOperation() : MathBaseOperation()
+{
+  this->m_rowFunction = math_multiply_row;
+}
+
 void MathMultiplyOperation::executePixelSampled(float output[4],
                                                 float x,
                                                 float y,
@@ -117,6 +274,11 @@ void MathMultiplyOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+MathDivideOperation::MathDivideOperation() : MathBaseOperation()
+{
+  this->m_rowFunction = math_divide_row;
+}
+
 void MathDivideOperation::executePixelSampled(float output[4],
                                               float x,
                                               float y,
@@ -341,6 +503,11 @@ void MathLogarithmOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+MathMinimumOperation::MathMinimumOperation() : MathBaseOperation()
+{
+  this->m_rowFunction = math_minimum_row;
+}
+
 void MathMinimumOperation::executePixelSampled(float output[4],
                                                float x,
                                                float y,
@@ -357,6 +524,11 @@ void MathMinimumOperation::executePixelSampled(float output[4],
   clampIfNeeded(output);
 }
 
+MathMaximumOperation::MathMaximumOperation() : MathBaseOperation()
+{
+  this->m_rowFunction = math_maximum_row;
+}
+
 void MathMaximumOperation::executePixelSampled(float output[4],
                                                float x,
                                                float y,
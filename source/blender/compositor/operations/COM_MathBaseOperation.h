@@ -25,6 +25,15 @@
  * it assumes we are in sRGB color space.
  */
 class MathBaseOperation : public NodeOperation {
+ public:
+  /**
+   * Calculate a row of \a width values.
+   */
+  typedef void (*MathRowFunction)(float *output,
+                                  const float *value1,
+                                  const float *value2,
+                                  int width);
+
  protected:
   /**
    * Prefetched reference to the inputProgram
@@ -35,6 +44,11 @@ class MathBaseOperation : public NodeOperation {
 
   bool m_useClamp;
 
+  /**
+   * Kernel used by #executeRect, NULL when the function only supports per pixel execution.
+   */
+  MathRowFunction m_rowFunction;
+
  protected:
   /**
    * Default constructor
@@ -49,6 +63,12 @@ class MathBaseOperation : public NodeOperation {
    */
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler) = 0;
 
+  void executeRect(MemoryBuffer *output, const rcti *rect);
+  bool isBufferOperation() const
+  {
+    return this->m_rowFunction != NULL;
+  }
+
   /**
    * Initialize the execution
    */
@@ -72,30 +92,22 @@ class MathBaseOperation : public NodeOperation {
 
 class MathAddOperation : public MathBaseOperation {
  public:
-  MathAddOperation() : MathBaseOperation()
-  {
-  }
+  MathAddOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 };
 class MathSubtractOperation : public MathBaseOperation {
  public:
-  MathSubtractOperation() : MathBaseOperation()
-  {
-  }
+  MathSubtractOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 };
 class MathMultiplyOperation : public MathBaseOperation {
  public:
-  MathMultiplyOperation() : MathBaseOperation()
-  {
-  }
+  MathMultiplyOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 };
 class MathDivideOperation : public MathBaseOperation {
  public:
-  MathDivideOperation() : MathBaseOperation()
-  {
-  }
+  MathDivideOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 };
 class MathSineOperation : public MathBaseOperation {
@@ -179,16 +191,12 @@ class MathLogarithmOperation : public MathBaseOperation {
 };
 class MathMinimumOperation : public MathBaseOperation {
  public:
-  MathMinimumOperation() : MathBaseOperation()
-  {
-  }
+  MathMinimumOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 };
 class MathMaximumOperation : public MathBaseOperation {
  public:
-  MathMaximumOperation() : MathBaseOperation()
-  {
-  }
+  MathMaximumOperation();
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 };
 class MathRoundOperation : public MathBaseOperation {
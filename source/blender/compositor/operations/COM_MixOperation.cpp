@@ -22,6 +22,143 @@ extern "C" {
 #include "BLI_math.h"
 }
 
+#include "MEM_guardedalloc.h"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+
+/* ******** Mix Row Kernels ******** */
+
+/* All kernels handle one RGBA pixel per register and take the alpha of the first color. */
+
+static inline __m128 mix_alpha_from_color1(__m128 result, __m128 color1)
+{
+  const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+  return _mm_or_ps(_mm_andnot_ps(mask, result), _mm_and_ps(mask, color1));
+}
+
+static void mix_add_row(
+    float *output, const float *value, const float *color1, const float *color2, int width)
+{
+  for (int i = 0; i < width; i++, output += 4, color1 += 4, color2 += 4) {
+    const __m128 fac = _mm_set1_ps(value[i]);
+    const __m128 col1 = _mm_loadu_ps(color1);
+    const __m128 col2 = _mm_loadu_ps(color2);
+    const __m128 result = _mm_add_ps(col1, _mm_mul_ps(fac, col2));
+    _mm_storeu_ps(output, mix_alpha_from_color1(result, col1));
+  }
+}
+
+static void mix_blend_row(
+    float *output, const float *value, const float *color1, const float *color2, int width)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int i = 0; i < width; i++, output += 4, color1 += 4, color2 += 4) {
+    const __m128 fac = _mm_set1_ps(value[i]);
+    const __m128 facm = _mm_sub_ps(one, fac);
+    const __m128 col1 = _mm_loadu_ps(color1);
+    const __m128 col2 = _mm_loadu_ps(color2);
+    const __m128 result = _mm_add_ps(_mm_mul_ps(facm, col1), _mm_mul_ps(fac, col2));
+    _mm_storeu_ps(output, mix_alpha_from_color1(result, col1));
+  }
+}
+
+static void mix_darken_row(
+    float *output, const float *value, const float *color1, const float *color2, int width)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int i = 0; i < width; i++, output += 4, color1 += 4, color2 += 4) {
+    const __m128 fac = _mm_set1_ps(value[i]);
+    const __m128 facm = _mm_sub_ps(one, fac);
+    const __m128 col1 = _mm_loadu_ps(color1);
+    const __m128 col2 = _mm_loadu_ps(color2);
+    const __m128 result = _mm_add_ps(_mm_mul_ps(_mm_min_ps(col1, col2), fac),
+                                     _mm_mul_ps(col1, facm));
+    _mm_storeu_ps(output, mix_alpha_from_color1(result, col1));
+  }
+}
+
+static void mix_difference_row(
+    float *output, const float *value, const float *color1, const float *color2, int width)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  for (int i = 0; i < width; i++, output += 4, color1 += 4, color2 += 4) {
+    const __m128 fac = _mm_set1_ps(value[i]);
+    const __m128 facm = _mm_sub_ps(one, fac);
+    const __m128 col1 = _mm_loadu_ps(color1);
+    const __m128 col2 = _mm_loadu_ps(color2);
+    const __m128 diff = _mm_and_ps(_mm_sub_ps(col1, col2), sign_mask);
+    const __m128 result = _mm_add_ps(_mm_mul_ps(facm, col1), _mm_mul_ps(fac, diff));
+    _mm_storeu_ps(output, mix_alpha_from_color1(result, col1));
+  }
+}
+
+static void mix_lighten_row(
+    float *output, const float *value, const float *color1, const float *color2, int width)
+{
+  for (int i = 0; i < width; i++, output += 4, color1 += 4, color2 += 4) {
+    const __m128 fac = _mm_set1_ps(value[i]);
+    const __m128 col1 = _mm_loadu_ps(color1);
+    const __m128 col2 = _mm_loadu_ps(color2);
+    const __m128 result = _mm_max_ps(_mm_mul_ps(fac, col2), col1);
+    _mm_storeu_ps(output, mix_alpha_from_color1(result, col1));
+  }
+}
+
+static void mix_multiply_row(
+    float *output, const float *value, const float *color1, const float *color2, int width)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int i = 0; i < width; i++, output += 4, color1 += 4, color2 += 4) {
+    const __m128 fac = _mm_set1_ps(value[i]);
+    const __m128 facm = _mm_sub_ps(one, fac);
+    const __m128 col1 = _mm_loadu_ps(color1);
+    const __m128 col2 = _mm_loadu_ps(color2);
+    const __m128 result = _mm_mul_ps(col1, _mm_add_ps(facm, _mm_mul_ps(fac, col2)));
+    _mm_storeu_ps(output, mix_alpha_from_color1(result, col1));
+  }
+}
+
+static void mix_screen_row(
+    float *output, const float *value, const float *color1, const float *color2, int width)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int i = 0; i < width; i++, output += 4, color1 += 4, color2 += 4) {
+    const __m128 fac = _mm_set1_ps(value[i]);
+    const __m128 facm = _mm_sub_ps(one, fac);
+    const __m128 col1 = _mm_loadu_ps(color1);
+    const __m128 col2 = _mm_loadu_ps(color2);
+    const __m128 result = _mm_sub_ps(
+        one,
+        _mm_mul_ps(_mm_add_ps(facm, _mm_mul_ps(fac, _mm_sub_ps(one, col2))),
+                   _mm_sub_ps(one, col1)));
+    _mm_storeu_ps(output, mix_alpha_from_color1(result, col1));
+  }
+}
+
+static void mix_subtract_row(
+    float *output, const float *value, const float *color1, const float *color2, int width)
+{
+  for (int i = 0; i < width; i++, output += 4, color1 += 4, color2 += 4) {
+    const __m128 fac = _mm_set1_ps(value[i]);
+    const __m128 col1 = _mm_loadu_ps(color1);
+    const __m128 col2 = _mm_loadu_ps(color2);
+    const __m128 result = _mm_sub_ps(col1, _mm_mul_ps(fac, col2));
+    _mm_storeu_ps(output, mix_alpha_from_color1(result, col1));
+  }
+}
+
+static void mix_clamp_row(float *output, int width)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (int i = 0; i < width; i++, output += 4) {
+    _mm_storeu_ps(output, _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(output))));
+  }
+}
+#endif /* __SSE2__ */
+
 /* ******** Mix Base Operation ******** */
 
 MixBaseOperation::MixBaseOperation() : NodeOperation()
@@ -35,6 +172,7 @@ MixBaseOperation::MixBaseOperation() : NodeOperation()
   this->m_inputColor2Operation = NULL;
   this->setUseValueAlphaMultiply(false);
   this->setUseClamp(false);
+  this->m_rowFunction = NULL;
 }
 
 void MixBaseOperation::initExecution()
@@ -65,6 +203,54 @@ void MixBaseOperation::executePixelSampled(float output[4], float x, float y, Pi
   output[3] = inputColor1[3];
 }
 
+void MixBaseOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  if (this->m_rowFunction == NULL) {
+    NodeOperation::executeRect(output, rect);
+    return;
+  }
+
+  MemoryBuffer *inputValue = this->readInputRect(0, rect);
+  MemoryBuffer *inputColor1 = this->readInputRect(1, rect);
+  MemoryBuffer *inputColor2 = this->readInputRect(2, rect);
+
+  const rcti *output_rect = output->getRect();
+  const int width = BLI_rcti_size_x(rect);
+  float *factors = NULL;
+  if (this->useValueAlphaMultiply()) {
+    factors = (float *)MEM_mallocN_aligned(sizeof(float) * width, 16, __func__);
+  }
+
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    const int row_offset = (y - rect->ymin) * width;
+    const float *value = inputValue->getBuffer() + row_offset;
+    const float *color1 = inputColor1->getBuffer() + row_offset * 4;
+    const float *color2 = inputColor2->getBuffer() + row_offset * 4;
+    float *row = output->getBuffer() + ((y - output_rect->ymin) * output->getWidth() +
+                                        (rect->xmin - output_rect->xmin)) *
+                                           4;
+    if (factors) {
+      for (int i = 0; i < width; i++) {
+        factors[i] = value[i] * color2[i * 4 + 3];
+      }
+      value = factors;
+    }
+    this->m_rowFunction(row, value, color1, color2, width);
+#ifdef __SSE2__
+    if (this->m_useClamp) {
+      mix_clamp_row(row, width);
+    }
+#endif
+  }
+
+  if (factors) {
+    MEM_freeN(factors);
+  }
+  delete inputValue;
+  delete inputColor1;
+  delete inputColor2;
+}
+
 void MixBaseOperation::determineResolution(unsigned int resolution[2],
                                            unsigned int preferredResolution[2])
 {
@@ -101,7 +287,9 @@ void MixBaseOperation::deinitExecution()
 
 MixAddOperation::MixAddOperation() : MixBaseOperation()
 {
-  /* pass */
+#ifdef __SSE2__
+  this->m_rowFunction = mix_add_row;
+#endif
 }
 
 void MixAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
@@ -130,7 +318,9 @@ void MixAddOperation::executePixelSampled(float output[4], float x, float y, Pix
 
 MixBlendOperation::MixBlendOperation() : MixBaseOperation()
 {
-  /* pass */
+#ifdef __SSE2__
+  this->m_rowFunction = mix_blend_row;
+#endif
 }
 
 void MixBlendOperation::executePixelSampled(float output[4],
@@ -292,7 +482,9 @@ void MixColorOperation::executePixelSampled(float output[4],
 
 MixDarkenOperation::MixDarkenOperation() : MixBaseOperation()
 {
-  /* pass */
+#ifdef __SSE2__
+  this->m_rowFunction = mix_darken_row;
+#endif
 }
 
 void MixDarkenOperation::executePixelSampled(float output[4],
@@ -325,7 +517,9 @@ void MixDarkenOperation::executePixelSampled(float output[4],
 
 MixDifferenceOperation::MixDifferenceOperation() : MixBaseOperation()
 {
-  /* pass */
+#ifdef __SSE2__
+  this->m_rowFunction = mix_difference_row;
+#endif
 }
 
 void MixDifferenceOperation::executePixelSampled(float output[4],
@@ -579,7 +773,9 @@ void MixHueOperation::executePixelSampled(float output[4], float x, float y, Pix
 
 MixLightenOperation::MixLightenOperation() : MixBaseOperation()
 {
-  /* pass */
+#ifdef __SSE2__
+  this->m_rowFunction = mix_lighten_row;
+#endif
 }
 
 void MixLightenOperation::executePixelSampled(float output[4],
@@ -678,7 +874,9 @@ void MixLinearLightOperation::executePixelSampled(float output[4],
 
 MixMultiplyOperation::MixMultiplyOperation() : MixBaseOperation()
 {
-  /* pass */
+#ifdef __SSE2__
+  this->m_rowFunction = mix_multiply_row;
+#endif
 }
 
 void MixMultiplyOperation::executePixelSampled(float output[4],
@@ -803,7 +1001,9 @@ void MixSaturationOperation::executePixelSampled(float output[4],
 
 MixScreenOperation::MixScreenOperation() : MixBaseOperation()
 {
-  /* pass */
+#ifdef __SSE2__
+  this->m_rowFunction = mix_screen_row;
+#endif
 }
 
 void MixScreenOperation::executePixelSampled(float output[4],
@@ -883,7 +1083,9 @@ void MixSoftLightOperation::executePixelSampled(float output[4],
 
 MixSubtractOperation::MixSubtractOperation() : MixBaseOperation()
 {
-  /* pass */
+#ifdef __SSE2__
+  this->m_rowFunction = mix_subtract_row;
+#endif
 }
 
 void MixSubtractOperation::executePixelSampled(float output[4],
@@ -26,6 +26,14 @@
  */
 
 class MixBaseOperation : public NodeOperation {
+ public:
+  /**
+   * Mix a row of \a width pixels, \a value holds one factor per pixel.
+   * The alpha of the result is the alpha of \a color1.
+   */
+  typedef void (*MixRowFunction)(
+      float *output, const float *value, const float *color1, const float *color2, int width);
+
  protected:
   /**
    * Prefetched reference to the inputProgram
@@ -36,6 +44,11 @@ class MixBaseOperation : public NodeOperation {
   bool m_valueAlphaMultiply;
   bool m_useClamp;
 
+  /**
+   * Kernel used by #executeRect, NULL when the mix type only supports per pixel execution.
+   */
+  MixRowFunction m_rowFunction;
+
   inline void clampIfNeeded(float color[4])
   {
     if (m_useClamp) {
@@ -57,6 +70,12 @@ class MixBaseOperation : public NodeOperation {
    */
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
 
+  void executeRect(MemoryBuffer *output, const rcti *rect);
+  bool isBufferOperation() const
+  {
+    return this->m_rowFunction != NULL;
+  }
+
   /**
    * Initialize the execution
    */
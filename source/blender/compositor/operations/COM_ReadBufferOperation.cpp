@@ -74,6 +74,38 @@ void ReadBufferOperation::executePixelSampled(float output[4],
   }
 }
 
+void ReadBufferOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  const int num_channels = output->get_num_channels();
+  if (m_single_value || num_channels != (int)m_buffer->get_num_channels()) {
+    NodeOperation::executeRect(output, rect);
+    return;
+  }
+
+  /* Copy rows, pixels outside of the buffer are zero as with #MemoryBuffer.read. */
+  const rcti *buffer_rect = m_buffer->getRect();
+  const rcti *output_rect = output->getRect();
+  const int xmin = min(max(rect->xmin, buffer_rect->xmin), rect->xmax);
+  const int xmax = max(min(rect->xmax, buffer_rect->xmax), xmin);
+  const size_t pixel_size = sizeof(float) * num_channels;
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    float *row = output->getBuffer() + ((y - output_rect->ymin) * output->getWidth() +
+                                        (rect->xmin - output_rect->xmin)) *
+                                           num_channels;
+    if (y < buffer_rect->ymin || y >= buffer_rect->ymax) {
+      memset(row, 0, pixel_size * BLI_rcti_size_x(rect));
+      continue;
+    }
+    const float *buffer_row = m_buffer->getBuffer() +
+                              ((y - buffer_rect->ymin) * m_buffer->getWidth() +
+                               (xmin - buffer_rect->xmin)) *
+                                  num_channels;
+    memset(row, 0, pixel_size * (xmin - rect->xmin));
+    memcpy(row + (xmin - rect->xmin) * num_channels, buffer_row, pixel_size * (xmax - xmin));
+    memset(row + (xmax - rect->xmin) * num_channels, 0, pixel_size * (rect->xmax - xmax));
+  }
+}
+
 void ReadBufferOperation::executePixelExtend(float output[4],
                                              float x,
                                              float y,
@@ -44,6 +44,11 @@ class ReadBufferOperation : public NodeOperation {
 
   void *initializeTileData(rcti *rect);
   void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+  void executeRect(MemoryBuffer *output, const rcti *rect);
+  bool isBufferOperation() const
+  {
+    return true;
+  }
   void executePixelExtend(float output[4],
                           float x,
                           float y,
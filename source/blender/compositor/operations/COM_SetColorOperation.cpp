@@ -31,6 +31,19 @@ void SetColorOperation::executePixelSampled(float output[4],
   copy_v4_v4(output, this->m_color);
 }
 
+void SetColorOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  const rcti *output_rect = output->getRect();
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    float *row = output->getBuffer() + ((y - output_rect->ymin) * output->getWidth() +
+                                        (rect->xmin - output_rect->xmin)) *
+                                           4;
+    for (int x = rect->xmin; x < rect->xmax; x++, row += 4) {
+      copy_v4_v4(row, this->m_color);
+    }
+  }
+}
+
 void SetColorOperation::determineResolution(unsigned int resolution[2],
                                             unsigned int preferredResolution[2])
 {
@@ -31,6 +31,16 @@ void SetValueOperation::executePixelSampled(float output[4],
   output[0] = this->m_value;
 }
 
+void SetValueOperation::executeRect(MemoryBuffer *output, const rcti *rect)
+{
+  const rcti *output_rect = output->getRect();
+  for (int y = rect->ymin; y < rect->ymax; y++) {
+    float *row = output->getBuffer() + (y - output_rect->ymin) * output->getWidth() +
+                 (rect->xmin - output_rect->xmin);
+    copy_vn_fl(row, BLI_rcti_size_x(rect), this->m_value);
+  }
+}
+
 void SetValueOperation::determineResolution(unsigned int resolution[2],
                                             unsigned int preferredResolution[2])
 {
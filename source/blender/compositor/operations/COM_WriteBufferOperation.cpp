@@ -21,6 +21,9 @@
 #include <stdio.h>
 #include "COM_OpenCLDevice.h"
 
+/* Number of pixels of the bands of rows buffer operations calculate at once. */
+#define BUFFER_OPERATION_BAND_PIXELS 4096
+
 WriteBufferOperation::WriteBufferOperation(DataType datatype) : NodeOperation()
 {
   this->addInputSocket(datatype);
@@ -85,6 +88,20 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/
       data = NULL;
     }
   }
+  else if (this->m_input->isBufferOperation()) {
+    /* Execute bands of rows, so the execution can be stopped like the per pixel loops, without
+     * allocating the temporary input buffers for every row. */
+    const int band_height = max_ii(1, BUFFER_OPERATION_BAND_PIXELS / BLI_rcti_size_x(rect));
+    rcti band_rect = *rect;
+    for (int y = rect->ymin; y < rect->ymax; y += band_height) {
+      band_rect.ymin = y;
+      band_rect.ymax = min_ii(y + band_height, rect->ymax);
+      this->m_input->executeRect(memoryBuffer, &band_rect);
+      if (isBraked()) {
+        break;
+      }
+    }
+  }
   else {
     int x1 = rect->xmin;
     int y1 = rect->ymin;
@@ -78,6 +78,8 @@ Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluati
       scene_cow(NULL),
       is_active(false),
       is_evaluating(false),
+      cost_update_countdown(0),
+      need_update_critical_path(true),
       is_render_pipeline_depsgraph(false)
 {
   BLI_spin_init(&lock);
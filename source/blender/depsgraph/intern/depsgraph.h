@@ -161,6 +161,13 @@ struct Depsgraph {
 
   bool is_evaluating;
 
+  /* Operation costs are only measured every few evaluations, this counts the evaluations left
+   * until the next measurement. */
+  int cost_update_countdown;
+  /* Set when relations were rebuilt, so the critical path of operations is computed even when
+   * their costs did not change. */
+  bool need_update_critical_path;
+
   /* Is set to truth for dependency graph which are used for post-processing (compositor and
    * sequencer).
    * Such dependency graph needs all view layers (so render pipeline can access names), but it
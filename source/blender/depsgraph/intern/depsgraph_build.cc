@@ -223,6 +223,7 @@ static void graph_build_finalize_common(DEG::Depsgraph *deg_graph, Main *bmain)
 #endif
   /* Relations are up to date. */
   deg_graph->need_update = false;
+  deg_graph->need_update_critical_path = true;
 }
 
 /* Build depsgraph for the given scene layer, and dump results in given graph container. */
@@ -25,6 +25,8 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include "MEM_guardedalloc.h"
+
 #include "PIL_time.h"
 
 #include "BLI_compiler_attrs.h"
@@ -32,6 +34,7 @@
 #include "BLI_task.h"
 #include "BLI_ghash.h"
 #include "BLI_gsqueue.h"
+#include "BLI_trace.h"
 
 #include "BKE_global.h"
 
@@ -75,6 +78,40 @@ void schedule_node_to_pool(OperationNode *node, const int thread_id, TaskPool *p
       pool, deg_task_run_func, node, false, TASK_PRIORITY_HIGH, thread_id);
 }
 
+/* Operations which became ready for evaluation, collected so they can be scheduled in the order
+ * of their critical path cost. */
+typedef vector<OperationNode *> ReadyOperations;
+
+void schedule_node_to_ready_operations(OperationNode *node,
+                                       const int /*thread_id*/,
+                                       ReadyOperations *ready_operations)
+{
+  ready_operations->push_back(node);
+}
+
+bool operation_critical_path_greater(const OperationNode *a, const OperationNode *b)
+{
+  return a->critical_path_cost > b->critical_path_cost;
+}
+
+/* Order operations so the ones with the longest remaining path come first. */
+void sort_ready_operations(ReadyOperations &ready_operations)
+{
+  std::sort(ready_operations.begin(), ready_operations.end(), operation_critical_path_greater);
+}
+
+/* Push sorted operations to the pool. Other threads steal the oldest tasks first, so the
+ * operations with the longest remaining path are the first to start. */
+void push_ready_operations_to_pool(const ReadyOperations &ready_operations,
+                                   const size_t start,
+                                   const int thread_id,
+                                   TaskPool *pool)
+{
+  for (size_t i = start; i < ready_operations.size(); i++) {
+    schedule_node_to_pool(ready_operations[i], thread_id, pool);
+  }
+}
+
 /* Denotes which part of dependency graph is being evaluated. */
 enum class EvaluationStage {
   /* Stage 1: Only  Copy-on-Write operations are to be evaluated, prior to anything else.
@@ -92,27 +129,53 @@ enum class EvaluationStage {
   SINGLE_THREADED_WORKAROUND,
 };
 
+/* Number of evaluations between measurements of the cost of all operations. */
+static const int COST_UPDATE_INTERVAL = 8;
+
 struct DepsgraphEvalState {
   Depsgraph *graph;
   bool do_stats;
+  /* Measure time of all operations, otherwise only of the ones without a cost estimate. */
+  bool do_timing;
+  /* Operations which were timed, their costs are updated after the evaluation. */
+  OperationNode **timed_operations;
+  uint32_t timed_operations_num;
   EvaluationStage stage;
   bool need_single_thread_pass;
 };
 
-void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_node)
+void evaluate_node(DepsgraphEvalState *state, OperationNode *operation_node)
 {
   ::Depsgraph *depsgraph = reinterpret_cast<::Depsgraph *>(state->graph);
 
   /* Sanity checks. */
   BLI_assert(!operation_node->is_noop() && "NOOP nodes should not actually be scheduled");
-  /* Perform operation. */
-  if (state->do_stats) {
-    const double start_time = PIL_check_seconds_timer();
+  /* Perform operation. Timing is used to estimate the operation cost for scheduling of the next
+   * evaluations, it is only gathered every few evaluations. */
+  const bool do_trace = BLI_trace_is_recording();
+  const bool do_timing = state->do_timing || operation_node->cost == 0.0f;
+  if (!do_timing && !do_trace) {
     operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
+    return;
   }
-  else {
-    operation_node->evaluate(depsgraph);
+  const double start_time = PIL_check_seconds_timer();
+  operation_node->evaluate(depsgraph);
+  const double end_time = PIL_check_seconds_timer();
+
+  /* Tracing alone doesn't need the costs, avoid the atomic for every operation. */
+  if (do_timing) {
+    operation_node->stats.current_time += end_time - start_time;
+
+    const uint32_t timed_index = atomic_fetch_and_add_uint32(&state->timed_operations_num, 1);
+    BLI_assert(timed_index < state->graph->operations.size());
+    state->timed_operations[timed_index] = operation_node;
+  }
+
+  if (do_trace) {
+    const char *name_parts[3] = {operation_node->owner->owner->name.c_str(),
+                                 operationCodeAsString(operation_node->opcode),
+                                 operation_node->name.c_str()};
+    BLI_trace_span_add_parts("depsgraph", name_parts, 3, start_time, end_time);
   }
 }
 
@@ -121,14 +184,33 @@ void deg_task_run_func(TaskPool *pool, void *taskdata, int thread_id)
   void *userdata_v = BLI_task_pool_userdata(pool);
   DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 
-  /* Evaluate node. */
   OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
-  evaluate_node(state, operation_node);
+  ReadyOperations ready_operations;
+
+  /* Children which became ready are evaluated in this same task, starting with the one on the
+   * longest path, so chains of small operations (like bones and drivers) don't pay the overhead
+   * of a task for each operation. Other ready children are pushed to the pool, so other threads
+   * can pick them up in the meantime. */
+  while (true) {
+    /* Evaluate node. */
+    evaluate_node(state, operation_node);
+
+    /* Schedule children. */
+    ready_operations.clear();
+    schedule_children(
+        state, operation_node, thread_id, schedule_node_to_ready_operations, &ready_operations);
+    if (ready_operations.empty()) {
+      break;
+    }
 
-  /* Schedule children. */
-  BLI_task_pool_delayed_push_begin(pool, thread_id);
-  schedule_children(state, operation_node, thread_id, schedule_node_to_pool, pool);
-  BLI_task_pool_delayed_push_end(pool, thread_id);
+    sort_ready_operations(ready_operations);
+    if (ready_operations.size() > 1) {
+      BLI_task_pool_delayed_push_begin(pool, thread_id);
+      push_ready_operations_to_pool(ready_operations, 1, thread_id, pool);
+      BLI_task_pool_delayed_push_end(pool, thread_id);
+    }
+    operation_node = ready_operations[0];
+  }
 }
 
 bool check_operation_node_visible(OperationNode *op_node)
@@ -181,15 +263,12 @@ void calculate_pending_parents(Depsgraph *graph)
   }
 }
 
-void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
+void initialize_execution(Depsgraph *graph)
 {
-  const bool do_stats = state->do_stats;
   calculate_pending_parents(graph);
   /* Clear tags and other things which needs to be clear. */
   for (OperationNode *node : graph->operations) {
-    if (do_stats) {
-      node->stats.reset_current();
-    }
+    node->stats.reset_current();
   }
 }
 
@@ -313,6 +392,14 @@ void schedule_children(DepsgraphEvalState *state,
   }
 }
 
+void schedule_graph_to_pool(DepsgraphEvalState *state, TaskPool *pool)
+{
+  ReadyOperations ready_operations;
+  schedule_graph(state, schedule_node_to_ready_operations, &ready_operations);
+  sort_ready_operations(ready_operations);
+  push_ready_operations_to_pool(ready_operations, 0, -1, pool);
+}
+
 void schedule_node_to_queue(OperationNode *node,
                             const int /*thread_id*/,
                             GSQueue *evaluation_queue)
@@ -367,6 +454,7 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   }
 
   graph->debug.begin_graph_evaluation();
+  const double start_time = PIL_check_seconds_timer();
 
   graph->is_evaluating = true;
   depsgraph_ensure_view_layer(graph);
@@ -374,6 +462,16 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   DepsgraphEvalState state;
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
+  state.do_timing = state.do_stats || graph->cost_update_countdown == 0;
+  if (state.do_timing) {
+    graph->cost_update_countdown = COST_UPDATE_INTERVAL;
+  }
+  else {
+    graph->cost_update_countdown--;
+  }
+  state.timed_operations = (OperationNode **)MEM_mallocN(
+      sizeof(OperationNode *) * std::max(graph->operations.size(), (size_t)1), __func__);
+  state.timed_operations_num = 0;
   state.need_single_thread_pass = false;
   /* Set up task scheduler and pull for threaded evaluation. */
   TaskScheduler *task_scheduler;
@@ -388,18 +486,18 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   }
   TaskPool *task_pool = BLI_task_pool_create_suspended(task_scheduler, &state);
   /* Prepare all nodes for evaluation. */
-  initialize_execution(&state, graph);
+  initialize_execution(graph);
 
   /* Do actual evaluation now. */
 
   /* First, process all Copy-On-Write nodes. */
   state.stage = EvaluationStage::COPY_ON_WRITE;
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
+  schedule_graph_to_pool(&state, task_pool);
   BLI_task_pool_work_wait_and_reset(task_pool);
 
   /* After that, process all other nodes. */
   state.stage = EvaluationStage::THREADED_EVALUATION;
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
+  schedule_graph_to_pool(&state, task_pool);
   BLI_task_pool_work_and_wait(task_pool);
   BLI_task_pool_free(task_pool);
 
@@ -414,6 +512,8 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   if (state.do_stats) {
     deg_eval_stats_aggregate(graph);
   }
+  deg_eval_stats_update_costs(graph, state.timed_operations, state.timed_operations_num);
+  MEM_freeN(state.timed_operations);
   /* Clear any uncleared tags - just in case. */
   deg_graph_clear_tags(graph);
   if (need_free_scheduler) {
@@ -421,6 +521,10 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   }
   graph->is_evaluating = false;
 
+  if (BLI_trace_is_recording()) {
+    BLI_trace_span_add(
+        "depsgraph", "Depsgraph evaluation", start_time, PIL_check_seconds_timer());
+  }
   graph->debug.end_graph_evaluation();
 }
 
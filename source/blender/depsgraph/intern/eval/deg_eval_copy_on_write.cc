@@ -277,7 +277,7 @@ struct ValidateData {
 
 /* Similar to generic BKE_id_copy() but does not require main and assumes pointer
  * is already allocated. */
-bool id_copy_inplace_no_main(const ID *id, ID *newid)
+bool id_copy_inplace_no_main(const ID *id, ID *newid, const int extra_flag = 0)
 {
   const ID *id_for_copy = id;
 
@@ -286,8 +286,10 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
   id_for_copy = nested_id_hack_get_discarded_pointers(&id_hack_storage, id);
 #endif
 
-  bool result = BKE_id_copy_ex(
-      NULL, (ID *)id_for_copy, &newid, (LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE));
+  bool result = BKE_id_copy_ex(NULL,
+                               (ID *)id_for_copy,
+                               &newid,
+                               (LIB_ID_COPY_LOCALIZE | LIB_ID_CREATE_NO_ALLOCATE | extra_flag));
 
 #ifdef NESTED_ID_NASTY_WORKAROUND
   if (result) {
@@ -298,6 +300,26 @@ bool id_copy_inplace_no_main(const ID *id, ID *newid)
   return result;
 }
 
+/* Geometry layers of meshes can be shared with the original, so updates of large meshes don't
+ * have to copy all of their data. The copy gets its own copy of a layer before modifying it
+ * through the CustomData API, while the original owns the data and writes it in place. So only
+ * share when such writes can't be seen by evaluation: the active depsgraph is evaluated from the
+ * main thread in between edits, and is updated after them. Inactive and render dependency graphs
+ * can be evaluated from other threads while the original is edited, and sculpt and vertex/weight
+ * paint modes write the original of the active object without updating the evaluated mesh. */
+static bool mesh_copy_share_layers(const Depsgraph *depsgraph, const Mesh *mesh_orig)
+{
+  if (!DEG_is_active(reinterpret_cast<const ::Depsgraph *>(depsgraph))) {
+    return false;
+  }
+  const Base *base_active = depsgraph->view_layer->basact;
+  if (base_active != NULL && base_active->object->data == mesh_orig &&
+      (base_active->object->mode & OB_MODE_ALL_SCULPT)) {
+    return false;
+  }
+  return true;
+}
+
 /* Similar to BKE_scene_copy() but does not require main and assumes pointer
  * is already allocated. */
 bool scene_copy_inplace_no_main(const Scene *scene, Scene *new_scene)
@@ -882,8 +904,9 @@ ID *deg_expand_copy_on_write_datablock(const Depsgraph *depsgraph,
       break;
     }
     case ID_ME: {
-      /* TODO(sergey): Ideally we want to handle meshes in a special
-       * manner here to avoid initial copy of all the geometry arrays. */
+      if (mesh_copy_share_layers(depsgraph, (const Mesh *)id_orig)) {
+        done = id_copy_inplace_no_main(id_orig, id_cow, LIB_ID_COPY_CD_SHARE);
+      }
       break;
     }
     default:
@@ -25,8 +25,10 @@
 
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_math_base.h"
 
 #include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
 
 #include "intern/node/deg_node.h"
 #include "intern/node/deg_node_component.h"
@@ -56,4 +58,91 @@ void deg_eval_stats_aggregate(Depsgraph *graph)
   }
 }
 
+/* Weight of the last evaluation time in the cost estimate. Smooths out noise from timing of
+ * small operations, while still following changes of the evaluated data quickly. */
+static const float COST_UPDATE_FACTOR = 0.25f;
+
+/* The critical path is only computed again when the cost of an operation changed by more than
+ * this part of the cost it was last computed with, and by more than the minimal change in
+ * seconds. Changes of small operations are mostly noise of the timer. */
+static const float COST_CHANGE_FACTOR = 0.2f;
+static const float COST_CHANGE_MIN = 1e-5f;
+
+/* Returns true when the cost of any operation changed enough to affect the scheduling. */
+static bool deg_eval_stats_update_operation_costs(OperationNode *const *timed_operations,
+                                                  int timed_operations_num)
+{
+  bool is_changed = false;
+  for (int i = 0; i < timed_operations_num; i++) {
+    OperationNode *op_node = timed_operations[i];
+    const float time = (float)op_node->stats.current_time;
+    if (op_node->cost == 0.0f) {
+      op_node->cost = time;
+    }
+    else {
+      op_node->cost += (time - op_node->cost) * COST_UPDATE_FACTOR;
+    }
+    const float cost_change = fabsf(op_node->cost - op_node->critical_path_own_cost);
+    if (cost_change > max_ff(op_node->critical_path_own_cost * COST_CHANGE_FACTOR,
+                             COST_CHANGE_MIN)) {
+      is_changed = true;
+    }
+  }
+  return is_changed;
+}
+
+/* Accumulate costs from the end of the graph towards its roots, in reverse topological order.
+ * Cyclic relations are ignored, same as in the evaluation. */
+static void deg_eval_stats_update_critical_path(Depsgraph *graph)
+{
+  vector<OperationNode *> queue;
+  queue.reserve(graph->operations.size());
+  for (OperationNode *op_node : graph->operations) {
+    op_node->custom_flags = 0;
+    for (Relation *rel : op_node->outlinks) {
+      if ((rel->flag & RELATION_FLAG_CYCLIC) == 0) {
+        op_node->custom_flags++;
+      }
+    }
+    if (op_node->custom_flags == 0) {
+      queue.push_back(op_node);
+    }
+  }
+  while (!queue.empty()) {
+    OperationNode *op_node = queue.back();
+    queue.pop_back();
+    float children_cost = 0.0f;
+    for (Relation *rel : op_node->outlinks) {
+      if ((rel->flag & RELATION_FLAG_CYCLIC) == 0) {
+        const OperationNode *child = (OperationNode *)rel->to;
+        children_cost = max_ff(children_cost, child->critical_path_cost);
+      }
+    }
+    op_node->critical_path_cost = op_node->cost + children_cost;
+    op_node->critical_path_own_cost = op_node->cost;
+    for (Relation *rel : op_node->inlinks) {
+      if (rel->from->type != NodeType::OPERATION || (rel->flag & RELATION_FLAG_CYCLIC)) {
+        continue;
+      }
+      OperationNode *parent = (OperationNode *)rel->from;
+      if (--parent->custom_flags == 0) {
+        queue.push_back(parent);
+      }
+    }
+  }
+}
+
+void deg_eval_stats_update_costs(Depsgraph *graph,
+                                 OperationNode *const *timed_operations,
+                                 int timed_operations_num)
+{
+  if (deg_eval_stats_update_operation_costs(timed_operations, timed_operations_num)) {
+    graph->need_update_critical_path = true;
+  }
+  if (graph->need_update_critical_path) {
+    deg_eval_stats_update_critical_path(graph);
+    graph->need_update_critical_path = false;
+  }
+}
+
 }  // namespace DEG
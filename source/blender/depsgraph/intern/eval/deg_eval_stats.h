@@ -26,8 +26,15 @@
 namespace DEG {
 
 struct Depsgraph;
+struct OperationNode;
 
 /* Aggregate operation timings to overall component and ID nodes timing. */
 void deg_eval_stats_aggregate(Depsgraph *graph);
 
+/* Update cost estimates of the timed operations, and the critical path cost of all operations
+ * which is used for scheduling when any of the costs changed noticeably. */
+void deg_eval_stats_update_costs(Depsgraph *graph,
+                                 OperationNode *const *timed_operations,
+                                 int timed_operations_num);
+
 }  // namespace DEG
@@ -196,7 +196,8 @@ const char *operationCodeAsString(OperationCode opcode)
   return "UNKNOWN";
 }
 
-OperationNode::OperationNode() : name_tag(-1), flag(0)
+OperationNode::OperationNode()
+    : name_tag(-1), flag(0), cost(0.0f), critical_path_cost(0.0f), critical_path_own_cost(0.0f)
 {
 }
 
@@ -259,6 +259,14 @@ struct OperationNode : public Node {
   /* (OperationFlag) extra settings affecting evaluation. */
   int flag;
 
+  /* Estimated evaluation time in seconds, averaged over previous evaluations. */
+  float cost;
+  /* Estimated time needed to evaluate the longest chain of operations which starts with this
+   * one. Operations with a longer chain are scheduled first. */
+  float critical_path_cost;
+  /* Cost used when the critical path was last computed. */
+  float critical_path_own_cost;
+
   DEG_DEPSNODE_DECLARE;
 };
 
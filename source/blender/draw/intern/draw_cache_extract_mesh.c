@@ -122,8 +122,11 @@ typedef struct MeshRenderData {
   BMFace *efa_act_uv;
   /* Data created on-demand (usually not for bmesh-based data). */
   MLoopTri *mlooptri;
-  float (*loop_normals)[3];
-  float (*poly_normals)[3];
+  /* Owned by the mesh runtime, except for loop normals of bmesh-based data. */
+  const float (*loop_normals)[3];
+  const float (*poly_normals)[3];
+  /* Loop normals of bmesh-based data. */
+  float (*bm_loop_normals)[3];
   int *lverts, *ledges;
 } MeshRenderData;
 
@@ -212,35 +215,11 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
     mr->p_origindex = CustomData_get_layer(&mr->me->pdata, CD_ORIGINDEX);
 
     if (data_flag & (MR_DATA_POLY_NOR | MR_DATA_LOOP_NOR | MR_DATA_TAN_LOOP_NOR)) {
-      mr->poly_normals = MEM_mallocN(sizeof(*mr->poly_normals) * mr->poly_len, __func__);
-      BKE_mesh_calc_normals_poly((MVert *)mr->mvert,
-                                 NULL,
-                                 mr->vert_len,
-                                 mr->mloop,
-                                 mr->mpoly,
-                                 mr->loop_len,
-                                 mr->poly_len,
-                                 mr->poly_normals,
-                                 true);
+      mr->poly_normals = BKE_mesh_runtime_poly_normals_ensure(mr->me);
     }
     if (((data_flag & MR_DATA_LOOP_NOR) && is_auto_smooth) || (data_flag & MR_DATA_TAN_LOOP_NOR)) {
-      mr->loop_normals = MEM_mallocN(sizeof(*mr->loop_normals) * mr->loop_len, __func__);
-      short(*clnors)[2] = CustomData_get_layer(&mr->me->ldata, CD_CUSTOMLOOPNORMAL);
-      BKE_mesh_normals_loop_split(mr->me->mvert,
-                                  mr->vert_len,
-                                  mr->me->medge,
-                                  mr->edge_len,
-                                  mr->me->mloop,
-                                  mr->loop_normals,
-                                  mr->loop_len,
-                                  mr->me->mpoly,
-                                  mr->poly_normals,
-                                  mr->poly_len,
-                                  is_auto_smooth,
-                                  split_angle,
-                                  NULL,
-                                  clnors,
-                                  NULL);
+      mr->loop_normals = BKE_mesh_runtime_loop_normals_ensure(
+          mr->me, is_auto_smooth, split_angle);
     }
     if ((iter_type & MR_ITER_LOOPTRI) || (data_flag & MR_DATA_LOOPTRI)) {
       mr->mlooptri = MEM_mallocN(sizeof(*mr->mlooptri) * mr->tri_len, "MR_DATATYPE_LOOPTRI");
@@ -300,7 +279,7 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
       /* Use bmface->no instead. */
     }
     if (((data_flag & MR_DATA_LOOP_NOR) && is_auto_smooth) || (data_flag & MR_DATA_TAN_LOOP_NOR)) {
-      mr->loop_normals = MEM_mallocN(sizeof(*mr->loop_normals) * mr->loop_len, __func__);
+      mr->bm_loop_normals = MEM_mallocN(sizeof(*mr->bm_loop_normals) * mr->loop_len, __func__);
       int clnors_offset = CustomData_get_offset(&mr->bm->ldata, CD_CUSTOMLOOPNORMAL);
       BM_loops_calc_normal_vcos(mr->bm,
                                 NULL,
@@ -308,11 +287,12 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
                                 NULL,
                                 is_auto_smooth,
                                 split_angle,
-                                mr->loop_normals,
+                                mr->bm_loop_normals,
                                 NULL,
                                 NULL,
                                 clnors_offset,
                                 false);
+      mr->loop_normals = (const float(*)[3])mr->bm_loop_normals;
     }
     if ((iter_type & MR_ITER_LOOPTRI) || (data_flag & MR_DATA_LOOPTRI)) {
       /* Edit mode ensures this is valid, no need to calculate. */
@@ -355,8 +335,7 @@ static MeshRenderData *mesh_render_data_create(Mesh *me,
 static void mesh_render_data_free(MeshRenderData *mr)
 {
   MEM_SAFE_FREE(mr->mlooptri);
-  MEM_SAFE_FREE(mr->poly_normals);
-  MEM_SAFE_FREE(mr->loop_normals);
+  MEM_SAFE_FREE(mr->bm_loop_normals);
 
   MEM_SAFE_FREE(mr->lverts);
   MEM_SAFE_FREE(mr->ledges);
@@ -3455,7 +3434,7 @@ static void statvis_calc_distort(const MeshRenderData *mr, float *r_distort)
       float fac = -1.0f;
 
       if (mpoly->totloop > 3) {
-        float *f_no = mr->poly_normals[p];
+        const float *f_no = mr->poly_normals[p];
         fac = 0.0f;
 
         for (int i = 1; i <= mpoly->totloop; i++) {
@@ -3549,7 +3528,7 @@ static void statvis_calc_sharp(const MeshRenderData *mr, float *r_sharp)
         void **pval;
         bool value_is_init = BLI_edgehash_ensure_p(eh, l_curr->v, l_next->v, &pval);
         if (!value_is_init) {
-          *pval = mr->poly_normals[p];
+          *pval = (void *)mr->poly_normals[p];
           /* non-manifold edge, yet... */
           continue;
         }
@@ -1077,6 +1077,8 @@ static void mesh_remove_verts(Mesh *mesh, int len)
   const int totvert = mesh->totvert - len;
   CustomData_free_elem(&mesh->vdata, totvert, len);
   mesh->totvert = totvert;
+  /* Layers shared with evaluated copies got their own copy. */
+  BKE_mesh_update_customdata_pointers(mesh, false);
 }
 
 static void mesh_remove_edges(Mesh *mesh, int len)
@@ -1087,6 +1089,8 @@ static void mesh_remove_edges(Mesh *mesh, int len)
   const int totedge = mesh->totedge - len;
   CustomData_free_elem(&mesh->edata, totedge, len);
   mesh->totedge = totedge;
+  /* Layers shared with evaluated copies got their own copy. */
+  BKE_mesh_update_customdata_pointers(mesh, false);
 }
 
 static void mesh_remove_loops(Mesh *mesh, int len)
@@ -1097,6 +1101,8 @@ static void mesh_remove_loops(Mesh *mesh, int len)
   const int totloop = mesh->totloop - len;
   CustomData_free_elem(&mesh->ldata, totloop, len);
   mesh->totloop = totloop;
+  /* Layers shared with evaluated copies got their own copy. */
+  BKE_mesh_update_customdata_pointers(mesh, false);
 }
 
 static void mesh_remove_polys(Mesh *mesh, int len)
@@ -1107,6 +1113,8 @@ static void mesh_remove_polys(Mesh *mesh, int len)
   const int totpoly = mesh->totpoly - len;
   CustomData_free_elem(&mesh->pdata, totpoly, len);
   mesh->totpoly = totpoly;
+  /* Layers shared with evaluated copies got their own copy. */
+  BKE_mesh_update_customdata_pointers(mesh, false);
 }
 
 void ED_mesh_verts_remove(Mesh *mesh, ReportList *reports, int count)
@@ -342,8 +342,9 @@ static int screen_render_exec(bContext *C, wmOperator *op)
   /* cleanup sequencer caches before starting user triggered render.
    * otherwise, invalidated cache entries can make their way into
    * the output rendering. We can't put that into RE_RenderFrame,
-   * since sequence rendering can call that recursively... (peter) */
-  BKE_sequencer_cache_cleanup(scene);
+   * since sequence rendering can call that recursively... (peter)
+   * The disk cache is invalidated on edits, so it can be kept. */
+  BKE_sequencer_cache_cleanup_memory(scene);
 
   RE_SetReports(re, op->reports);
 
@@ -960,8 +961,9 @@ static int screen_render_invoke(bContext *C, wmOperator *op, const wmEvent *even
   /* cleanup sequencer caches before starting user triggered render.
    * otherwise, invalidated cache entries can make their way into
    * the output rendering. We can't put that into RE_RenderFrame,
-   * since sequence rendering can call that recursively... (peter) */
-  BKE_sequencer_cache_cleanup(scene);
+   * since sequence rendering can call that recursively... (peter)
+   * The disk cache is invalidated on edits, so it can be kept. */
+  BKE_sequencer_cache_cleanup_memory(scene);
 
   // store spare
   // get view3d layer, local layer, make this nice api call to render
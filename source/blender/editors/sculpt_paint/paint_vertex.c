@@ -1157,6 +1157,8 @@ static void ed_vwpaintmode_enter_generic(Main *bmain,
 
   /* Flush object mode. */
   DEG_id_tag_update(&ob->id, ID_RECALC_COPY_ON_WRITE);
+  /* Strokes write the original mesh, the evaluated one stops sharing its layers. */
+  DEG_id_tag_update(&me->id, ID_RECALC_COPY_ON_WRITE);
 }
 
 void ED_object_vpaintmode_enter_ex(
@@ -8574,6 +8574,8 @@ void ED_object_sculptmode_enter_ex(Main *bmain,
 
   /* Flush object mode. */
   DEG_id_tag_update(&ob->id, ID_RECALC_COPY_ON_WRITE);
+  /* Strokes write the original mesh, the evaluated one stops sharing its layers. */
+  DEG_id_tag_update(&me->id, ID_RECALC_COPY_ON_WRITE);
 }
 
 void ED_object_sculptmode_enter(struct bContext *C, Depsgraph *depsgraph, ReportList *reports)
@@ -681,7 +681,7 @@ static void namebutton_cb(bContext *C, void *tsep, char *oldname)
     TreeElement *te = outliner_find_tree_element(&soops->tree, tselem);
 
     if (tselem->type == 0) {
-      BLI_libblock_ensure_unique_name(bmain, tselem->id->name);
+      BLI_libblock_ensure_unique_name(bmain, tselem->id);
 
       switch (GS(tselem->id->name)) {
         case ID_MA:
@@ -739,7 +739,7 @@ static void namebutton_cb(bContext *C, void *tsep, char *oldname)
           defgroup_unique_name(te->directdata, (Object *)tselem->id);  //  id = object
           break;
         case TSE_NLA_ACTION:
-          BLI_libblock_ensure_unique_name(bmain, tselem->id->name);
+          BLI_libblock_ensure_unique_name(bmain, tselem->id);
           break;
         case TSE_EBONE: {
           bArmature *arm = (bArmature *)tselem->id;
@@ -837,7 +837,7 @@ static void namebutton_cb(bContext *C, void *tsep, char *oldname)
           break;
         }
         case TSE_LAYER_COLLECTION: {
-          BLI_libblock_ensure_unique_name(bmain, tselem->id->name);
+          BLI_libblock_ensure_unique_name(bmain, tselem->id);
           WM_event_add_notifier(C, NC_ID | NA_RENAME, NULL);
           break;
         }
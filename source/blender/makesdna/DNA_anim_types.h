@@ -614,6 +614,9 @@ typedef struct FCurve {
   float color[3];
 
   float prev_norm_factor, prev_offset;
+
+  /** Runtime segment lookup and Bezier coefficients, see #BKE_fcurves_evaluate_batch. */
+  struct FCurveEvalCache *eval_cache;
 } FCurve;
 
 /* user-editable flags/settings */
@@ -222,6 +222,10 @@ enum {
   CD_FLAG_EXTERNAL = (1 << 3),
   /* Indicates external data is read into memory */
   CD_FLAG_IN_MEMORY = (1 << 4),
+  /* Indicates the layer data may be shared with layers of other CustomData (run-time only) */
+  CD_FLAG_SHARED = (1 << 5),
+  /* Indicates the layer doesn't own its shared data, it copies it before modifying it */
+  CD_FLAG_SHARED_COPY_ON_WRITE = (1 << 6),
 };
 
 /* Limits */
@@ -33,6 +33,7 @@
 
 struct AnimData;
 struct Ipo;
+struct KeySparseData;
 
 typedef struct KeyBlock {
   struct KeyBlock *next, *prev;
@@ -100,6 +101,9 @@ typedef struct Key {
 
   ID *from;
 
+  /** Runtime only: elements changed by each key block, for evaluation of relative keys. */
+  struct KeySparseData *sparse_data;
+
   /** (totkey == BLI_listbase_count(&key->block)) */
   int totkey;
   short flag;
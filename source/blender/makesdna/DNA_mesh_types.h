@@ -47,6 +47,7 @@ struct MPoly;
 struct MVert;
 struct Material;
 struct Mesh;
+struct MeshNormalsCache;
 struct Multires;
 struct SubdivCCG;
 
@@ -101,10 +102,20 @@ typedef struct Mesh_Runtime {
 
   /** 'BVHCache', for 'BKE_bvhutil.c' */
   struct LinkNode *bvh_cache;
+  /**
+   * Trees of the previous evaluated mesh of the object,
+   * refitted instead of built again when the topology didn't change.
+   */
+  struct LinkNode *bvh_cache_prev;
+  /** Hash of the topology the trees depend on, zero when not computed yet. */
+  uint64_t topology_hash;
 
   /** Non-manifold boundary data for Shrinkwrap Target Project. */
   struct ShrinkwrapBoundaryData *shrinkwrap_data;
 
+  /** Cached poly and loop normals, see #BKE_mesh_runtime_poly_normals_ensure. */
+  struct MeshNormalsCache *normals_cache;
+
   /** Set by modifier stack if only deformed from original. */
   char deformed_only;
   /**
@@ -165,6 +165,18 @@ typedef struct Object_Runtime {
    * It has deformation only modifiers applied on it.
    */
   struct Mesh *mesh_deform_eval;
+  /**
+   * BVH trees of the last freed evaluated mesh,
+   * given to the next one, see #bvhcache_carry_over_store.
+   */
+  struct LinkNode *bvh_cache_prev;
+  /**
+   * Modifier cache keys of the stages of the last modifier stack evaluation, and the frame it was
+   * done at, see #mesh_calc_modifiers.
+   */
+  uint64_t *modifier_cache_keys;
+  int modifier_cache_keys_num;
+  float modifier_cache_ctime;
 
   /**
    * This is a mesh representation of corresponding object.
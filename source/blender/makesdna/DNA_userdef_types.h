@@ -851,6 +851,13 @@ typedef struct UserDef {
   char filebrowser_display_type; /* eUserpref_TempSpaceDisplayType */
   char _pad5[4];
 
+  /** 1024 = FILE_MAX. */
+  char sequencer_disk_cache_dir[1024];
+  /** Sequencer disk cache size limit in gigabytes. */
+  int sequencer_disk_cache_size_limit;
+  /** #eUserpref_SeqDiskCacheCompression. */
+  int sequencer_disk_cache_compression;
+
   struct WalkNavigation walk_navigation;
 
   /** The UI for the user preferences. */
@@ -1275,6 +1282,12 @@ typedef enum eUserpref_TempSpaceDisplayType {
   USER_TEMP_SPACE_DISPLAY_WINDOW,
 } eUserpref_TempSpaceDisplayType;
 
+typedef enum eUserpref_SeqDiskCacheCompression {
+  USER_SEQ_DISK_CACHE_COMPRESSION_NONE = 0,
+  USER_SEQ_DISK_CACHE_COMPRESSION_LOW = 1,
+  USER_SEQ_DISK_CACHE_COMPRESSION_HIGH = 2,
+} eUserpref_SeqDiskCacheCompression;
+
 typedef enum eUserpref_EmulateMMBMod {
   USER_EMU_MMB_MOD_ALT = 0,
   USER_EMU_MMB_MOD_OSKEY = 1,
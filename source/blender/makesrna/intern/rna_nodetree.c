@@ -9354,6 +9354,13 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
                            "Use two pass execution during editing: first calculate fast nodes, "
                            "second pass calculate all nodes");
 
+  prop = RNA_def_property(srna, "use_full_frame", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_FULL_FRAME);
+  RNA_def_property_ui_text(prop,
+                           "Full Frame",
+                           "Calculate each buffered operation for the full frame before the "
+                           "operations using it, instead of scheduling tiles on demand");
+
   prop = RNA_def_property(srna, "use_viewer_border", PROP_BOOLEAN, PROP_NONE);
   RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_VIEWER_BORDER);
   RNA_def_property_ui_text(
@@ -583,6 +583,9 @@ static void rna_Sequence_name_set(PointerRNA *ptr, const char *value)
     BKE_animdata_fix_paths_rename(
         &scene->id, adt, NULL, "sequence_editor.sequences_all", oldname, seq->name + 2, 0, 0, 1);
   }
+
+  /* Disk cache files are found by strip name. */
+  BKE_sequence_invalidate_cache_raw(scene, seq);
 }
 
 static StructRNA *rna_Sequence_refine(struct PointerRNA *ptr)
@@ -1952,6 +1955,14 @@ static void rna_def_editor(BlenderRNA *brna)
   RNA_def_property_float_sdna(prop, NULL, "recycle_max_cost");
   RNA_def_property_ui_text(
       prop, "Recycle Up to Cost", "Only frames with cost lower than this value will be recycled");
+
+  prop = RNA_def_property(srna, "use_cache_disk", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "cache_flag", SEQ_CACHE_DISK_CACHE_ENABLE);
+  RNA_def_property_ui_text(prop,
+                           "Use Disk Cache",
+                           "Also store cached images on disk, so they can be used after the "
+                           "memory cache is full and in later sessions (requires a saved file "
+                           "and a disk cache directory in the preferences)");
 }
 
 static void rna_def_filter_video(StructRNA *srna)
@@ -49,6 +49,9 @@
 typedef struct SubsurfRuntimeData {
   /* Cached subdivision surface descriptor, with topology and settings. */
   struct Subdiv *subdiv;
+
+  /* Last subdivided mesh, for deforming animation. */
+  SubdivMeshCache mesh_cache;
 } SubsurfRuntimeData;
 
 static void initData(ModifierData *md)
@@ -83,6 +86,7 @@ static void freeRuntimeData(void *runtime_data_v)
   if (runtime_data->subdiv != NULL) {
     BKE_subdiv_free(runtime_data->subdiv);
   }
+  BKE_subdiv_mesh_cache_free(&runtime_data->mesh_cache);
   MEM_freeN(runtime_data);
 }
 
@@ -157,14 +161,19 @@ static Mesh *subdiv_as_mesh(SubsurfModifierData *smd,
                             Mesh *mesh,
                             Subdiv *subdiv)
 {
+  SubsurfRuntimeData *runtime_data = (SubsurfRuntimeData *)smd->modifier.runtime;
   Mesh *result = mesh;
   SubdivToMeshSettings mesh_settings;
   subdiv_mesh_settings_init(&mesh_settings, smd, ctx);
   if (mesh_settings.resolution < 3) {
     return result;
   }
-  result = BKE_subdiv_to_mesh(subdiv, &mesh_settings, mesh);
-  return result;
+  /* Orco evaluation subdivides a different mesh with the same descriptor, keep the cache for
+   * the regular evaluation. */
+  if (ctx->flag & MOD_APPLY_ORCO) {
+    return BKE_subdiv_to_mesh(subdiv, &mesh_settings, mesh);
+  }
+  return BKE_subdiv_to_mesh_cached(subdiv, &mesh_settings, mesh, &runtime_data->mesh_cache);
 }
 
 /* Subdivide into CCG. */
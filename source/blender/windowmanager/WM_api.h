@@ -172,6 +172,10 @@ bool WM_stereo3d_enabled(struct wmWindow *win, bool only_fullscreen_test);
 /* files */
 void WM_file_autoexec_init(const char *filepath);
 bool WM_file_read(struct bContext *C, const char *filepath, struct ReportList *reports);
+bool WM_file_read_ex(struct bContext *C,
+                     const char *filepath,
+                     const char *scene_name,
+                     struct ReportList *reports);
 void WM_autosave_init(struct wmWindowManager *wm);
 void WM_recover_last_session(struct bContext *C, struct ReportList *reports);
 void WM_file_tag_modified(void);
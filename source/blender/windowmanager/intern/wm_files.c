@@ -595,7 +595,14 @@ static void wm_file_read_post(bContext *C,
   }
 }
 
-bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
+/**
+ * \param scene_name: The scene to read instead of the active one and the UI when only used
+ * data-blocks are read (see #G_FLAG_READ_USED_ONLY), may be NULL.
+ */
+bool WM_file_read_ex(bContext *C,
+                     const char *filepath,
+                     const char *scene_name,
+                     ReportList *reports)
 {
   /* assume automated tasks with background, don't write recent file list */
   const bool do_history = (G.background == false) && (CTX_wm_manager(C)->op_undo_depth == 0);
@@ -625,19 +632,30 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
     /* also exit screens and editors */
     wm_window_match_init(C, &wmbase);
 
+    /* Loading preferences when the user intended to load a regular file is a security risk,
+     * because the excluded path list is also loaded.
+     * Further it's just confusing if a user loads a file and various preferences change. */
+    eBLOReadSkip skip_flags = BLO_READ_SKIP_USERDEF;
+    /* Rendering a single scene in the background doesn't need any other data. */
+    char root_idname[MAX_ID_NAME];
+    root_idname[0] = '\0';
+    if (G.background && (G.f & G_FLAG_READ_USED_ONLY)) {
+      skip_flags |= BLO_READ_SKIP_UNUSED;
+      if (scene_name != NULL) {
+        BLI_snprintf(root_idname, sizeof(root_idname), "SC%s", scene_name);
+      }
+    }
+
     /* confusing this global... */
     G.relbase_valid = 1;
-    success = BKE_blendfile_read(
-        C,
-        filepath,
-        /* Loading preferences when the user intended to load a regular file is a security risk,
-         * because the excluded path list is also loaded.
-         * Further it's just confusing if a user loads a file and various preferences change. */
-        &(const struct BlendFileReadParams){
-            .is_startup = false,
-            .skip_flags = BLO_READ_SKIP_USERDEF,
-        },
-        reports);
+    success = BKE_blendfile_read(C,
+                                 filepath,
+                                 &(const struct BlendFileReadParams){
+                                     .is_startup = false,
+                                     .skip_flags = skip_flags,
+                                     .root_idname = root_idname[0] ? root_idname : NULL,
+                                 },
+                                 reports);
 
     /* BKE_file_read sets new Main into context. */
     Main *bmain = CTX_data_main(C);
@@ -712,6 +730,11 @@ bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
   return success;
 }
 
+bool WM_file_read(bContext *C, const char *filepath, ReportList *reports)
+{
+  return WM_file_read_ex(C, filepath, NULL, reports);
+}
+
 static struct {
   char app_template[64];
   bool override;
@@ -1343,6 +1366,11 @@ static bool wm_file_write(bContext *C, const char *filepath, int fileflags, Repo
     return ok;
   }
 
+  if (bmain->is_read_partial) {
+    BKE_report(reports, RPT_ERROR, "Only the data used by the active scene was read, cannot save");
+    return ok;
+  }
+
   /* Check if file write permission is ok */
   if (BLI_exists(filepath) && !BLI_file_is_writable(filepath)) {
     BKE_reportf(reports, RPT_ERROR, "Cannot save blend file, path '%s' is not writable", filepath);
@@ -1523,9 +1551,13 @@ void wm_autosave_timer(const bContext *C, wmWindowManager *wm, wmTimer *UNUSED(w
     }
   }
   else {
-    /*  save as regular blend file */
+    /*  save as regular blend file, compressed when the file is saved compressed.
+     * Chunked compression only re-compresses data that changed since the last auto-save. */
     Main *bmain = CTX_data_main(C);
     int fileflags = G.fileflags & ~(G_FILE_COMPRESS | G_FILE_HISTORY);
+    if (G.fileflags & G_FILE_COMPRESS) {
+      fileflags |= G_FILE_COMPRESS_CHUNKED;
+    }
 
     ED_editors_flush_edits(bmain, false);
 
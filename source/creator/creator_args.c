@@ -42,9 +42,11 @@
 #  include "BLI_fileops.h"
 #  include "BLI_mempool.h"
 #  include "BLI_system.h"
+#  include "BLI_trace.h"
 
 #  include "BLO_readfile.h" /* only for BLO_has_bfile_extension */
 
+#  include "BKE_blender.h"
 #  include "BKE_blender_version.h"
 #  include "BKE_context.h"
 
@@ -520,6 +522,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--background");
   BLI_argsPrintArgDoc(ba, "--render-anim");
   BLI_argsPrintArgDoc(ba, "--scene");
+  BLI_argsPrintArgDoc(ba, "--read-used-only");
   BLI_argsPrintArgDoc(ba, "--render-frame");
   BLI_argsPrintArgDoc(ba, "--frame-start");
   BLI_argsPrintArgDoc(ba, "--frame-end");
@@ -598,6 +601,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-no-threads");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-time");
   BLI_argsPrintArgDoc(ba, "--debug-depsgraph-pretty");
+  BLI_argsPrintArgDoc(ba, "--debug-trace");
   BLI_argsPrintArgDoc(ba, "--debug-gpu");
   BLI_argsPrintArgDoc(ba, "--debug-gpumem");
   BLI_argsPrintArgDoc(ba, "--debug-gpu-shaders");
@@ -1080,6 +1084,55 @@ static int arg_handle_debug_fpe_set(int UNUSED(argc),
   return 0;
 }
 
+static char trace_filepath[FILE_MAX];
+
+static void arg_trace_write_atexit(void *UNUSED(user_data))
+{
+  BLI_trace_end();
+  if (BLI_trace_write(trace_filepath)) {
+    printf("Trace written to '%s'\n", trace_filepath);
+  }
+  else {
+    printf("\nError: could not write trace to '%s'.\n", trace_filepath);
+  }
+  BLI_trace_free();
+}
+
+static const char arg_handle_debug_trace_set_doc[] =
+    "<filepath>\n"
+    "\tRecord a timeline of depsgraph, modifier and compositor evaluation on all threads,\n"
+    "\twritten on exit as Chrome trace JSON (open in 'chrome://tracing' or Perfetto).";
+static int arg_handle_debug_trace_set(int argc, const char **argv, void *UNUSED(data))
+{
+  const char *arg_id = "--debug-trace";
+  if (argc > 1) {
+    BLI_strncpy(trace_filepath, argv[1], sizeof(trace_filepath));
+    BLI_path_cwd(trace_filepath, sizeof(trace_filepath));
+    if (!BLI_trace_is_recording()) {
+      BLI_trace_begin();
+      BKE_blender_atexit_register(arg_trace_write_atexit, NULL);
+    }
+    return 1;
+  }
+  else {
+    printf("\nError: '%s' no args given.\n", arg_id);
+    return 0;
+  }
+}
+
+static const char arg_handle_read_used_only_set_doc[] =
+    "\n\t"
+    "Only read the active scene and the data it uses from blend files loaded in background mode.\n"
+    "\tThe scene set by '-S / --scene' after the file is read instead of the active one.\n"
+    "\tSpeeds up rendering of large files, files read this way can't be saved.";
+static int arg_handle_read_used_only_set(int UNUSED(argc),
+                                         const char **UNUSED(argv),
+                                         void *UNUSED(data))
+{
+  G.f |= G_FLAG_READ_USED_ONLY;
+  return 0;
+}
+
 static const char arg_handle_app_template_doc[] =
     "<template>\n"
     "\tSet the application template (matching the directory name), use 'default' for none.";
@@ -1951,7 +2004,24 @@ static int arg_handle_addons_set(int argc, const char **argv, void *data)
   }
 }
 
-static int arg_handle_load_file(int UNUSED(argc), const char **argv, void *data)
+/**
+ * With `--read-used-only`, the scene set by a following `-S / --scene`,
+ * which has to be read in place of the active one.
+ */
+static const char *arg_load_file_scene_name(int argc, const char **argv)
+{
+  if (!(G.background && (G.f & G_FLAG_READ_USED_ONLY))) {
+    return NULL;
+  }
+  for (int i = 1; i + 1 < argc; i++) {
+    if (STREQ(argv[i], "-S") || STREQ(argv[i], "--scene")) {
+      return argv[i + 1];
+    }
+  }
+  return NULL;
+}
+
+static int arg_handle_load_file(int argc, const char **argv, void *data)
 {
   bContext *C = data;
   ReportList reports;
@@ -1971,7 +2041,14 @@ static int arg_handle_load_file(int UNUSED(argc), const char **argv, void *data)
   /* load the file */
   BKE_reports_init(&reports, RPT_PRINT);
   WM_file_autoexec_init(filename);
-  success = WM_file_read(C, filename, &reports);
+  const char *scene_name = arg_load_file_scene_name(argc, argv);
+  success = WM_file_read_ex(C, filename, scene_name, &reports);
+  if (success && scene_name &&
+      BKE_libblock_find_name(CTX_data_main(C), ID_SCE, scene_name) == NULL) {
+    /* Read the active scene, '-S / --scene' reports the missing one as without
+     * '--read-used-only'. */
+    success = WM_file_read(C, filename, &reports);
+  }
   BKE_reports_clear(&reports);
 
   if (success) {
@@ -2102,6 +2179,7 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_argsAdd(ba, 1, NULL, "--debug-io", CB(arg_handle_debug_mode_io), NULL);
 
   BLI_argsAdd(ba, 1, NULL, "--debug-fpe", CB(arg_handle_debug_fpe_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--debug-trace", CB(arg_handle_debug_trace_set), NULL);
 
 #  ifdef WITH_LIBMV
   BLI_argsAdd(ba, 1, NULL, "--debug-libmv", CB(arg_handle_debug_mode_libmv), NULL);
@@ -2189,6 +2267,7 @@ void main_args_setup(bContext *C, bArgs *ba)
 
   BLI_argsAdd(ba, 1, NULL, "--app-template", CB(arg_handle_app_template), NULL);
   BLI_argsAdd(ba, 1, NULL, "--factory-startup", CB(arg_handle_factory_startup_set), NULL);
+  BLI_argsAdd(ba, 1, NULL, "--read-used-only", CB(arg_handle_read_used_only_set), NULL);
   BLI_argsAdd(
       ba, 1, NULL, "--disable-library-override", CB(arg_handle_disable_override_library), NULL);
   BLI_argsAdd(ba, 1, NULL, "--enable-event-simulate", CB(arg_handle_enable_event_simulate), NULL);
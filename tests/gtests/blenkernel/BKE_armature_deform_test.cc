@@ -0,0 +1,220 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/blendfile_loading_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "DNA_action_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_action.h"
+#include "BKE_armature.h"
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_lattice.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_object_deform.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_string.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define VERTS_NUM 1000000
+#define BONES_NUM 200
+#define VERT_WEIGHTS_NUM 4
+#define CHECK_STEP 997
+
+class ArmatureDeformTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Object *rig = nullptr;
+  Object *object = nullptr;
+  Mesh *mesh = nullptr;
+  std::vector<float> coords;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+  }
+
+  virtual void TearDown()
+  {
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /* Row of bones, each rotated and moved by a different amount. */
+  void build_rig()
+  {
+    rig = BKE_object_add_only_object(bmain, OB_ARMATURE, "Rig");
+    bArmature *arm = BKE_armature_add(bmain, "Armature");
+    rig->data = arm;
+
+    for (int i = 0; i < BONES_NUM; i++) {
+      Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+      BLI_snprintf(bone->name, sizeof(bone->name), "Bone %d", i);
+      bone->layer = 1;
+      bone->weight = 1.0f;
+      bone->segments = 1;
+      bone->head[0] = bone->tail[0] = (float)i;
+      bone->tail[1] = 1.0f;
+      BLI_addtail(&arm->bonebase, bone);
+    }
+    BKE_armature_where_is(arm);
+    BKE_pose_rebuild(bmain, rig, arm, true);
+
+    int i = 0;
+    LISTBASE_FOREACH (bPoseChannel *, pchan, &rig->pose->chanbase) {
+      axis_angle_to_mat4_single(pchan->chan_mat, 'Z', 0.01f * i);
+      pchan->chan_mat[3][2] = 0.1f * (i % 10);
+      mat4_to_dquat(&pchan->runtime.deform_dual_quat, pchan->bone->arm_mat, pchan->chan_mat);
+      i++;
+    }
+  }
+
+  /* Vertices with weights for a few neighboring bones. */
+  void build_object()
+  {
+    object = BKE_object_add_only_object(bmain, OB_MESH, "Object");
+    mesh = BKE_mesh_add(bmain, "Mesh");
+    object->data = mesh;
+
+    for (int i = 0; i < BONES_NUM; i++) {
+      char name[MAXBONENAME];
+      BLI_snprintf(name, sizeof(name), "Bone %d", i);
+      BKE_object_defgroup_add_name(object, name);
+    }
+    /* Group without bone, which has to be skipped. */
+    BKE_object_defgroup_add_name(object, "Other");
+
+    mesh->totvert = VERTS_NUM;
+    CustomData_add_layer(&mesh->vdata, CD_MVERT, CD_CALLOC, NULL, mesh->totvert);
+    CustomData_add_layer(&mesh->vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, mesh->totvert);
+    BKE_mesh_update_customdata_pointers(mesh, false);
+
+    coords.resize(VERTS_NUM * 3);
+    for (int v = 0; v < VERTS_NUM; v++) {
+      const float x = (float)(v % 1000) / 1000.0f * BONES_NUM;
+      coords[v * 3 + 0] = x;
+      coords[v * 3 + 1] = (float)(v / 1000) / 1000.0f;
+      coords[v * 3 + 2] = 0.0f;
+
+      MDeformVert *dvert = &mesh->dvert[v];
+      for (int j = 0; j < VERT_WEIGHTS_NUM; j++) {
+        const int bone = ((int)x + j) % BONES_NUM;
+        defvert_add_index_notest(dvert, bone, 1.0f / (j + 1));
+      }
+      defvert_add_index_notest(dvert, BONES_NUM, 1.0f);
+    }
+  }
+
+  /* Deformation of a vertex by each bone separately, as a reference. */
+  void deform_vert_reference(int v, bool use_quaternion, float r_co[3])
+  {
+    const float *co = &coords[v * 3];
+    const MDeformVert *dvert = &mesh->dvert[v];
+    float sum[3] = {0.0f, 0.0f, 0.0f};
+    DualQuat sum_dq;
+    float contrib = 0.0f;
+    memset(&sum_dq, 0, sizeof(sum_dq));
+
+    for (int j = 0; j < dvert->totweight; j++) {
+      const MDeformWeight *dw = &dvert->dw[j];
+      if (dw->def_nr >= BONES_NUM) {
+        continue;
+      }
+      const bPoseChannel *pchan = (bPoseChannel *)BLI_findlink(&rig->pose->chanbase, dw->def_nr);
+      if (use_quaternion) {
+        add_weighted_dq_dq(&sum_dq, &pchan->runtime.deform_dual_quat, dw->weight);
+      }
+      else {
+        float tmp[3];
+        mul_v3_m4v3(tmp, pchan->chan_mat, co);
+        sub_v3_v3(tmp, co);
+        madd_v3_v3fl(sum, tmp, dw->weight);
+      }
+      contrib += dw->weight;
+    }
+
+    copy_v3_v3(r_co, co);
+    if (use_quaternion) {
+      normalize_dq(&sum_dq, contrib);
+      mul_v3m3_dq(r_co, nullptr, &sum_dq);
+    }
+    else {
+      madd_v3_v3fl(r_co, sum, 1.0f / contrib);
+    }
+  }
+
+  /* Deform all vertices, returns the time taken. */
+  double deform(int deformflag, std::vector<float> &r_coords)
+  {
+    r_coords = coords;
+    const double start_time = PIL_check_seconds_timer();
+    armature_deform_verts(rig,
+                          object,
+                          mesh,
+                          (float(*)[3])r_coords.data(),
+                          nullptr,
+                          VERTS_NUM,
+                          deformflag,
+                          nullptr,
+                          "",
+                          nullptr);
+    return PIL_check_seconds_timer() - start_time;
+  }
+};
+
+TEST_F(ArmatureDeformTest, Benchmark)
+{
+  build_rig();
+  build_object();
+
+  std::vector<float> coords_linear, coords_quaternion;
+  const double time_linear = deform(ARM_DEF_VGROUP, coords_linear);
+  const double time_quaternion = deform(ARM_DEF_VGROUP | ARM_DEF_QUATERNION, coords_quaternion);
+
+  for (int v = 0; v < VERTS_NUM; v += CHECK_STEP) {
+    float co_linear[3], co_quaternion[3];
+    deform_vert_reference(v, false, co_linear);
+    deform_vert_reference(v, true, co_quaternion);
+    for (int k = 0; k < 3; k++) {
+      EXPECT_NEAR(coords_linear[v * 3 + k], co_linear[k], 1e-3f);
+      EXPECT_NEAR(coords_quaternion[v * 3 + k], co_quaternion[k], 1e-3f);
+    }
+  }
+
+  printf("%d vertices with %d bones: linear blending %.2f ms, dual quaternions %.2f ms\n",
+         VERTS_NUM,
+         BONES_NUM,
+         time_linear * 1e3,
+         time_quaternion * 1e3);
+}
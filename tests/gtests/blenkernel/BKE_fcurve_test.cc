@@ -0,0 +1,148 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "testing/testing.h"
+
+#include <vector>
+
+extern "C" {
+#include "DNA_anim_types.h"
+#include "DNA_curve_types.h"
+
+#include "BKE_fcurve.h"
+
+#include "BLI_math.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define FCURVES_NUM 100000
+#define KEYS_NUM 20
+#define FRAMES_NUM 100
+/* Time between evaluations, keys are a few frames apart. */
+#define FRAME_STEP 0.5f
+
+class FCurveEvaluateTest : public testing::Test {
+ protected:
+  std::vector<FCurve *> fcurves;
+
+  virtual void TearDown()
+  {
+    for (FCurve *fcu : fcurves) {
+      free_fcurve(fcu);
+    }
+    fcurves.clear();
+  }
+
+  /* Curves with keyframes at varying times, mostly Bezier with automatic handles. */
+  void build_fcurves(int fcurves_num)
+  {
+    for (int i = 0; i < fcurves_num; i++) {
+      FCurve *fcu = (FCurve *)MEM_callocN(sizeof(FCurve), __func__);
+      fcu->totvert = KEYS_NUM;
+      fcu->bezt = (BezTriple *)MEM_callocN(sizeof(BezTriple) * KEYS_NUM, __func__);
+      fcu->extend = (i % 5 == 0) ? FCURVE_EXTRAPOLATE_LINEAR : FCURVE_EXTRAPOLATE_CONSTANT;
+
+      float time = (float)(i % 7);
+      for (int k = 0; k < KEYS_NUM; k++) {
+        BezTriple *bezt = &fcu->bezt[k];
+        bezt->vec[1][0] = time;
+        bezt->vec[1][1] = sinf((float)(i + k * 3)) * 2.0f;
+        bezt->h1 = bezt->h2 = (k % 4 == 0) ? HD_VECT : HD_AUTO_ANIM;
+        bezt->ipo = BEZT_IPO_BEZ;
+        if (i % 11 == 0) {
+          bezt->ipo = (k % 3 == 0) ? BEZT_IPO_LIN : BEZT_IPO_CONST;
+        }
+        else if (i % 13 == 0) {
+          bezt->ipo = BEZT_IPO_ELASTIC;
+        }
+        /* Some keys on integer frames, others between them. */
+        time += (k % 2 == 0) ? 5.0f : 3.5f + (float)(i % 3) * 0.25f;
+      }
+      calchandles_fcurve(fcu);
+      fcurves.push_back(fcu);
+    }
+  }
+
+  /* Evaluate all curves one by one, returns the time taken. */
+  double evaluate(float evaltime, std::vector<float> &r_values)
+  {
+    r_values.resize(fcurves.size());
+    const double start_time = PIL_check_seconds_timer();
+    for (int i = 0; i < fcurves.size(); i++) {
+      r_values[i] = evaluate_fcurve(fcurves[i], evaltime);
+    }
+    return PIL_check_seconds_timer() - start_time;
+  }
+
+  double evaluate_batch(float evaltime, std::vector<float> &r_values)
+  {
+    r_values.resize(fcurves.size());
+    const double start_time = PIL_check_seconds_timer();
+    BKE_fcurves_evaluate_batch(fcurves.data(), fcurves.size(), evaltime, r_values.data());
+    return PIL_check_seconds_timer() - start_time;
+  }
+};
+
+TEST_F(FCurveEvaluateTest, SameResult)
+{
+  build_fcurves(1000);
+
+  /* Forward and backward playback, jumps, and times on and around keyframes. */
+  std::vector<float> times;
+  for (float time = -3.0f; time < 100.0f; time += 0.25f) {
+    times.push_back(time);
+  }
+  for (float time = 100.0f; time > -3.0f; time -= 1.0f) {
+    times.push_back(time);
+  }
+  for (int i = 0; i < 200; i++) {
+    times.push_back((float)((i * 37) % 103) - 3.0f + 0.0001f * (i % 3));
+  }
+
+  std::vector<float> values, values_batch;
+  for (float time : times) {
+    evaluate(time, values);
+    evaluate_batch(time, values_batch);
+    for (int i = 0; i < fcurves.size(); i++) {
+      EXPECT_EQ(values_batch[i], values[i]) << "curve " << i << " at " << time;
+    }
+  }
+}
+
+TEST_F(FCurveEvaluateTest, Benchmark)
+{
+  build_fcurves(FCURVES_NUM);
+
+  std::vector<float> values, values_batch;
+  double time_single = 0.0, time_batch = 0.0;
+  for (int frame = 0; frame < FRAMES_NUM; frame++) {
+    const float time = frame * FRAME_STEP;
+    time_single += evaluate(time, values);
+    time_batch += evaluate_batch(time, values_batch);
+  }
+  EXPECT_EQ(values_batch, values);
+
+  printf("%d curves with %d keys: one by one %.2f ms, batched %.2f ms per frame\n",
+         FCURVES_NUM,
+         KEYS_NUM,
+         time_single / FRAMES_NUM * 1e3,
+         time_batch / FRAMES_NUM * 1e3);
+}
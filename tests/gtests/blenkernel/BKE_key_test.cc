@@ -0,0 +1,230 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/blendfile_loading_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "DNA_key_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_key.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_object_deform.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_string.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define VERTS_NUM 100000
+#define KEYS_NUM 100
+/* Vertices moved by each of the regular keys. */
+#define KEY_REGION_SIZE 2000
+#define FRAMES_NUM 10
+
+class KeyEvaluateTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Object *object = nullptr;
+  Mesh *mesh = nullptr;
+  Key *key = nullptr;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+  }
+
+  virtual void TearDown()
+  {
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /* Key block with the coordinates of the mesh. */
+  KeyBlock *add_keyblock(const char *name)
+  {
+    KeyBlock *kb = BKE_keyblock_add(key, name);
+    float(*co)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * VERTS_NUM, __func__);
+    for (int v = 0; v < VERTS_NUM; v++) {
+      copy_v3_v3(co[v], mesh->mvert[v].co);
+    }
+    kb->data = co;
+    kb->totelem = VERTS_NUM;
+    return kb;
+  }
+
+  /* Face-like shapes: most keys move a small region of the mesh, with a few exceptions which
+   * move everything, use vertex groups, are muted or are relative to another key. */
+  void build_object()
+  {
+    object = BKE_object_add_only_object(bmain, OB_MESH, "Object");
+    mesh = BKE_mesh_add(bmain, "Mesh");
+    object->data = mesh;
+    BKE_object_defgroup_add_name(object, "Group");
+
+    mesh->totvert = VERTS_NUM;
+    CustomData_add_layer(&mesh->vdata, CD_MVERT, CD_CALLOC, NULL, mesh->totvert);
+    CustomData_add_layer(&mesh->vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, mesh->totvert);
+    BKE_mesh_update_customdata_pointers(mesh, false);
+    for (int v = 0; v < VERTS_NUM; v++) {
+      mesh->mvert[v].co[0] = (float)(v % 1000) * 0.01f;
+      mesh->mvert[v].co[1] = (float)(v / 1000) * 0.01f;
+      mesh->mvert[v].co[2] = sinf((float)v);
+      defvert_add_index_notest(&mesh->dvert[v], 0, (float)(v % 7) / 6.0f);
+    }
+
+    key = BKE_key_add(bmain, &mesh->id);
+    key->type = KEY_RELATIVE;
+    mesh->key = key;
+    add_keyblock("Basis");
+
+    for (int k = 0; k < KEYS_NUM; k++) {
+      char name[64];
+      BLI_snprintf(name, sizeof(name), "Key %d", k);
+      KeyBlock *kb = add_keyblock(name);
+      float(*co)[3] = (float(*)[3])kb->data;
+
+      const bool move_all = (k % 25 == 0);
+      const int start = (k * 997) % (VERTS_NUM - KEY_REGION_SIZE);
+      const int end = move_all ? VERTS_NUM : start + KEY_REGION_SIZE;
+      for (int v = move_all ? 0 : start; v < end; v++) {
+        co[v][0] += 0.001f * (float)(k + 1);
+        co[v][2] -= 0.37f * sinf((float)(v + k));
+      }
+
+      if (k % 10 == 3) {
+        BLI_strncpy(kb->vgroup, "Group", sizeof(kb->vgroup));
+      }
+      if (k % 17 == 5) {
+        kb->flag |= KEYBLOCK_MUTE;
+      }
+      if (k % 30 == 7) {
+        /* Relative to the previous key. */
+        kb->relative = k;
+      }
+    }
+  }
+
+  void set_frame(int frame)
+  {
+    int k = 0;
+    LISTBASE_FOREACH (KeyBlock *, kb, &key->block) {
+      /* Some keys without influence in each frame. */
+      kb->curval = ((k + frame) % 4 == 0) ? 0.0f : 0.1f + 0.03f * ((k * 7 + frame) % 31);
+      k++;
+    }
+  }
+
+  /* Evaluation of each key on all vertices in order, as done before sparse keys. */
+  void evaluate_reference(std::vector<float> &r_coords)
+  {
+    r_coords.assign((float *)key->refkey->data, (float *)key->refkey->data + VERTS_NUM * 3);
+    LISTBASE_FOREACH (KeyBlock *, kb, &key->block) {
+      if (kb == key->refkey || (kb->flag & KEYBLOCK_MUTE) || kb->curval == 0.0f) {
+        continue;
+      }
+      const KeyBlock *refb = (KeyBlock *)BLI_findlink(&key->block, kb->relative);
+      const float *co = (float *)kb->data;
+      const float *ref_co = (float *)refb->data;
+      const bool use_weights = kb->vgroup[0] != '\0';
+      for (int v = 0; v < VERTS_NUM; v++) {
+        const float weight = use_weights ? mesh->dvert[v].dw->weight * kb->curval : kb->curval;
+        for (int j = 0; j < 3; j++) {
+          r_coords[v * 3 + j] -= weight * (ref_co[v * 3 + j] - co[v * 3 + j]);
+        }
+      }
+    }
+  }
+
+  /* Evaluate the key as an original or as an evaluated copy, returns the time taken. */
+  double evaluate(bool copied_on_write, std::vector<float> &r_coords)
+  {
+    SET_FLAG_FROM_TEST(key->id.tag, copied_on_write, LIB_TAG_COPIED_ON_WRITE);
+    r_coords.resize(VERTS_NUM * 3);
+    const double start_time = PIL_check_seconds_timer();
+    float *result = BKE_key_evaluate_object_ex(
+        object, nullptr, r_coords.data(), sizeof(float) * r_coords.size());
+    const double time = PIL_check_seconds_timer() - start_time;
+    key->id.tag &= ~LIB_TAG_COPIED_ON_WRITE;
+    EXPECT_EQ(result, r_coords.data());
+    return time;
+  }
+};
+
+TEST_F(KeyEvaluateTest, ExactResult)
+{
+  build_object();
+
+  std::vector<float> coords_reference, coords_dense, coords_sparse;
+  for (int frame = 0; frame < 3; frame++) {
+    set_frame(frame);
+    evaluate_reference(coords_reference);
+    evaluate(false, coords_dense);
+    evaluate(true, coords_sparse);
+    EXPECT_NE(key->sparse_data, nullptr);
+
+    /* Bitwise equal, not only close. */
+    EXPECT_EQ(memcmp(coords_dense.data(),
+                     coords_reference.data(),
+                     sizeof(float) * coords_reference.size()),
+              0);
+    EXPECT_EQ(memcmp(coords_sparse.data(),
+                     coords_reference.data(),
+                     sizeof(float) * coords_reference.size()),
+              0);
+  }
+}
+
+TEST_F(KeyEvaluateTest, Benchmark)
+{
+  build_object();
+
+  std::vector<float> coords_reference, coords;
+  double time_reference = 0.0, time_dense = 0.0, time_sparse = 0.0;
+  /* Build the sparse data outside of the timing, as it's done once per copy of the key. */
+  evaluate(true, coords);
+  for (int frame = 0; frame < FRAMES_NUM; frame++) {
+    set_frame(frame);
+    const double start_time = PIL_check_seconds_timer();
+    evaluate_reference(coords_reference);
+    time_reference += PIL_check_seconds_timer() - start_time;
+    time_dense += evaluate(false, coords);
+    time_sparse += evaluate(true, coords);
+  }
+  EXPECT_EQ(memcmp(coords.data(), coords_reference.data(), sizeof(float) * coords.size()), 0);
+
+  printf("%d vertices with %d keys: sequential %.2f ms, parallel %.2f ms, sparse %.2f ms\n",
+         VERTS_NUM,
+         KEYS_NUM,
+         time_reference / FRAMES_NUM * 1e3,
+         time_dense / FRAMES_NUM * 1e3,
+         time_sparse / FRAMES_NUM * 1e3);
+}
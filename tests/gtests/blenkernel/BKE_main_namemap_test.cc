@@ -0,0 +1,142 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/blendfile_loading_base_test.h"
+
+extern "C" {
+#include "DNA_ID.h"
+
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_main_namemap.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+
+#include "PIL_time.h"
+}
+
+#define IDS_NUM 100000
+#define BATCHES_NUM 10
+
+class MainNamemapTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+  }
+
+  virtual void TearDown()
+  {
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  ID *find(const char *name)
+  {
+    return BKE_libblock_find_name(bmain, ID_GR, name);
+  }
+};
+
+TEST_F(MainNamemapTest, CollidingNames)
+{
+  /* All IDs are given the same name, like objects imported by a script. Adding them should not
+   * get slower as the list grows. */
+  double batch_times[BATCHES_NUM];
+  for (int batch = 0; batch < BATCHES_NUM; batch++) {
+    const double start_time = PIL_check_seconds_timer();
+    for (int i = 0; i < IDS_NUM / BATCHES_NUM; i++) {
+      BKE_id_new(bmain, ID_GR, "Collection");
+    }
+    batch_times[batch] = PIL_check_seconds_timer() - start_time;
+  }
+
+  ASSERT_EQ(BLI_listbase_count(&bmain->collections), IDS_NUM);
+  EXPECT_TRUE(BKE_main_namemap_validate(bmain));
+  EXPECT_NE(find("Collection"), nullptr);
+  EXPECT_NE(find("Collection.001"), nullptr);
+  EXPECT_NE(find("Collection.99999"), nullptr);
+  EXPECT_EQ(find("Collection.100000"), nullptr);
+  EXPECT_LT(batch_times[BATCHES_NUM - 1], batch_times[0] * 5.0 + 0.01);
+
+  /* Names given with a number suffix collide with the generated ones too. */
+  ID *id = (ID *)BKE_id_new(bmain, ID_GR, "Collection.012");
+  EXPECT_STREQ(id->name + 2, "Collection.100000");
+
+  /* Smallest numbers freed by removal or renaming are used again. */
+  BKE_id_delete(bmain, find("Collection.500"));
+  BKE_libblock_rename(bmain, find("Collection.020"), "Other");
+  EXPECT_EQ(find("Collection.500"), nullptr);
+  EXPECT_STREQ(((ID *)BKE_id_new(bmain, ID_GR, "Collection"))->name + 2, "Collection.020");
+  EXPECT_STREQ(((ID *)BKE_id_new(bmain, ID_GR, "Collection"))->name + 2, "Collection.500");
+
+  /* Renaming the way RNA does it, by writing the name before making it unique. */
+  id = find("Other");
+  BLI_strncpy(id->name + 2, "Collection.001", sizeof(id->name) - 2);
+  BLI_libblock_ensure_unique_name(bmain, id);
+  EXPECT_STREQ(id->name + 2, "Collection.100001");
+  EXPECT_EQ(find("Other"), nullptr);
+  EXPECT_EQ(find("Collection.100001"), id);
+
+  /* IDs moved to another main and back, as partial file writing does, are only found in the
+   * main they are in. */
+  Main *bmain_other = BKE_main_new();
+  EXPECT_EQ(BKE_libblock_find_name(bmain_other, ID_GR, "Collection.100001"), nullptr);
+  BKE_main_namemap_remove_name(bmain, id);
+  BLI_remlink(&bmain->collections, id);
+  BLI_addtail(&bmain_other->collections, id);
+  BKE_main_namemap_add_name(bmain_other, id);
+  EXPECT_EQ(find("Collection.100001"), nullptr);
+  EXPECT_EQ(BKE_libblock_find_name(bmain_other, ID_GR, "Collection.100001"), id);
+  BKE_main_namemap_remove_name(bmain_other, id);
+  BLI_remlink(&bmain_other->collections, id);
+  BLI_addtail(&bmain->collections, id);
+  BKE_main_namemap_add_name(bmain, id);
+  EXPECT_EQ(find("Collection.100001"), id);
+  BKE_main_free(bmain_other);
+
+  /* Truncated names are kept unique. */
+  char long_name[MAX_ID_NAME - 2];
+  memset(long_name, 'a', sizeof(long_name) - 1);
+  long_name[sizeof(long_name) - 1] = '\0';
+  ID *id_long_a = (ID *)BKE_id_new(bmain, ID_GR, long_name);
+  ID *id_long_b = (ID *)BKE_id_new(bmain, ID_GR, long_name);
+  EXPECT_STRNE(id_long_a->name + 2, id_long_b->name + 2);
+  EXPECT_LT(strlen(id_long_b->name + 2), sizeof(long_name));
+
+  EXPECT_TRUE(BKE_main_namemap_validate(bmain));
+
+  /* Clearing the map builds it again from the list. */
+  BKE_main_namemap_clear(bmain);
+  EXPECT_NE(find("Collection.500"), nullptr);
+  EXPECT_TRUE(BKE_main_namemap_validate(bmain));
+
+  double time_total = 0.0;
+  for (int batch = 0; batch < BATCHES_NUM; batch++) {
+    time_total += batch_times[batch];
+  }
+  printf("%d IDs with the same name: %.2f ms, first %d %.2f ms, last %d %.2f ms\n",
+         IDS_NUM,
+         time_total * 1e3,
+         IDS_NUM / BATCHES_NUM,
+         batch_times[0] * 1e3,
+         IDS_NUM / BATCHES_NUM,
+         batch_times[BATCHES_NUM - 1] * 1e3);
+}
@@ -0,0 +1,276 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/mesh_grid_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
+
+#include "BLI_math.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define GRID_SIZE 1000
+/* About ten million triangles. */
+#define GRID_SIZE_BENCHMARK 2237
+#define SPLIT_ANGLE DEG2RADF(30.0f)
+
+class MeshNormalsTest : public MeshGridBaseTest {
+ protected:
+  Mesh *mesh = nullptr;
+
+  /* Grid of quads split into triangles, folded so that some edges are sharp. */
+  void build_mesh(int grid_size = GRID_SIZE)
+  {
+    mesh = BKE_mesh_add(bmain, "Mesh");
+    mesh_grid_fill(mesh, grid_size, true);
+
+    for (int v = 0; v < mesh->totvert; v++) {
+      MVert *mvert = &mesh->mvert[v];
+      mvert->co[2] = fabsf((float)((int)mvert->co[0] % 8 - 4));
+    }
+
+    BKE_mesh_calc_normals(mesh);
+  }
+
+  /* Poly and loop normals computed without the cache, returns the time taken. */
+  double calc_loop_normals(std::vector<float> &r_loop_normals)
+  {
+    r_loop_normals.resize(mesh->totloop * 3);
+    const double start_time = PIL_check_seconds_timer();
+    float(*poly_normals)[3] = (float(*)[3])MEM_malloc_arrayN(
+        mesh->totpoly, sizeof(*poly_normals), __func__);
+    BKE_mesh_calc_normals_poly(mesh->mvert,
+                               nullptr,
+                               mesh->totvert,
+                               mesh->mloop,
+                               mesh->mpoly,
+                               mesh->totloop,
+                               mesh->totpoly,
+                               poly_normals,
+                               true);
+    BKE_mesh_normals_loop_split(mesh->mvert,
+                                mesh->totvert,
+                                mesh->medge,
+                                mesh->totedge,
+                                mesh->mloop,
+                                (float(*)[3])r_loop_normals.data(),
+                                mesh->totloop,
+                                mesh->mpoly,
+                                (const float(*)[3])poly_normals,
+                                mesh->totpoly,
+                                true,
+                                SPLIT_ANGLE,
+                                nullptr,
+                                nullptr,
+                                nullptr);
+    MEM_freeN(poly_normals);
+    return PIL_check_seconds_timer() - start_time;
+  }
+
+  void calc_vert_normals(std::vector<float> &r_vert_normals)
+  {
+    r_vert_normals.resize(mesh->totvert * 3);
+    BKE_mesh_calc_normals_poly(mesh->mvert,
+                               (float(*)[3])r_vert_normals.data(),
+                               mesh->totvert,
+                               mesh->mloop,
+                               mesh->mpoly,
+                               mesh->totloop,
+                               mesh->totpoly,
+                               nullptr,
+                               false);
+  }
+
+  /* Vertex normals accumulated in a single thread in loop order, with the same operations as
+   * #BKE_mesh_calc_normals_poly. */
+  void calc_vert_normals_serial(std::vector<float> &r_vert_normals)
+  {
+    r_vert_normals.assign(mesh->totvert * 3, 0.0f);
+    float(*vert_normals)[3] = (float(*)[3])r_vert_normals.data();
+    std::vector<float> edge_vectors;
+
+    for (int p = 0; p < mesh->totpoly; p++) {
+      const MPoly *mp = &mesh->mpoly[p];
+      const MLoop *ml = &mesh->mloop[mp->loopstart];
+      const int nverts = mp->totloop;
+      edge_vectors.resize(nverts * 3);
+      float(*edgevecbuf)[3] = (float(*)[3])edge_vectors.data();
+
+      float pnor[3];
+      zero_v3(pnor);
+      const float *v_prev = mesh->mvert[ml[nverts - 1].v].co;
+      for (int i = 0, i_prev = nverts - 1; i < nverts; i_prev = i++) {
+        const float *v_curr = mesh->mvert[ml[i].v].co;
+        add_newell_cross_v3_v3v3(pnor, v_prev, v_curr);
+        sub_v3_v3v3(edgevecbuf[i_prev], v_prev, v_curr);
+        normalize_v3(edgevecbuf[i_prev]);
+        v_prev = v_curr;
+      }
+      if (normalize_v3(pnor) == 0.0f) {
+        pnor[2] = 1.0f;
+      }
+
+      const float *prev_edge = edgevecbuf[nverts - 1];
+      for (int i = 0; i < nverts; i++) {
+        float lnor[3];
+        mul_v3_v3fl(lnor, pnor, saacos(-dot_v3v3(edgevecbuf[i], prev_edge)));
+        add_v3_v3(vert_normals[ml[i].v], lnor);
+        prev_edge = edgevecbuf[i];
+      }
+    }
+
+    for (int v = 0; v < mesh->totvert; v++) {
+      if (normalize_v3(vert_normals[v]) == 0.0f) {
+        normalize_v3_v3(vert_normals[v], mesh->mvert[v].co);
+      }
+    }
+  }
+
+  /* Create the task scheduler again, with the number of threads of the system for 0. */
+  void task_scheduler_recreate(int num_threads)
+  {
+    BLI_threadapi_exit();
+    BLI_system_num_threads_override_set(num_threads);
+    BLI_threadapi_init();
+  }
+};
+
+TEST_F(MeshNormalsTest, LoopNormalsCache)
+{
+  build_mesh();
+
+  std::vector<float> loop_normals;
+  const double time_direct = calc_loop_normals(loop_normals);
+
+  EXPECT_EQ(BKE_mesh_runtime_loop_normals_get(mesh, true, SPLIT_ANGLE), nullptr);
+
+  double start_time = PIL_check_seconds_timer();
+  const float(*lnors)[3] = BKE_mesh_runtime_loop_normals_ensure(mesh, true, SPLIT_ANGLE);
+  const double time_ensure = PIL_check_seconds_timer() - start_time;
+
+  ASSERT_NE(lnors, nullptr);
+  for (int l = 0; l < mesh->totloop; l++) {
+    for (int k = 0; k < 3; k++) {
+      ASSERT_EQ(lnors[l][k], loop_normals[l * 3 + k]);
+    }
+  }
+
+  /* Sharp folds give different normals for loops of the same vertex. */
+  EXPECT_FALSE(equals_v3v3(lnors[6 * 3 + 1], lnors[8 * 3]));
+
+  /* Second call reuses the result, other settings don't. */
+  start_time = PIL_check_seconds_timer();
+  EXPECT_EQ(BKE_mesh_runtime_loop_normals_ensure(mesh, true, SPLIT_ANGLE), lnors);
+  const double time_cached = PIL_check_seconds_timer() - start_time;
+  EXPECT_EQ(BKE_mesh_runtime_loop_normals_get(mesh, true, SPLIT_ANGLE), lnors);
+  EXPECT_EQ(BKE_mesh_runtime_loop_normals_get(mesh, false, SPLIT_ANGLE), nullptr);
+
+  /* Moving vertices invalidates the cache. */
+  std::vector<float> coords(mesh->totvert * 3);
+  BKE_mesh_vert_coords_get(mesh, (float(*)[3])coords.data());
+  for (int v = 0; v < mesh->totvert; v++) {
+    coords[v * 3 + 2] *= 0.5f;
+  }
+  BKE_mesh_vert_coords_apply(mesh, (const float(*)[3])coords.data());
+  EXPECT_EQ(BKE_mesh_runtime_loop_normals_get(mesh, true, SPLIT_ANGLE), nullptr);
+
+  BKE_mesh_calc_normals(mesh);
+  calc_loop_normals(loop_normals);
+  lnors = BKE_mesh_runtime_loop_normals_ensure(mesh, true, SPLIT_ANGLE);
+  for (int l = 0; l < mesh->totloop; l++) {
+    for (int k = 0; k < 3; k++) {
+      ASSERT_EQ(lnors[l][k], loop_normals[l * 3 + k]);
+    }
+  }
+
+  /* Vertex normals tagged dirty compute poly normals again once, arrays returned before stay
+   * valid for their readers. */
+  const float(*pnors)[3] = BKE_mesh_runtime_poly_normals_ensure(mesh);
+  mesh->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
+  const float(*pnors_dirty)[3] = BKE_mesh_runtime_poly_normals_ensure(mesh);
+  EXPECT_NE(pnors_dirty, pnors);
+  EXPECT_TRUE(equals_v3v3(pnors[0], pnors_dirty[0]));
+  lnors = BKE_mesh_runtime_loop_normals_ensure(mesh, true, SPLIT_ANGLE);
+  EXPECT_EQ(BKE_mesh_runtime_poly_normals_ensure(mesh), pnors_dirty);
+  EXPECT_EQ(BKE_mesh_runtime_loop_normals_ensure(mesh, true, SPLIT_ANGLE), lnors);
+
+  printf("Mesh with %d triangles: loop normals %.2f ms, cache ensure %.2f ms, cached %.4f ms\n",
+         mesh->totpoly,
+         time_direct * 1e3,
+         time_ensure * 1e3,
+         time_cached * 1e3);
+}
+
+TEST_F(MeshNormalsTest, VertexNormalsThreaded)
+{
+  build_mesh();
+  /* Irregular faces, so the order in which weighted normals are added matters. */
+  for (int v = 0; v < mesh->totvert; v++) {
+    mesh->mvert[v].co[2] += 0.37f * sinf((float)v * 1.7f);
+  }
+
+  /* Vertex normals gathered by multiple threads are the same as the ones accumulated in a single
+   * thread, whatever the machine running the test. */
+  std::vector<float> vert_normals_single, vert_normals;
+  calc_vert_normals_serial(vert_normals_single);
+  task_scheduler_recreate(4);
+  EXPECT_EQ(BLI_task_scheduler_num_threads(BLI_task_scheduler_get()), 4);
+  calc_vert_normals(vert_normals);
+  task_scheduler_recreate(0);
+
+  for (int i = 0; i < mesh->totvert * 3; i++) {
+    ASSERT_EQ(vert_normals[i], vert_normals_single[i]);
+  }
+}
+
+TEST_F(MeshNormalsTest, VertexNormalsBenchmark)
+{
+  build_mesh(GRID_SIZE_BENCHMARK);
+
+  std::vector<float> vert_normals;
+  task_scheduler_recreate(1);
+  double start_time = PIL_check_seconds_timer();
+  calc_vert_normals(vert_normals);
+  const double time_single = PIL_check_seconds_timer() - start_time;
+
+  task_scheduler_recreate(0);
+  const int num_threads = BLI_task_scheduler_num_threads(BLI_task_scheduler_get());
+  start_time = PIL_check_seconds_timer();
+  calc_vert_normals(vert_normals);
+  const double time_threaded = PIL_check_seconds_timer() - start_time;
+
+  printf("Mesh with %d triangles: vertex normals %.2f ms on 1 thread, %.2f ms on %d threads\n",
+         mesh->totpoly,
+         time_single * 1e3,
+         time_threaded * 1e3,
+         num_threads);
+}
@@ -0,0 +1,228 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/blendfile_loading_base_test.h"
+
+#include <string>
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_main.h"
+#include "BKE_scene.h"
+#include "BKE_sequencer.h"
+
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+
+#include "DNA_scene_types.h"
+#include "DNA_sequence_types.h"
+#include "DNA_userdef_types.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+}
+
+#define FRAMES_NUM 20
+
+class SequencerCacheTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  SeqRenderData context;
+  std::string cache_dir;
+  UserDef userdef_backup;
+
+  virtual void SetUp()
+  {
+    BKE_tempdir_init(NULL);
+    cache_dir = std::string(BKE_tempdir_session()) + "sequencer_cache_test";
+
+    /* Small memory cache, so most frames only stay on disk. */
+    userdef_backup = U;
+    U.memcachelimit = 4;
+    BLI_strncpy(U.sequencer_disk_cache_dir, cache_dir.c_str(), sizeof(U.sequencer_disk_cache_dir));
+    U.sequencer_disk_cache_size_limit = 1;
+    U.sequencer_disk_cache_compression = USER_SEQ_DISK_CACHE_COMPRESSION_LOW;
+
+    bmain = BKE_main_new();
+    BLI_path_join(bmain->name, sizeof(bmain->name), cache_dir.c_str(), "test.blend", NULL);
+    scene = BKE_scene_add(bmain, "Scene");
+
+    Editing *ed = BKE_sequencer_editing_ensure(scene);
+    ed->cache_flag |= SEQ_CACHE_DISK_CACHE_ENABLE;
+
+    /* One frame long color strips, each with its own color. Strips are not adjacent, so
+     * invalidating one doesn't affect final images of others. */
+    for (int i = 0; i < FRAMES_NUM; i++) {
+      Sequence *seq = BKE_sequence_alloc(ed->seqbasep, strip_frame(i), 1, SEQ_TYPE_COLOR);
+      BLI_snprintf(seq->name + 2, sizeof(seq->name) - 2, "Color %d", i);
+      BKE_sequence_get_effect(seq).init(seq);
+      seq->len = 1;
+      seq->flag |= SEQ_USE_EFFECT_DEFAULT_FADE;
+      BKE_sequence_calc(scene, seq);
+      set_color(seq, (float)i / FRAMES_NUM);
+    }
+
+    BKE_sequencer_new_render_data(bmain, NULL, scene, 640, 360, 100, false, &context);
+  }
+
+  virtual void TearDown()
+  {
+    BKE_sequencer_editing_free(scene, true);
+    BKE_main_free(bmain);
+    BLI_delete(cache_dir.c_str(), true, true);
+    U = userdef_backup;
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  static int strip_frame(int index)
+  {
+    return index * 2 + 1;
+  }
+
+  Sequence *strip(int index)
+  {
+    return (Sequence *)BLI_findlink(&scene->ed->seqbase, index);
+  }
+
+  void set_color(Sequence *seq, float value)
+  {
+    SolidColorVars *colvars = (SolidColorVars *)seq->effectdata;
+    colvars->col[0] = colvars->col[1] = colvars->col[2] = value;
+  }
+
+  /* Red channel of the first pixel, as float. */
+  float render_frame(int cfra)
+  {
+    ImBuf *ibuf = BKE_sequencer_give_ibuf(&context, cfra, 0);
+    EXPECT_NE(ibuf, nullptr);
+    if (ibuf == NULL) {
+      return -1.0f;
+    }
+
+    const float value = (ibuf->rect_float) ? ibuf->rect_float[0] :
+                                             ((unsigned char *)ibuf->rect)[0] / 255.0f;
+    IMB_freeImBuf(ibuf);
+    return value;
+  }
+
+  static bool count_final_cb(void *userdata,
+                             Sequence * /*seq*/,
+                             int /*nfra*/,
+                             int cache_type,
+                             float /*cost*/)
+  {
+    if (cache_type == SEQ_CACHE_STORE_FINAL_OUT) {
+      (*(int *)userdata)++;
+    }
+    return false;
+  }
+
+  int memory_cache_final_frames()
+  {
+    int count = 0;
+    BKE_sequencer_cache_iterate(scene, &count, count_final_cb);
+    return count;
+  }
+
+  /* Number of files in all cache directories of the blend file, once queued images are
+   * written. */
+  int disk_cache_files_count(const char *dir)
+  {
+    BKE_sequencer_cache_disk_write_wait(scene);
+
+    struct direntry *entries;
+    const uint entries_num = BLI_filelist_dir_contents(dir, &entries);
+    int count = 0;
+
+    for (uint i = 0; i < entries_num; i++) {
+      if (S_ISDIR(entries[i].type) && !FILENAME_IS_CURRPAR(entries[i].relname)) {
+        char path[FILE_MAX];
+        BLI_path_join(path, sizeof(path), dir, entries[i].relname, NULL);
+        count += disk_cache_files_count(path);
+      }
+      else if (S_ISREG(entries[i].type)) {
+        count++;
+      }
+    }
+
+    BLI_filelist_free(entries, entries_num);
+    return count;
+  }
+};
+
+TEST_F(SequencerCacheTest, DiskCacheSpill)
+{
+  scene->r.cfra = strip_frame(FRAMES_NUM - 1);
+  for (int i = 0; i < FRAMES_NUM; i++) {
+    EXPECT_NEAR(render_frame(strip_frame(i)), (float)i / FRAMES_NUM, 1.0f / 255.0f);
+  }
+
+  /* Memory limit is exceeded, but every frame is stored on disk. */
+  EXPECT_LT(memory_cache_final_frames(), FRAMES_NUM);
+  EXPECT_EQ(disk_cache_files_count(cache_dir.c_str()), FRAMES_NUM);
+  EXPECT_NE(scene->ed->disk_cache_timestamp, 0);
+
+  /* Change the strip without invalidating the cache, images must come from disk. */
+  const float value_old = (float)1 / FRAMES_NUM;
+  set_color(strip(1), 1.0f);
+  BKE_sequencer_cache_cleanup_memory(scene);
+  EXPECT_EQ(memory_cache_final_frames(), 0);
+  EXPECT_NEAR(render_frame(strip_frame(1)), value_old, 1.0f / 255.0f);
+  EXPECT_EQ(memory_cache_final_frames(), 1);
+
+  /* Files are used again after the cache is freed, as in a new session. */
+  BKE_sequencer_cache_destruct(scene);
+  EXPECT_NEAR(render_frame(strip_frame(1)), value_old, 1.0f / 255.0f);
+
+  /* Invalidating the strip removes its files, other frames are kept. */
+  const int64_t timestamp = scene->ed->disk_cache_timestamp;
+  BKE_sequence_invalidate_cache_raw(scene, strip(1));
+  EXPECT_GT(scene->ed->disk_cache_timestamp, timestamp);
+  EXPECT_NEAR(render_frame(strip_frame(1)), 1.0f, 1.0f / 255.0f);
+  EXPECT_EQ(disk_cache_files_count(cache_dir.c_str()), FRAMES_NUM);
+
+  /* Full invalidation removes all files. */
+  BKE_sequencer_cache_cleanup(scene);
+  EXPECT_EQ(disk_cache_files_count(cache_dir.c_str()), 0);
+}
+
+TEST_F(SequencerCacheTest, DiskCacheOldTimestamp)
+{
+  render_frame(strip_frame(0));
+  render_frame(strip_frame(1));
+  EXPECT_EQ(disk_cache_files_count(cache_dir.c_str()), 2);
+
+  /* Reverting to a previously saved state must not use images of later edits. */
+  const int64_t timestamp = scene->ed->disk_cache_timestamp;
+  set_color(strip(0), 1.0f);
+  BKE_sequence_invalidate_cache_raw(scene, strip(0));
+  EXPECT_NEAR(render_frame(strip_frame(0)), 1.0f, 1.0f / 255.0f);
+  EXPECT_EQ(disk_cache_files_count(cache_dir.c_str()), 2);
+
+  set_color(strip(0), 0.0f);
+  BKE_sequencer_cache_destruct(scene);
+  scene->ed->disk_cache_timestamp = timestamp;
+  EXPECT_NEAR(render_frame(strip_frame(0)), 0.0f, 1.0f / 255.0f);
+
+  /* Files of the other time stamp are removed. */
+  EXPECT_EQ(disk_cache_files_count(cache_dir.c_str()), 1);
+}
@@ -0,0 +1,124 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/blendfile_loading_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "BKE_main.h"
+#include "BKE_scene.h"
+#include "BKE_sequencer.h"
+
+#include "BLI_string.h"
+
+#include "DNA_scene_types.h"
+#include "DNA_sequence_types.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+#include "PIL_time.h"
+}
+
+#define LAYERS_NUM 10
+#define FRAMES_NUM 8
+
+class SequencerRenderTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    Editing *ed = BKE_sequencer_editing_ensure(scene);
+
+    /* Half transparent color strips with a color balance modifier on every channel, so every
+     * layer has to be rendered, preprocessed and blended. */
+    for (int i = 0; i < LAYERS_NUM; i++) {
+      Sequence *seq = BKE_sequence_alloc(ed->seqbasep, 1, i + 1, SEQ_TYPE_COLOR);
+      BLI_snprintf(seq->name + 2, sizeof(seq->name) - 2, "Layer %d", i);
+      BKE_sequence_get_effect(seq).init(seq);
+      seq->len = FRAMES_NUM;
+      seq->flag |= SEQ_USE_EFFECT_DEFAULT_FADE;
+      seq->blend_mode = SEQ_TYPE_CROSS;
+      seq->blend_opacity = 50.0f;
+      BKE_sequence_calc(scene, seq);
+
+      SolidColorVars *colvars = (SolidColorVars *)seq->effectdata;
+      colvars->col[0] = (float)i / LAYERS_NUM;
+      colvars->col[1] = 1.0f - colvars->col[0];
+      colvars->col[2] = 0.5f;
+
+      BKE_sequence_modifier_new(seq, NULL, seqModifierType_ColorBalance);
+    }
+  }
+
+  virtual void TearDown()
+  {
+    BKE_sequencer_editing_free(scene, true);
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  /* Render all frames without cache, returns frames per second. */
+  double render(bool threaded, std::vector<unsigned char> &r_last_frame)
+  {
+    if (threaded) {
+      scene->r.mode &= ~R_FIXED_THREADS;
+    }
+    else {
+      scene->r.mode |= R_FIXED_THREADS;
+      scene->r.threads = 1;
+    }
+
+    SeqRenderData context;
+    BKE_sequencer_new_render_data(bmain, NULL, scene, 960, 540, 100, false, &context);
+    context.skip_cache = true;
+
+    const double start_time = PIL_check_seconds_timer();
+    for (int cfra = 1; cfra <= FRAMES_NUM; cfra++) {
+      ImBuf *ibuf = BKE_sequencer_give_ibuf(&context, cfra, 0);
+      EXPECT_NE(ibuf, nullptr);
+      if (ibuf && ibuf->rect && cfra == FRAMES_NUM) {
+        unsigned char *rect = (unsigned char *)ibuf->rect;
+        r_last_frame.assign(rect, rect + ibuf->x * ibuf->y * 4);
+      }
+      IMB_freeImBuf(ibuf);
+    }
+    return FRAMES_NUM / (PIL_check_seconds_timer() - start_time);
+  }
+};
+
+TEST_F(SequencerRenderTest, StripStackBenchmark)
+{
+  std::vector<unsigned char> result_single, result_threaded;
+
+  const double fps_single = render(false, result_single);
+  const double fps_threaded = render(true, result_threaded);
+
+  ASSERT_EQ((size_t)960 * 540 * 4, result_single.size());
+  EXPECT_EQ(result_single, result_threaded);
+
+  printf("%d layers at 960x540: strips in order %.2f fps, in parallel %.2f fps\n",
+         LAYERS_NUM,
+         fps_single,
+         fps_threaded);
+}
@@ -0,0 +1,371 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/blendfile_loading_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier_cache.h"
+#include "BKE_subdiv.h"
+#include "BKE_subdiv_mesh.h"
+
+#include "BLI_math.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+/* Torus of quads, about the density of a character base mesh. */
+#define MAJOR_SEGMENTS 128
+#define MINOR_SEGMENTS 64
+#define LEVEL 3
+#define FRAMES_NUM 5
+
+class SubdivMeshTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Mesh *mesh = nullptr;
+  std::vector<float> rest_coords;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+  }
+
+  virtual void TearDown()
+  {
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  int vert_index(int i, int j)
+  {
+    return (j % MINOR_SEGMENTS) * MAJOR_SEGMENTS + (i % MAJOR_SEGMENTS);
+  }
+
+  void build_mesh()
+  {
+    mesh = BKE_mesh_add(bmain, "Mesh");
+    mesh->totvert = MAJOR_SEGMENTS * MINOR_SEGMENTS;
+    mesh->totedge = mesh->totvert * 2;
+    mesh->totpoly = mesh->totvert;
+    mesh->totloop = mesh->totpoly * 4;
+
+    CustomData_add_layer(&mesh->vdata, CD_MVERT, CD_CALLOC, NULL, mesh->totvert);
+    CustomData_add_layer(&mesh->edata, CD_MEDGE, CD_CALLOC, NULL, mesh->totedge);
+    CustomData_add_layer(&mesh->ldata, CD_MLOOP, CD_CALLOC, NULL, mesh->totloop);
+    CustomData_add_layer_named(&mesh->ldata, CD_MLOOPUV, CD_CALLOC, NULL, mesh->totloop, "UV");
+    CustomData_add_layer(&mesh->pdata, CD_MPOLY, CD_CALLOC, NULL, mesh->totpoly);
+    BKE_mesh_update_customdata_pointers(mesh, false);
+
+    rest_coords.resize(mesh->totvert * 3);
+    for (int j = 0; j < MINOR_SEGMENTS; j++) {
+      for (int i = 0; i < MAJOR_SEGMENTS; i++) {
+        const float major_angle = 2.0f * (float)M_PI * i / MAJOR_SEGMENTS;
+        const float minor_angle = 2.0f * (float)M_PI * j / MINOR_SEGMENTS;
+        const float radius = 1.0f + 0.3f * cosf(minor_angle);
+        float *co = &rest_coords[vert_index(i, j) * 3];
+        co[0] = radius * cosf(major_angle);
+        co[1] = radius * sinf(major_angle);
+        co[2] = 0.3f * sinf(minor_angle);
+        copy_v3_v3(mesh->mvert[vert_index(i, j)].co, co);
+      }
+    }
+
+    /* Edges along the major direction first, then along the minor one. */
+    const int minor_edges_start = mesh->totvert;
+    for (int j = 0; j < MINOR_SEGMENTS; j++) {
+      for (int i = 0; i < MAJOR_SEGMENTS; i++) {
+        MEdge *edge = &mesh->medge[vert_index(i, j)];
+        edge->v1 = vert_index(i, j);
+        edge->v2 = vert_index(i + 1, j);
+        edge = &mesh->medge[minor_edges_start + vert_index(i, j)];
+        edge->v1 = vert_index(i, j);
+        edge->v2 = vert_index(i, j + 1);
+      }
+    }
+
+    for (int j = 0; j < MINOR_SEGMENTS; j++) {
+      for (int i = 0; i < MAJOR_SEGMENTS; i++) {
+        const int p = vert_index(i, j);
+        MPoly *poly = &mesh->mpoly[p];
+        poly->loopstart = p * 4;
+        poly->totloop = 4;
+        poly->flag = ME_SMOOTH;
+
+        MLoop *loop = &mesh->mloop[poly->loopstart];
+        loop[0].v = vert_index(i, j);
+        loop[0].e = vert_index(i, j);
+        loop[1].v = vert_index(i + 1, j);
+        loop[1].e = minor_edges_start + vert_index(i + 1, j);
+        loop[2].v = vert_index(i + 1, j + 1);
+        loop[2].e = vert_index(i, j + 1);
+        loop[3].v = vert_index(i, j + 1);
+        loop[3].e = minor_edges_start + vert_index(i, j);
+
+        MLoopUV *mloopuv = &mesh->mloopuv[poly->loopstart];
+        const float u = (float)i / MAJOR_SEGMENTS, v = (float)j / MINOR_SEGMENTS;
+        const float du = 1.0f / MAJOR_SEGMENTS, dv = 1.0f / MINOR_SEGMENTS;
+        ARRAY_SET_ITEMS(mloopuv[0].uv, u, v);
+        ARRAY_SET_ITEMS(mloopuv[1].uv, u + du, v);
+        ARRAY_SET_ITEMS(mloopuv[2].uv, u + du, v + dv);
+        ARRAY_SET_ITEMS(mloopuv[3].uv, u, v + dv);
+      }
+    }
+
+    BKE_mesh_calc_normals(mesh);
+  }
+
+  void subdiv_settings_init(SubdivSettings *settings)
+  {
+    memset(settings, 0, sizeof(*settings));
+    settings->level = LEVEL;
+    settings->is_adaptive = true;
+    settings->use_creases = true;
+    settings->vtx_boundary_interpolation = SUBDIV_VTX_BOUNDARY_EDGE_ONLY;
+    settings->fvar_linear_interpolation = SUBDIV_FVAR_LINEAR_INTERPOLATION_CORNERS_ONLY;
+  }
+
+  /* Bend the torus around the X axis, more with every frame, like an animated limb. */
+  void deform(int frame)
+  {
+    for (int v = 0; v < mesh->totvert; v++) {
+      const float *co = &rest_coords[v * 3];
+      float mat[3][3];
+      axis_angle_to_mat3_single(mat, 'X', 0.1f * frame * co[1]);
+      mul_v3_m3v3(mesh->mvert[v].co, mat, co);
+    }
+    BKE_mesh_calc_normals(mesh);
+  }
+};
+
+TEST_F(SubdivMeshTest, DeformBenchmark)
+{
+  build_mesh();
+
+  SubdivSettings settings;
+  subdiv_settings_init(&settings);
+  Subdiv *subdiv = BKE_subdiv_new_from_mesh(&settings, mesh);
+  ASSERT_NE(subdiv, nullptr);
+  if (subdiv->topology_refiner == nullptr) {
+    printf("Built without OpenSubdiv, skipping\n");
+    BKE_subdiv_free(subdiv);
+    return;
+  }
+
+  SubdivToMeshSettings mesh_settings;
+  mesh_settings.resolution = (1 << LEVEL) + 1;
+  mesh_settings.use_optimal_display = false;
+
+  SubdivMeshCache cache = {nullptr};
+  Mesh *result_first = BKE_subdiv_to_mesh_cached(subdiv, &mesh_settings, mesh, &cache);
+  ASSERT_NE(cache.mesh, nullptr);
+  ASSERT_NE(cache.vertex_samples, nullptr);
+  BKE_id_free(nullptr, result_first);
+
+  /* Memory of the results, the cached one only allocates vertices. */
+  double time_full = 0.0, time_update = 0.0;
+  size_t memory_full = 0, memory_update = 0;
+  for (int frame = 1; frame <= FRAMES_NUM; frame++) {
+    deform(frame);
+
+    size_t memory_start = MEM_get_memory_in_use();
+    double start_time = PIL_check_seconds_timer();
+    Mesh *result_full = BKE_subdiv_to_mesh(subdiv, &mesh_settings, mesh);
+    time_full += PIL_check_seconds_timer() - start_time;
+    memory_full += MEM_get_memory_in_use() - memory_start;
+
+    memory_start = MEM_get_memory_in_use();
+    start_time = PIL_check_seconds_timer();
+    Mesh *result_update = BKE_subdiv_to_mesh_cached(subdiv, &mesh_settings, mesh, &cache);
+    time_update += PIL_check_seconds_timer() - start_time;
+    memory_update += MEM_get_memory_in_use() - memory_start;
+
+    /* Vertices are owned by the result, everything else is shared with the cache. */
+    ASSERT_NE(result_update->mvert, cache.mesh->mvert);
+    ASSERT_EQ(result_update->mloop, cache.mesh->mloop);
+    ASSERT_EQ(result_update->mloopuv, cache.mesh->mloopuv);
+    EXPECT_FALSE(CustomData_has_copy_on_write(&result_update->vdata));
+    EXPECT_TRUE(CustomData_has_copy_on_write(&result_update->ldata));
+
+    ASSERT_EQ(result_update->totvert, result_full->totvert);
+    ASSERT_EQ(result_update->totloop, result_full->totloop);
+    for (int v = 0; v < result_full->totvert; v++) {
+      const MVert *mv_full = &result_full->mvert[v];
+      const MVert *mv_update = &result_update->mvert[v];
+      ASSERT_TRUE(equals_v3v3(mv_full->co, mv_update->co));
+      for (int k = 0; k < 3; k++) {
+        /* Edge normals are normalized without scaling, which can round differently. */
+        ASSERT_NEAR(mv_full->no[k], mv_update->no[k], 1);
+      }
+      ASSERT_EQ(mv_full->flag, mv_update->flag);
+    }
+    for (int l = 0; l < result_full->totloop; l++) {
+      ASSERT_EQ(result_full->mloop[l].v, result_update->mloop[l].v);
+      ASSERT_EQ(result_full->mloop[l].e, result_update->mloop[l].e);
+    }
+
+    BKE_id_free(nullptr, result_full);
+    BKE_id_free(nullptr, result_update);
+  }
+
+  /* The cache uses its layers alone again once the results are freed. */
+  EXPECT_FALSE(CustomData_has_copy_on_write(&cache.mesh->ldata));
+  EXPECT_LT(memory_update, memory_full);
+
+  printf("Level %d subdivision of %d faces into %d faces: full %.2f ms %.1f MB, "
+         "cached %.2f ms %.1f MB\n",
+         LEVEL,
+         mesh->totpoly,
+         cache.mesh->totpoly,
+         time_full / FRAMES_NUM * 1e3,
+         (double)memory_full / FRAMES_NUM / (1024.0 * 1024.0),
+         time_update / FRAMES_NUM * 1e3,
+         (double)memory_update / FRAMES_NUM / (1024.0 * 1024.0));
+
+  BKE_subdiv_mesh_cache_free(&cache);
+  BKE_subdiv_free(subdiv);
+}
+
+TEST_F(SubdivMeshTest, CacheInvalidation)
+{
+  build_mesh();
+
+  SubdivSettings settings;
+  subdiv_settings_init(&settings);
+  Subdiv *subdiv = BKE_subdiv_new_from_mesh(&settings, mesh);
+  ASSERT_NE(subdiv, nullptr);
+
+  SubdivToMeshSettings mesh_settings;
+  mesh_settings.resolution = (1 << LEVEL) + 1;
+  mesh_settings.use_optimal_display = false;
+
+  uint64_t hash = 0;
+  ASSERT_TRUE(BKE_modifier_cache_hash_mesh_without_positions(&hash, mesh));
+
+  /* Fill the cache by hand, subdividing needs OpenSubdiv. */
+  SubdivMeshCache cache = {nullptr};
+  EXPECT_FALSE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings, hash));
+  cache.mesh = BKE_mesh_copy_for_eval(mesh, false);
+  cache.subdiv_settings = subdiv->settings;
+  cache.mesh_settings = mesh_settings;
+  cache.coarse_mesh_hash = hash;
+  EXPECT_TRUE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings, hash));
+
+  /* Deformation keeps the cache. */
+  uint64_t hash_other = 0;
+  deform(1);
+  ASSERT_TRUE(BKE_modifier_cache_hash_mesh_without_positions(&hash_other, mesh));
+  EXPECT_EQ(hash_other, hash);
+
+  /* Any other data doesn't. */
+  mesh->mloopuv[0].uv[0] += 0.5f;
+  hash_other = 0;
+  ASSERT_TRUE(BKE_modifier_cache_hash_mesh_without_positions(&hash_other, mesh));
+  EXPECT_NE(hash_other, hash);
+  EXPECT_FALSE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings, hash_other));
+  mesh->mloopuv[0].uv[0] -= 0.5f;
+
+  mesh->mloop[0].e = mesh->mloop[3].e;
+  hash_other = 0;
+  ASSERT_TRUE(BKE_modifier_cache_hash_mesh_without_positions(&hash_other, mesh));
+  EXPECT_NE(hash_other, hash);
+
+  /* The orco mesh is evaluated without the cache, it would miss it anyway because of its
+   * different layers. */
+  Mesh *mesh_orco = BKE_mesh_copy_for_eval(mesh, false);
+  CustomData_free_layers(&mesh_orco->ldata, CD_MLOOPUV, mesh_orco->totloop);
+  hash_other = 0;
+  ASSERT_TRUE(BKE_modifier_cache_hash_mesh_without_positions(&hash_other, mesh_orco));
+  EXPECT_NE(hash_other, hash);
+  BKE_id_free(nullptr, mesh_orco);
+
+  /* Settings of the subdivision and of the result. */
+  SubdivToMeshSettings mesh_settings_other = mesh_settings;
+  mesh_settings_other.resolution = (1 << (LEVEL - 1)) + 1;
+  EXPECT_FALSE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings_other, hash));
+  mesh_settings_other = mesh_settings;
+  mesh_settings_other.use_optimal_display = true;
+  EXPECT_FALSE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings_other, hash));
+
+  subdiv->settings.use_creases = false;
+  EXPECT_FALSE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings, hash));
+  subdiv->settings.use_creases = true;
+  subdiv->settings.vtx_boundary_interpolation = SUBDIV_VTX_BOUNDARY_EDGE_AND_CORNER;
+  EXPECT_FALSE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings, hash));
+  subdiv->settings.vtx_boundary_interpolation = SUBDIV_VTX_BOUNDARY_EDGE_ONLY;
+  EXPECT_TRUE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings, hash));
+
+  BKE_subdiv_mesh_cache_free(&cache);
+  EXPECT_EQ(cache.mesh, nullptr);
+  EXPECT_FALSE(BKE_subdiv_mesh_cache_is_valid(&cache, subdiv, &mesh_settings, hash));
+  BKE_subdiv_free(subdiv);
+}
+
+TEST_F(SubdivMeshTest, CacheLooseGeometry)
+{
+  /* Loose edges are not evaluated from the limit surface, so they are never cached. */
+  Mesh *wire = BKE_mesh_add(bmain, "Wire");
+  wire->totvert = 4;
+  wire->totedge = 3;
+  CustomData_add_layer(&wire->vdata, CD_MVERT, CD_CALLOC, NULL, wire->totvert);
+  CustomData_add_layer(&wire->edata, CD_MEDGE, CD_CALLOC, NULL, wire->totedge);
+  BKE_mesh_update_customdata_pointers(wire, false);
+  for (int i = 0; i < wire->totvert; i++) {
+    wire->mvert[i].co[0] = (float)i;
+    wire->mvert[i].co[1] = (float)(i % 2);
+  }
+  for (int i = 0; i < wire->totedge; i++) {
+    wire->medge[i].v1 = i;
+    wire->medge[i].v2 = i + 1;
+    wire->medge[i].flag = ME_LOOSEEDGE;
+  }
+
+  SubdivSettings settings;
+  subdiv_settings_init(&settings);
+  Subdiv *subdiv = BKE_subdiv_new_from_mesh(&settings, wire);
+  ASSERT_NE(subdiv, nullptr);
+
+  SubdivToMeshSettings mesh_settings;
+  mesh_settings.resolution = (1 << LEVEL) + 1;
+  mesh_settings.use_optimal_display = false;
+
+  SubdivMeshCache cache = {nullptr};
+  for (int frame = 1; frame <= 2; frame++) {
+    wire->mvert[0].co[2] = (float)frame;
+    Mesh *result = BKE_subdiv_to_mesh_cached(subdiv, &mesh_settings, wire, &cache);
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ(result->totedge, wire->totedge * (mesh_settings.resolution - 1));
+    EXPECT_EQ(result->mvert[0].co[2], (float)frame);
+    EXPECT_EQ(cache.mesh, nullptr);
+    EXPECT_EQ(cache.vertex_samples, nullptr);
+    BKE_id_free(nullptr, result);
+  }
+
+  BKE_subdiv_mesh_cache_free(&cache);
+  BKE_subdiv_free(subdiv);
+}
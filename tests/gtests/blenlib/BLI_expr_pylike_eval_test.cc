@@ -2,11 +2,15 @@
 
 #include "testing/testing.h"
 
+#include <algorithm>
+#include <float.h>
 #include <string.h>
 
 extern "C" {
 #include "BLI_expr_pylike_eval.h"
 #include "BLI_math.h"
+
+#include "PIL_time.h"
 };
 
 #define TRUE_VAL 1.0
@@ -113,6 +117,13 @@ TEST_PARSE_FAIL(Truncated7, "1 and")
 TEST_PARSE_FAIL(Truncated8, "1 or")
 TEST_PARSE_FAIL(Truncated9, "sqrt(1")
 TEST_PARSE_FAIL(Truncated10, "fmod(1,")
+TEST_PARSE_FAIL(Truncated11, "2 **")
+TEST_PARSE_FAIL(Truncated12, "2 //")
+TEST_PARSE_FAIL(Truncated13, "2 %")
+TEST_PARSE_FAIL(BadPow, "2 *** 3")
+TEST_PARSE_FAIL(BadArgCount6, "log()")
+TEST_PARSE_FAIL(BadArgCount7, "log(1,2,3)")
+TEST_PARSE_FAIL(BadArgCount8, "round(1,2)")
 
 /* Constant expression with working constant folding */
 #define TEST_CONST(name, str, value) \
@@ -249,6 +260,60 @@ TEST_RESULT(Or2, "0 or 3", 3.0)
 TEST_RESULT(Bool1, "2 or 3 and 4", 2.0)
 TEST_RESULT(Bool2, "not 2 or 3 and 4", 4.0)
 
+TEST_CONST(Tau, "tau", M_PI * 2)
+TEST_CONST(E, "e", M_E)
+
+TEST_CONST(Mod1, "7 % 3", 1.0)
+TEST_CONST(Mod2, "-7 % 3", 2.0)
+TEST_CONST(Mod3, "7 % -3", -2.0)
+TEST_CONST(Mod4, "7.5 % 2", 1.5)
+TEST_EVAL(Mod, "x % 3", -7, 2.0)
+
+TEST_CONST(FloorDiv1, "7 // 2", 3.0)
+TEST_CONST(FloorDiv2, "-7 // 2", -4.0)
+TEST_CONST(FloorDiv3, "7.5 // -2", -4.0)
+TEST_EVAL(FloorDiv, "x // 2", -7, -4.0)
+
+TEST_CONST(PowOp1, "2 ** 3", 8.0)
+TEST_CONST(PowOp2, "2 ** 3 ** 2", 512.0)
+TEST_CONST(PowOp3, "-2 ** 2", -4.0)
+TEST_CONST(PowOp4, "(-2) ** 2", 4.0)
+TEST_CONST(PowOp5, "2 ** -1", 0.5)
+TEST_EVAL(PowOp, "x ** 2", 3, 9.0)
+
+TEST_CONST(Precedence1, "2 * 3 % 4", 2.0)
+TEST_CONST(Precedence2, "1 + 7 // 2 * 2", 7.0)
+TEST_CONST(Precedence3, "2 * 3 ** 2", 18.0)
+
+TEST_CONST(Round1, "round(2.5)", 2.0)
+TEST_CONST(Round2, "round(3.5)", 4.0)
+TEST_CONST(Round3, "round(-2.5)", -2.0)
+TEST_CONST(Round4, "round(2.6)", 3.0)
+TEST_EVAL(Round, "round(x)", 0.5, 0.0)
+
+TEST_CONST(Float, "float(3)", 3.0)
+TEST_CONST(Bool1, "bool(2)", TRUE_VAL)
+TEST_CONST(Bool2, "bool(0)", FALSE_VAL)
+
+TEST_CONST(Hypot, "hypot(3, 4)", 5.0)
+TEST_CONST(CopySign, "copysign(2, -0.5)", -2.0)
+TEST_CONST(Log10, "log10(100)", 2.0)
+TEST_CONST(Log2, "log2(8)", 3.0)
+TEST_CONST(LogBase, "log(8, 2)", log(8.0) / log(2.0))
+TEST_EVAL(LogBase, "log(x, 2)", 8.0, log(8.0) / log(2.0))
+TEST_EVAL(Tanh, "tanh(x)", 0.5, tanh(0.5))
+
+TEST_EVAL(Param, "x", 2, 2.0)
+TEST_EVAL(MinMax1, "min(x, 2, 0.5 * x)", 3, 1.5)
+TEST_EVAL(MinMax2, "max(1, min(x, 2), x - 1)", 3, 2.0)
+TEST_EVAL(Nested1, "1 + (x if x > 1 else 2)", 3, 4.0)
+TEST_EVAL(Nested2, "1 + (x if x > 1 else 2)", 0, 3.0)
+TEST_EVAL(Nested3, "2 * (x and 2 or 3)", 0, 6.0)
+TEST_EVAL(Nested4, "2 * (x and 2 or 3)", 1, 4.0)
+TEST_EVAL(Nested5, "3 - (1 < x < x * 2 < 10)", 2, 2.0)
+TEST_EVAL(Nested6, "3 - (1 < x < x * 2 < 10)", 6, 3.0)
+TEST_EVAL(Nested7, "(x or 5) + (0 or x)", 0, 5.0)
+
 TEST(expr_pylike, Eval_Ternary1)
 {
   ExprPyLike_Parsed *expr = parse_for_eval("x / 2 if x < 4 else x - 2 if x < 8 else x*2 - 12",
@@ -318,6 +383,26 @@ TEST_ERROR(Mixed1, "sqrt(x) + 1 / max(0, x)", -1.0, EXPR_PYLIKE_MATH_ERROR)
 TEST_ERROR(Mixed2, "sqrt(x) + 1 / max(0, x)", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
 TEST_ERROR(Mixed3, "sqrt(x) + 1 / max(0, x)", 1.0, EXPR_PYLIKE_SUCCESS)
 
+TEST_ERROR(ModZero, "x % 0", 1.0, EXPR_PYLIKE_MATH_ERROR)
+TEST_ERROR(FloorDivZero, "x // 0", 1.0, EXPR_PYLIKE_MATH_ERROR)
+TEST_ERROR(PowOpZero, "x ** -1", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
+TEST_ERROR(LogBaseOne, "log(x, 1)", 2.0, EXPR_PYLIKE_DIV_BY_ZERO)
+
+/* Errors are detected after an error in a previous evaluation. */
+TEST(expr_pylike, Error_Repeated)
+{
+  ExprPyLike_Parsed *expr = parse_for_eval("1 / x", true);
+  double x = 0.0, result;
+
+  EXPECT_EQ(BLI_expr_pylike_eval(expr, &x, 1, &result), EXPR_PYLIKE_DIV_BY_ZERO);
+  x = 1.0;
+  EXPECT_EQ(BLI_expr_pylike_eval(expr, &x, 1, &result), EXPR_PYLIKE_SUCCESS);
+  x = 0.0;
+  EXPECT_EQ(BLI_expr_pylike_eval(expr, &x, 1, &result), EXPR_PYLIKE_DIV_BY_ZERO);
+
+  BLI_expr_pylike_free(expr);
+}
+
 TEST(expr_pylike, Error_Invalid)
 {
   ExprPyLike_Parsed *expr = BLI_expr_pylike_parse("", NULL, 0);
@@ -337,3 +422,49 @@ TEST(expr_pylike, Error_ArgumentCount)
 
   BLI_expr_pylike_free(expr);
 }
+
+#define BENCHMARK_EVALS_NUM 1000000
+#define BENCHMARK_REPEAT_NUM 5
+
+TEST(expr_pylike, Benchmark)
+{
+  /* Expressions typical for drivers of rigs. */
+  const char *expressions[] = {
+      "x * 0.5 + 0.1",
+      "radians(x) * 2 - frame / 24",
+      "max(0, min(1, (x - 0.2) / 0.6))",
+      "x / 2 if x < 4 else x - 2 if x < 8 else x*2 - 12",
+      "sin(frame / 10) * y + 1 < x < 3 and y",
+      "(x * 0.3 + y * 0.2 - 0.1) * (1 - y) + (x - 1) * (x - 2) * 0.25 + abs(x - y) * 0.5",
+  };
+  const char *names[3] = {"x", "y", "frame"};
+
+  for (int i = 0; i < ARRAY_SIZE(expressions); i++) {
+    ExprPyLike_Parsed *expr = BLI_expr_pylike_parse(expressions[i], names, ARRAY_SIZE(names));
+    EXPECT_TRUE(BLI_expr_pylike_is_valid(expr));
+
+    double values[3] = {0.0, 0.5, 0.0};
+    double best_time = DBL_MAX, sum = 0.0, result;
+    int errors = 0;
+
+    /* Best of several runs, to reduce noise. */
+    for (int repeat = 0; repeat < BENCHMARK_REPEAT_NUM; repeat++) {
+      const double start_time = PIL_check_seconds_timer();
+      for (int j = 0; j < BENCHMARK_EVALS_NUM; j++) {
+        values[0] = (j % 100) * 0.1;
+        values[2] = j;
+        errors += BLI_expr_pylike_eval(expr, values, 3, &result) != EXPR_PYLIKE_SUCCESS;
+        sum += result;
+      }
+      best_time = std::min(best_time, PIL_check_seconds_timer() - start_time);
+    }
+
+    EXPECT_EQ(errors, 0);
+    printf("%s: %.1f ns per evaluation (sum %g)\n",
+           expressions[i],
+           best_time / BENCHMARK_EVALS_NUM * 1e9,
+           sum);
+
+    BLI_expr_pylike_free(expr);
+  }
+}
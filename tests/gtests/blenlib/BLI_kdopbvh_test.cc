@@ -8,8 +8,10 @@ extern "C" {
 #include "BLI_compiler_attrs.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_rand.h"
+#include "BLI_math_geom.h"
 #include "BLI_math_vector.h"
 #include "MEM_guardedalloc.h"
+#include "PIL_time.h"
 }
 
 #include "stubs/bf_intern_eigen_stubs.h"
@@ -135,3 +137,448 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/* -------------------------------------------------------------------- */
+/* Build Modes */
+
+typedef struct TriMesh {
+  float (*verts)[3];
+  int (*tris)[3];
+  int verts_len, tris_len;
+} TriMesh;
+
+/**
+ * Noisy sphere with uneven sampling and triangle sizes, similar to a scanned object.
+ */
+static void tri_mesh_scan_create(TriMesh *mesh, int rings, int segments, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+
+  mesh->verts_len = (rings + 1) * segments;
+  mesh->tris_len = rings * segments * 2;
+  mesh->verts = (float(*)[3])MEM_malloc_arrayN(mesh->verts_len, sizeof(*mesh->verts), __func__);
+  mesh->tris = (int(*)[3])MEM_malloc_arrayN(mesh->tris_len, sizeof(*mesh->tris), __func__);
+
+  for (int r = 0; r <= rings; r++) {
+    /* Denser sampling around the equator. */
+    const float t = (float)r / (float)rings * 2.0f - 1.0f;
+    const float theta = (float)M_PI_2 * (t * t * t + t) * 0.5f;
+    for (int s = 0; s < segments; s++) {
+      const float phi = 2.0f * (float)M_PI * (float)s / (float)segments;
+      const float radius = 1.0f + 0.02f * (BLI_rng_get_float(rng) - 0.5f);
+      float *co = mesh->verts[r * segments + s];
+      co[0] = radius * cosf(theta) * cosf(phi);
+      co[1] = radius * cosf(theta) * sinf(phi);
+      co[2] = radius * sinf(theta);
+    }
+  }
+
+  for (int r = 0; r < rings; r++) {
+    for (int s = 0; s < segments; s++) {
+      const int v0 = r * segments + s, v1 = r * segments + (s + 1) % segments;
+      const int v2 = v0 + segments, v3 = v1 + segments;
+      int(*tri)[3] = &mesh->tris[(r * segments + s) * 2];
+      ARRAY_SET_ITEMS(tri[0], v0, v1, v3);
+      ARRAY_SET_ITEMS(tri[1], v0, v3, v2);
+    }
+  }
+
+  BLI_rng_free(rng);
+}
+
+static void tri_mesh_free(TriMesh *mesh)
+{
+  MEM_freeN(mesh->verts);
+  MEM_freeN(mesh->tris);
+}
+
+static BVHTree *tri_mesh_bvhtree_build(const TriMesh *mesh, int tree_type, int flag)
+{
+  BVHTree *tree = BLI_bvhtree_new(mesh->tris_len, 0.0f, tree_type, 6);
+  for (int i = 0; i < mesh->tris_len; i++) {
+    float co[3][3];
+    for (int j = 0; j < 3; j++) {
+      copy_v3_v3(co[j], mesh->verts[mesh->tris[i][j]]);
+    }
+    BLI_bvhtree_insert(tree, i, co[0], 3);
+  }
+  BLI_bvhtree_balance_ex(tree, flag);
+  return tree;
+}
+
+static void tri_mesh_nearest_cb(void *userdata,
+                                int index,
+                                const float co[3],
+                                BVHTreeNearest *nearest)
+{
+  const TriMesh *mesh = (const TriMesh *)userdata;
+  const int *tri = mesh->tris[index];
+  float nearest_tmp[3];
+
+  closest_on_tri_to_point_v3(
+      nearest_tmp, co, mesh->verts[tri[0]], mesh->verts[tri[1]], mesh->verts[tri[2]]);
+  const float dist_sq = len_squared_v3v3(co, nearest_tmp);
+  if (dist_sq < nearest->dist_sq) {
+    nearest->index = index;
+    nearest->dist_sq = dist_sq;
+    copy_v3_v3(nearest->co, nearest_tmp);
+  }
+}
+
+static void tri_mesh_raycast_cb(void *userdata,
+                                int index,
+                                const BVHTreeRay *ray,
+                                BVHTreeRayHit *hit)
+{
+  const TriMesh *mesh = (const TriMesh *)userdata;
+  const int *tri = mesh->tris[index];
+  float dist;
+
+  if (isect_ray_tri_v3(ray->origin,
+                       ray->direction,
+                       mesh->verts[tri[0]],
+                       mesh->verts[tri[1]],
+                       mesh->verts[tri[2]],
+                       &dist,
+                       NULL) &&
+      dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+    madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+  }
+}
+
+/**
+ * Points around the surface and rays from outside of it, roughly aimed at the center.
+ */
+static void tri_mesh_queries_create(
+    int queries_len, int random_seed, float (*r_co)[3], float (*r_ray_co)[3], float (*r_dir)[3])
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  for (int i = 0; i < queries_len; i++) {
+    float dir[3];
+    BLI_rng_get_float_unit_v3(rng, dir);
+    mul_v3_v3fl(r_co[i], dir, 0.8f + 0.4f * BLI_rng_get_float(rng));
+    mul_v3_v3fl(r_ray_co[i], dir, 2.0f);
+
+    BLI_rng_get_float_unit_v3(rng, r_dir[i]);
+    madd_v3_v3fl(r_dir[i], dir, -4.0f);
+    normalize_v3(r_dir[i]);
+  }
+  BLI_rng_free(rng);
+}
+
+/**
+ * Run all queries, returning the time taken by nearest and ray cast queries.
+ */
+static void tri_mesh_queries_run(BVHTree *tree,
+                                 TriMesh *mesh,
+                                 int queries_len,
+                                 const float (*co)[3],
+                                 const float (*ray_co)[3],
+                                 const float (*dir)[3],
+                                 BVHTreeNearest *r_nearest,
+                                 BVHTreeRayHit *r_hits,
+                                 double r_time[2])
+{
+  double start_time = PIL_check_seconds_timer();
+  for (int i = 0; i < queries_len; i++) {
+    r_nearest[i].index = -1;
+    r_nearest[i].dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree, co[i], &r_nearest[i], tri_mesh_nearest_cb, mesh);
+  }
+  r_time[0] = PIL_check_seconds_timer() - start_time;
+
+  start_time = PIL_check_seconds_timer();
+  for (int i = 0; i < queries_len; i++) {
+    r_hits[i].index = -1;
+    r_hits[i].dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree, ray_co[i], dir[i], 0.0f, &r_hits[i], tri_mesh_raycast_cb, mesh);
+  }
+  r_time[1] = PIL_check_seconds_timer() - start_time;
+}
+
+/* -------------------------------------------------------------------- */
+/* Batched Queries */
+
+/**
+ * Compare batched nearest queries against one query at a time for \a queries_len random points,
+ * also reporting the time taken by both. Points and queries are on a grid, so many points are
+ * equally near.
+ */
+static void batch_queries_test(int points_len, int queries_len, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+
+  float(*points)[3] = (float(*)[3])MEM_malloc_arrayN(points_len, sizeof(*points), __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+
+  float(*co)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*co), __func__);
+  for (int i = 0; i < queries_len; i++) {
+    rng_v3_round(co[i], 3, rng, 1000, 1.0f);
+  }
+
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_malloc_arrayN(
+      queries_len, sizeof(*nearest), __func__);
+  BVHTreeNearest *nearest_batch = (BVHTreeNearest *)MEM_malloc_arrayN(
+      queries_len, sizeof(*nearest_batch), __func__);
+  for (int i = 0; i < queries_len; i++) {
+    nearest[i].index = nearest_batch[i].index = -1;
+    nearest[i].dist_sq = nearest_batch[i].dist_sq = FLT_MAX;
+  }
+
+  double start_time = PIL_check_seconds_timer();
+  for (int i = 0; i < queries_len; i++) {
+    BLI_bvhtree_find_nearest(tree, co[i], &nearest[i], NULL, NULL);
+  }
+  const double time_nearest = PIL_check_seconds_timer() - start_time;
+
+  start_time = PIL_check_seconds_timer();
+  BLI_bvhtree_find_nearest_batch(tree, co, queries_len, nearest_batch, NULL, NULL, 0);
+  const double time_nearest_batch = PIL_check_seconds_timer() - start_time;
+
+  for (int i = 0; i < queries_len; i++) {
+    ASSERT_NE(nearest_batch[i].index, -1);
+    EXPECT_EQ(nearest_batch[i].index, nearest[i].index);
+    EXPECT_EQ(nearest_batch[i].dist_sq, nearest[i].dist_sq);
+  }
+
+  printf("%d queries on %d points: nearest %.2f ms, batch %.2f ms\n",
+         queries_len,
+         points_len,
+         time_nearest * 1e3,
+         time_nearest_batch * 1e3);
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(co);
+  MEM_freeN(nearest);
+  MEM_freeN(nearest_batch);
+}
+
+TEST(kdopbvh, Batch_1)
+{
+  batch_queries_test(1, 10, 1234);
+}
+TEST(kdopbvh, Batch_500)
+{
+  batch_queries_test(500, 1000, 12);
+}
+TEST(kdopbvh, BatchBenchmark)
+{
+  batch_queries_test(100000, 200000, 123);
+}
+
+/**
+ * Compare batched queries on triangles against one query at a time, also reporting the time
+ * taken by both. Every other query is at a vertex of the mesh, or a ray aimed at one, so that
+ * several triangles are equally near.
+ */
+static void batch_tri_mesh_test(int rings, int segments, int queries_len)
+{
+  TriMesh mesh;
+  tri_mesh_scan_create(&mesh, rings, segments, 1234);
+  BVHTree *tree = tri_mesh_bvhtree_build(&mesh, 4, 0);
+
+  float(*co)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*co), __func__);
+  float(*ray_co)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*ray_co), __func__);
+  float(*dir)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*dir), __func__);
+  tri_mesh_queries_create(queries_len, 12, co, ray_co, dir);
+  for (int i = 0; i < queries_len; i += 2) {
+    const float *vert = mesh.verts[(i / 2 * 7) % mesh.verts_len];
+    copy_v3_v3(co[i], vert);
+    sub_v3_v3v3(dir[i], vert, ray_co[i]);
+    normalize_v3(dir[i]);
+  }
+
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_malloc_arrayN(
+      queries_len, sizeof(*nearest), __func__);
+  BVHTreeNearest *nearest_batch = (BVHTreeNearest *)MEM_malloc_arrayN(
+      queries_len, sizeof(*nearest_batch), __func__);
+  BVHTreeRayHit *hits = (BVHTreeRayHit *)MEM_malloc_arrayN(queries_len, sizeof(*hits), __func__);
+  BVHTreeRayHit *hits_batch = (BVHTreeRayHit *)MEM_malloc_arrayN(
+      queries_len, sizeof(*hits_batch), __func__);
+  for (int i = 0; i < queries_len; i++) {
+    nearest_batch[i].index = -1;
+    nearest_batch[i].dist_sq = FLT_MAX;
+    hits_batch[i].index = -1;
+    hits_batch[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+
+  double time_query[2];
+  tri_mesh_queries_run(tree, &mesh, queries_len, co, ray_co, dir, nearest, hits, time_query);
+
+  double start_time = PIL_check_seconds_timer();
+  BLI_bvhtree_find_nearest_batch(
+      tree, co, queries_len, nearest_batch, tri_mesh_nearest_cb, &mesh, 0);
+  const double time_nearest_batch = PIL_check_seconds_timer() - start_time;
+
+  start_time = PIL_check_seconds_timer();
+  BLI_bvhtree_ray_cast_batch(tree,
+                             ray_co,
+                             dir,
+                             queries_len,
+                             0.0f,
+                             hits_batch,
+                             tri_mesh_raycast_cb,
+                             &mesh,
+                             BVH_RAYCAST_DEFAULT);
+  const double time_ray_cast_batch = PIL_check_seconds_timer() - start_time;
+
+  int hits_num = 0;
+  for (int i = 0; i < queries_len; i++) {
+    ASSERT_NE(nearest_batch[i].index, -1);
+    EXPECT_EQ(nearest_batch[i].index, nearest[i].index);
+    EXPECT_EQ(nearest_batch[i].dist_sq, nearest[i].dist_sq);
+    EXPECT_EQ(hits_batch[i].index, hits[i].index);
+    EXPECT_EQ(hits_batch[i].dist, hits[i].dist);
+    hits_num += (hits[i].index != -1);
+  }
+  /* Rays are aimed at the mesh, nearly all of them hit it. */
+  EXPECT_GT(hits_num, queries_len * 9 / 10);
+
+  printf("%d queries on %d triangles: nearest %.2f ms, batch %.2f ms, "
+         "ray cast %.2f ms, batch %.2f ms\n",
+         queries_len,
+         mesh.tris_len,
+         time_query[0] * 1e3,
+         time_nearest_batch * 1e3,
+         time_query[1] * 1e3,
+         time_ray_cast_batch * 1e3);
+
+  BLI_bvhtree_free(tree);
+  MEM_freeN(co);
+  MEM_freeN(ray_co);
+  MEM_freeN(dir);
+  MEM_freeN(nearest);
+  MEM_freeN(nearest_batch);
+  MEM_freeN(hits);
+  MEM_freeN(hits_batch);
+  tri_mesh_free(&mesh);
+}
+
+TEST(kdopbvh, BatchTriMesh)
+{
+  batch_tri_mesh_test(16, 32, 1000);
+}
+TEST(kdopbvh, BatchTriMeshBenchmark)
+{
+  batch_tri_mesh_test(256, 512, 200000);
+}
+
+/**
+ * Compare queries on trees built with the surface area heuristic against the default build,
+ * on a tree refitted after moving the mesh too. Prints the time taken by each build mode.
+ */
+static void build_mode_test(int rings, int segments, int tree_type, int queries_len)
+{
+  TriMesh mesh;
+  tri_mesh_scan_create(&mesh, rings, segments, 1234);
+
+  float(*co)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*co), __func__);
+  float(*ray_co)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*ray_co), __func__);
+  float(*dir)[3] = (float(*)[3])MEM_malloc_arrayN(queries_len, sizeof(*dir), __func__);
+  tri_mesh_queries_create(queries_len, 12, co, ray_co, dir);
+
+  const int flags[2] = {0, BVH_BALANCE_SAH};
+  BVHTreeNearest *nearest[2];
+  BVHTreeRayHit *hits[2];
+  double time_build[2], time_query[2][2];
+  BVHTree *trees[2];
+
+  for (int mode = 0; mode < 2; mode++) {
+    nearest[mode] = (BVHTreeNearest *)MEM_malloc_arrayN(
+        queries_len, sizeof(**nearest), __func__);
+    hits[mode] = (BVHTreeRayHit *)MEM_malloc_arrayN(queries_len, sizeof(**hits), __func__);
+
+    const double start_time = PIL_check_seconds_timer();
+    trees[mode] = tri_mesh_bvhtree_build(&mesh, tree_type, flags[mode]);
+    time_build[mode] = PIL_check_seconds_timer() - start_time;
+
+    tri_mesh_queries_run(trees[mode],
+                         &mesh,
+                         queries_len,
+                         co,
+                         ray_co,
+                         dir,
+                         nearest[mode],
+                         hits[mode],
+                         time_query[mode]);
+  }
+
+  for (int i = 0; i < queries_len; i++) {
+    /* Equally near triangles may be found in a different order. */
+    EXPECT_EQ(nearest[0][i].dist_sq, nearest[1][i].dist_sq);
+    EXPECT_EQ(hits[0][i].index == -1, hits[1][i].index == -1);
+    EXPECT_EQ(hits[0][i].dist, hits[1][i].dist);
+  }
+
+  printf("%d triangles, tree type %d, %d queries:\n", mesh.tris_len, tree_type, queries_len);
+  for (int mode = 0; mode < 2; mode++) {
+    printf("  %-6s build %.2f ms, nearest %.2f ms, ray cast %.2f ms\n",
+           mode ? "SAH" : "median",
+           time_build[mode] * 1e3,
+           time_query[mode][0] * 1e3,
+           time_query[mode][1] * 1e3);
+  }
+
+  /* Move the mesh and refit the trees, which should give the results of new trees. */
+  for (int v = 0; v < mesh.verts_len; v++) {
+    mesh.verts[v][0] *= 1.5f;
+    mesh.verts[v][2] += 0.1f * sinf(mesh.verts[v][1] * 4.0f);
+  }
+  BVHTree *tree_new = tri_mesh_bvhtree_build(&mesh, tree_type, 0);
+  tri_mesh_queries_run(
+      tree_new, &mesh, queries_len, co, ray_co, dir, nearest[0], hits[0], time_query[0]);
+
+  BVHTree *tree_refit = trees[1];
+  for (int i = 0; i < mesh.tris_len; i++) {
+    float tri_co[3][3];
+    for (int j = 0; j < 3; j++) {
+      copy_v3_v3(tri_co[j], mesh.verts[mesh.tris[i][j]]);
+    }
+    BLI_bvhtree_update_node(tree_refit, i, tri_co[0], NULL, 3);
+  }
+  BLI_bvhtree_update_tree(tree_refit);
+  tri_mesh_queries_run(
+      tree_refit, &mesh, queries_len, co, ray_co, dir, nearest[1], hits[1], time_query[1]);
+
+  for (int i = 0; i < queries_len; i++) {
+    EXPECT_EQ(nearest[0][i].dist_sq, nearest[1][i].dist_sq);
+    EXPECT_EQ(hits[0][i].dist, hits[1][i].dist);
+  }
+
+  BLI_bvhtree_free(tree_new);
+  for (int mode = 0; mode < 2; mode++) {
+    BLI_bvhtree_free(trees[mode]);
+    MEM_freeN(nearest[mode]);
+    MEM_freeN(hits[mode]);
+  }
+  MEM_freeN(co);
+  MEM_freeN(ray_co);
+  MEM_freeN(dir);
+  tri_mesh_free(&mesh);
+}
+
+TEST(kdopbvh, BuildSAH_Binary)
+{
+  build_mode_test(16, 32, 2, 1000);
+}
+TEST(kdopbvh, BuildSAH_Quad)
+{
+  build_mode_test(16, 32, 4, 1000);
+}
+TEST(kdopbvh, BuildSAH_Oct)
+{
+  build_mode_test(16, 32, 8, 1000);
+}
+TEST(kdopbvh, BuildSAHBenchmark)
+{
+  build_mode_test(256, 512, 4, 50000);
+}
@@ -11,6 +11,7 @@ extern "C" {
 #include "BLI_utildefines.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
 
@@ -122,6 +123,106 @@ TEST(task, RangeIter1000k)
   task_parallel_range_test_do("Range parallel iteration - Threaded - 1000K items", 1000000, true);
 }
 
+/* *** Task pool scaling with the number of scheduler threads. *** */
+
+typedef struct TaskPoolScalingData {
+  TaskScheduler *scheduler;
+  uint32_t num_done;
+} TaskPoolScalingData;
+
+static void task_pool_light_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+  TaskPoolScalingData *data = (TaskPoolScalingData *)BLI_task_pool_userdata(pool);
+  const uint index = (uint)POINTER_AS_INT(taskdata);
+  const uint limit = index + (gen_pseudo_random_number(index) >> 6);
+  for (uint i = index; i < limit;) {
+    i += gen_pseudo_random_number(i) >> 6;
+  }
+  atomic_add_and_fetch_uint32(&data->num_done, 1);
+}
+
+static void task_pool_nested_func(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+  TaskPoolScalingData *data = (TaskPoolScalingData *)BLI_task_pool_userdata(pool);
+  TaskPool *subpool = BLI_task_pool_create(data->scheduler, data);
+  for (int i = 0; i < 64; i++) {
+    BLI_task_pool_push_from_thread(subpool,
+                                   task_pool_light_func,
+                                   POINTER_FROM_INT(POINTER_AS_INT(taskdata) + i),
+                                   false,
+                                   TASK_PRIORITY_LOW,
+                                   threadid);
+  }
+  BLI_task_pool_work_and_wait(subpool);
+  BLI_task_pool_free(subpool);
+}
+
+static void task_pool_scaling_test_do(const char *id, const int num_tasks, const bool use_nested)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+
+  const int max_threads = max_ii(BLI_system_thread_count(), 2);
+  for (int num_threads = 1;; num_threads = min_ii(num_threads * 2, max_threads)) {
+    TaskPoolScalingData data;
+    data.scheduler = BLI_task_scheduler_create(num_threads);
+    data.num_done = 0;
+
+    const int num_pushed = use_nested ? num_tasks / 64 : num_tasks;
+    const int num_expected = use_nested ? num_pushed * 64 : num_tasks;
+
+    double averaged_timing = 0.0;
+    for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+      const double init_time = PIL_check_seconds_timer();
+      TaskPool *pool = BLI_task_pool_create(data.scheduler, &data);
+      for (int j = 0; j < num_pushed; j++) {
+        BLI_task_pool_push(pool,
+                           use_nested ? task_pool_nested_func : task_pool_light_func,
+                           POINTER_FROM_INT(j * 64),
+                           false,
+                           TASK_PRIORITY_LOW);
+      }
+      BLI_task_pool_work_and_wait(pool);
+      BLI_task_pool_free(pool);
+      averaged_timing += PIL_check_seconds_timer() - init_time;
+
+      EXPECT_EQ(data.num_done, num_expected);
+      data.num_done = 0;
+    }
+
+    printf("\t%d threads: done in %fs on average over %d runs\n",
+           num_threads,
+           averaged_timing / NUM_RUN_AVERAGED,
+           NUM_RUN_AVERAGED);
+
+    BLI_task_scheduler_free(data.scheduler);
+
+    if (num_threads == max_threads) {
+      break;
+    }
+  }
+
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(task, PoolScaling10k)
+{
+  task_pool_scaling_test_do("Task pool scaling - 10K light tasks", 10000, false);
+}
+
+TEST(task, PoolScaling100k)
+{
+  task_pool_scaling_test_do("Task pool scaling - 100K light tasks", 100000, false);
+}
+
+TEST(task, PoolScalingNested100k)
+{
+  task_pool_scaling_test_do("Task pool scaling - 100K light tasks in nested pools", 100000, true);
+}
+
 /* *** Parallel iterations over double-linked list items. *** */
 
 static void task_listbase_light_iter_func(void *UNUSED(userdata),
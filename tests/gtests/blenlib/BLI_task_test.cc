@@ -253,3 +253,59 @@ TEST(task, ListBaseIter)
   MEM_freeN(items_buffer);
   BLI_threadapi_exit();
 }
+
+/* *** Nested task pools, with tasks stolen between threads. *** */
+
+#define NUM_NESTED_TASKS 64
+#define NUM_NESTED_SUBTASKS 256
+
+typedef struct TaskPoolNestedData {
+  TaskScheduler *scheduler;
+  uint32_t num_done;
+} TaskPoolNestedData;
+
+static void task_pool_subtask_func(TaskPool *__restrict pool,
+                                   void *UNUSED(taskdata),
+                                   int UNUSED(threadid))
+{
+  uint32_t *num_done = (uint32_t *)BLI_task_pool_userdata(pool);
+  atomic_add_and_fetch_uint32(num_done, 1);
+}
+
+static void task_pool_nested_func(TaskPool *__restrict pool, void *UNUSED(taskdata), int threadid)
+{
+  TaskPoolNestedData *data = (TaskPoolNestedData *)BLI_task_pool_userdata(pool);
+  uint32_t num_done = 0;
+
+  TaskPool *subpool = BLI_task_pool_create(data->scheduler, &num_done);
+  for (int i = 0; i < NUM_NESTED_SUBTASKS; i++) {
+    BLI_task_pool_push_from_thread(
+        subpool, task_pool_subtask_func, NULL, false, TASK_PRIORITY_LOW, threadid);
+  }
+  BLI_task_pool_work_and_wait(subpool);
+  BLI_task_pool_free(subpool);
+
+  EXPECT_EQ(num_done, NUM_NESTED_SUBTASKS);
+  atomic_add_and_fetch_uint32(&data->num_done, num_done);
+}
+
+TEST(task, PoolNested)
+{
+  BLI_threadapi_init();
+
+  TaskPoolNestedData data;
+  data.scheduler = BLI_task_scheduler_create(4);
+  data.num_done = 0;
+
+  TaskPool *pool = BLI_task_pool_create(data.scheduler, &data);
+  for (int i = 0; i < NUM_NESTED_TASKS; i++) {
+    BLI_task_pool_push(pool, task_pool_nested_func, NULL, false, TASK_PRIORITY_LOW);
+  }
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+
+  EXPECT_EQ(data.num_done, NUM_NESTED_TASKS * NUM_NESTED_SUBTASKS);
+
+  BLI_task_scheduler_free(data.scheduler);
+  BLI_threadapi_exit();
+}
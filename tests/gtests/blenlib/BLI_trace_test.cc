@@ -0,0 +1,103 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "BLI_fileops.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_trace.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+#define TRACE_FILE "BLI_trace_test.json"
+#define NUM_SPANS 5000
+
+static std::string trace_read()
+{
+  std::ifstream f(TRACE_FILE);
+  std::stringstream buffer;
+  buffer << f.rdbuf();
+  return buffer.str();
+}
+
+static int count_occurrences(const std::string &str, const std::string &pattern)
+{
+  int count = 0;
+  for (size_t pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + pattern.size())) {
+    count++;
+  }
+  return count;
+}
+
+static void trace_span_func(void *__restrict /*userdata*/,
+                            const int index,
+                            const TaskParallelTLS *__restrict /*tls*/)
+{
+  const int ids[2] = {index, index * 2};
+  const double time = PIL_check_seconds_timer();
+  BLI_trace_span_add_ids("test", "Span %d-%d", ids, 2, time, time + 1e-6);
+}
+
+TEST(trace, NotRecording)
+{
+  EXPECT_FALSE(BLI_trace_is_recording());
+  BLI_trace_span_add("test", "Span", 0.0, 1.0);
+
+  EXPECT_TRUE(BLI_trace_write(TRACE_FILE));
+  EXPECT_EQ(trace_read(), "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n]}\n");
+
+  BLI_delete(TRACE_FILE, false, false);
+}
+
+TEST(trace, Threads)
+{
+  BLI_threadapi_init();
+
+  /* Spans of an earlier recording are dropped. */
+  BLI_trace_begin();
+  BLI_trace_span_add("test", "Old", 0.0, 1.0);
+  BLI_trace_end();
+
+  BLI_trace_begin();
+  EXPECT_TRUE(BLI_trace_is_recording());
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, NUM_SPANS, NULL, trace_span_func, &settings);
+  BLI_trace_span_add("test", "Name with \"quotes\"", 0.0, 1.0);
+  /* Names made of parts are copied, the parts can be freed before writing. */
+  char part[16];
+  BLI_strncpy(part, "Temporary", sizeof(part));
+  const char *name_parts[3] = {"Made of", "", part};
+  BLI_trace_span_add_parts("test", name_parts, 3, 0.0, 1.0);
+  BLI_strncpy(part, "Overwritten", sizeof(part));
+
+  BLI_trace_end();
+  EXPECT_FALSE(BLI_trace_is_recording());
+  /* Not recorded any more. */
+  BLI_trace_span_add("test", "Span", 0.0, 1.0);
+
+  EXPECT_TRUE(BLI_trace_write(TRACE_FILE));
+  BLI_trace_free();
+
+  const std::string trace = trace_read();
+  EXPECT_EQ(count_occurrences(trace, "\"ph\": \"X\""), NUM_SPANS + 2);
+  EXPECT_EQ(count_occurrences(trace, "\"name\": \"Span "), NUM_SPANS);
+  EXPECT_EQ(count_occurrences(trace, "\"name\": \"Span 21-42\""), 1);
+  EXPECT_EQ(count_occurrences(trace, "\"name\": \"Made of Temporary\""), 1);
+  EXPECT_EQ(count_occurrences(trace, "\"name\": \"Old\""), 0);
+  EXPECT_EQ(count_occurrences(trace, "\"name\": \"Name with \\\"quotes\\\"\""), 1);
+  EXPECT_EQ(count_occurrences(trace, "\"name\": \"Main Thread\""), 1);
+  EXPECT_GE(count_occurrences(trace, "\"ph\": \"M\""), 1);
+  EXPECT_EQ(trace.substr(trace.size() - 3), "]}\n");
+
+  BLI_delete(TRACE_FILE, false, false);
+  BLI_threadapi_exit();
+}
@@ -0,0 +1,270 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blendfile_loading_base_test.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
+#include "BKE_text.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+
+#include "BLO_chunkfile.h"
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_text_types.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#ifndef _WIN32
+#  include <unistd.h>
+#else
+#  include <io.h>
+#endif
+
+class BlendfileChunkedWriteTest : public BlendfileLoadingBaseTest {
+ public:
+  static void SetUpTestCase()
+  {
+    BlendfileLoadingBaseTest::SetUpTestCase();
+    BKE_tempdir_init(NULL);
+  }
+
+ protected:
+  std::string temp_filepath(const char *filename)
+  {
+    char filepath[FILE_MAX];
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), filename);
+    return filepath;
+  }
+};
+
+/* Compressible data, similar to DNA structs: repeating layout with varying values. */
+static std::vector<char> chunked_test_data(size_t size, uint seed)
+{
+  std::vector<char> data(size);
+  RNG *rng = BLI_rng_new(seed);
+  for (size_t i = 0; i < size; i += 4) {
+    const uint value = ((i / 4) % 8 == 0) ? BLI_rng_get_uint(rng) : (uint)((i / 64) & 0xff);
+    memcpy(&data[i], &value, MIN2(sizeof(value), size - i));
+  }
+  BLI_rng_free(rng);
+  return data;
+}
+
+/* Write in pieces of varying size, with data-block like segments. */
+static bool chunked_test_write(const char *filepath,
+                               const char *reference_filepath,
+                               const std::vector<char> &data,
+                               ChunkFileWriteStats *r_stats)
+{
+  ChunkFileWriter *writer = BLO_chunkfile_writer_open(filepath, reference_filepath);
+  if (writer == NULL) {
+    return false;
+  }
+  size_t offset = 0;
+  size_t step = 1;
+  while (offset < data.size()) {
+    const size_t len = MIN2(step, data.size() - offset);
+    BLO_chunkfile_writer_write(writer, &data[offset], len);
+    offset += len;
+    step = (step * 7 + 13) % 100000;
+    if (step % 3 == 0) {
+      BLO_chunkfile_writer_segment_end(writer);
+    }
+  }
+  return BLO_chunkfile_writer_close(writer, r_stats);
+}
+
+static std::vector<char> chunked_test_read(const char *filepath)
+{
+  std::vector<char> data;
+  const int file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+  if (file == -1) {
+    return data;
+  }
+  ChunkFileReader *reader = BLO_chunkfile_reader_open(file);
+  if (reader != NULL) {
+    const int64_t size = BLO_chunkfile_reader_seek(reader, 0, SEEK_END);
+    BLO_chunkfile_reader_seek(reader, 0, SEEK_SET);
+    data.resize((size_t)size);
+    if (BLO_chunkfile_reader_read(reader, data.data(), data.size()) != size) {
+      data.clear();
+    }
+    BLO_chunkfile_reader_close(reader);
+  }
+  close(file);
+  return data;
+}
+
+TEST_F(BlendfileChunkedWriteTest, RoundTrip)
+{
+  const std::string filepath = temp_filepath("chunked_round_trip.bin");
+
+  for (size_t size : {0, 1, 1000, 1 << 20, (3 << 20) + 17}) {
+    const std::vector<char> data = chunked_test_data(size, (uint)size);
+    ChunkFileWriteStats stats;
+    ASSERT_TRUE(chunked_test_write(filepath.c_str(), NULL, data, &stats));
+    EXPECT_EQ(size, stats.raw_size);
+    EXPECT_EQ(0, stats.num_chunks_reused);
+
+    const std::vector<char> data_read = chunked_test_read(filepath.c_str());
+    ASSERT_EQ(data.size(), data_read.size());
+    EXPECT_TRUE(data == data_read);
+  }
+
+  BLI_delete(filepath.c_str(), false, false);
+}
+
+TEST_F(BlendfileChunkedWriteTest, SeekDecodesOnlyNeededChunks)
+{
+  const std::string filepath = temp_filepath("chunked_seek.bin");
+  const std::vector<char> data = chunked_test_data(16 << 20, 1);
+  ChunkFileWriteStats stats;
+  ASSERT_TRUE(chunked_test_write(filepath.c_str(), NULL, data, &stats));
+  EXPECT_GT(stats.num_chunks, 4);
+  EXPECT_LT(stats.file_size, stats.raw_size);
+
+  const int file = BLI_open(filepath.c_str(), O_BINARY | O_RDONLY, 0);
+  ASSERT_NE(-1, file);
+  ChunkFileReader *reader = BLO_chunkfile_reader_open(file);
+  ASSERT_NE(nullptr, reader);
+
+  /* Reading a few bytes near the end only decodes the chunk containing them. */
+  char buf[64];
+  const int64_t offset = (int64_t)data.size() - 1000;
+  EXPECT_EQ(offset, BLO_chunkfile_reader_seek(reader, offset, SEEK_SET));
+  EXPECT_EQ(sizeof(buf), BLO_chunkfile_reader_read(reader, buf, sizeof(buf)));
+  EXPECT_EQ(0, memcmp(buf, &data[offset], sizeof(buf)));
+  EXPECT_EQ(1, BLO_chunkfile_reader_chunks_decoded(reader));
+
+  /* Reading past the end is short. */
+  EXPECT_EQ(offset + (int64_t)sizeof(buf), BLO_chunkfile_reader_seek(reader, 0, SEEK_CUR));
+  BLO_chunkfile_reader_seek(reader, -10, SEEK_END);
+  EXPECT_EQ(10, BLO_chunkfile_reader_read(reader, buf, sizeof(buf)));
+  EXPECT_EQ(0, BLO_chunkfile_reader_read(reader, buf, sizeof(buf)));
+
+  BLO_chunkfile_reader_close(reader);
+  close(file);
+  BLI_delete(filepath.c_str(), false, false);
+}
+
+TEST_F(BlendfileChunkedWriteTest, IncrementalReusesUnchangedChunks)
+{
+  const std::string filepath = temp_filepath("chunked_incremental.bin");
+  const std::string filepath_tmp = filepath + "@";
+
+  std::vector<char> data = chunked_test_data(16 << 20, 2);
+  ChunkFileWriteStats stats;
+  ASSERT_TRUE(chunked_test_write(filepath.c_str(), NULL, data, &stats));
+  const uint num_chunks = stats.num_chunks;
+
+  /* Change a few bytes in the middle, the same size. */
+  memset(&data[data.size() / 2], 0xAB, 100);
+  ASSERT_TRUE(chunked_test_write(filepath_tmp.c_str(), filepath.c_str(), data, &stats));
+  EXPECT_EQ(num_chunks, stats.num_chunks);
+  EXPECT_GE(stats.num_chunks_reused, num_chunks - 2);
+  EXPECT_LT(stats.num_chunks_reused, num_chunks);
+
+  const std::vector<char> data_read = chunked_test_read(filepath_tmp.c_str());
+  EXPECT_TRUE(data == data_read);
+
+  BLI_delete(filepath.c_str(), false, false);
+  BLI_delete(filepath_tmp.c_str(), false, false);
+}
+
+TEST_F(BlendfileChunkedWriteTest, BlendFileRoundTrip)
+{
+  const std::string filepath = temp_filepath("chunked_round_trip.blend");
+  const int num_texts = 64;
+
+  Main *bmain = BKE_main_new();
+  for (int i = 0; i < num_texts; i++) {
+    char name[32];
+    BLI_snprintf(name, sizeof(name), "Text%d", i);
+    Text *text = BKE_text_add(bmain, name);
+    for (int line = 0; line < 2000; line++) {
+      char str[64];
+      BLI_snprintf(str, sizeof(str), "text %d line %d\n", i, line);
+      BKE_text_write(text, str);
+    }
+  }
+
+  /* Second write uses the first file as a reference. */
+  for (int pass = 0; pass < 2; pass++) {
+    ASSERT_TRUE(BLO_write_file(bmain, filepath.c_str(), G_FILE_COMPRESS_CHUNKED, NULL, NULL));
+
+    BlendFileData *bfd = BLO_read_from_file(filepath.c_str(), BLO_READ_SKIP_NONE, NULL);
+    ASSERT_NE(nullptr, bfd);
+    EXPECT_EQ(num_texts, BLI_listbase_count(&bfd->main->texts));
+
+    Text *text = (Text *)BLI_findstring(&bfd->main->texts, "Text33", offsetof(ID, name) + 2);
+    ASSERT_NE(nullptr, text);
+    EXPECT_EQ(2001, BLI_listbase_count(&text->lines));
+    EXPECT_STREQ("text 33 line 1999", ((TextLine *)BLI_findlink(&text->lines, 1999))->line);
+
+    BLO_blendfiledata_free(bfd);
+  }
+
+  BKE_main_free(bmain);
+  BLI_delete(filepath.c_str(), false, false);
+}
+
+TEST_F(BlendfileChunkedWriteTest, Throughput)
+{
+  const std::string filepath = temp_filepath("chunked_throughput.bin");
+  const std::string filepath_tmp = filepath + "@";
+  const std::vector<char> data = chunked_test_data(64 << 20, 3);
+  const double size_mb = (double)data.size() / (1024.0 * 1024.0);
+  ChunkFileWriteStats stats;
+
+  double time = PIL_check_seconds_timer();
+  ASSERT_TRUE(chunked_test_write(filepath.c_str(), NULL, data, &stats));
+  const double time_write = PIL_check_seconds_timer() - time;
+
+  time = PIL_check_seconds_timer();
+  ASSERT_TRUE(chunked_test_write(filepath_tmp.c_str(), filepath.c_str(), data, &stats));
+  const double time_write_incremental = PIL_check_seconds_timer() - time;
+  EXPECT_EQ(stats.num_chunks, stats.num_chunks_reused);
+
+  time = PIL_check_seconds_timer();
+  const std::vector<char> data_read = chunked_test_read(filepath_tmp.c_str());
+  const double time_read = PIL_check_seconds_timer() - time;
+  EXPECT_TRUE(data == data_read);
+
+  printf("%.1f MB -> %.1f MB, write: %.1f MB/s, incremental write: %.1f MB/s, read: %.1f MB/s\n",
+         size_mb,
+         (double)stats.file_size / (1024.0 * 1024.0),
+         size_mb / time_write,
+         size_mb / time_write_incremental,
+         size_mb / time_read);
+
+  BLI_delete(filepath.c_str(), false, false);
+  BLI_delete(filepath_tmp.c_str(), false, false);
+}
@@ -0,0 +1,150 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blendfile_loading_base_test.h"
+
+#include <string>
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_collection.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+#include "BKE_text.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+
+#include "BLO_readfile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+}
+
+class BlendfilePartialLoadTest : public BlendfileLoadingBaseTest {
+ public:
+  static void SetUpTestCase()
+  {
+    BlendfileLoadingBaseTest::SetUpTestCase();
+    BKE_tempdir_init(NULL);
+  }
+
+ protected:
+  std::string filepath;
+
+  virtual void SetUp()
+  {
+    char path[FILE_MAX];
+    BLI_join_dirfile(path, sizeof(path), BKE_tempdir_session(), "partial_load.blend");
+    filepath = path;
+
+    /* Two scenes, each using its own object & mesh, and an unused text. */
+    Main *bmain = BKE_main_new();
+    for (const char *suffix : {"A", "B"}) {
+      Scene *scene = BKE_scene_add(bmain, (std::string("Scene") + suffix).c_str());
+      Object *ob = BKE_object_add_only_object(
+          bmain, OB_MESH, (std::string("Object") + suffix).c_str());
+      ob->data = BKE_mesh_add(bmain, (std::string("Mesh") + suffix).c_str());
+      BKE_collection_object_add(bmain, scene->master_collection, ob);
+    }
+    BKE_text_add(bmain, "Unused");
+
+    ASSERT_TRUE(BLO_write_file(bmain, filepath.c_str(), 0, NULL, NULL));
+    BKE_main_free(bmain);
+  }
+
+  virtual void TearDown()
+  {
+    BLI_delete(filepath.c_str(), false, false);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  bool has_id(ListBase *lb, const char *name)
+  {
+    return BLI_findstring(lb, name, offsetof(ID, name) + 2) != NULL;
+  }
+};
+
+TEST_F(BlendfilePartialLoadTest, ReadAll)
+{
+  bfile = BLO_read_from_file(filepath.c_str(), BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(nullptr, bfile);
+  EXPECT_EQ(2, BLI_listbase_count(&bfile->main->scenes));
+  EXPECT_EQ(2, BLI_listbase_count(&bfile->main->objects));
+  EXPECT_EQ(2, BLI_listbase_count(&bfile->main->meshes));
+  EXPECT_EQ(1, BLI_listbase_count(&bfile->main->texts));
+  EXPECT_FALSE(bfile->main->is_read_partial);
+}
+
+TEST_F(BlendfilePartialLoadTest, SkipUnused)
+{
+  /* Without a window-manager the first scene is the active one. */
+  bfile = BLO_read_from_file(filepath.c_str(), BLO_READ_SKIP_UNUSED, NULL);
+  ASSERT_NE(nullptr, bfile);
+  Main *bmain = bfile->main;
+  EXPECT_EQ(1, BLI_listbase_count(&bmain->scenes));
+  EXPECT_EQ(1, BLI_listbase_count(&bmain->objects));
+  EXPECT_EQ(1, BLI_listbase_count(&bmain->meshes));
+  EXPECT_EQ(0, BLI_listbase_count(&bmain->texts));
+
+  ASSERT_NE(nullptr, bfile->curscene);
+  EXPECT_STREQ("SCSceneA", bfile->curscene->id.name);
+  EXPECT_TRUE(has_id(&bmain->objects, "ObjectA"));
+  EXPECT_TRUE(has_id(&bmain->meshes, "MeshA"));
+
+  /* Pointers between the data-blocks that were read are linked. */
+  Object *ob = static_cast<Object *>(bmain->objects.first);
+  ASSERT_NE(nullptr, ob->data);
+  EXPECT_STREQ("MEMeshA", static_cast<ID *>(ob->data)->name);
+  EXPECT_TRUE(BKE_collection_has_object(bfile->curscene->master_collection, ob));
+
+  /* Saving would lose the data-blocks that were skipped. */
+  EXPECT_TRUE(bmain->is_read_partial);
+}
+
+TEST_F(BlendfilePartialLoadTest, ReadSingleID)
+{
+  bfile = BLO_read_from_file_id(filepath.c_str(), "SCSceneB", BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(nullptr, bfile);
+  Main *bmain = bfile->main;
+  EXPECT_EQ(1, BLI_listbase_count(&bmain->scenes));
+  EXPECT_EQ(1, BLI_listbase_count(&bmain->objects));
+  EXPECT_EQ(1, BLI_listbase_count(&bmain->meshes));
+  EXPECT_EQ(0, BLI_listbase_count(&bmain->texts));
+
+  /* Pointers between the data-blocks that were read are linked. */
+  ASSERT_NE(nullptr, bfile->curscene);
+  EXPECT_STREQ("SCSceneB", bfile->curscene->id.name);
+  EXPECT_EQ(nullptr, bfile->curscreen);
+  Object *ob = static_cast<Object *>(bmain->objects.first);
+  EXPECT_STREQ("OBObjectB", ob->id.name);
+  ASSERT_NE(nullptr, ob->data);
+  EXPECT_STREQ("MEMeshB", static_cast<ID *>(ob->data)->name);
+  EXPECT_TRUE(BKE_collection_has_object(bfile->curscene->master_collection, ob));
+  EXPECT_TRUE(bmain->is_read_partial);
+}
+
+TEST_F(BlendfilePartialLoadTest, ReadSingleIDMissing)
+{
+  bfile = BLO_read_from_file_id(filepath.c_str(), "SCSceneC", BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(nullptr, bfile);
+  EXPECT_TRUE(BLI_listbase_is_empty(&bfile->main->scenes));
+  EXPECT_TRUE(BLI_listbase_is_empty(&bfile->main->objects));
+}
@@ -0,0 +1,236 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blendfile_loading_base_test.h"
+
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_object.h"
+#include "BKE_text.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+
+#include "BLO_readfile.h"
+#include "BLO_undofile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_object_types.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+class BlendfileUndoMemfileTest : public BlendfileLoadingBaseTest {
+ public:
+  static void SetUpTestCase()
+  {
+    BlendfileLoadingBaseTest::SetUpTestCase();
+    BKE_tempdir_init(NULL);
+  }
+
+ protected:
+  Main *bmain = nullptr;
+  std::vector<MemFile *> steps;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+    for (int i = 0; i < 2000; i++) {
+      char name[32];
+      BLI_snprintf(name, sizeof(name), "Object%04d", i);
+      Object *ob = BKE_object_add_only_object(bmain, OB_EMPTY, name);
+      ob->loc[0] = (float)i;
+    }
+    /* Some bigger data-blocks. */
+    for (int i = 0; i < 20; i++) {
+      char name[32];
+      BLI_snprintf(name, sizeof(name), "Text%02d", i);
+      Text *text = BKE_text_add(bmain, name);
+      for (int line = 0; line < 500; line++) {
+        char str[64];
+        BLI_snprintf(str, sizeof(str), "text %d line %d\n", i, line);
+        BKE_text_write(text, str);
+      }
+    }
+  }
+
+  virtual void TearDown()
+  {
+    /* Free oldest first, as the undo system does. */
+    for (size_t i = 0; i < steps.size(); i++) {
+      if (i + 1 < steps.size()) {
+        BLO_memfile_merge(steps[i], steps[i + 1]);
+      }
+      else {
+        BLO_memfile_free(steps[i]);
+      }
+      MEM_freeN(steps[i]);
+    }
+    steps.clear();
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  MemFile *undo_push()
+  {
+    MemFile *prev = steps.empty() ? NULL : steps.back();
+    MemFile *memfile = static_cast<MemFile *>(MEM_callocN(sizeof(MemFile), __func__));
+    EXPECT_TRUE(BLO_write_file_mem(bmain, prev, memfile, 0));
+    steps.push_back(memfile);
+    return memfile;
+  }
+
+  /* Memory the step would use if chunks were only shared with the chunk at the same position in
+   * the previous step. */
+  static size_t memfile_size_positional(const MemFile *memfile, const MemFile *prev)
+  {
+    size_t size = 0;
+    const MemFileChunk *chunk_prev = prev ? (const MemFileChunk *)prev->chunks.first : NULL;
+    LISTBASE_FOREACH (const MemFileChunk *, chunk, &memfile->chunks) {
+      if (!(chunk_prev && chunk_prev->size == chunk->size &&
+            memcmp(chunk_prev->buf, chunk->buf, chunk->size) == 0)) {
+        size += chunk->size;
+      }
+      chunk_prev = chunk_prev ? (const MemFileChunk *)chunk_prev->next : NULL;
+    }
+    return size;
+  }
+
+  static size_t memfile_size_total(const MemFile *memfile)
+  {
+    size_t size = 0;
+    LISTBASE_FOREACH (const MemFileChunk *, chunk, &memfile->chunks) {
+      size += chunk->size;
+    }
+    return size;
+  }
+};
+
+TEST_F(BlendfileUndoMemfileTest, ReadBack)
+{
+  undo_push();
+  BKE_object_add_only_object(bmain, OB_EMPTY, "AAA");
+  MemFile *memfile = undo_push();
+
+  char filepath[FILE_MAX];
+  BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "undo_memfile.blend");
+  ASSERT_TRUE(BLO_memfile_write_file(memfile, filepath));
+
+  bfile = BLO_read_from_file(filepath, BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(nullptr, bfile);
+  EXPECT_EQ(2001, BLI_listbase_count(&bfile->main->objects));
+  EXPECT_EQ(20, BLI_listbase_count(&bfile->main->texts));
+  Object *ob = (Object *)BLI_findstring(
+      &bfile->main->objects, "Object1234", offsetof(ID, name) + 2);
+  ASSERT_NE(nullptr, ob);
+  EXPECT_EQ(1234.0f, ob->loc[0]);
+
+  BLI_delete(filepath, false, false);
+}
+
+TEST_F(BlendfileUndoMemfileTest, SharedChunksFreed)
+{
+  uint chunks_num;
+  size_t store_size;
+  BLO_memfile_store_stats(&chunks_num, &store_size);
+  ASSERT_EQ(0u, chunks_num);
+
+  MemFile *first = undo_push();
+  MemFile *second = undo_push();
+  EXPECT_GT(first->size, (size_t)0);
+  EXPECT_EQ((size_t)0, second->size);
+
+  /* The second step only adds users to the chunks stored by the first one. */
+  BLO_memfile_store_stats(&chunks_num, &store_size);
+  const uint chunks_num_stored = chunks_num;
+  EXPECT_GT(chunks_num, 0u);
+  EXPECT_EQ(first->size, store_size);
+
+  /* Freeing in any order, the chunks stay valid until all users are freed. */
+  BLO_memfile_free(second);
+  EXPECT_EQ(memfile_size_total(first), first->size);
+  BLO_memfile_store_stats(&chunks_num, &store_size);
+  EXPECT_EQ(chunks_num_stored, chunks_num);
+  EXPECT_EQ(first->size, store_size);
+
+  BLO_memfile_free(first);
+  MEM_freeN(first);
+  MEM_freeN(second);
+  steps.clear();
+
+  BLO_memfile_store_stats(&chunks_num, &store_size);
+  EXPECT_EQ(0u, chunks_num);
+  EXPECT_EQ((size_t)0, store_size);
+}
+
+TEST_F(BlendfileUndoMemfileTest, EditSequence)
+{
+  struct {
+    const char *name;
+    void (*edit)(Main *bmain, int step);
+  } script[] = {
+      {"initial", [](Main * /*bmain*/, int /*step*/) {}},
+      {"move object",
+       [](Main *bmain, int step) {
+         Object *ob = (Object *)BLI_findlink(&bmain->objects, 1000);
+         ob->loc[2] += (float)step;
+       }},
+      {"add object at start",
+       [](Main *bmain, int step) {
+         char name[32];
+         BLI_snprintf(name, sizeof(name), "AAA%d", step);
+         BKE_object_add_only_object(bmain, OB_EMPTY, name);
+       }},
+      {"delete object",
+       [](Main *bmain, int /*step*/) { BKE_id_delete(bmain, BLI_findlink(&bmain->objects, 10)); }},
+      {"edit text",
+       [](Main *bmain, int /*step*/) {
+         BKE_text_write((Text *)BLI_findlink(&bmain->texts, 5), "more\n");
+       }},
+      {"no change", [](Main * /*bmain*/, int /*step*/) {}},
+  };
+
+  size_t total_size = 0, total_size_positional = 0;
+  int step = 0;
+  for (int pass = 0; pass < 3; pass++) {
+    for (size_t i = 0; i < ARRAY_SIZE(script); i++) {
+      const auto &edit = script[i];
+      if (pass > 0 && i == 0) {
+        continue;
+      }
+      edit.edit(bmain, step);
+      const MemFile *prev = steps.empty() ? NULL : steps.back();
+      const MemFile *memfile = undo_push();
+      const size_t size_positional = memfile_size_positional(memfile, prev);
+
+      /* Content sharing never stores more than sharing by position. */
+      EXPECT_LE(memfile->size, size_positional) << "step " << step << ": " << edit.name;
+      if (step > 0) {
+        total_size += memfile->size;
+        total_size_positional += size_positional;
+      }
+      step++;
+    }
+  }
+
+  EXPECT_LT(total_size * 4, total_size_positional);
+}
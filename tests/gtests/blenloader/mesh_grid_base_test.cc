@@ -0,0 +1,154 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#include "mesh_grid_base_test.h"
+
+extern "C" {
+#include "BKE_customdata.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+}
+
+void MeshGridBaseTest::SetUp()
+{
+  BlendfileLoadingBaseTest::SetUp();
+
+  bmain = BKE_main_new();
+  scene = BKE_scene_add(bmain, "Scene");
+  view_layer = (ViewLayer *)scene->view_layers.first;
+}
+
+void MeshGridBaseTest::TearDown()
+{
+  depsgraph_free();
+  BKE_main_free(bmain);
+  bmain = nullptr;
+
+  BlendfileLoadingBaseTest::TearDown();
+}
+
+void MeshGridBaseTest::mesh_grid_fill(Mesh *mesh, int grid_size, bool triangulate)
+{
+  const int row = grid_size + 1;
+  const int quads_num = grid_size * grid_size;
+  mesh->totvert = row * row;
+  mesh->totedge = 2 * grid_size * row + (triangulate ? quads_num : 0);
+  mesh->totpoly = triangulate ? quads_num * 2 : quads_num;
+  mesh->totloop = quads_num * 4 + (triangulate ? quads_num * 2 : 0);
+
+  CustomData_add_layer(&mesh->vdata, CD_MVERT, CD_CALLOC, NULL, mesh->totvert);
+  CustomData_add_layer(&mesh->edata, CD_MEDGE, CD_CALLOC, NULL, mesh->totedge);
+  CustomData_add_layer(&mesh->ldata, CD_MLOOP, CD_CALLOC, NULL, mesh->totloop);
+  CustomData_add_layer(&mesh->pdata, CD_MPOLY, CD_CALLOC, NULL, mesh->totpoly);
+  BKE_mesh_update_customdata_pointers(mesh, false);
+
+  for (int y = 0; y < row; y++) {
+    for (int x = 0; x < row; x++) {
+      MVert *mvert = &mesh->mvert[y * row + x];
+      mvert->co[0] = (float)x;
+      mvert->co[1] = (float)y;
+    }
+  }
+
+  const int vertical_edges_start = grid_size * row;
+  const int diagonal_edges_start = 2 * grid_size * row;
+  for (int y = 0; y < row; y++) {
+    for (int x = 0; x < grid_size; x++) {
+      MEdge *edge = &mesh->medge[y * grid_size + x];
+      edge->v1 = y * row + x;
+      edge->v2 = y * row + x + 1;
+    }
+  }
+  for (int y = 0; y < grid_size; y++) {
+    for (int x = 0; x < row; x++) {
+      MEdge *edge = &mesh->medge[vertical_edges_start + y * row + x];
+      edge->v1 = y * row + x;
+      edge->v2 = (y + 1) * row + x;
+    }
+  }
+
+  for (int y = 0; y < grid_size; y++) {
+    for (int x = 0; x < grid_size; x++) {
+      const int q = y * grid_size + x;
+      const int loop_edges[4] = {
+          q,
+          vertical_edges_start + y * row + x + 1,
+          (y + 1) * grid_size + x,
+          vertical_edges_start + y * row + x,
+      };
+      const int loop_verts[4] = {
+          y * row + x,
+          y * row + x + 1,
+          (y + 1) * row + x + 1,
+          (y + 1) * row + x,
+      };
+
+      if (!triangulate) {
+        MPoly *poly = &mesh->mpoly[q];
+        poly->loopstart = q * 4;
+        poly->totloop = 4;
+
+        MLoop *loop = &mesh->mloop[poly->loopstart];
+        for (int i = 0; i < 4; i++) {
+          loop[i].v = loop_verts[i];
+          loop[i].e = loop_edges[i];
+        }
+        continue;
+      }
+
+      /* Split along the diagonal from the first to the third corner. */
+      const int diagonal_edge = diagonal_edges_start + q;
+      MEdge *edge = &mesh->medge[diagonal_edge];
+      edge->v1 = loop_verts[0];
+      edge->v2 = loop_verts[2];
+
+      MPoly *poly = &mesh->mpoly[q * 2];
+      poly[0].loopstart = q * 6;
+      poly[0].totloop = 3;
+      poly[1].loopstart = q * 6 + 3;
+      poly[1].totloop = 3;
+
+      MLoop *loop = &mesh->mloop[poly->loopstart];
+      loop[0].v = loop_verts[0];
+      loop[0].e = loop_edges[0];
+      loop[1].v = loop_verts[1];
+      loop[1].e = loop_edges[1];
+      loop[2].v = loop_verts[2];
+      loop[2].e = diagonal_edge;
+      loop[3].v = loop_verts[0];
+      loop[3].e = diagonal_edge;
+      loop[4].v = loop_verts[2];
+      loop[4].e = loop_edges[2];
+      loop[5].v = loop_verts[3];
+      loop[5].e = loop_edges[3];
+    }
+  }
+}
+
+Object *MeshGridBaseTest::grid_object_add(const char *name, int grid_size)
+{
+  Object *ob = BKE_object_add(bmain, scene, view_layer, OB_MESH, name);
+  mesh_grid_fill((Mesh *)ob->data, grid_size);
+  return ob;
+}
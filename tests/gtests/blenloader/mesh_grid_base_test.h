@@ -0,0 +1,49 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 by Blender Foundation.
+ */
+#ifndef __MESH_GRID_BASE_TEST_H__
+#define __MESH_GRID_BASE_TEST_H__
+
+#include "blendfile_loading_base_test.h"
+
+struct Main;
+struct Mesh;
+struct Object;
+struct Scene;
+struct ViewLayer;
+
+/* Tests running on generated grid meshes, in a new Main with a single scene. */
+class MeshGridBaseTest : public BlendfileLoadingBaseTest {
+ protected:
+  struct Main *bmain = nullptr;
+  struct Scene *scene = nullptr;
+  struct ViewLayer *view_layer = nullptr;
+
+  virtual void SetUp();
+  /* Frees the depsgraph & Main. */
+  virtual void TearDown();
+
+  /* Fill an empty mesh with a grid of grid_size * grid_size quads in the XY plane, one unit
+   * apart. Vertices are ordered by rows, horizontal edges come first, then vertical ones.
+   * When triangulate is set, each quad is split into two triangles, with the diagonal edges
+   * last. Normals are not calculated. */
+  static void mesh_grid_fill(struct Mesh *mesh, int grid_size, bool triangulate = false);
+  /* Add a mesh object to the scene, using a new grid mesh. */
+  struct Object *grid_object_add(const char *name, int grid_size);
+};
+
+#endif /* __MESH_GRID_BASE_TEST_H__ */
@@ -0,0 +1,180 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/mesh_grid_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+
+#include "BLI_math.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "bmesh.h"
+
+#include "PIL_time.h"
+}
+
+#define GRID_SIZE 500
+
+class BMeshMeshConvTest : public MeshGridBaseTest {
+ protected:
+  Mesh *mesh = nullptr;
+
+  /* Grid of quads with UVs, creases and some selected and smooth faces. */
+  void build_grid()
+  {
+    mesh = BKE_mesh_add(bmain, "Mesh");
+    mesh_grid_fill(mesh, GRID_SIZE);
+
+    CustomData_add_layer_named(&mesh->ldata, CD_MLOOPUV, CD_CALLOC, NULL, mesh->totloop, "UV");
+    BKE_mesh_update_customdata_pointers(mesh, false);
+    mesh->cd_flag |= ME_CDFLAG_EDGE_CREASE;
+
+    for (int i = 0; i < mesh->totedge; i++) {
+      mesh->medge[i].crease = (char)(i % 256);
+    }
+
+    for (int p = 0; p < mesh->totpoly; p++) {
+      MPoly *poly = &mesh->mpoly[p];
+      poly->flag = (p % 3 == 0) ? ME_FACE_SEL : ME_SMOOTH;
+
+      const MLoop *loop = &mesh->mloop[poly->loopstart];
+      MLoopUV *mloopuv = &mesh->mloopuv[poly->loopstart];
+      for (int j = 0; j < poly->totloop; j++) {
+        copy_v2_v2(mloopuv[j].uv, mesh->mvert[loop[j].v].co);
+        mul_v2_fl(mloopuv[j].uv, 1.0f / GRID_SIZE);
+      }
+    }
+    mesh->act_face = mesh->totpoly / 2;
+
+    BKE_mesh_calc_normals(mesh);
+  }
+
+  BMesh *bmesh_from_mesh(double *r_time)
+  {
+    BMAllocTemplate allocsize = {mesh->totvert, mesh->totedge, mesh->totloop, mesh->totpoly};
+    BMeshCreateParams create_params = {0};
+    create_params.use_toolflags = true;
+    BMesh *bm = BM_mesh_create(&allocsize, &create_params);
+
+    BMeshFromMeshParams from_params = {0};
+    from_params.calc_face_normal = true;
+    const double start_time = PIL_check_seconds_timer();
+    BM_mesh_bm_from_me(bm, mesh, &from_params);
+    *r_time = PIL_check_seconds_timer() - start_time;
+    return bm;
+  }
+
+  void check_bmesh(BMesh *bm)
+  {
+    ASSERT_EQ(bm->totvert, mesh->totvert);
+    ASSERT_EQ(bm->totedge, mesh->totedge);
+    ASSERT_EQ(bm->totface, mesh->totpoly);
+    ASSERT_EQ(bm->totloop, mesh->totloop);
+    EXPECT_EQ(BM_mesh_elem_count(bm, BM_FACE), mesh->totpoly);
+    EXPECT_EQ(bm->totfacesel, (mesh->totpoly + 2) / 3);
+    ASSERT_NE(bm->act_face, nullptr);
+    EXPECT_EQ(BM_elem_index_get(bm->act_face), mesh->act_face);
+
+    /* Disk and radial cycles: a vertex uses its first edge, an edge uses its last loop. */
+    std::vector<int> vert_first_edge(mesh->totvert, -1), vert_edges_num(mesh->totvert, 0);
+    for (int i = mesh->totedge - 1; i >= 0; i--) {
+      vert_first_edge[mesh->medge[i].v1] = i;
+      vert_first_edge[mesh->medge[i].v2] = i;
+      vert_edges_num[mesh->medge[i].v1]++;
+      vert_edges_num[mesh->medge[i].v2]++;
+    }
+    std::vector<int> edge_last_loop(mesh->totedge, -1), edge_loops_num(mesh->totedge, 0);
+    for (int i = 0; i < mesh->totloop; i++) {
+      edge_last_loop[mesh->mloop[i].e] = i;
+      edge_loops_num[mesh->mloop[i].e]++;
+    }
+    BM_mesh_elem_table_ensure(bm, BM_VERT | BM_EDGE | BM_FACE);
+    for (int i = 0; i < bm->totvert; i++) {
+      ASSERT_EQ(BM_elem_index_get(bm->vtable[i]->e), vert_first_edge[i]);
+      ASSERT_EQ(BM_vert_edge_count(bm->vtable[i]), vert_edges_num[i]);
+    }
+    for (int i = 0; i < bm->totedge; i++) {
+      BMEdge *e = bm->etable[i];
+      ASSERT_EQ(BM_elem_index_get(e->l), edge_last_loop[i]);
+      ASSERT_EQ(BM_edge_face_count(e), edge_loops_num[i]);
+      ASSERT_TRUE(BM_vert_in_edge(e, bm->vtable[mesh->medge[i].v1]));
+      ASSERT_TRUE(BM_vert_in_edge(e, bm->vtable[mesh->medge[i].v2]));
+    }
+    for (int i = 0; i < bm->totface; i++) {
+      BMFace *f = bm->ftable[i];
+      ASSERT_FLOAT_EQ(BM_face_calc_area(f), 1.0f);
+      ASSERT_FLOAT_EQ(f->no[2], 1.0f);
+    }
+  }
+};
+
+TEST_F(BMeshMeshConvTest, RoundTripBenchmark)
+{
+  build_grid();
+
+  double time_from_mesh;
+  BMesh *bm = bmesh_from_mesh(&time_from_mesh);
+  check_bmesh(bm);
+
+  Mesh *result = BKE_mesh_add(bmain, "Result");
+  BMeshToMeshParams to_params = {0};
+  const double start_time = PIL_check_seconds_timer();
+  BM_mesh_bm_to_me(bmain, bm, result, &to_params);
+  const double time_to_mesh = PIL_check_seconds_timer() - start_time;
+  BM_mesh_free(bm);
+
+  ASSERT_EQ(result->totvert, mesh->totvert);
+  ASSERT_EQ(result->totedge, mesh->totedge);
+  ASSERT_EQ(result->totpoly, mesh->totpoly);
+  ASSERT_EQ(result->totloop, mesh->totloop);
+  ASSERT_NE(result->mloopuv, nullptr);
+  EXPECT_EQ(result->act_face, mesh->act_face);
+  for (int i = 0; i < mesh->totvert; i++) {
+    ASSERT_TRUE(equals_v3v3(result->mvert[i].co, mesh->mvert[i].co));
+  }
+  for (int i = 0; i < mesh->totedge; i++) {
+    ASSERT_EQ(result->medge[i].v1, mesh->medge[i].v1);
+    ASSERT_EQ(result->medge[i].v2, mesh->medge[i].v2);
+    ASSERT_EQ(result->medge[i].crease, mesh->medge[i].crease);
+  }
+  for (int i = 0; i < mesh->totpoly; i++) {
+    ASSERT_EQ(result->mpoly[i].loopstart, mesh->mpoly[i].loopstart);
+    ASSERT_EQ(result->mpoly[i].totloop, mesh->mpoly[i].totloop);
+    ASSERT_EQ(result->mpoly[i].flag, mesh->mpoly[i].flag);
+  }
+  for (int i = 0; i < mesh->totloop; i++) {
+    ASSERT_EQ(result->mloop[i].v, mesh->mloop[i].v);
+    ASSERT_EQ(result->mloop[i].e, mesh->mloop[i].e);
+    ASSERT_TRUE(equals_v2v2(result->mloopuv[i].uv, mesh->mloopuv[i].uv));
+  }
+
+  printf("%d faces, %d threads: Mesh to BMesh %.2f ms, BMesh to Mesh %.2f ms\n",
+         mesh->totpoly,
+         BLI_task_scheduler_num_threads(BLI_task_scheduler_get()),
+         time_from_mesh * 1e3,
+         time_to_mesh * 1e3);
+}
@@ -0,0 +1,218 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "testing/testing.h"
+
+#include <math.h>
+#include <string.h>
+
+extern "C" {
+#include "BLI_compiler_compat.h"
+#include "BLI_hash.h"
+#include "BLI_rect.h"
+
+#include "DNA_node_types.h"
+}
+
+#include "COM_ColorCorrectionOperation.h"
+#include "COM_ConvertOperation.h"
+#include "COM_GammaOperation.h"
+#include "COM_MathBaseOperation.h"
+#include "COM_MixOperation.h"
+
+/* Every pixel of the rectangle is compared, its width is not a multiple of four so the
+ * SSE2 row kernels run both their vector loop and their scalar tail. */
+#define OUTPUT_WIDTH 16
+#define OUTPUT_HEIGHT 4
+static const rcti test_rect = {2, 15, 1, 4};
+
+/* Input with a different value for every pixel and channel, including negative values, values
+ * above one, signed zeros and NaN, to cover the clamping and the special cases of the kernels.
+ * Only the channels of the data type are written, like the operations reading it expect. */
+class RandomInputOperation : public NodeOperation {
+ private:
+  unsigned int m_seed;
+  int m_num_channels;
+
+ public:
+  RandomInputOperation(DataType datatype, unsigned int seed) : m_seed(seed)
+  {
+    this->addOutputSocket(datatype);
+    this->m_num_channels = (datatype == COM_DT_VALUE) ?
+                               COM_NUM_CHANNELS_VALUE :
+                               (datatype == COM_DT_VECTOR) ? COM_NUM_CHANNELS_VECTOR :
+                                                             COM_NUM_CHANNELS_COLOR;
+  }
+
+  void executePixelSampled(float output[4], float x, float y, PixelSampler /*sampler*/)
+  {
+    for (int i = 0; i < this->m_num_channels; i++) {
+      const unsigned int hash = BLI_hash_int_2d(BLI_hash_int_2d((int)x, (int)y),
+                                                this->m_seed * 4 + i);
+      switch (hash % 16) {
+        case 0:
+        case 1:
+          output[i] = 0.0f;
+          break;
+        case 2:
+          output[i] = -0.0f;
+          break;
+        case 3:
+          output[i] = NAN;
+          break;
+        default:
+          output[i] = (float)(hash % 1000) / 500.0f - 0.5f;
+          break;
+      }
+    }
+  }
+};
+
+static void connect_random_inputs(NodeOperation *operation)
+{
+  for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+    NodeOperationInput *input = operation->getInputSocket(i);
+    RandomInputOperation *random_input = new RandomInputOperation(input->getDataType(), i + 1);
+    input->setLink(random_input->getOutputSocket());
+  }
+}
+
+static void free_random_inputs(NodeOperation *operation)
+{
+  for (unsigned int i = 0; i < operation->getNumberOfInputSockets(); i++) {
+    NodeOperationInput *input = operation->getInputSocket(i);
+    delete &input->getLink()->getOperation();
+    input->setLink(NULL);
+  }
+}
+
+/* Compare #NodeOperation::executeRect bit for bit against per pixel execution. */
+static void test_execute_rect(NodeOperation *operation)
+{
+  ASSERT_TRUE(operation->isBufferOperation());
+
+  connect_random_inputs(operation);
+  operation->initExecution();
+
+  rcti output_rect;
+  BLI_rcti_init(&output_rect, 0, OUTPUT_WIDTH, 0, OUTPUT_HEIGHT);
+  MemoryBuffer *output = new MemoryBuffer(operation->getOutputSocket()->getDataType(),
+                                          &output_rect);
+  operation->executeRect(output, &test_rect);
+
+  const int num_channels = output->get_num_channels();
+  for (int y = test_rect.ymin; y < test_rect.ymax; y++) {
+    for (int x = test_rect.xmin; x < test_rect.xmax; x++) {
+      float expected[4];
+      operation->readSampled(expected, x, y, COM_PS_NEAREST);
+      const float *result = output->getBuffer() + (y * OUTPUT_WIDTH + x) * num_channels;
+      EXPECT_EQ(0, memcmp(expected, result, sizeof(float) * num_channels))
+          << "pixel " << x << ", " << y;
+    }
+  }
+
+  delete output;
+  operation->deinitExecution();
+  free_random_inputs(operation);
+}
+
+static void test_mix(MixBaseOperation *operation)
+{
+  for (int i = 0; i < 4; i++) {
+    operation->setUseClamp(i & 1);
+    operation->setUseValueAlphaMultiply(i & 2);
+    test_execute_rect(operation);
+  }
+  delete operation;
+}
+
+static void test_math(MathBaseOperation *operation)
+{
+  for (int i = 0; i < 2; i++) {
+    operation->setUseClamp(i);
+    test_execute_rect(operation);
+  }
+  delete operation;
+}
+
+static void test_convert(ConvertBaseOperation *operation)
+{
+  test_execute_rect(operation);
+  delete operation;
+}
+
+TEST(compositor_buffer_operation, Mix)
+{
+  test_mix(new MixAddOperation());
+  test_mix(new MixBlendOperation());
+  test_mix(new MixDarkenOperation());
+  test_mix(new MixDifferenceOperation());
+  test_mix(new MixLightenOperation());
+  test_mix(new MixMultiplyOperation());
+  test_mix(new MixScreenOperation());
+  test_mix(new MixSubtractOperation());
+}
+
+TEST(compositor_buffer_operation, Math)
+{
+  test_math(new MathAddOperation());
+  test_math(new MathSubtractOperation());
+  test_math(new MathMultiplyOperation());
+  test_math(new MathDivideOperation());
+  test_math(new MathMinimumOperation());
+  test_math(new MathMaximumOperation());
+}
+
+TEST(compositor_buffer_operation, Convert)
+{
+  test_convert(new ConvertValueToColorOperation());
+  test_convert(new ConvertColorToValueOperation());
+  test_convert(new ConvertColorToBWOperation());
+  test_convert(new ConvertColorToVectorOperation());
+  test_convert(new ConvertValueToVectorOperation());
+  test_convert(new ConvertVectorToColorOperation());
+  test_convert(new ConvertVectorToValueOperation());
+}
+
+TEST(compositor_buffer_operation, Gamma)
+{
+  GammaOperation operation;
+  test_execute_rect(&operation);
+}
+
+TEST(compositor_buffer_operation, ColorCorrection)
+{
+  NodeColorCorrection data = {{0}};
+  ColorCorrectionData *levels[4] = {&data.master, &data.shadows, &data.midtones, &data.highlights};
+  for (int i = 0; i < 4; i++) {
+    levels[i]->saturation = 1.2f - 0.1f * i;
+    levels[i]->contrast = 0.9f + 0.1f * i;
+    levels[i]->gamma = 0.8f + 0.2f * i;
+    levels[i]->gain = 1.1f;
+    levels[i]->lift = 0.05f * i;
+  }
+  data.startmidtones = 0.2f;
+  data.endmidtones = 0.7f;
+
+  ColorCorrectionOperation operation;
+  operation.setData(&data);
+  operation.setRedChannelEnabled(true);
+  operation.setGreenChannelEnabled(false);
+  operation.setBlueChannelEnabled(true);
+  test_execute_rect(&operation);
+}
@@ -0,0 +1,182 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/blendfile_loading_base_test.h"
+
+#include <math.h>
+#include <vector>
+
+extern "C" {
+#include "BKE_image.h"
+#include "BKE_main.h"
+#include "BKE_node.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+
+#include "DNA_image_types.h"
+#include "DNA_node_types.h"
+#include "DNA_scene_types.h"
+
+#include "PIL_time.h"
+
+#include "RE_pipeline.h"
+}
+
+#include "COM_compositor.h"
+
+class CompositorExecutionTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  Render *re = nullptr;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    scene->r.xsch = 960;
+    scene->r.ysch = 540;
+    scene->r.size = 100;
+
+    re = RE_NewSceneRender(scene);
+    RE_InitState(re, NULL, &scene->r, &scene->view_layers, NULL, 960, 540, NULL);
+  }
+
+  virtual void TearDown()
+  {
+    RE_FreeRender(re);
+    COM_deinitialize();
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  static int test_break(void * /*handle*/)
+  {
+    return 0;
+  }
+  static void progress(void * /*handle*/, float /*progress*/)
+  {
+  }
+  static void stats_draw(void * /*handle*/, const char * /*str*/)
+  {
+  }
+
+  bNode *add_node(int type)
+  {
+    return nodeAddStaticNode(NULL, scene->nodetree, type);
+  }
+
+  void add_link(bNode *fromnode, int fromindex, bNode *tonode, int toindex)
+  {
+    nodeAddLink(scene->nodetree,
+                fromnode,
+                (bNodeSocket *)BLI_findlink(&fromnode->outputs, fromindex),
+                tonode,
+                (bNodeSocket *)BLI_findlink(&tonode->inputs, toindex));
+  }
+
+  /* Image -> Blur -> Glare -> Defocus -> Composite. */
+  void build_blur_glare_defocus_tree()
+  {
+    const float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    Image *image = BKE_image_add_generated(
+        bmain, 960, 540, "Grid", 32, true, IMA_GENTYPE_GRID_COLOR, color, false, false, false);
+
+    scene->nodetree = ntreeAddTree(NULL, "Compositing Nodetree", "CompositorNodeTree");
+    scene->use_nodes = true;
+    bNodeTree *ntree = scene->nodetree;
+    ntree->chunksize = 256;
+    ntree->test_break = test_break;
+    ntree->progress = progress;
+    ntree->stats_draw = stats_draw;
+
+    bNode *image_node = add_node(CMP_NODE_IMAGE);
+    image_node->id = &image->id;
+
+    bNode *blur = add_node(CMP_NODE_BLUR);
+    NodeBlurData *blur_data = (NodeBlurData *)blur->storage;
+    blur_data->sizex = blur_data->sizey = 20;
+
+    bNode *glare = add_node(CMP_NODE_GLARE);
+    ((NodeGlare *)glare->storage)->threshold = 0.5f;
+
+    bNode *defocus = add_node(CMP_NODE_DEFOCUS);
+    ((NodeDefocus *)defocus->storage)->scale = 8.0f;
+
+    bNode *composite = add_node(CMP_NODE_COMPOSITE);
+
+    add_link(image_node, 0, blur, 0);
+    add_link(blur, 0, glare, 0);
+    add_link(glare, 0, defocus, 0);
+    add_link(defocus, 0, composite, 0);
+
+    ntreeSetOutput(ntree);
+    ntreeUpdateTree(bmain, ntree);
+  }
+
+  double execute(bool full_frame, std::vector<float> &r_result)
+  {
+    if (full_frame) {
+      scene->nodetree->flag |= NTREE_COM_FULL_FRAME;
+    }
+    else {
+      scene->nodetree->flag &= ~NTREE_COM_FULL_FRAME;
+    }
+
+    const double start_time = PIL_check_seconds_timer();
+    COM_execute(
+        &scene->r, scene, scene->nodetree, true, &scene->view_settings, &scene->display_settings, "");
+    const double time = PIL_check_seconds_timer() - start_time;
+
+    RenderResult rres;
+    RE_AcquireResultImage(re, &rres, 0);
+    if (rres.rectf) {
+      r_result.assign(rres.rectf, rres.rectf + rres.rectx * rres.recty * 4);
+    }
+    RE_ReleaseResultImage(re);
+    return time;
+  }
+};
+
+TEST_F(CompositorExecutionTest, FullFrameBlurGlareDefocus)
+{
+  build_blur_glare_defocus_tree();
+
+  std::vector<float> result_tiled, result_full_frame;
+  /* Warm up, initializing the work scheduler and image buffers. */
+  execute(false, result_tiled);
+
+  const double time_tiled = execute(false, result_tiled);
+  const double time_full_frame = execute(true, result_full_frame);
+
+  ASSERT_EQ((size_t)960 * 540 * 4, result_tiled.size());
+  ASSERT_EQ(result_tiled.size(), result_full_frame.size());
+
+  float max_diff = 0.0f;
+  for (size_t i = 0; i < result_tiled.size(); i++) {
+    max_diff = fmaxf(max_diff, fabsf(result_tiled[i] - result_full_frame[i]));
+  }
+  EXPECT_LT(max_diff, 1e-4f);
+
+  printf("blur, glare & defocus %dx%d: tiled %.3fs, full frame %.3fs\n",
+         scene->r.xsch,
+         scene->r.ysch,
+         time_tiled,
+         time_full_frame);
+}
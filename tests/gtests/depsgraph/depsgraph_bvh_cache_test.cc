@@ -0,0 +1,182 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/mesh_grid_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_bvhutils.h"
+#include "BKE_customdata.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
+#include "BKE_modifier.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_linklist.h"
+#include "BLI_listbase.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define TARGET_GRID_SIZE 300
+#define WRAP_GRID_SIZE 100
+#define WRAP_OBJECTS_NUM 3
+#define FRAMES_NUM 10
+
+class DepsgraphBVHCacheTest : public MeshGridBaseTest {
+ protected:
+  Object *target = nullptr;
+  Object *wraps[WRAP_OBJECTS_NUM];
+
+  /* Grid of quads spanning 10 units at the given height. */
+  Object *add_grid_object(const char *name, int grid_size, float height)
+  {
+    Object *ob = grid_object_add(name, grid_size);
+    Mesh *mesh = (Mesh *)ob->data;
+
+    const float scale = 10.0f / grid_size;
+    for (int v = 0; v < mesh->totvert; v++) {
+      MVert *mvert = &mesh->mvert[v];
+      mvert->co[0] = mvert->co[0] * scale - 5.0f;
+      mvert->co[1] = mvert->co[1] * scale - 5.0f;
+      mvert->co[2] = height;
+    }
+    BKE_mesh_calc_normals(mesh);
+    return ob;
+  }
+
+  /* Target animated by a wave, with objects above it shrink-wrapped to its surface.
+   * The target also has a disabled mirror modifier, to change its topology. */
+  void build_scene()
+  {
+    target = add_grid_object("Target", TARGET_GRID_SIZE, 0.0f);
+    BLI_addtail(&target->modifiers, modifier_new(eModifierType_Wave));
+    ModifierData *mirror = modifier_new(eModifierType_Mirror);
+    mirror->mode &= ~eModifierMode_Realtime;
+    BLI_addtail(&target->modifiers, mirror);
+
+    for (int i = 0; i < WRAP_OBJECTS_NUM; i++) {
+      wraps[i] = add_grid_object("Wrap", WRAP_GRID_SIZE, 1.0f + i);
+      ShrinkwrapModifierData *smd = (ShrinkwrapModifierData *)modifier_new(
+          eModifierType_Shrinkwrap);
+      smd->shrinkType = MOD_SHRINKWRAP_NEAREST_SURFACE;
+      smd->target = target;
+      BLI_addtail(&wraps[i]->modifiers, smd);
+    }
+
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  Mesh *target_mesh_eval()
+  {
+    Object *ob_eval = DEG_get_evaluated_object(depsgraph, target);
+    return BKE_object_get_evaluated_mesh(depsgraph, ob_eval);
+  }
+
+  /* Evaluate a frame and append the evaluated vertex positions of the wrapped objects,
+   * returns the time taken. */
+  double evaluate_frame(int cfra, std::vector<float> &r_positions)
+  {
+    scene->r.cfra = cfra;
+    const double start_time = PIL_check_seconds_timer();
+    DEG_evaluate_on_framechange(bmain, depsgraph, (float)cfra);
+    const double time = PIL_check_seconds_timer() - start_time;
+
+    for (int i = 0; i < WRAP_OBJECTS_NUM; i++) {
+      Object *ob_eval = DEG_get_evaluated_object(depsgraph, wraps[i]);
+      const Mesh *me_eval = BKE_object_get_evaluated_mesh(depsgraph, ob_eval);
+      for (int v = 0; v < me_eval->totvert; v++) {
+        r_positions.insert(r_positions.end(), me_eval->mvert[v].co, me_eval->mvert[v].co + 3);
+      }
+    }
+    return time;
+  }
+};
+
+TEST_F(DepsgraphBVHCacheTest, ShrinkwrapAnimatedTarget)
+{
+  build_scene();
+
+  /* Trees of the target are built again every frame when dropped between frames. */
+  std::vector<float> positions_rebuilt;
+  double time_rebuilt = 0.0;
+  for (int cfra = 1; cfra <= FRAMES_NUM; cfra++) {
+    Mesh *me_eval = target_mesh_eval();
+    bvhcache_free(&me_eval->runtime.bvh_cache);
+    bvhcache_free(&me_eval->runtime.bvh_cache_prev);
+    time_rebuilt += evaluate_frame(cfra, positions_rebuilt);
+  }
+
+  /* Otherwise the same tree is refitted every frame and shared by all wrapped objects. */
+  std::vector<float> positions_refit;
+  double time_refit = 0.0;
+  BVHTree *tree_first = nullptr;
+  for (int cfra = 1; cfra <= FRAMES_NUM; cfra++) {
+    time_refit += evaluate_frame(cfra, positions_refit);
+
+    Mesh *me_eval = target_mesh_eval();
+    BVHTree *tree = nullptr;
+    ASSERT_TRUE(bvhcache_find(me_eval->runtime.bvh_cache, BVHTREE_FROM_LOOPTRI, &tree));
+    ASSERT_NE(tree, nullptr);
+    EXPECT_EQ(BLI_linklist_count(me_eval->runtime.bvh_cache), 1);
+    if (tree_first == nullptr) {
+      tree_first = tree;
+    }
+    EXPECT_EQ(tree, tree_first);
+  }
+
+  ASSERT_EQ(positions_rebuilt.size(), positions_refit.size());
+  for (size_t i = 0; i < positions_rebuilt.size(); i++) {
+    ASSERT_NEAR(positions_rebuilt[i], positions_refit[i], 1e-5f);
+  }
+
+  /* Changed topology can't use the previous trees. */
+  ModifierData *mirror = modifiers_findByType(target, eModifierType_Mirror);
+  mirror->mode |= eModifierMode_Realtime;
+  DEG_id_tag_update_ex(bmain, &target->id, ID_RECALC_GEOMETRY);
+  std::vector<float> positions;
+  evaluate_frame(FRAMES_NUM, positions);
+  Mesh *me_eval = target_mesh_eval();
+  BVHTree *tree = nullptr;
+  ASSERT_TRUE(bvhcache_find(me_eval->runtime.bvh_cache, BVHTREE_FROM_LOOPTRI, &tree));
+  EXPECT_GT(BKE_mesh_runtime_looptri_len(me_eval), 2 * TARGET_GRID_SIZE * TARGET_GRID_SIZE);
+  EXPECT_EQ(BLI_bvhtree_get_len(tree), BKE_mesh_runtime_looptri_len(me_eval));
+
+  printf("%d objects wrapped to %d faces: %.2f ms per frame building trees, %.2f ms refitting\n",
+         WRAP_OBJECTS_NUM,
+         TARGET_GRID_SIZE * TARGET_GRID_SIZE,
+         time_rebuilt / FRAMES_NUM * 1e3,
+         time_refit / FRAMES_NUM * 1e3);
+}
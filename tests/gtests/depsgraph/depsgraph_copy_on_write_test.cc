@@ -0,0 +1,204 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/mesh_grid_base_test.h"
+
+extern "C" {
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_object.h"
+#include "BKE_object_deform.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define GRID_SIZE 400
+#define EDITS_NUM 20
+
+class DepsgraphCopyOnWriteTest : public MeshGridBaseTest {
+ protected:
+  Object *object = nullptr;
+  Mesh *mesh = nullptr;
+
+  /* Grid of quads with a vertex group and UV map, as a large mesh being weight painted. */
+  void build_mesh()
+  {
+    object = grid_object_add("Object", GRID_SIZE);
+    mesh = (Mesh *)object->data;
+    BKE_object_defgroup_add_name(object, "Group");
+
+    CustomData_add_layer(&mesh->vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, mesh->totvert);
+    CustomData_add_layer_named(&mesh->ldata, CD_MLOOPUV, CD_CALLOC, NULL, mesh->totloop, "UV");
+    BKE_mesh_update_customdata_pointers(mesh, false);
+
+    for (int v = 0; v < mesh->totvert; v++) {
+      MDeformVert *dvert = &mesh->dvert[v];
+      dvert->dw = (MDeformWeight *)MEM_callocN(sizeof(MDeformWeight), __func__);
+      dvert->dw->weight = 1.0f;
+      dvert->totweight = 1;
+    }
+
+    BKE_mesh_calc_normals(mesh);
+  }
+
+  /* Layers are only shared by the active depsgraph, as used for the viewport. */
+  void build_depsgraph(bool is_active = true)
+  {
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    if (is_active) {
+      DEG_make_active(depsgraph);
+    }
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  Mesh *mesh_eval()
+  {
+    return (Mesh *)DEG_get_evaluated_id(depsgraph, &mesh->id);
+  }
+
+  /* Edit a property of the original and update, returns the time taken. */
+  double edit_weight(int index, float weight)
+  {
+    const double start_time = PIL_check_seconds_timer();
+    mesh->dvert[index].dw->weight = weight;
+    DEG_id_tag_update_ex(bmain, &mesh->id, ID_RECALC_GEOMETRY);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+    return PIL_check_seconds_timer() - start_time;
+  }
+};
+
+TEST_F(DepsgraphCopyOnWriteTest, SharedLayers)
+{
+  build_mesh();
+  build_depsgraph();
+
+  Mesh *me_eval = mesh_eval();
+  ASSERT_NE(me_eval, mesh);
+  EXPECT_EQ(me_eval->mvert, mesh->mvert);
+  EXPECT_EQ(me_eval->dvert, mesh->dvert);
+  EXPECT_EQ(me_eval->mloop, mesh->mloop);
+  EXPECT_TRUE(CustomData_has_referenced(&me_eval->vdata));
+
+  /* Edits of the original are seen after the update, still without copying. */
+  edit_weight(10, 0.25f);
+  me_eval = mesh_eval();
+  EXPECT_EQ(me_eval->dvert, mesh->dvert);
+  EXPECT_EQ(me_eval->dvert[10].dw->weight, 0.25f);
+
+  /* The original owns its layers, it keeps its data pointers when modifying them. */
+  MVert *mvert = mesh->mvert;
+  BKE_mesh_calc_normals(mesh);
+  EXPECT_EQ(mesh->mvert, mvert);
+  EXPECT_EQ(CustomData_duplicate_referenced_layer(&mesh->vdata, CD_MDEFORMVERT, mesh->totvert),
+            mesh->dvert);
+  EXPECT_FALSE(CustomData_has_referenced(&mesh->vdata));
+  EXPECT_EQ(me_eval->mvert, mesh->mvert);
+
+  /* Modifying the evaluated copy makes its own copy first. */
+  MDeformVert *dvert_eval = (MDeformVert *)CustomData_duplicate_referenced_layer(
+      &me_eval->vdata, CD_MDEFORMVERT, me_eval->totvert);
+  ASSERT_NE(dvert_eval, mesh->dvert);
+  EXPECT_NE(dvert_eval[10].dw, mesh->dvert[10].dw);
+  dvert_eval[10].dw->weight = 0.75f;
+  EXPECT_EQ(mesh->dvert[10].dw->weight, 0.25f);
+
+  /* Removing the layer from the original keeps it alive for the evaluated copy. */
+  const MVert *mvert_eval = me_eval->mvert;
+  CustomData_free_layers(&mesh->vdata, CD_MVERT, mesh->totvert);
+  BKE_mesh_update_customdata_pointers(mesh, false);
+  EXPECT_EQ(mesh->mvert, nullptr);
+  EXPECT_EQ(mvert_eval[mesh->totvert - 1].co[0], (float)GRID_SIZE);
+  EXPECT_EQ(mvert_eval[mesh->totvert - 1].co[1], (float)GRID_SIZE);
+}
+
+TEST_F(DepsgraphCopyOnWriteTest, InactiveCopies)
+{
+  build_mesh();
+  build_depsgraph(false);
+
+  /* May be evaluated from another thread while the original is edited. */
+  Mesh *me_eval = mesh_eval();
+  EXPECT_NE(me_eval->mvert, mesh->mvert);
+  EXPECT_NE(me_eval->dvert, mesh->dvert);
+  EXPECT_FALSE(CustomData_has_referenced(&me_eval->vdata));
+  EXPECT_FALSE(CustomData_has_referenced(&mesh->vdata));
+
+  edit_weight(10, 0.25f);
+  me_eval = mesh_eval();
+  EXPECT_NE(me_eval->dvert, mesh->dvert);
+  EXPECT_EQ(me_eval->dvert[10].dw->weight, 0.25f);
+}
+
+TEST_F(DepsgraphCopyOnWriteTest, EditBenchmark)
+{
+  build_mesh();
+
+  /* Copy of the mesh as done by copy-on-write updates, without and with shared layers. */
+  const int copy_flag = LIB_ID_COPY_LOCALIZE;
+  double copy_times[2];
+  size_t copy_memory[2];
+  for (int i = 0; i < 2; i++) {
+    const size_t memory_start = MEM_get_memory_in_use();
+    const double start_time = PIL_check_seconds_timer();
+    Mesh *me_copy = nullptr;
+    BKE_id_copy_ex(nullptr,
+                   &mesh->id,
+                   (ID **)&me_copy,
+                   (i == 0) ? copy_flag : (copy_flag | LIB_ID_COPY_CD_SHARE));
+    copy_times[i] = PIL_check_seconds_timer() - start_time;
+    copy_memory[i] = MEM_get_memory_in_use() - memory_start;
+    BKE_id_free(nullptr, me_copy);
+  }
+  EXPECT_LT(copy_memory[1] * 100, copy_memory[0]);
+
+  const size_t memory_start = MEM_get_memory_in_use();
+  build_depsgraph();
+
+  double edit_time = 0.0;
+  for (int i = 0; i < EDITS_NUM; i++) {
+    edit_time += edit_weight(i, 0.5f);
+  }
+  const size_t memory_evaluated = MEM_get_memory_in_use() - memory_start;
+  EXPECT_LT(memory_evaluated, copy_memory[0]);
+  EXPECT_EQ(mesh_eval()->dvert[EDITS_NUM - 1].dw->weight, 0.5f);
+
+  printf("Mesh with %d faces: copy %.2f ms / %.2f MB, shared copy %.3f ms / %.3f MB, "
+         "weight edit update %.2f ms, evaluated state %.2f MB\n",
+         mesh->totpoly,
+         copy_times[0] * 1e3,
+         copy_memory[0] / (1024.0 * 1024.0),
+         copy_times[1] * 1e3,
+         copy_memory[1] / (1024.0 * 1024.0),
+         edit_time / EDITS_NUM * 1e3,
+         memory_evaluated / (1024.0 * 1024.0));
+}
@@ -0,0 +1,254 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/blendfile_loading_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "BKE_action.h"
+#include "BKE_animsys.h"
+#include "BKE_armature.h"
+#include "BKE_fcurve.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+#include "BLI_trace.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define CHAINS_NUM 50
+#define CHAIN_BONES_NUM 10
+#define FRAMES_NUM 100
+
+class DepsgraphEvalTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  ViewLayer *view_layer = nullptr;
+  Object *rig = nullptr;
+
+  virtual void SetUp()
+  {
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    view_layer = (ViewLayer *)scene->view_layers.first;
+  }
+
+  virtual void TearDown()
+  {
+    depsgraph_free();
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+
+  static void bone_name(char *name, size_t name_len, int chain, int index)
+  {
+    BLI_snprintf(name, name_len, "Bone %d.%d", chain, index);
+  }
+
+  static void bone_path(char *path, size_t path_len, int chain, int index)
+  {
+    char name[MAXBONENAME];
+    bone_name(name, sizeof(name), chain, index);
+    BLI_snprintf(path, path_len, "pose.bones[\"%s\"].rotation_euler", name);
+  }
+
+  static FCurve *add_fcurve(ListBase *curves, const char *rna_path, int array_index)
+  {
+    FCurve *fcu = (FCurve *)MEM_callocN(sizeof(FCurve), __func__);
+    fcu->flag = (FCURVE_VISIBLE | FCURVE_SELECTED);
+    fcu->rna_path = BLI_strdup(rna_path);
+    fcu->array_index = array_index;
+    BLI_addtail(curves, fcu);
+    return fcu;
+  }
+
+  static void add_linear_keys(FCurve *fcu, float value_start, float value_end)
+  {
+    fcu->totvert = 2;
+    fcu->bezt = (BezTriple *)MEM_callocN(sizeof(BezTriple) * 2, __func__);
+    for (int i = 0; i < 2; i++) {
+      BezTriple *bezt = &fcu->bezt[i];
+      bezt->vec[1][0] = (i == 0) ? 1.0f : FRAMES_NUM;
+      bezt->vec[1][1] = (i == 0) ? value_start : value_end;
+      bezt->ipo = BEZT_IPO_LIN;
+      bezt->h1 = bezt->h2 = HD_AUTO_ANIM;
+    }
+    calchandles_fcurve(fcu);
+  }
+
+  /* Rig with chains of bones. Every bone has an animated X rotation, and bones in the chain have
+   * a driver which derives their Z rotation from the X rotation of their parent. This gives many
+   * small bone and driver operations, as in character rigs. */
+  void build_rig()
+  {
+    rig = BKE_object_add(bmain, scene, view_layer, OB_ARMATURE, "Rig");
+    bArmature *arm = (bArmature *)rig->data;
+
+    for (int chain = 0; chain < CHAINS_NUM; chain++) {
+      Bone *parent = nullptr;
+      for (int i = 0; i < CHAIN_BONES_NUM; i++) {
+        Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+        bone_name(bone->name, sizeof(bone->name), chain, i);
+        bone->parent = parent;
+        bone->layer = 1;
+        bone->weight = 1.0f;
+        bone->dist = 0.25f;
+        bone->rad_head = bone->rad_tail = 0.1f;
+        bone->segments = 1;
+        if (parent) {
+          bone->flag |= BONE_CONNECTED;
+        }
+        else {
+          bone->head[0] = (float)chain;
+        }
+        bone->tail[0] = bone->head[0];
+        bone->tail[1] = bone->head[1] + 1.0f;
+        BLI_addtail(parent ? &parent->childbase : &arm->bonebase, bone);
+        parent = bone;
+      }
+    }
+    BKE_armature_where_is(arm);
+    BKE_pose_rebuild(bmain, rig, arm, true);
+
+    LISTBASE_FOREACH (bPoseChannel *, pchan, &rig->pose->chanbase) {
+      pchan->rotmode = ROT_MODE_XYZ;
+    }
+
+    AnimData *adt = BKE_animdata_add_id(&rig->id);
+    adt->action = BKE_action_add(bmain, "Action");
+
+    for (int chain = 0; chain < CHAINS_NUM; chain++) {
+      for (int i = 0; i < CHAIN_BONES_NUM; i++) {
+        char path[MAXBONENAME + 64];
+        bone_path(path, sizeof(path), chain, i);
+
+        FCurve *fcu = add_fcurve(&adt->action->curves, path, 0);
+        add_linear_keys(fcu, 0.0f, 0.01f * (chain + i));
+
+        if (i == 0) {
+          continue;
+        }
+
+        FCurve *driver_fcu = add_fcurve(&adt->drivers, path, 2);
+        ChannelDriver *driver = (ChannelDriver *)MEM_callocN(sizeof(ChannelDriver), __func__);
+        driver->type = DRIVER_TYPE_PYTHON;
+        BLI_strncpy(driver->expression, "var * 0.5 + 0.1", sizeof(driver->expression));
+        driver_fcu->driver = driver;
+
+        char parent_path[MAXBONENAME + 64];
+        bone_path(parent_path, sizeof(parent_path), chain, i - 1);
+        DriverVar *dvar = driver_add_new_variable(driver);
+        driver_change_variable_type(dvar, DVAR_TYPE_SINGLE_PROP);
+        dvar->targets[0].id = &rig->id;
+        dvar->targets[0].idtype = ID_OB;
+        dvar->targets[0].rna_path = BLI_sprintfN("%s[0]", parent_path);
+      }
+    }
+  }
+
+  /* Evaluate all frames, returns frames per second. */
+  double evaluate_frames(bool threaded, std::vector<float> &r_pose_mats)
+  {
+    const int debug_backup = G.debug;
+    if (!threaded) {
+      G.debug |= G_DEBUG_DEPSGRAPH_NO_THREADS;
+    }
+
+    const double start_time = PIL_check_seconds_timer();
+    for (int cfra = 1; cfra <= FRAMES_NUM; cfra++) {
+      scene->r.cfra = cfra;
+      DEG_evaluate_on_framechange(bmain, depsgraph, (float)cfra);
+    }
+    const double fps = FRAMES_NUM / (PIL_check_seconds_timer() - start_time);
+
+    G.debug = debug_backup;
+
+    r_pose_mats.clear();
+    Object *rig_eval = DEG_get_evaluated_object(depsgraph, rig);
+    LISTBASE_FOREACH (bPoseChannel *, pchan, &rig_eval->pose->chanbase) {
+      r_pose_mats.insert(r_pose_mats.end(), &pchan->pose_mat[0][0], &pchan->pose_mat[0][0] + 16);
+    }
+    return fps;
+  }
+};
+
+TEST_F(DepsgraphEvalTest, RigBenchmark)
+{
+  build_rig();
+
+  depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+  DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+  BKE_scene_graph_update_tagged(depsgraph, bmain);
+
+  std::vector<float> result_single, result_threaded;
+  /* Warm up, this gathers the operation costs used for scheduling. */
+  evaluate_frames(true, result_threaded);
+
+  const double fps_single = evaluate_frames(false, result_single);
+  const double fps_threaded = evaluate_frames(true, result_threaded);
+
+  std::vector<float> result_traced;
+  BLI_trace_begin();
+  const double fps_traced = evaluate_frames(true, result_traced);
+  BLI_trace_end();
+  BLI_trace_free();
+
+  ASSERT_EQ((size_t)CHAINS_NUM * CHAIN_BONES_NUM * 16, result_single.size());
+  EXPECT_EQ(result_single, result_threaded);
+  EXPECT_EQ(result_single, result_traced);
+
+  /* Drivers are evaluated after the animation of the last frame. */
+  const Object *rig_eval = DEG_get_evaluated_object(depsgraph, rig);
+  char name[MAXBONENAME];
+  bone_name(name, sizeof(name), CHAINS_NUM - 1, CHAIN_BONES_NUM - 2);
+  const bPoseChannel *parent = BKE_pose_channel_find_name(rig_eval->pose, name);
+  bone_name(name, sizeof(name), CHAINS_NUM - 1, CHAIN_BONES_NUM - 1);
+  const bPoseChannel *pchan = BKE_pose_channel_find_name(rig_eval->pose, name);
+  ASSERT_NE(parent, nullptr);
+  ASSERT_NE(pchan, nullptr);
+  EXPECT_NEAR(parent->eul[0], 0.01f * (CHAINS_NUM + CHAIN_BONES_NUM - 3), 1e-6f);
+  EXPECT_NEAR(pchan->eul[2], parent->eul[0] * 0.5f + 0.1f, 1e-6f);
+
+  printf("%d bones over %d frames: single threaded %.2f fps, threaded %.2f fps, "
+         "threaded with trace recording %.2f fps (%.1f%% overhead)\n",
+         CHAINS_NUM * CHAIN_BONES_NUM,
+         FRAMES_NUM,
+         fps_single,
+         fps_threaded,
+         fps_traced,
+         (fps_threaded / fps_traced - 1.0) * 100.0);
+}
@@ -0,0 +1,330 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+#include "blenloader/mesh_grid_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_action.h"
+#include "BKE_animsys.h"
+#include "BKE_armature.h"
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_fcurve.h"
+#include "BKE_library.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_modifier_cache.h"
+#include "BKE_object.h"
+#include "BKE_object_deform.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+#define GRID_SIZE 100
+#define FRAMES_NUM 20
+
+class DepsgraphModifierCacheTest : public MeshGridBaseTest {
+ protected:
+  Object *rig = nullptr;
+  Object *object = nullptr;
+  size_t memory_limit = 0;
+
+  virtual void SetUp()
+  {
+    MeshGridBaseTest::SetUp();
+    memory_limit = BKE_modifier_cache_memory_limit_get();
+    BKE_modifier_cache_clear();
+    BKE_modifier_cache_stats_reset();
+  }
+
+  virtual void TearDown()
+  {
+    MeshGridBaseTest::TearDown();
+    BKE_modifier_cache_clear();
+    BKE_modifier_cache_memory_limit_set(memory_limit);
+  }
+
+  /* Armature with a single bone rotating over the frames. */
+  void build_rig()
+  {
+    rig = BKE_object_add(bmain, scene, view_layer, OB_ARMATURE, "Rig");
+    bArmature *arm = (bArmature *)rig->data;
+
+    Bone *bone = (Bone *)MEM_callocN(sizeof(Bone), __func__);
+    BLI_strncpy(bone->name, "Bone", sizeof(bone->name));
+    bone->layer = 1;
+    bone->weight = 1.0f;
+    bone->segments = 1;
+    bone->tail[0] = (float)GRID_SIZE;
+    BLI_addtail(&arm->bonebase, bone);
+    BKE_armature_where_is(arm);
+    BKE_pose_rebuild(bmain, rig, arm, true);
+
+    bPoseChannel *pchan = (bPoseChannel *)rig->pose->chanbase.first;
+    pchan->rotmode = ROT_MODE_XYZ;
+
+    AnimData *adt = BKE_animdata_add_id(&rig->id);
+    adt->action = BKE_action_add(bmain, "Action");
+
+    FCurve *fcu = (FCurve *)MEM_callocN(sizeof(FCurve), __func__);
+    fcu->flag = (FCURVE_VISIBLE | FCURVE_SELECTED);
+    fcu->rna_path = BLI_strdup("pose.bones[\"Bone\"].rotation_euler");
+    BLI_addtail(&adt->action->curves, fcu);
+
+    fcu->totvert = 2;
+    fcu->bezt = (BezTriple *)MEM_callocN(sizeof(BezTriple) * 2, __func__);
+    for (int i = 0; i < 2; i++) {
+      BezTriple *bezt = &fcu->bezt[i];
+      bezt->vec[1][0] = (i == 0) ? 1.0f : FRAMES_NUM;
+      bezt->vec[1][1] = (i == 0) ? 0.0f : 1.0f;
+      bezt->ipo = BEZT_IPO_LIN;
+      bezt->h1 = bezt->h2 = HD_AUTO_ANIM;
+    }
+    calchandles_fcurve(fcu);
+  }
+
+  /* Grid with weights increasing along the bone of the rig. */
+  void build_grid()
+  {
+    object = grid_object_add("Object", GRID_SIZE);
+    Mesh *mesh = (Mesh *)object->data;
+    BKE_object_defgroup_add_name(object, "Bone");
+
+    CustomData_add_layer(&mesh->vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, mesh->totvert);
+    BKE_mesh_update_customdata_pointers(mesh, false);
+
+    for (int v = 0; v < mesh->totvert; v++) {
+      defvert_add_index_notest(&mesh->dvert[v], 0, mesh->mvert[v].co[0] / GRID_SIZE);
+    }
+    BKE_mesh_calc_normals(mesh);
+  }
+
+  /* Grid deformed by the rig, followed by constructive modifiers. */
+  void build_object()
+  {
+    build_grid();
+
+    ArmatureModifierData *amd = (ArmatureModifierData *)modifier_new(eModifierType_Armature);
+    amd->object = rig;
+    BLI_addtail(&object->modifiers, amd);
+
+    SolidifyModifierData *smd = (SolidifyModifierData *)modifier_new(eModifierType_Solidify);
+    smd->offset = 0.5f;
+    BLI_addtail(&object->modifiers, smd);
+
+    BLI_addtail(&object->modifiers, modifier_new(eModifierType_Triangulate));
+  }
+
+  void build_depsgraph()
+  {
+    depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
+  }
+
+  /* Evaluate a frame and append the evaluated vertex positions. */
+  void evaluate_frame(int cfra, std::vector<float> &r_positions)
+  {
+    scene->r.cfra = cfra;
+    DEG_evaluate_on_framechange(bmain, depsgraph, (float)cfra);
+
+    Object *ob_eval = DEG_get_evaluated_object(depsgraph, object);
+    const Mesh *me_eval = BKE_object_get_evaluated_mesh(depsgraph, ob_eval);
+    for (int i = 0; i < me_eval->totvert; i++) {
+      r_positions.insert(r_positions.end(), me_eval->mvert[i].co, me_eval->mvert[i].co + 3);
+    }
+  }
+
+  void append_loops(const Mesh *me, std::vector<int> &r_loops)
+  {
+    for (int i = 0; i < me->totloop; i++) {
+      r_loops.push_back(me->mloop[i].v);
+    }
+  }
+
+  /* Evaluate frames forward and then backward, returns the time of both passes. */
+  void scrub(std::vector<float> &r_positions, double r_times[2])
+  {
+    r_positions.clear();
+    double start_time = PIL_check_seconds_timer();
+    for (int cfra = 1; cfra <= FRAMES_NUM; cfra++) {
+      evaluate_frame(cfra, r_positions);
+    }
+    r_times[0] = PIL_check_seconds_timer() - start_time;
+
+    start_time = PIL_check_seconds_timer();
+    for (int cfra = FRAMES_NUM; cfra >= 1; cfra--) {
+      evaluate_frame(cfra, r_positions);
+    }
+    r_times[1] = PIL_check_seconds_timer() - start_time;
+  }
+};
+
+TEST_F(DepsgraphModifierCacheTest, Scrubbing)
+{
+  build_rig();
+  build_object();
+  build_depsgraph();
+
+  std::vector<float> positions_uncached, positions_cached;
+  double times_uncached[2], times_cached[2];
+
+  BKE_modifier_cache_memory_limit_set(0);
+  scrub(positions_uncached, times_uncached);
+
+  ModifierCacheStats stats;
+  BKE_modifier_cache_stats_get(&stats);
+  EXPECT_EQ(stats.hits, 0);
+  EXPECT_EQ(stats.entries, 0);
+
+  BKE_modifier_cache_memory_limit_set(memory_limit);
+  scrub(positions_cached, times_cached);
+  ASSERT_FALSE(positions_uncached.empty());
+  EXPECT_EQ(positions_uncached, positions_cached);
+
+  /* Going backward every frame is found in the cache, both constructive modifiers are stored
+   * for every frame. */
+  BKE_modifier_cache_stats_get(&stats);
+  EXPECT_EQ(stats.hits, FRAMES_NUM);
+  EXPECT_EQ(stats.entries, 2 * FRAMES_NUM);
+  EXPECT_GT(stats.memory, (size_t)0);
+  EXPECT_LE(stats.memory, memory_limit);
+
+  printf("%d frames of %d faces: uncached %.2f ms, cached %.2f ms per frame scrubbing back\n",
+         FRAMES_NUM,
+         GRID_SIZE * GRID_SIZE,
+         times_uncached[1] / FRAMES_NUM * 1e3,
+         times_cached[1] / FRAMES_NUM * 1e3);
+}
+
+TEST_F(DepsgraphModifierCacheTest, Invalidation)
+{
+  build_rig();
+  build_object();
+  build_depsgraph();
+
+  std::vector<float> positions_first, positions;
+  evaluate_frame(1, positions_first);
+  BKE_modifier_cache_stats_reset();
+  ModifierCacheStats stats;
+  BKE_modifier_cache_stats_get(&stats);
+  const int entries_first = stats.entries;
+
+  /* Changed settings of the last modifier continue from the cached result before it. */
+  TriangulateModifierData *tmd = (TriangulateModifierData *)modifiers_findByType(
+      object, eModifierType_Triangulate);
+  const int quad_method = tmd->quad_method;
+  tmd->quad_method = (quad_method == MOD_TRIANGULATE_QUAD_FIXED) ? MOD_TRIANGULATE_QUAD_BEAUTY :
+                                                                   MOD_TRIANGULATE_QUAD_FIXED;
+  DEG_id_tag_update_ex(bmain, &object->id, ID_RECALC_GEOMETRY);
+  BKE_scene_graph_update_tagged(depsgraph, bmain);
+
+  BKE_modifier_cache_stats_get(&stats);
+  EXPECT_EQ(stats.hits, 1);
+  /* Results of edits at the same frame are not added. */
+  EXPECT_EQ(stats.entries, entries_first);
+
+  /* Changed input mesh misses the cache. */
+  BKE_modifier_cache_stats_reset();
+  Mesh *mesh = (Mesh *)object->data;
+  mesh->mvert[0].co[2] = 1.0f;
+  DEG_id_tag_update_ex(bmain, &mesh->id, ID_RECALC_GEOMETRY);
+  BKE_scene_graph_update_tagged(depsgraph, bmain);
+  BKE_modifier_cache_stats_get(&stats);
+  EXPECT_EQ(stats.hits, 0);
+
+  /* Restoring everything gives the first result back from the cache. */
+  mesh->mvert[0].co[2] = 0.0f;
+  DEG_id_tag_update_ex(bmain, &mesh->id, ID_RECALC_GEOMETRY);
+  tmd->quad_method = quad_method;
+  DEG_id_tag_update_ex(bmain, &object->id, ID_RECALC_GEOMETRY);
+  evaluate_frame(1, positions);
+  BKE_modifier_cache_stats_get(&stats);
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(positions_first, positions);
+}
+
+TEST_F(DepsgraphModifierCacheTest, InPlaceModifierAfterCachedStage)
+{
+  build_grid();
+  Mesh *mesh = (Mesh *)object->data;
+  mesh->flag |= ME_AUTOSMOOTH;
+
+#ifdef WITH_OPENSUBDIV
+  SubsurfModifierData *smd = (SubsurfModifierData *)modifier_new(eModifierType_Subsurf);
+  smd->levels = 1;
+  BLI_addtail(&object->modifiers, smd);
+#else
+  BLI_addtail(&object->modifiers, modifier_new(eModifierType_Triangulate));
+#endif
+
+  /* Radial normals pointing away from a center above the grid flip all faces, in place on the
+   * result of the cached stage before it. */
+  NormalEditModifierData *enmd = (NormalEditModifierData *)modifier_new(
+      eModifierType_NormalEdit);
+  enmd->offset[2] = 10.0f;
+  BLI_addtail(&object->modifiers, enmd);
+
+  build_depsgraph();
+  Object *ob_eval = DEG_get_evaluated_object(depsgraph, object);
+  std::vector<int> loops_first, loops_cached, loops;
+  append_loops(BKE_object_get_evaluated_mesh(depsgraph, ob_eval), loops_first);
+
+  ASSERT_EQ(ob_eval->runtime.modifier_cache_keys_num, 2);
+  ModifierCacheResult result;
+  ASSERT_TRUE(
+      BKE_modifier_cache_lookup(ob_eval->runtime.modifier_cache_keys[0], false, &result));
+  append_loops(result.mesh, loops_cached);
+  BKE_id_free(NULL, result.mesh);
+  ASSERT_FALSE(loops_first.empty());
+  EXPECT_NE(loops_first, loops_cached);
+
+  /* Edit the last modifier at the same frame, so it runs again on the cached result. */
+  BKE_modifier_cache_stats_reset();
+  enmd->offset[2] = 20.0f;
+  DEG_id_tag_update_ex(bmain, &object->id, ID_RECALC_GEOMETRY);
+  BKE_scene_graph_update_tagged(depsgraph, bmain);
+  append_loops(BKE_object_get_evaluated_mesh(depsgraph, ob_eval), loops);
+
+  ModifierCacheStats stats;
+  BKE_modifier_cache_stats_get(&stats);
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(loops_first, loops);
+}